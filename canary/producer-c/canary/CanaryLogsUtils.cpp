@@ -37,6 +37,20 @@ VOID setUpLogEventVector(PCHAR logString)
     }
 }
 
+// A rejected sequence token leaves the batch lost, but the expected token at the end of the message keeps later pushes going
+static VOID updateSequenceToken(PCloudwatchLogsObject pCloudwatchLogsObject, const Aws::CloudWatchLogs::Model::PutLogEventsOutcome& outcome)
+{
+    if (outcome.IsSuccess()) {
+        pCloudwatchLogsObject->token = outcome.GetResult().GetNextSequenceToken();
+    } else if (outcome.GetError().GetErrorType() == Aws::CloudWatchLogs::CloudWatchLogsErrors::INVALID_SEQUENCE_TOKEN) {
+        auto& message = outcome.GetError().GetMessage();
+        auto pos = message.rfind(' ');
+        if (pos != Aws::String::npos) {
+            pCloudwatchLogsObject->token = message.substr(pos + 1);
+        }
+    }
+}
+
 VOID onPutLogEventResponseReceivedHandler(const Aws::CloudWatchLogs::CloudWatchLogsClient* cwClientLog,
                                           const Aws::CloudWatchLogs::Model::PutLogEventsRequest& request,
                                           const Aws::CloudWatchLogs::Model::PutLogEventsOutcome& outcome,
@@ -46,8 +60,8 @@ VOID onPutLogEventResponseReceivedHandler(const Aws::CloudWatchLogs::CloudWatchL
         DLOGE("Failed to push logs: %s", outcome.GetError().GetMessage().c_str());
     } else {
         DLOGS("Successfully pushed logs to cloudwatch");
-        gCloudwatchLogsObject->token = outcome.GetResult().GetNextSequenceToken();
     }
+    updateSequenceToken(gCloudwatchLogsObject, outcome);
 }
 
 VOID canaryStreamSendLogs(PCloudwatchLogsObject pCloudwatchLogsObject)
@@ -81,6 +95,7 @@ VOID canaryStreamSendLogSync(PCloudwatchLogsObject pCloudwatchLogsObject)
     } else {
         DLOGS("Successfully pushed logs to cloudwatch");
     }
+    updateSequenceToken(pCloudwatchLogsObject, outcome);
     pCloudwatchLogsObject->canaryInputLogEventVec.clear();
 }
 
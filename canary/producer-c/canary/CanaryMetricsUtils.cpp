@@ -0,0 +1,267 @@
+/**
+ * Kinesis Video Producer canary metrics sinks
+ */
+#define LOG_CLASS "CanaryMetricsSink"
+#include "CanaryUtils.h"
+
+STATUS createCanaryMetricsSink(PCHAR sinkType, Aws::Client::ClientConfiguration& clientConfiguration, PCHAR filePrefix,
+                               PCanaryMetricsSink* ppMetricsSink)
+{
+    ENTERS();
+    STATUS retStatus = STATUS_SUCCESS;
+    PCanaryMetricsSink pMetricsSink = NULL;
+
+    CHK(sinkType != NULL && filePrefix != NULL && ppMetricsSink != NULL, STATUS_NULL_ARG);
+
+    // The sink holds C++ members, so it can't come from MEMCALLOC
+    pMetricsSink = new CanaryMetricsSink();
+    pMetricsSink->pCwClient = NULL;
+    pMetricsSink->batchStartTime = 0;
+    pMetricsSink->pendingRequests = 0;
+    pMetricsSink->terminate = FALSE;
+    pMetricsSink->pFile = NULL;
+    pMetricsSink->fileSize = 0;
+    pMetricsSink->fileIndex = 0;
+    STRNCPY(pMetricsSink->filePrefix, filePrefix, MAX_LOG_FILE_NAME_LEN);
+    pMetricsSink->filePrefix[MAX_LOG_FILE_NAME_LEN] = '\0';
+
+    if (STRCMPI(sinkType, CANARY_METRICS_SINK_CLOUDWATCH) == 0) {
+        pMetricsSink->type = CANARY_METRICS_SINK_TYPE_CLOUDWATCH;
+        pMetricsSink->pCwClient = new Aws::CloudWatch::CloudWatchClient(clientConfiguration);
+        pMetricsSink->flushThread = std::thread(canaryMetricsSinkFlushRoutine, pMetricsSink);
+    } else if (STRCMPI(sinkType, CANARY_METRICS_SINK_EMF) == 0) {
+        pMetricsSink->type = CANARY_METRICS_SINK_TYPE_EMF;
+    } else if (STRCMPI(sinkType, CANARY_METRICS_SINK_MEMORY) == 0) {
+        pMetricsSink->type = CANARY_METRICS_SINK_TYPE_MEMORY;
+    } else {
+        CHK_ERR(FALSE, STATUS_PRODUCER_UNKNOWN_METRICS_SINK, "Unknown metrics sink %s", sinkType);
+    }
+
+CleanUp:
+
+    if (STATUS_FAILED(retStatus)) {
+        freeCanaryMetricsSink(&pMetricsSink);
+    }
+
+    if (ppMetricsSink != NULL) {
+        *ppMetricsSink = pMetricsSink;
+    }
+
+    LEAVES();
+    return retStatus;
+}
+
+STATUS freeCanaryMetricsSink(PCanaryMetricsSink* ppMetricsSink)
+{
+    ENTERS();
+    STATUS retStatus = STATUS_SUCCESS;
+    PCanaryMetricsSink pMetricsSink = NULL;
+
+    CHK(ppMetricsSink != NULL, STATUS_NULL_ARG);
+
+    pMetricsSink = *ppMetricsSink;
+
+    // Call is idempotent
+    CHK(pMetricsSink != NULL, retStatus);
+
+    {
+        std::lock_guard<std::mutex> lock(pMetricsSink->mutex);
+        pMetricsSink->terminate = TRUE;
+    }
+    pMetricsSink->flushCvar.notify_one();
+    if (pMetricsSink->flushThread.joinable()) {
+        pMetricsSink->flushThread.join();
+    }
+
+    canaryMetricsSinkFlush(pMetricsSink);
+
+    // need to wait all metrics to be flushed out before the client goes away
+    // https://docs.aws.amazon.com/sdk-for-cpp/v1/developer-guide/basic-use.html
+    while (pMetricsSink->pendingRequests.load() > 0) {
+        THREAD_SLEEP(HUNDREDS_OF_NANOS_IN_A_MILLISECOND * 100);
+    }
+
+    if (pMetricsSink->pFile != NULL) {
+        fclose(pMetricsSink->pFile);
+    }
+
+    delete pMetricsSink->pCwClient;
+    delete pMetricsSink;
+
+    *ppMetricsSink = NULL;
+
+CleanUp:
+
+    LEAVES();
+    return retStatus;
+}
+
+VOID onPutMetricDataResponseReceivedHandler(const Aws::CloudWatch::CloudWatchClient* cwClient,
+                                            const Aws::CloudWatch::Model::PutMetricDataRequest& request,
+                                            const Aws::CloudWatch::Model::PutMetricDataOutcome& outcome,
+                                            const std::shared_ptr<const Aws::Client::AsyncCallerContext>& context)
+{
+    if (!outcome.IsSuccess()) {
+        DLOGE("Failed to put %u metric datums: %s", (UINT32) request.GetMetricData().size(), outcome.GetError().GetMessage().c_str());
+    } else {
+        DLOGS("Successfully put %u metric datums", (UINT32) request.GetMetricData().size());
+    }
+}
+
+// Writes the datum as a single line of CloudWatch embedded metric format
+static VOID canaryMetricsSinkWriteEmf(PCanaryMetricsSink pMetricsSink, Aws::CloudWatch::Model::MetricDatum& metricDatum)
+{
+    Aws::Utils::Json::JsonValue root, metadata, directive, metric;
+    auto& dimensions = metricDatum.GetDimensions();
+    auto& values = metricDatum.GetValues();
+    Aws::Utils::Array<Aws::Utils::Json::JsonValue> directives(1), metrics(1), dimensionSets(1), dimensionNames(dimensions.size());
+    CHAR filePath[MAX_PATH_LEN + 1];
+
+    for (size_t i = 0; i < dimensions.size(); i++) {
+        dimensionNames[i].AsString(dimensions[i].GetName());
+        root.WithString(dimensions[i].GetName(), dimensions[i].GetValue());
+    }
+    dimensionSets[0].AsArray(std::move(dimensionNames));
+
+    metric.WithString("Name", metricDatum.GetMetricName());
+    metric.WithString("Unit", Aws::CloudWatch::Model::StandardUnitMapper::GetNameForStandardUnit(metricDatum.GetUnit()));
+    metrics[0] = metric;
+
+    directive.WithString("Namespace", CANARY_CLOUDWATCH_NAMESPACE);
+    directive.WithArray("Dimensions", std::move(dimensionSets));
+    directive.WithArray("Metrics", std::move(metrics));
+    directives[0] = directive;
+
+    metadata.WithInt64("Timestamp", GETTIME() / HUNDREDS_OF_NANOS_IN_A_MILLISECOND);
+    metadata.WithArray("CloudWatchMetrics", std::move(directives));
+    root.WithObject("_aws", metadata);
+
+    if (values.empty()) {
+        root.WithDouble(metricDatum.GetMetricName(), metricDatum.GetValue());
+    } else {
+        Aws::Utils::Array<Aws::Utils::Json::JsonValue> samples(values.size());
+        for (size_t i = 0; i < values.size(); i++) {
+            samples[i].AsDouble(values[i]);
+        }
+        root.WithArray(metricDatum.GetMetricName(), std::move(samples));
+    }
+
+    auto line = root.View().WriteCompact() + "\n";
+
+    // Rotate by size and keep only the latest CANARY_MAX_NUMBER_OF_METRICS_FILES files. If opening a file fails, the sink stays off
+    if ((pMetricsSink->pFile == NULL && pMetricsSink->fileIndex == 0) || pMetricsSink->fileSize >= CANARY_METRICS_FILE_MAX_SIZE) {
+        if (pMetricsSink->pFile != NULL) {
+            fclose(pMetricsSink->pFile);
+            pMetricsSink->pFile = NULL;
+        }
+
+        if (pMetricsSink->fileIndex >= CANARY_MAX_NUMBER_OF_METRICS_FILES) {
+            SNPRINTF(filePath, MAX_PATH_LEN, "./%s.%u.metrics.json", pMetricsSink->filePrefix,
+                     pMetricsSink->fileIndex - CANARY_MAX_NUMBER_OF_METRICS_FILES);
+            remove(filePath);
+        }
+
+        SNPRINTF(filePath, MAX_PATH_LEN, "./%s.%u.metrics.json", pMetricsSink->filePrefix, pMetricsSink->fileIndex);
+        pMetricsSink->pFile = fopen(filePath, "w");
+        pMetricsSink->fileIndex++;
+        pMetricsSink->fileSize = 0;
+        if (pMetricsSink->pFile == NULL) {
+            DLOGE("Failed to open metrics file %s", filePath);
+        }
+    }
+
+    if (pMetricsSink->pFile == NULL) {
+        return;
+    }
+
+    fwrite(line.c_str(), 1, line.size(), pMetricsSink->pFile);
+    fflush(pMetricsSink->pFile);
+    pMetricsSink->fileSize += line.size();
+}
+
+VOID canaryMetricsSinkPut(PCanaryMetricsSink pMetricsSink, Aws::CloudWatch::Model::MetricDatum& metricDatum)
+{
+    BOOL flush = FALSE;
+
+    if (pMetricsSink == NULL) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(pMetricsSink->mutex);
+        switch (pMetricsSink->type) {
+            case CANARY_METRICS_SINK_TYPE_CLOUDWATCH:
+                if (pMetricsSink->batch.empty()) {
+                    pMetricsSink->batchStartTime = GETTIME();
+                }
+                pMetricsSink->batch.push_back(metricDatum);
+                flush = pMetricsSink->batch.size() >= CANARY_MAX_CLOUDWATCH_METRIC_DATUM_COUNT ||
+                    GETTIME() - pMetricsSink->batchStartTime >= CANARY_CLOUDWATCH_METRICS_FLUSH_PERIOD;
+                break;
+            case CANARY_METRICS_SINK_TYPE_EMF:
+                canaryMetricsSinkWriteEmf(pMetricsSink, metricDatum);
+                break;
+            case CANARY_METRICS_SINK_TYPE_MEMORY:
+                pMetricsSink->memoryData.push_back(metricDatum);
+                break;
+        }
+    }
+
+    if (flush) {
+        canaryMetricsSinkFlush(pMetricsSink);
+    }
+}
+
+VOID canaryMetricsSinkFlush(PCanaryMetricsSink pMetricsSink)
+{
+    Aws::CloudWatch::Model::PutMetricDataRequest cwRequest;
+    Aws::Vector<Aws::CloudWatch::Model::MetricDatum> pending;
+
+    if (pMetricsSink == NULL || pMetricsSink->type != CANARY_METRICS_SINK_TYPE_CLOUDWATCH) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(pMetricsSink->mutex);
+        pending.swap(pMetricsSink->batch);
+    }
+
+    if (pending.empty()) {
+        return;
+    }
+
+    cwRequest.SetNamespace(CANARY_CLOUDWATCH_NAMESPACE);
+    cwRequest.SetMetricData(pending);
+
+    pMetricsSink->pendingRequests++;
+    pMetricsSink->pCwClient->PutMetricDataAsync(cwRequest,
+                                                [pMetricsSink](const Aws::CloudWatch::CloudWatchClient* cwClient,
+                                                               const Aws::CloudWatch::Model::PutMetricDataRequest& request,
+                                                               const Aws::CloudWatch::Model::PutMetricDataOutcome& outcome,
+                                                               const std::shared_ptr<const Aws::Client::AsyncCallerContext>& context) {
+                                                    onPutMetricDataResponseReceivedHandler(cwClient, request, outcome, context);
+                                                    pMetricsSink->pendingRequests--;
+                                                });
+}
+
+// Flushes a partial batch once it gets old, also when no more datums come in to trigger it
+VOID canaryMetricsSinkFlushRoutine(PCanaryMetricsSink pMetricsSink)
+{
+    std::unique_lock<std::mutex> lock(pMetricsSink->mutex);
+    UINT64 now, wait;
+
+    while (!pMetricsSink->terminate) {
+        now = GETTIME();
+        if (!pMetricsSink->batch.empty() && now - pMetricsSink->batchStartTime >= CANARY_CLOUDWATCH_METRICS_FLUSH_PERIOD) {
+            lock.unlock();
+            canaryMetricsSinkFlush(pMetricsSink);
+            lock.lock();
+            continue;
+        }
+
+        // A batch started after this point is looked at one period later at the latest
+        wait = pMetricsSink->batch.empty() ? CANARY_CLOUDWATCH_METRICS_FLUSH_PERIOD
+                                           : pMetricsSink->batchStartTime + CANARY_CLOUDWATCH_METRICS_FLUSH_PERIOD - now;
+        pMetricsSink->flushCvar.wait_for(lock, std::chrono::milliseconds(MAX(wait / HUNDREDS_OF_NANOS_IN_A_MILLISECOND, 1)));
+    }
+}
@@ -4,7 +4,7 @@
 #define LOG_CLASS "CanaryStreamCallbacks"
 #include "CanaryUtils.h"
 
-STATUS createCanaryStreamCallbacks(Aws::CloudWatch::CloudWatchClient* cwClient, PCHAR pStreamName, PCHAR canaryLabel, PCanaryStreamCallbacks* ppCanaryStreamCallbacks)
+STATUS createCanaryStreamCallbacks(PCanaryMetricsSink pMetricsSink, PCHAR pStreamName, PCHAR canaryLabel, PCanaryStreamCallbacks* ppCanaryStreamCallbacks)
 {
     ENTERS();
     STATUS retStatus = STATUS_SUCCESS;
@@ -22,7 +22,7 @@ STATUS createCanaryStreamCallbacks(Aws::CloudWatch::CloudWatchClient* cwClient,
     pCanaryStreamCallbacks->streamCallbacks.customData = (UINT64) pCanaryStreamCallbacks;
     pCanaryStreamCallbacks->timeOfNextKeyFrame = new std::map<UINT64, UINT64>();
 
-    pCanaryStreamCallbacks->pCwClient = cwClient;
+    pCanaryStreamCallbacks->pMetricsSink = pMetricsSink;
 
     pCanaryStreamCallbacks->dimensionPerStream.SetName("ProducerSDKCanaryStreamName");
     pCanaryStreamCallbacks->dimensionPerStream.SetValue(pStreamName);
@@ -232,24 +232,9 @@ STATUS canaryStreamFragmentAckHandler(UINT64 customData, STREAM_HANDLE streamHan
     return STATUS_SUCCESS;
 }
 
-VOID onPutMetricDataResponseReceivedHandler(const Aws::CloudWatch::CloudWatchClient* cwClient,
-                                            const Aws::CloudWatch::Model::PutMetricDataRequest& request,
-                                            const Aws::CloudWatch::Model::PutMetricDataOutcome& outcome,
-                                            const std::shared_ptr<const Aws::Client::AsyncCallerContext>& context)
-{
-    if (!outcome.IsSuccess()) {
-        DLOGE("Failed to put sample metric data: %s", outcome.GetError().GetMessage().c_str());
-    } else {
-        DLOGS("Successfully put sample metric data");
-    }
-}
-
 VOID canaryStreamSendMetrics(PCanaryStreamCallbacks pCanaryStreamCallbacks, Aws::CloudWatch::Model::MetricDatum& metricDatum)
 {
-    Aws::CloudWatch::Model::PutMetricDataRequest cwRequest;
-    cwRequest.SetNamespace("KinesisVideoSDKCanary");
-    cwRequest.AddMetricData(metricDatum);
-    pCanaryStreamCallbacks->pCwClient->PutMetricDataAsync(cwRequest, onPutMetricDataResponseReceivedHandler);
+    canaryMetricsSinkPut(pCanaryStreamCallbacks->pMetricsSink, metricDatum);
 }
 
 STATUS publishErrorRate(STREAM_HANDLE streamHandle, PCanaryStreamCallbacks pCanaryStreamCallbacks, UINT64 duration)
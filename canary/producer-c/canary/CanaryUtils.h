@@ -13,6 +13,9 @@
 #include <aws/logs/model/PutLogEventsRequest.h>
 #include <aws/logs/model/DeleteLogStreamRequest.h>
 #include <aws/logs/model/DescribeLogStreamsRequest.h>
+#include <aws/core/utils/json/JsonSerializer.h>
+#include <thread>
+#include <condition_variable>
 
 #ifdef __cplusplus
 extern "C" {
@@ -50,6 +53,12 @@ extern "C" {
 #define CANARY_SCENARIO_ENV_VAR        (PCHAR) "CANARY_RUN_SCENARIO"
 #define CANARY_TRACK_TYPE_ENV_VAR      (PCHAR) "TRACK_TYPE"
 #define CANARY_CP_API_ENV_VAR          (PCHAR) "CANARY_CP_URL"
+#define CANARY_METRICS_SINK_ENV_VAR    (PCHAR) "CANARY_METRICS_SINK"
+#define CANARY_CW_ENDPOINT_ENV_VAR     (PCHAR) "CANARY_CLOUDWATCH_ENDPOINT"
+
+#define CANARY_METRICS_SINK_CLOUDWATCH (PCHAR) "Cloudwatch"
+#define CANARY_METRICS_SINK_EMF        (PCHAR) "Emf"
+#define CANARY_METRICS_SINK_MEMORY     (PCHAR) "Memory"
 
 // IoT related env
 #define CANARY_USE_IOT_CREDENTIALS_ENV_VAR   (PCHAR) "CANARY_USE_IOT_PROVIDER"
@@ -67,6 +76,7 @@ extern "C" {
 #define CANARY_DEFAULT_FRAGMENT_SIZE       (25 * 1024)
 #define CANARY_DEFAULT_CANARY_LABEL        (PCHAR) "Longrun"
 #define CANARY_DEFAULT_TRACK_TYPE          CANARY_SINGLE_TRACK_TYPE
+#define CANARY_DEFAULT_METRICS_SINK        CANARY_METRICS_SINK_CLOUDWATCH
 
 #define CANARY_TYPE_STR_LEN                20
 #define CANARY_STREAM_NAME_STR_LEN         255
@@ -74,11 +84,19 @@ extern "C" {
 #define CANARY_LABEL_LEN                   40
 #define MAX_LOG_FILE_NAME_LEN              300
 #define CANARY_TRACK_TYPE_STR_LEN          20
+#define CANARY_METRICS_SINK_STR_LEN        20
 #define IOT_ENDPOINT_LENGTH                1023
 
 
+#define CANARY_CLOUDWATCH_NAMESPACE             "KinesisVideoSDKCanary"
+#define CANARY_MAX_CLOUDWATCH_METRIC_DATUM_COUNT 20
+#define CANARY_CLOUDWATCH_METRICS_FLUSH_PERIOD   (10 * HUNDREDS_OF_NANOS_IN_A_SECOND)
+#define CANARY_METRICS_FILE_MAX_SIZE             (10 * 1024 * 1024)
+#define CANARY_MAX_NUMBER_OF_METRICS_FILES       10
+
 #define STATUS_PRODUCER_CANARY_BASE                    0x80000000
 #define STATUS_PRODUCER_EMPTY_IOT_CRED_FILE            STATUS_PRODUCER_CANARY_BASE + 0x00000001
+#define STATUS_PRODUCER_UNKNOWN_METRICS_SINK           STATUS_PRODUCER_CANARY_BASE + 0x00000002
 
 struct __CallbackStateMachine;
 struct __CallbacksProvider;
@@ -94,6 +112,7 @@ typedef struct {
     CHAR canaryLabel[CANARY_LABEL_LEN + 1];
     CHAR canaryScenario[CANARY_LABEL_LEN + 1];
     CHAR canaryTrackType[CANARY_TRACK_TYPE_STR_LEN + 1];
+    CHAR canaryMetricsSink[CANARY_METRICS_SINK_STR_LEN + 1];
     CHAR iotCoreCredentialEndPointFile[MAX_URI_CHAR_LEN + 1];
     BYTE iotEndpoint[MAX_URI_CHAR_LEN + 1];
     CHAR iotCoreCert[MAX_PATH_LEN + 1];
@@ -101,6 +120,7 @@ typedef struct {
     CHAR iotCoreRoleAlias[MAX_ROLE_ALIAS_LEN + 1];
     CHAR iotThingName[CANARY_STREAM_NAME_STR_LEN + 1];
     CHAR canaryCpUrl[MAX_URI_CHAR_LEN];
+    CHAR canaryCloudwatchEndpoint[MAX_URI_CHAR_LEN];
     UINT64 fragmentSizeInBytes;
     UINT64 canaryDuration;
     UINT64 bufferDuration;
@@ -124,6 +144,36 @@ struct __CloudwatchLogsObject {
 };
 typedef struct __CloudwatchLogsObject* PCloudwatchLogsObject;
 
+typedef enum {
+    CANARY_METRICS_SINK_TYPE_CLOUDWATCH,
+    CANARY_METRICS_SINK_TYPE_EMF,
+    CANARY_METRICS_SINK_TYPE_MEMORY,
+} CANARY_METRICS_SINK_TYPE;
+
+// Destination of the canary metrics, selected with CANARY_METRICS_SINK
+typedef struct __CanaryMetricsSink CanaryMetricsSink;
+struct __CanaryMetricsSink {
+    CANARY_METRICS_SINK_TYPE type;
+    std::mutex mutex;
+    // Cloudwatch: datums are batched into a single PutMetricData call
+    Aws::CloudWatch::CloudWatchClient* pCwClient;
+    Aws::Vector<Aws::CloudWatch::Model::MetricDatum> batch;
+    UINT64 batchStartTime;
+    std::atomic<UINT64> pendingRequests;
+    // Flushes an old batch when no more datums come in to do it
+    std::condition_variable flushCvar;
+    std::thread flushThread;
+    BOOL terminate;
+    // Emf: one embedded metric format JSON line per datum in a rotating local file
+    FILE* pFile;
+    UINT64 fileSize;
+    UINT32 fileIndex;
+    CHAR filePrefix[MAX_LOG_FILE_NAME_LEN + 1];
+    // Memory: datums are kept around for inspection
+    Aws::Vector<Aws::CloudWatch::Model::MetricDatum> memoryData;
+};
+typedef struct __CanaryMetricsSink* PCanaryMetricsSink;
+
 typedef struct {
     UINT64 prevErrorAckCount;
     UINT64 prevPutFrameErrorCount;
@@ -136,8 +186,7 @@ struct __CanaryStreamCallbacks {
     PCHAR pStreamName;
     UINT64 totalNumberOfErrors;
     BOOL aggregateMetrics;
-    Aws::CloudWatch::CloudWatchClient* pCwClient;
-    Aws::CloudWatch::Model::PutMetricDataRequest* cwRequest;
+    PCanaryMetricsSink pMetricsSink;
     Aws::CloudWatch::Model::Dimension dimensionPerStream;
     Aws::CloudWatch::Model::Dimension aggregatedDimension;
     HistoricStreamMetric historicStreamMetric;
@@ -148,7 +197,7 @@ typedef struct __CanaryStreamCallbacks* PCanaryStreamCallbacks;
 ////////////////////////////////////////////////////////////////////////
 // Callback function implementations
 ////////////////////////////////////////////////////////////////////////
-STATUS createCanaryStreamCallbacks(Aws::CloudWatch::CloudWatchClient*, PCHAR, PCHAR, PCanaryStreamCallbacks*);
+STATUS createCanaryStreamCallbacks(PCanaryMetricsSink, PCHAR, PCHAR, PCanaryStreamCallbacks*);
 STATUS freeCanaryStreamCallbacks(PStreamCallbacks*);
 STATUS canaryStreamFragmentAckHandler(UINT64, STREAM_HANDLE, UPLOAD_HANDLE, PFragmentAck);
 STATUS canaryStreamErrorReportHandler(UINT64, STREAM_HANDLE, UPLOAD_HANDLE, UINT64, STATUS);
@@ -163,6 +212,15 @@ STATUS publishErrorRate(STREAM_HANDLE, PCanaryStreamCallbacks, UINT64);
 STATUS pushStartUpLatency(PCanaryStreamCallbacks, DOUBLE);
 STATUS publishMetrics(STREAM_HANDLE, CLIENT_HANDLE, PCanaryStreamCallbacks);
 
+////////////////////////////////////////////////////////////////////////
+// Metrics sink related functions
+////////////////////////////////////////////////////////////////////////
+STATUS createCanaryMetricsSink(PCHAR, Aws::Client::ClientConfiguration&, PCHAR, PCanaryMetricsSink*);
+STATUS freeCanaryMetricsSink(PCanaryMetricsSink*);
+VOID canaryMetricsSinkPut(PCanaryMetricsSink, Aws::CloudWatch::Model::MetricDatum&);
+VOID canaryMetricsSinkFlush(PCanaryMetricsSink);
+VOID canaryMetricsSinkFlushRoutine(PCanaryMetricsSink);
+
 ////////////////////////////////////////////////////////////////////////
 // Cloudwatch logging related functions
 ////////////////////////////////////////////////////////////////////////
@@ -78,6 +78,9 @@ STATUS parseConfigFile(PCanaryConfig pCanaryConfig, PCHAR filePath)
     CHK_ERR(size < 1024, STATUS_INVALID_ARG_LEN, "File size too big. Max allowed is 1024 bytes");
     CHK_STATUS(readFile(filePath, TRUE, params, &size));
 
+    // Optional keys
+    STRCPY(pCanaryConfig->canaryMetricsSink, CANARY_DEFAULT_METRICS_SINK);
+
     jsmn_init(&parser);
     jsmntok_t tokens[256];
 
@@ -116,9 +119,15 @@ STATUS parseConfigFile(PCanaryConfig pCanaryConfig, PCHAR filePath)
         } else if (compareJsonString((PCHAR) params, &tokens[i], JSMN_STRING, CANARY_TRACK_TYPE_ENV_VAR)) {
             getJsonValue(params, tokens[i + 1], pCanaryConfig->canaryTrackType);
             i++;
+        } else if (compareJsonString((PCHAR) params, &tokens[i], JSMN_STRING, CANARY_METRICS_SINK_ENV_VAR)) {
+            getJsonValue(params, tokens[i + 1], pCanaryConfig->canaryMetricsSink);
+            i++;
         } else if (compareJsonString((PCHAR) params, &tokens[i], JSMN_STRING, CANARY_CP_API_ENV_VAR)) {
             getJsonValue(params, tokens[i + 1], pCanaryConfig->canaryCpUrl);  
             i++;
+        } else if (compareJsonString((PCHAR) params, &tokens[i], JSMN_STRING, CANARY_CW_ENDPOINT_ENV_VAR)) {
+            getJsonValue(params, tokens[i + 1], pCanaryConfig->canaryCloudwatchEndpoint);
+            i++;
         }
 
         // IoT related items
@@ -217,6 +226,8 @@ STATUS printConfig(PCanaryConfig pCanaryConfig)
     DLOGI("Canary storage size: %llu bytes", pCanaryConfig->storageSizeInBytes);
     DLOGI("Canary scenario: %s", pCanaryConfig->canaryScenario);
     DLOGI("Canary track type: %s", pCanaryConfig->canaryTrackType);
+    DLOGI("Canary metrics sink: %s", pCanaryConfig->canaryMetricsSink);
+    DLOGI("Canary cloudwatch endpoint: %s", pCanaryConfig->canaryCloudwatchEndpoint[0] == '\0' ? "(regional)" : pCanaryConfig->canaryCloudwatchEndpoint);
     DLOGI("Credential type: %s", pCanaryConfig->useIotCredentialProvider ? "IoT" : "Static");
 
     if(pCanaryConfig->useIotCredentialProvider == TRUE) {
@@ -240,6 +251,8 @@ STATUS initWithEnvVars(PCanaryConfig pCanaryConfig)
     CHAR canaryScenario[CANARY_LABEL_LEN + 1];
     CHAR canaryTrackType[CANARY_TRACK_TYPE_STR_LEN + 1];
     CHAR canaryCpUrl[MAX_URI_CHAR_LEN];
+    CHAR canaryCloudwatchEndpoint[MAX_URI_CHAR_LEN];
+    CHAR canaryMetricsSink[CANARY_METRICS_SINK_STR_LEN + 1];
     CHK(pCanaryConfig != NULL, STATUS_NULL_ARG);
 
     CHK_STATUS(optenv(CANARY_STREAM_NAME_ENV_VAR, streamName, CANARY_DEFAULT_STREAM_NAME));
@@ -257,10 +270,15 @@ STATUS initWithEnvVars(PCanaryConfig pCanaryConfig)
     CHK_STATUS(optenv(CANARY_TRACK_TYPE_ENV_VAR, canaryTrackType, CANARY_DEFAULT_TRACK_TYPE));
     STRCPY(pCanaryConfig->canaryTrackType, canaryTrackType);
 
+    CHK_STATUS(optenv(CANARY_METRICS_SINK_ENV_VAR, canaryMetricsSink, CANARY_DEFAULT_METRICS_SINK));
+    STRCPY(pCanaryConfig->canaryMetricsSink, canaryMetricsSink);
 
     CHK_STATUS(optenv(CANARY_CP_API_ENV_VAR, canaryCpUrl, EMPTY_STRING));
     STRCPY(pCanaryConfig->canaryCpUrl, canaryCpUrl);
 
+    CHK_STATUS(optenv(CANARY_CW_ENDPOINT_ENV_VAR, canaryCloudwatchEndpoint, EMPTY_STRING));
+    STRCPY(pCanaryConfig->canaryCloudwatchEndpoint, canaryCloudwatchEndpoint);
+
     CHK_STATUS(optenvUint64(FRAGMENT_SIZE_ENV_VAR, &pCanaryConfig->fragmentSizeInBytes, CANARY_DEFAULT_FRAGMENT_SIZE));
     CHK_STATUS(optenvUint64(CANARY_DURATION_ENV_VAR, &pCanaryConfig->canaryDuration, CANARY_DEFAULT_DURATION_IN_SECONDS));
 
@@ -307,6 +325,7 @@ INT32 main(INT32 argc, CHAR* argv[])
     UINT64 lastKeyFrameTimestamp = 0;
     CloudwatchLogsObject cloudwatchLogsObject;
     PCanaryStreamCallbacks pCanaryStreamCallbacks = NULL;
+    PCanaryMetricsSink pMetricsSink = NULL;
     UINT64 currentTime, canaryStopTime;
     BOOL cleanUpDone = FALSE;
     BOOL fileLoggingEnabled = FALSE;
@@ -336,7 +355,8 @@ INT32 main(INT32 argc, CHAR* argv[])
                   "\t\texport CANARY_BUFFER_DURATION_IN_SECONDS=<duration in seconds>"
                   "\t\texport CANARY_STORAGE_SIZE_IN_BYTES=<storage size in bytes>"
                   "\t\texport CANARY_LABEL=<canary label (longtime,periodic, etc >"
-                  "\t\texport CANARY_RUN_SCENARIO=<canary label (normal/intermittent) >");
+                  "\t\texport CANARY_RUN_SCENARIO=<canary label (normal/intermittent) >"
+                  "\t\texport CANARY_METRICS_SINK=<Cloudwatch/Emf/Memory>");
             CHK_STATUS(initWithEnvVars(&config));
         } else {
             CHK_ERR(STRLEN(argv[1]) < (MAX_PATH_LEN + 1), STATUS_INVALID_ARG_LEN, "File path length too long");
@@ -359,8 +379,9 @@ INT32 main(INT32 argc, CHAR* argv[])
 
         Aws::Client::ClientConfiguration clientConfiguration;
         clientConfiguration.region = region;
-        Aws::CloudWatch::CloudWatchClient cw(clientConfiguration);
-
+        if (config.canaryCloudwatchEndpoint[0] != '\0') {
+            clientConfiguration.endpointOverride = config.canaryCloudwatchEndpoint;
+        }
         Aws::CloudWatchLogs::CloudWatchLogsClient cwl(clientConfiguration);
 
         STRCPY(cloudwatchLogsObject.logGroupName, "ProducerSDK");
@@ -425,7 +446,8 @@ INT32 main(INT32 argc, CHAR* argv[])
             }
         }
 
-        CHK_STATUS(createCanaryStreamCallbacks(&cw, streamName, config.canaryLabel, &pCanaryStreamCallbacks));
+        CHK_STATUS(createCanaryMetricsSink(config.canaryMetricsSink, clientConfiguration, streamName, &pMetricsSink));
+        CHK_STATUS(createCanaryStreamCallbacks(pMetricsSink, streamName, config.canaryLabel, &pCanaryStreamCallbacks));
         CHK_STATUS(addStreamCallbacks(pClientCallbacks, &pCanaryStreamCallbacks->streamCallbacks));
 
         if (!fileLoggingEnabled) {
@@ -528,6 +550,7 @@ INT32 main(INT32 argc, CHAR* argv[])
         freeKinesisVideoStream(&streamHandle);
         freeKinesisVideoClient(&clientHandle);
         freeCallbacksProvider(&pClientCallbacks); // This will also take care of freeing canaryStreamCallbacks
+        freeCanaryMetricsSink(&pMetricsSink);
         RESET_INSTRUMENTED_ALLOCATORS();
         DLOGI("CleanUp Done");
         cleanUpDone = TRUE;
@@ -537,6 +560,8 @@ INT32 main(INT32 argc, CHAR* argv[])
         }
     }
 CleanUp:
+    // The sink owns a Cloudwatch client, so it has to go before the SDK is shut down
+    freeCanaryMetricsSink(&pMetricsSink);
     Aws::ShutdownAPI(options);
     CHK_LOG_ERR(retStatus);
 
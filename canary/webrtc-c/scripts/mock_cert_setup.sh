@@ -0,0 +1,14 @@
+#!/bin/bash
+#
+# Creates a self-signed certificate for kvsWebrtcMockSignaling and a CA bundle the canaries can trust it through.
+# Run from canary/webrtc-c, then point AWS_KVS_CACERT_PATH at certs/mock/cacert.pem.
+
+host=${1:-localhost}
+outDir="certs/mock"
+
+mkdir -p $outDir
+openssl req -x509 -newkey rsa:2048 -nodes -days 365 \
+    -keyout $outDir/key.pem -out $outDir/cert.pem \
+    -subj "/CN=${host}" -addext "subjectAltName=DNS:${host},DNS:localhost,IP:127.0.0.1"
+# Keep the regular roots in the bundle so STUN/TURN and anything else using the same path keeps working
+cat certs/cert.pem $outDir/cert.pem > $outDir/cacert.pem
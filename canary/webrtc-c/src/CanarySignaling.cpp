@@ -106,6 +106,7 @@ STATUS signalingMessageReceived(UINT64 customData, PReceivedSignalingMessage pRe
     SignalingMessage message = {};
 
     CHK(pCanarySessionInfo != NULL, STATUS_INTERNAL_ERROR);
+    Canary::ResourceSampler::nameThread((PCHAR) RESOURCE_SAMPLER_THREAD_SIGNALING);
 
     switch (pReceivedSignalingMessage->signalingMessage.messageType) {
         case SIGNALING_MESSAGE_TYPE_OFFER:
@@ -257,6 +258,38 @@ VOID generateChannelName(PCHAR pChannelName)
     *pCur = '\0';
 }
 
+STATUS runLoad(Canary::PConfig pConfig, PAwsCredentialProvider pCredentialProvider, TIMER_QUEUE_HANDLE timerQueueHandle, PCHAR channelName,
+               BOOL channelNameGenerated, PCanarySessionInfo pCanarySessionInfo)
+{
+    STATUS retStatus = STATUS_SUCCESS;
+    UINT32 timeoutTimerId;
+    Canary::SignalingLoad load(pConfig, pCredentialProvider);
+
+    // Set it to a non-terminated state before the clients come up
+    ATOMIC_STORE_BOOL(&gExitCanary, FALSE);
+
+    CHK_STATUS(load.init(channelName, channelNameGenerated));
+
+    if (pConfig->duration.value != 0) {
+        CHK_STATUS(timerQueueAddTimer(timerQueueHandle, pConfig->duration.value, TIMER_QUEUE_SINGLE_INVOCATION_PERIOD, terminateCanaryCallback,
+                                      (UINT64) pCanarySessionInfo, &timeoutTimerId));
+    }
+
+    CHK_STATUS(load.start(timerQueueHandle));
+
+    while (!ATOMIC_LOAD_BOOL(&gExitCanary)) {
+        // Waking up often allows for Ctrl+C cancellation to be more responsive
+        THREAD_SLEEP(SIGNALING_LOAD_TICK_PERIOD);
+    }
+
+    // Stopping publishes the last period and the totals, then frees the clients
+    load.stop();
+
+CleanUp:
+
+    return retStatus;
+}
+
 STATUS run(Canary::PConfig pConfig)
 {
     STATUS retStatus = STATUS_SUCCESS;
@@ -277,6 +310,8 @@ STATUS run(Canary::PConfig pConfig)
     MUTEX lock = INVALID_MUTEX_VALUE;
     CVAR terminateCv = INVALID_CVAR_VALUE;
     CHAR channelName[MAX_CHANNEL_NAME_LEN + 1];
+    CHAR controlPlaneUrl[MAX_CONTROL_PLANE_URI_CHAR_LEN];
+    Canary::ResourceSampler sampler;
 
     canarySessionInfo.roundtripLock = INVALID_MUTEX_VALUE;
     canarySessionInfo.roundtripCv = INVALID_CVAR_VALUE;
@@ -298,6 +333,12 @@ STATUS run(Canary::PConfig pConfig)
 
     // The timer loop for iteration
     CHK_STATUS(timerQueueCreate(&timerQueueHandle));
+    // Load mode runs every viewer of every channel, otherwise there is a single viewer
+    CHK_STATUS(sampler.start(timerQueueHandle,
+                             pConfig->signalingLoadViewerCount.value != 0
+                                 ? pConfig->signalingLoadChannelCount.value * pConfig->signalingLoadViewerCount.value
+                                 : 1,
+                             (PCHAR) "Viewer"));
 
     // We will create a static credential provider. We can replace it with others if needed.
     if(pConfig->useIotCredentialProvider.value) {
@@ -324,8 +365,18 @@ STATUS run(Canary::PConfig pConfig)
         STRNCPY(channelName, pConfig->channelName.value.c_str(), MAX_CHANNEL_NAME_LEN);
     }
 
+    // Load mode owns its own clients and channels and replaces the single roundtrip session
+    if (pConfig->signalingLoadViewerCount.value != 0) {
+        CHK_STATUS(runLoad(pConfig, pCredentialProvider, timerQueueHandle, channelName, channelNameGenerated, &canarySessionInfo));
+        CHK(FALSE, retStatus);
+    }
+
     // Prepare the channel info structure
     masterChannelInfo.version = CHANNEL_INFO_CURRENT_VERSION;
+    if (!pConfig->endpoint.value.empty()) {
+        SNPRINTF(controlPlaneUrl, MAX_CONTROL_PLANE_URI_CHAR_LEN, "%s%s", CONTROL_PLANE_URI_PREFIX, pConfig->endpoint.value.c_str());
+        masterChannelInfo.pControlPlaneUrl = (PCHAR) controlPlaneUrl;
+    }
     masterChannelInfo.pChannelName = channelName;
     masterChannelInfo.pRegion = (PCHAR) pConfig->region.value.c_str();
     masterChannelInfo.pKmsKeyId = NULL;
@@ -338,7 +389,7 @@ STATUS run(Canary::PConfig pConfig)
     masterChannelInfo.asyncIceServerConfig = FALSE;
     masterChannelInfo.retry = TRUE;
     masterChannelInfo.reconnect = TRUE;
-    masterChannelInfo.pCertPath = (PCHAR) DEFAULT_KVS_CACERT_PATH;
+    masterChannelInfo.pCertPath = (PCHAR) pConfig->caCertPath.value.c_str();
     masterChannelInfo.messageTtl = 0; // Default is 60 seconds
 
     masterSignalingClientCallbacks.version = SIGNALING_CLIENT_CALLBACKS_CURRENT_VERSION;
@@ -411,6 +462,7 @@ STATUS run(Canary::PConfig pConfig)
 
 CleanUp:
 
+    sampler.stop();
     if (IS_VALID_TIMER_QUEUE_HANDLE(timerQueueHandle)) {
         timerQueueFree(&timerQueueHandle);
     }
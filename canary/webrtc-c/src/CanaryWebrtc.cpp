@@ -3,12 +3,12 @@
 STATUS onNewConnection(Canary::PPeer);
 STATUS run(Canary::PConfig);
 VOID runPeer(Canary::PConfig, TIMER_QUEUE_HANDLE, STATUS*);
+VOID runChurn(Canary::PConfig, TIMER_QUEUE_HANDLE, STATUS*);
 VOID sendLocalFrames(Canary::PPeer, MEDIA_STREAM_TRACK_KIND, const std::string&, UINT64, UINT32);
-VOID sendCustomFrames(Canary::PPeer, MEDIA_STREAM_TRACK_KIND, UINT64, UINT64);
-STATUS canaryRtpOutboundStats(UINT32, UINT64, UINT64);
-STATUS canaryRtpInboundStats(UINT32, UINT64, UINT64);
-STATUS canaryEndToEndStats(UINT32, UINT64, UINT64);
-STATUS canaryKvsStats(UINT32, UINT64, UINT64);
+VOID sendCustomFrames(Canary::PPeer, MEDIA_STREAM_TRACK_KIND, Canary::PLoadProfile);
+VOID sendAudioFrames(Canary::PPeer);
+STATUS canaryStats(UINT32, UINT64, UINT64);
+STATUS canaryImpairmentStats(UINT32, UINT64, UINT64);
 
 std::atomic<bool> terminated;
 VOID handleSignal(INT32 signal)
@@ -17,21 +17,23 @@ VOID handleSignal(INT32 signal)
     terminated = TRUE;
 }
 
-// add frame pts, original frame size, CRC to beginning of buffer after Annex-B format NALu
-VOID addCanaryMetadataToFrameData(PBYTE buffer, PFrame pFrame)
+// add frame pts, original frame size, CRC and sequence number to beginning of buffer after Annex-B format NALu
+VOID addCanaryMetadataToFrameData(PBYTE buffer, PFrame pFrame, UINT32 sequence)
 {
     PBYTE pCurPtr = buffer + ANNEX_B_NALU_SIZE;
     putUnalignedInt64BigEndian((PINT64) pCurPtr, pFrame->presentationTs);
     pCurPtr += SIZEOF(UINT64);
     putUnalignedInt32BigEndian((PINT32) pCurPtr, pFrame->size);
     pCurPtr += SIZEOF(UINT32);
+    // The sequence number goes in first so that the CRC covers it
+    putUnalignedInt32BigEndian((PINT32)(pCurPtr + SIZEOF(UINT32)), sequence);
     putUnalignedInt32BigEndian((PINT32) pCurPtr, COMPUTE_CRC32(buffer, pFrame->size));
 }
 
-// Frame Data format: NALu (4 bytes) + Header (PTS, Size (including header), CRC (frame data) + Randomly generated frameBits
+// Frame Data format: NALu (4 bytes) + Header (PTS, Size (including header), CRC (frame data), sequence number) + Randomly generated frameBits
 
 // TODO: Support dynamic random frame sizes to bring it closer to real time scenarios
-VOID createCanaryFrameData(PBYTE buffer, PFrame pFrame)
+VOID createCanaryFrameData(PBYTE buffer, PFrame pFrame, UINT32 sequence)
 {
     UINT32 i;
     // For decoding purposes, the first 4 bytes need to be a NALu
@@ -39,7 +41,7 @@ VOID createCanaryFrameData(PBYTE buffer, PFrame pFrame)
     for (i = ANNEX_B_NALU_SIZE + CANARY_METADATA_SIZE; i < pFrame->size; i++) {
         buffer[i] = RAND();
     }
-    addCanaryMetadataToFrameData(buffer, pFrame);
+    addCanaryMetadataToFrameData(buffer, pFrame, sequence);
 }
 
 INT32 main(INT32 argc, CHAR* argv[])
@@ -89,7 +91,8 @@ STATUS run(Canary::PConfig pConfig)
     STATUS retStatus = STATUS_SUCCESS;
     BOOL initialized = FALSE;
     TIMER_QUEUE_HANDLE timerQueueHandle = 0;
-    UINT32 timeoutTimerId;
+    UINT32 timeoutTimerId, impairmentTimerId;
+    Canary::ResourceSampler sampler;
 
     CHK_STATUS(Canary::Cloudwatch::init(pConfig));
     CHK_STATUS(initKvsWebRtc());
@@ -111,7 +114,26 @@ STATUS run(Canary::PConfig pConfig)
                                       &timeoutTimerId));
     }
 
-    if (!pConfig->runBothPeers.value) {
+    if (!pConfig->impairmentProfile.value.empty()) {
+        if (pConfig->runBothPeers.value) {
+            // Relay candidates would carry the media around the relay and host ones are all that gets relayed
+            CHK_ERR(!pConfig->forceTurn.value, STATUS_INVALID_ARG, "Impairment relay needs host candidates, it can't be used with forced TURN");
+            CHK_STATUS(Canary::ImpairmentRelay::getInstance().init(pConfig->impairmentProfile.value));
+            CHK_STATUS(timerQueueAddTimer(timerQueueHandle, IMPAIRMENT_STATS_PERIOD, IMPAIRMENT_STATS_PERIOD, canaryImpairmentStats, (UINT64) NULL,
+                                          &impairmentTimerId));
+        } else {
+            DLOGW("Impairment profile only applies when both peers run in this process, ignoring it");
+        }
+    }
+
+    // Churn runs that many sessions at once and both peers in this process make two streams
+    CHK_STATUS(sampler.start(timerQueueHandle,
+                             pConfig->churnConcurrency.value != 0 ? pConfig->churnConcurrency.value : (pConfig->runBothPeers.value ? 2 : 1),
+                             (PCHAR) "Stream"));
+
+    if (pConfig->churnConcurrency.value != 0) {
+        runChurn(pConfig, timerQueueHandle, &retStatus);
+    } else if (!pConfig->runBothPeers.value) {
         runPeer(pConfig, timerQueueHandle, &retStatus);
     } else {
         // Modify config to differentiate master and viewer
@@ -152,10 +174,14 @@ STATUS run(Canary::PConfig pConfig)
 
 CleanUp:
 
+    sampler.stop();
     if (IS_VALID_TIMER_QUEUE_HANDLE(timerQueueHandle)) {
         timerQueueFree(&timerQueueHandle);
     }
 
+    Canary::ImpairmentRelay::getInstance().deinit();
+    Canary::TurnProbe::getInstance().deinit();
+
     DLOGI("Exiting with 0x%08x", retStatus);
     if (initialized) {
         Canary::Cloudwatch::getInstance().monitoring.pushExitStatus(retStatus);
@@ -177,27 +203,30 @@ VOID runPeer(Canary::PConfig pConfig, TIMER_QUEUE_HANDLE timerQueueHandle, STATU
     callbacks.onDisconnected = []() { terminated = TRUE; };
 
     Canary::Peer peer;
+    Canary::LoadProfile profile;
 
     CHK(pConfig != NULL, STATUS_NULL_ARG);
 
     pConfig->print();
-    CHK_STATUS(timerQueueAddTimer(timerQueueHandle, KVS_METRICS_INVOCATION_PERIOD, KVS_METRICS_INVOCATION_PERIOD,
-                                  canaryKvsStats, (UINT64) &peer, &timeoutTimerId));
+    CHK_STATUS(profile.init(pConfig));
+    // All metrics tracking happens on a single timer: one pass samples every transceiver, the selected ICE candidate pair
+    // and the transport, and each group is published at its own period
+    CHK_STATUS(timerQueueAddTimer(timerQueueHandle, STATS_SAMPLER_INVOCATION_PERIOD, STATS_SAMPLER_INVOCATION_PERIOD, canaryStats, (UINT64) &peer,
+                                  &timeoutTimerId));
     CHK_STATUS(peer.init(pConfig, callbacks));
     CHK_STATUS(peer.connect());
 
     {
-        // Since the goal of the canary is to test robustness of the SDK, there is not an immediate need
-        // to send audio frames as well. It can always be added in if needed in the future
-        std::thread videoThread(sendCustomFrames, &peer, MEDIA_STREAM_TRACK_KIND_VIDEO, pConfig->bitRate.value, pConfig->frameRate.value);
-        // All metrics tracking will happen on a time queue to simplify handling periodicity
-        CHK_STATUS(timerQueueAddTimer(timerQueueHandle, METRICS_INVOCATION_PERIOD, METRICS_INVOCATION_PERIOD, canaryRtpOutboundStats, (UINT64) &peer,
-                                      &timeoutTimerId));
-        CHK_STATUS(timerQueueAddTimer(timerQueueHandle, METRICS_INVOCATION_PERIOD, METRICS_INVOCATION_PERIOD, canaryRtpInboundStats, (UINT64) &peer,
-                                      &timeoutTimerId));
-        CHK_STATUS(timerQueueAddTimer(timerQueueHandle, END_TO_END_METRICS_INVOCATION_PERIOD, END_TO_END_METRICS_INVOCATION_PERIOD,
-                                      canaryEndToEndStats, (UINT64) &peer, &timeoutTimerId));
+        // Audio goes out on its own thread so that its 20 ms cadence doesn't depend on how long a video frame takes
+        std::thread videoThread(sendCustomFrames, &peer, MEDIA_STREAM_TRACK_KIND_VIDEO, &profile);
+        std::thread audioThread;
+        if (pConfig->sendAudio.value) {
+            audioThread = std::thread(sendAudioFrames, &peer);
+        }
         videoThread.join();
+        if (audioThread.joinable()) {
+            audioThread.join();
+        }
     }
 
     CHK_STATUS(peer.shutdown());
@@ -207,6 +236,27 @@ CleanUp:
     *pRetStatus = retStatus;
 }
 
+VOID runChurn(Canary::PConfig pConfig, TIMER_QUEUE_HANDLE timerQueueHandle, STATUS* pRetStatus)
+{
+    STATUS retStatus = STATUS_SUCCESS, stopStatus;
+    Canary::Churn churn(pConfig);
+
+    pConfig->print();
+
+    CHK_STATUS(churn.start(timerQueueHandle));
+
+    while (!terminated.load()) {
+        // Waking up often allows for Ctrl+C cancellation to be more responsive
+        THREAD_SLEEP(CHURN_CHECK_PERIOD);
+    }
+
+CleanUp:
+
+    // Stopping publishes the last period and the totals, then checks what the cycles left behind
+    stopStatus = churn.stop();
+    *pRetStatus = STATUS_FAILED(retStatus) ? retStatus : stopStatus;
+}
+
 STATUS onNewConnection(Canary::PPeer pPeer)
 {
     STATUS retStatus = STATUS_SUCCESS;
@@ -226,7 +276,7 @@ STATUS onNewConnection(Canary::PPeer pPeer)
     STRCPY(videoTrack.trackId, "myVideoTrack");
     CHK_STATUS(pPeer->addTransceiver(videoTrack));
 
-    // Add a SendRecv Transceiver of type video
+    // Add a SendRecv Transceiver of type audio
     audioTrack.kind = MEDIA_STREAM_TRACK_KIND_AUDIO;
     audioTrack.codec = RTC_CODEC_OPUS;
     STRCPY(audioTrack.streamId, "myKvsVideoStream");
@@ -238,40 +288,78 @@ CleanUp:
     return retStatus;
 }
 
-VOID sendCustomFrames(Canary::PPeer pPeer, MEDIA_STREAM_TRACK_KIND kind, UINT64 dataRate, UINT64 frameRate)
+VOID sendCustomFrames(Canary::PPeer pPeer, MEDIA_STREAM_TRACK_KIND kind, Canary::PLoadProfile pProfile)
 {
     STATUS retStatus = STATUS_SUCCESS;
     Frame frame;
+    Canary::LoadPoint point;
     UINT32 hexStrLen = 0;
     UINT32 actualFrameSize = 0;
     UINT32 frameSizeWithoutNalu = 0;
-    // This is the actual frame size that includes the metadata and the actual frame data
-    actualFrameSize = CANARY_METADATA_SIZE + ((dataRate / 8) / frameRate);
-    frameSizeWithoutNalu = actualFrameSize - ANNEX_B_NALU_SIZE;
+    UINT32 canaryFrameCapacity = 0, frameDataCapacity = 0;
+    UINT32 sequence = 0;
+    UINT32 segment = MAX_UINT32;
+    UINT64 averageFrameSize, deltaFrameSize;
 
     PBYTE canaryFrameData = NULL;
-    canaryFrameData = (PBYTE) MEMALLOC(actualFrameSize);
 
-    // We allocate a bigger buffer to accomodate the hex encoded string
-    frame.frameData = (PBYTE) MEMALLOC(frameSizeWithoutNalu * 2 + 1 + ANNEX_B_NALU_SIZE);
+    Canary::ResourceSampler::nameThread((PCHAR) RESOURCE_SAMPLER_THREAD_SEND);
+    frame.frameData = NULL;
     frame.version = FRAME_CURRENT_VERSION;
     frame.presentationTs = GETTIME();
 
     while (!terminated.load()) {
+        pProfile->sample(frame.presentationTs, &point);
+        if (point.segment != segment) {
+            segment = point.segment;
+            DLOGI("Load segment %s: %lu bps at %lu fps, key frame every %lu frames", pProfile->getLabel(segment).c_str(), point.bitRate,
+                  point.frameRate, point.keyFrameInterval);
+            if (pProfile->isEnabled()) {
+                Canary::Cloudwatch::getInstance().monitoring.setSegment(pProfile->getLabel(segment));
+            }
+        }
+
+        // Key frames are bigger than the delta frames between them, sizes are picked so that the average still matches the bitrate
+        averageFrameSize = (point.bitRate / 8) / point.frameRate;
+        frame.flags = FRAME_FLAG_NONE;
+        if (point.keyFrameInterval > 1) {
+            deltaFrameSize = averageFrameSize * point.keyFrameInterval / (point.keyFrameInterval - 1 + CANARY_KEY_FRAME_SIZE_FACTOR);
+            if (sequence % point.keyFrameInterval == 0) {
+                frame.flags = FRAME_FLAG_KEY_FRAME;
+                averageFrameSize = deltaFrameSize * CANARY_KEY_FRAME_SIZE_FACTOR;
+            } else {
+                averageFrameSize = deltaFrameSize;
+            }
+        } else if (point.keyFrameInterval == 1) {
+            frame.flags = FRAME_FLAG_KEY_FRAME;
+        }
+
+        // The metadata goes in after the NALu, a low bitrate must still leave room for both
+        averageFrameSize = MAX(averageFrameSize, ANNEX_B_NALU_SIZE);
+
+        // This is the actual frame size that includes the metadata and the actual frame data
+        actualFrameSize = CANARY_METADATA_SIZE + (UINT32) averageFrameSize;
+        frameSizeWithoutNalu = actualFrameSize - ANNEX_B_NALU_SIZE;
+
+        // Buffers only grow, so a profile that moves around settles on its biggest frame without allocating in the loop
+        if (actualFrameSize > canaryFrameCapacity) {
+            canaryFrameData = (PBYTE) REALLOC(canaryFrameData, actualFrameSize);
+            CHK_ERR(canaryFrameData != NULL, STATUS_NOT_ENOUGH_MEMORY, "Failed to realloc frame buffer");
+            canaryFrameCapacity = actualFrameSize;
+        }
+
         frame.size = actualFrameSize;
-        createCanaryFrameData(canaryFrameData, &frame);
+        createCanaryFrameData(canaryFrameData, &frame, sequence++);
 
         // Hex encode the data (without the ANNEX-B NALu) to ensure parts of random frame data is not skipped if they
         // are the same as the ANNEX-B NALu
-        CHK_STATUS(hexEncode(frame.frameData + ANNEX_B_NALU_SIZE, frameSizeWithoutNalu, NULL, &hexStrLen));
+        CHK_STATUS(hexEncode(canaryFrameData + ANNEX_B_NALU_SIZE, frameSizeWithoutNalu, NULL, &hexStrLen));
 
-        // This re-alloc is done in case the estimated size does not match the actual requirement.
-        // We do not want to constantly malloc within a loop. Hence, we re-allocate only if required
-        // Either ways, the realloc should not happen
-        if (hexStrLen != (frameSizeWithoutNalu * 2 + 1)) {
-            DLOGW("Re allocating...this should not happen...something might be wrong");
+        // We allocate a bigger buffer to accomodate the hex encoded string
+        if (hexStrLen + ANNEX_B_NALU_SIZE > frameDataCapacity) {
             frame.frameData = (PBYTE) REALLOC(frame.frameData, hexStrLen + ANNEX_B_NALU_SIZE);
             CHK_ERR(frame.frameData != NULL, STATUS_NOT_ENOUGH_MEMORY, "Failed to realloc media buffer");
+            frameDataCapacity = hexStrLen + ANNEX_B_NALU_SIZE;
         }
         CHK_STATUS(hexEncode(canaryFrameData + ANNEX_B_NALU_SIZE, frameSizeWithoutNalu, (PCHAR)(frame.frameData + ANNEX_B_NALU_SIZE), &hexStrLen));
         MEMCPY(frame.frameData, canaryFrameData, ANNEX_B_NALU_SIZE);
@@ -279,7 +367,7 @@ VOID sendCustomFrames(Canary::PPeer pPeer, MEDIA_STREAM_TRACK_KIND kind, UINT64
         // We must update the size to reflect the original data with hex encoded data
         frame.size = hexStrLen + ANNEX_B_NALU_SIZE;
         pPeer->writeFrame(&frame, kind);
-        THREAD_SLEEP(HUNDREDS_OF_NANOS_IN_A_SECOND / frameRate);
+        THREAD_SLEEP(HUNDREDS_OF_NANOS_IN_A_SECOND / point.frameRate);
         frame.presentationTs = GETTIME();
     }
 CleanUp:
@@ -295,44 +383,73 @@ CleanUp:
     }
 }
 
-STATUS canaryRtpOutboundStats(UINT32 timerId, UINT64 currentTime, UINT64 customData)
+// Audio frame format: Header (PTS, Size (including header), sequence number) + an Opus sample frame from the assets
+VOID sendAudioFrames(Canary::PPeer pPeer)
 {
-    UNUSED_PARAM(timerId);
-    UNUSED_PARAM(currentTime);
     STATUS retStatus = STATUS_SUCCESS;
-    if (!terminated.load()) {
-        Canary::PPeer pPeer = (Canary::PPeer) customData;
-        pPeer->publishStatsForCanary(RTC_STATS_TYPE_OUTBOUND_RTP);
-    } else {
-        retStatus = STATUS_TIMER_QUEUE_STOP_SCHEDULING;
+    Frame frame;
+    UINT64 fileIndex, frameSize, nextFrameTime, now;
+    UINT32 sequence = 0;
+    CHAR filePath[MAX_PATH_LEN + 1];
+    std::vector<std::vector<BYTE>> samples(NUMBER_OF_OPUS_FRAME_FILES);
+    std::vector<BYTE> buffer;
+
+    Canary::ResourceSampler::nameThread((PCHAR) RESOURCE_SAMPLER_THREAD_SEND);
+
+    // Load every sample up front, reading two files per frame every 20 ms would show up in the CPU numbers
+    for (fileIndex = 0; fileIndex < NUMBER_OF_OPUS_FRAME_FILES; fileIndex++) {
+        SNPRINTF(filePath, MAX_PATH_LEN, CANARY_AUDIO_FRAMES_PATH, fileIndex + 1);
+        CHK_STATUS(readFile(filePath, TRUE, NULL, &frameSize));
+        samples[fileIndex].resize(frameSize);
+        CHK_STATUS(readFile(filePath, TRUE, samples[fileIndex].data(), &frameSize));
     }
 
-    return retStatus;
-}
+    MEMSET(&frame, 0x00, SIZEOF(Frame));
+    frame.version = FRAME_CURRENT_VERSION;
+    frame.duration = SAMPLE_AUDIO_FRAME_DURATION;
+    nextFrameTime = GETTIME();
+
+    for (fileIndex = 0; !terminated.load(); fileIndex = (fileIndex + 1) % NUMBER_OF_OPUS_FRAME_FILES) {
+        auto& sample = samples[fileIndex];
+        buffer.resize(CANARY_AUDIO_METADATA_SIZE + sample.size());
+        MEMCPY(buffer.data() + CANARY_AUDIO_METADATA_SIZE, sample.data(), sample.size());
+
+        frame.presentationTs = frame.decodingTs = GETTIME();
+        frame.frameData = buffer.data();
+        frame.size = (UINT32) buffer.size();
+        putUnalignedInt64BigEndian((PINT64) frame.frameData, frame.presentationTs);
+        putUnalignedInt32BigEndian((PINT32)(frame.frameData + SIZEOF(UINT64)), frame.size);
+        putUnalignedInt32BigEndian((PINT32)(frame.frameData + SIZEOF(UINT64) + SIZEOF(UINT32)), sequence++);
+
+        pPeer->writeFrame(&frame, MEDIA_STREAM_TRACK_KIND_AUDIO);
+
+        // Pace against a fixed schedule so late wake ups don't accumulate. After a stall longer than a frame, start
+        // over from now instead of sending a burst to catch up
+        nextFrameTime += SAMPLE_AUDIO_FRAME_DURATION;
+        now = GETTIME();
+        if (nextFrameTime > now) {
+            THREAD_SLEEP(nextFrameTime - now);
+        } else if (now - nextFrameTime > SAMPLE_AUDIO_FRAME_DURATION) {
+            nextFrameTime = now;
+        }
+    }
 
-STATUS canaryRtpInboundStats(UINT32 timerId, UINT64 currentTime, UINT64 customData)
-{
-    UNUSED_PARAM(timerId);
-    UNUSED_PARAM(currentTime);
-    STATUS retStatus = STATUS_SUCCESS;
-    if (!terminated.load()) {
-        Canary::PPeer pPeer = (Canary::PPeer) customData;
-        pPeer->publishStatsForCanary(RTC_STATS_TYPE_INBOUND_RTP);
+CleanUp:
+
+    if (STATUS_FAILED(retStatus)) {
+        DLOGE("audio thread exited with 0x%08x", retStatus);
     } else {
-        retStatus = STATUS_TIMER_QUEUE_STOP_SCHEDULING;
+        DLOGI("audio thread exited successfully");
     }
-
-    return retStatus;
 }
 
-STATUS canaryEndToEndStats(UINT32 timerId, UINT64 currentTime, UINT64 customData)
+STATUS canaryStats(UINT32 timerId, UINT64 currentTime, UINT64 customData)
 {
     UNUSED_PARAM(timerId);
-    UNUSED_PARAM(currentTime);
     STATUS retStatus = STATUS_SUCCESS;
     if (!terminated.load()) {
         Canary::PPeer pPeer = (Canary::PPeer) customData;
-        pPeer->publishEndToEndMetrics();
+        pPeer->sampleStats(currentTime);
     } else {
         retStatus = STATUS_TIMER_QUEUE_STOP_SCHEDULING;
     }
@@ -340,14 +457,19 @@ STATUS canaryEndToEndStats(UINT32 timerId, UINT64 currentTime, UINT64 customData
     return retStatus;
 }
 
-STATUS canaryKvsStats(UINT32 timerId, UINT64 currentTime, UINT64 customData)
+STATUS canaryImpairmentStats(UINT32 timerId, UINT64 currentTime, UINT64 customData)
 {
     UNUSED_PARAM(timerId);
     UNUSED_PARAM(currentTime);
+    UNUSED_PARAM(customData);
     STATUS retStatus = STATUS_SUCCESS;
+    Canary::ImpairmentStats stats;
+
     if (!terminated.load()) {
-        Canary::PPeer pPeer = (Canary::PPeer) customData;
-        pPeer->publishRetryCount();
+        Canary::ImpairmentRelay::getInstance().sample(&stats);
+        DLOGD("Impairment phase %u: received %lu, forwarded %lu, lost %lu, queue dropped %lu, reordered %lu", stats.phase, stats.received,
+              stats.forwarded, stats.lost, stats.queueDropped, stats.reordered);
+        Canary::Cloudwatch::getInstance().monitoring.pushImpairmentStats(stats);
     } else {
         retStatus = STATUS_TIMER_QUEUE_STOP_SCHEDULING;
     }
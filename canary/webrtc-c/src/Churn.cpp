@@ -0,0 +1,380 @@
+#include "Include.h"
+
+namespace Canary {
+
+static std::string getErrorName(STATUS status)
+{
+    switch (status) {
+        case STATUS_OPERATION_TIMED_OUT:
+            return "Timeout";
+        case STATUS_PEERCONNECTION_BASE:
+            return "Failed";
+        default:
+            return "SetupError";
+    }
+}
+
+static DOUBLE usageDelta(UINT64 from, UINT64 to, UINT64 cycles)
+{
+    return ((DOUBLE) to - (DOUBLE) from) / (DOUBLE) MAX(cycles, 1);
+}
+
+Churn::Session::Session()
+{
+    this->offerer.pSession = this;
+    this->answerer.pSession = this;
+}
+
+Churn::Churn(PConfig pConfig) : pConfig(pConfig)
+{
+    // No ICE servers at all, both ends of a session live in this process and host candidates are all they need
+    MEMSET(&this->rtcConfiguration, 0x00, SIZEOF(RtcConfiguration));
+    MEMSET(&this->baseline, 0x00, SIZEOF(ResourceUsage));
+    MEMSET(&this->lastUsage, 0x00, SIZEOF(ResourceUsage));
+}
+
+Churn::~Churn()
+{
+    this->stop();
+}
+
+STATUS Churn::start(TIMER_QUEUE_HANDLE timerQueueHandle)
+{
+    STATUS retStatus = STATUS_SUCCESS;
+    UINT64 now, i;
+
+    CHK(IS_VALID_TIMER_QUEUE_HANDLE(timerQueueHandle) && this->pConfig->churnConcurrency.value != 0 && !this->started, STATUS_INVALID_OPERATION);
+
+    // The first peer connection pays for one time initialization, keep it out of the stats and the baseline
+    CHK_STATUS(this->runCycle(FALSE));
+    CHK_STATUS(ResourceSampler::sampleUsage(&this->baseline));
+    this->lastUsage = this->baseline;
+    this->started = TRUE;
+
+    now = GETTIME();
+    {
+        std::lock_guard<std::mutex> lock(this->statsMutex);
+        this->period.start = now;
+        this->total.start = now;
+    }
+
+    CHK_STATUS(timerQueueAddTimer(timerQueueHandle, CHURN_REPORT_PERIOD, CHURN_REPORT_PERIOD, Churn::onTick, (UINT64) this, &this->tickTimerId));
+    this->timerQueueHandle = timerQueueHandle;
+
+    for (i = 0; i < this->pConfig->churnConcurrency.value; i++) {
+        this->workers.emplace_back(&Churn::work, this);
+    }
+
+    DLOGI("Churn started with %lu concurrent connections, each streaming for %lu ms", this->pConfig->churnConcurrency.value,
+          this->pConfig->churnStreamDuration.value / HUNDREDS_OF_NANOS_IN_A_MILLISECOND);
+
+CleanUp:
+
+    return retStatus;
+}
+
+STATUS Churn::stop()
+{
+    STATUS retStatus = STATUS_SUCCESS;
+    ResourceUsage usage;
+    ResourceDelta leaked;
+
+    this->terminated = true;
+    for (auto& worker : this->workers) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+    this->workers.clear();
+
+    if (IS_VALID_TIMER_QUEUE_HANDLE(this->timerQueueHandle)) {
+        timerQueueCancelTimer(this->timerQueueHandle, this->tickTimerId, (UINT64) this);
+        this->timerQueueHandle = INVALID_TIMER_QUEUE_HANDLE_VALUE;
+
+        this->report(FALSE);
+        this->report(TRUE);
+    }
+
+    CHK(this->started, retStatus);
+    this->started = FALSE;
+
+    // Every peer connection is freed by now, whatever is above the baseline was left behind by the cycles
+    CHK_STATUS(ResourceSampler::sampleUsage(&usage));
+    leaked.rss = usageDelta(this->baseline.rss, usage.rss, 1);
+    leaked.heap = usageDelta(this->baseline.heap, usage.heap, 1);
+    leaked.fds = usageDelta(this->baseline.fds, usage.fds, 1);
+    leaked.threads = usageDelta(this->baseline.threads, usage.threads, 1);
+
+    DLOGI("Churn left behind %.0f bytes of heap, %.0f fds and %.0f threads, RSS changed by %.0f bytes", leaked.heap, leaked.fds, leaked.threads,
+          leaked.rss);
+    Cloudwatch::getInstance().monitoring.pushChurnLeaks(leaked);
+
+    CHK_ERR(usage.heap <= this->baseline.heap, STATUS_WEBRTC_CANARY_CHURN_LEAK, "Churn leaked %lu bytes of heap", usage.heap - this->baseline.heap);
+
+CleanUp:
+
+    return retStatus;
+}
+
+VOID Churn::work()
+{
+    while (!this->terminated) {
+        if (STATUS_FAILED(this->runCycle(TRUE)) && !this->terminated) {
+            // Keep a setup that fails right away from spinning
+            THREAD_SLEEP(CHURN_CHECK_PERIOD);
+        }
+    }
+}
+
+STATUS Churn::runCycle(BOOL record)
+{
+    STATUS retStatus = STATUS_SUCCESS;
+    Session session;
+    UINT64 start = GETTIME(), setupLatency = 0, teardownStart;
+
+    retStatus = this->connectSession(&session);
+    if (STATUS_SUCCEEDED(retStatus)) {
+        setupLatency = GETTIME() - start;
+        this->stream(&session);
+    }
+
+    teardownStart = GETTIME();
+    this->freeSession(&session);
+
+    // A setup that was cut short by the end of the run is not a failure
+    if (record && (STATUS_SUCCEEDED(retStatus) || !this->terminated)) {
+        this->recordCycle(retStatus, setupLatency, GETTIME() - teardownStart);
+    }
+
+    return retStatus;
+}
+
+STATUS Churn::connectSession(Session* pSession)
+{
+    STATUS retStatus = STATUS_SUCCESS;
+    RtcSessionDescriptionInit sdp;
+    Endpoint* pOfferer = &pSession->offerer;
+    Endpoint* pAnswerer = &pSession->answerer;
+
+    pSession->deadline = GETTIME() + CHURN_SETUP_TIMEOUT;
+    CHK_STATUS(this->initEndpoint(pOfferer));
+    CHK_STATUS(this->initEndpoint(pAnswerer));
+
+    // Candidates go out with the descriptions instead of trickling, gathering host candidates only takes a moment
+    MEMSET(&sdp, 0x00, SIZEOF(RtcSessionDescriptionInit));
+    CHK_STATUS(createOffer(pOfferer->pPeerConnection, &sdp));
+    CHK_STATUS(setLocalDescription(pOfferer->pPeerConnection, &sdp));
+    CHK_STATUS(this->await(pSession, [pOfferer]() -> BOOL { return pOfferer->gathered; }));
+    CHK_STATUS(peerConnectionGetLocalDescription(pOfferer->pPeerConnection, &sdp));
+    CHK_STATUS(setRemoteDescription(pAnswerer->pPeerConnection, &sdp));
+
+    MEMSET(&sdp, 0x00, SIZEOF(RtcSessionDescriptionInit));
+    CHK_STATUS(createAnswer(pAnswerer->pPeerConnection, &sdp));
+    CHK_STATUS(setLocalDescription(pAnswerer->pPeerConnection, &sdp));
+    CHK_STATUS(this->await(pSession, [pAnswerer]() -> BOOL { return pAnswerer->gathered; }));
+    CHK_STATUS(peerConnectionGetLocalDescription(pAnswerer->pPeerConnection, &sdp));
+    CHK_STATUS(setRemoteDescription(pOfferer->pPeerConnection, &sdp));
+
+    CHK_STATUS(this->await(pSession, [pOfferer, pAnswerer]() -> BOOL { return pOfferer->connected && pAnswerer->connected; }));
+
+CleanUp:
+
+    return retStatus;
+}
+
+STATUS Churn::initEndpoint(Endpoint* pEndpoint)
+{
+    STATUS retStatus = STATUS_SUCCESS;
+    RtcMediaStreamTrack track;
+
+    MEMSET(&track, 0x00, SIZEOF(RtcMediaStreamTrack));
+    track.kind = MEDIA_STREAM_TRACK_KIND_VIDEO;
+    track.codec = RTC_CODEC_H264_PROFILE_42E01F_LEVEL_ASYMMETRY_ALLOWED_PACKETIZATION_MODE;
+    STRCPY(track.streamId, "churnStream");
+    STRCPY(track.trackId, "churnVideoTrack");
+
+    CHK_STATUS(createPeerConnection(&this->rtcConfiguration, &pEndpoint->pPeerConnection));
+    CHK_STATUS(peerConnectionOnIceCandidate(pEndpoint->pPeerConnection, (UINT64) pEndpoint, Churn::onIceCandidate));
+    CHK_STATUS(peerConnectionOnConnectionStateChange(pEndpoint->pPeerConnection, (UINT64) pEndpoint, Churn::onConnectionStateChange));
+    CHK_STATUS(addSupportedCodec(pEndpoint->pPeerConnection, track.codec));
+    CHK_STATUS(addTransceiver(pEndpoint->pPeerConnection, &track, NULL, &pEndpoint->pTransceiver));
+
+CleanUp:
+
+    return retStatus;
+}
+
+STATUS Churn::await(Session* pSession, const std::function<BOOL()>& done)
+{
+    STATUS retStatus = STATUS_SUCCESS;
+    std::unique_lock<std::mutex> lock(pSession->mutex);
+    UINT64 now;
+
+    // Wait in slices so the end of the run doesn't have to sit out the setup timeout
+    while (!done() && !pSession->failed && !this->terminated && (now = GETTIME()) < pSession->deadline) {
+        pSession->cvar.wait_for(lock, std::chrono::nanoseconds(MIN(pSession->deadline - now, CHURN_CHECK_PERIOD) * DEFAULT_TIME_UNIT_IN_NANOS));
+    }
+
+    // Same as Peer, there is no way to get the actual error code of a failed connection
+    CHK(!pSession->failed, STATUS_PEERCONNECTION_BASE);
+    CHK(done(), STATUS_OPERATION_TIMED_OUT);
+
+CleanUp:
+
+    return retStatus;
+}
+
+VOID Churn::stream(Session* pSession)
+{
+    STATUS retStatus;
+    Frame frame;
+    UINT64 frameRate = MAX(this->pConfig->frameRate.value, 1);
+    UINT64 end = GETTIME() + this->pConfig->churnStreamDuration.value;
+    std::vector<BYTE> data(MAX(this->pConfig->bitRate.value / 8 / frameRate, ANNEX_B_NALU_SIZE + 1));
+
+    // The content doesn't matter, it only has to go through the packetizer as one NALu without start codes in it
+    putUnalignedInt32BigEndian((PINT32) data.data(), 0x00000001);
+    std::fill(data.begin() + ANNEX_B_NALU_SIZE, data.end(), 0x01);
+
+    MEMSET(&frame, 0x00, SIZEOF(Frame));
+    frame.version = FRAME_CURRENT_VERSION;
+    frame.frameData = data.data();
+    frame.size = (UINT32) data.size();
+    frame.duration = HUNDREDS_OF_NANOS_IN_A_SECOND / frameRate;
+
+    while (!this->terminated && GETTIME() < end) {
+        frame.presentationTs = frame.decodingTs = GETTIME();
+        retStatus = writeFrame(pSession->offerer.pTransceiver, &frame);
+        if (STATUS_FAILED(retStatus) && retStatus != STATUS_SRTP_NOT_READY_YET) {
+            DLOGW("Churn failed to write a frame with 0x%08x", retStatus);
+            break;
+        }
+        THREAD_SLEEP(frame.duration);
+    }
+}
+
+VOID Churn::freeSession(Session* pSession)
+{
+    for (Endpoint* pEndpoint : {&pSession->offerer, &pSession->answerer}) {
+        if (pEndpoint->pPeerConnection != NULL) {
+            CHK_LOG_ERR(closePeerConnection(pEndpoint->pPeerConnection));
+            CHK_LOG_ERR(freePeerConnection(&pEndpoint->pPeerConnection));
+        }
+    }
+}
+
+VOID Churn::recordCycle(STATUS status, UINT64 setupLatency, UINT64 teardownLatency)
+{
+    std::lock_guard<std::mutex> lock(this->statsMutex);
+
+    for (Window* pWindow : {&this->period, &this->total}) {
+        pWindow->teardownLatencies[teardownLatency / HUNDREDS_OF_NANOS_IN_A_MILLISECOND]++;
+        if (STATUS_SUCCEEDED(status)) {
+            pWindow->setups++;
+            pWindow->setupLatencies[setupLatency / HUNDREDS_OF_NANOS_IN_A_MILLISECOND]++;
+        } else {
+            pWindow->errors[getErrorName(status)]++;
+        }
+    }
+}
+
+VOID Churn::report(BOOL final)
+{
+    Window window;
+    ResourceUsage usage, reference;
+    ResourceDelta growth;
+    UINT64 now = GETTIME(), cycles = 0;
+    DOUBLE seconds;
+    std::stringstream errors;
+
+    {
+        std::lock_guard<std::mutex> lock(this->statsMutex);
+        if (final) {
+            window = this->total;
+            reference = this->baseline;
+        } else {
+            window = std::move(this->period);
+            this->period = Window();
+            this->period.start = now;
+            reference = this->lastUsage;
+        }
+    }
+
+    if (STATUS_FAILED(ResourceSampler::sampleUsage(&usage))) {
+        usage = reference;
+    }
+    if (!final) {
+        this->lastUsage = usage;
+    }
+
+    seconds = MAX((DOUBLE) (now - window.start) / HUNDREDS_OF_NANOS_IN_A_SECOND, 1.0);
+    for (auto& bucket : window.teardownLatencies) {
+        cycles += bucket.second;
+    }
+    for (auto& error : window.errors) {
+        errors << ' ' << error.first << '=' << error.second;
+    }
+
+    growth.rss = usageDelta(reference.rss, usage.rss, cycles);
+    growth.heap = usageDelta(reference.heap, usage.heap, cycles);
+    growth.fds = usageDelta(reference.fds, usage.fds, cycles);
+    growth.threads = usageDelta(reference.threads, usage.threads, cycles);
+
+    DLOGI("%s churn: %.1f setups/s, setup p50 %lu ms, p90 %lu ms, p99 %lu ms, max %lu ms, teardown p50 %lu ms, p99 %lu ms, max %lu ms, "
+          "growth per cycle: RSS %.0f B, heap %.0f B, fds %.3f, threads %.3f, errors:%s",
+          final ? "Total" : "Period", window.setups / seconds, percentile(window.setupLatencies, window.setups, 0.5),
+          percentile(window.setupLatencies, window.setups, 0.9), percentile(window.setupLatencies, window.setups, 0.99),
+          window.setupLatencies.empty() ? 0 : window.setupLatencies.rbegin()->first, percentile(window.teardownLatencies, cycles, 0.5),
+          percentile(window.teardownLatencies, cycles, 0.99), window.teardownLatencies.empty() ? 0 : window.teardownLatencies.rbegin()->first,
+          growth.rss, growth.heap, growth.fds, growth.threads, window.errors.empty() ? " none" : errors.str().c_str());
+
+    // Every period is published on its own, the total would count the same samples twice
+    if (!final) {
+        auto& monitoring = Cloudwatch::getInstance().monitoring;
+        monitoring.pushChurnStats(window.setups / seconds, window.setupLatencies, window.teardownLatencies, window.errors);
+        monitoring.pushChurnGrowth(growth);
+    }
+}
+
+STATUS Churn::onTick(UINT32 timerId, UINT64 currentTime, UINT64 customData)
+{
+    UNUSED_PARAM(timerId);
+    UNUSED_PARAM(currentTime);
+    Churn* pChurn = (Churn*) customData;
+
+    if (pChurn == NULL || pChurn->terminated) {
+        return STATUS_TIMER_QUEUE_STOP_SCHEDULING;
+    }
+
+    pChurn->report(FALSE);
+
+    return STATUS_SUCCESS;
+}
+
+VOID Churn::onIceCandidate(UINT64 customData, PCHAR candidateJson)
+{
+    Endpoint* pEndpoint = (Endpoint*) customData;
+
+    // Only the end of gathering matters, the candidates go out with the description
+    if (candidateJson == NULL) {
+        std::lock_guard<std::mutex> lock(pEndpoint->pSession->mutex);
+        pEndpoint->gathered = TRUE;
+        pEndpoint->pSession->cvar.notify_all();
+    }
+}
+
+VOID Churn::onConnectionStateChange(UINT64 customData, RTC_PEER_CONNECTION_STATE newState)
+{
+    Endpoint* pEndpoint = (Endpoint*) customData;
+    std::lock_guard<std::mutex> lock(pEndpoint->pSession->mutex);
+
+    if (newState == RTC_PEER_CONNECTION_STATE_CONNECTED) {
+        pEndpoint->connected = TRUE;
+    } else if (newState == RTC_PEER_CONNECTION_STATE_FAILED) {
+        pEndpoint->pSession->failed = TRUE;
+    }
+
+    pEndpoint->pSession->cvar.notify_all();
+}
+
+} // namespace Canary
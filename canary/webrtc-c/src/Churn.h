@@ -0,0 +1,91 @@
+#pragma once
+
+namespace Canary {
+
+// Signed difference between two ResourceUsage samples, optionally divided by a number of cycles
+typedef struct {
+    DOUBLE rss;
+    DOUBLE heap;
+    DOUBLE fds;
+    DOUBLE threads;
+} ResourceDelta;
+typedef ResourceDelta* PResourceDelta;
+
+/*
+ * Connection churn mode. Every worker creates an offerer and an answerer peer connection in this process, exchanges
+ * the descriptions directly, waits for both to be connected, streams video for a short while and frees both again,
+ * over and over. Workers run concurrently so setups and teardowns overlap. Only host candidates are gathered, which
+ * keeps STUN, TURN and signaling out of the numbers. One warm up cycle runs before the baseline resource sample is
+ * taken so that one time initialization in the SDK doesn't read as a leak.
+ */
+class Churn {
+  public:
+    Churn(PConfig);
+    ~Churn();
+    STATUS start(TIMER_QUEUE_HANDLE);
+    STATUS stop();
+
+  private:
+    class Session;
+
+    class Endpoint {
+      public:
+        Session* pSession;
+        PRtcPeerConnection pPeerConnection = NULL;
+        PRtcRtpTransceiver pTransceiver = NULL;
+        BOOL gathered = FALSE;
+        BOOL connected = FALSE;
+    };
+
+    class Session {
+      public:
+        Session();
+        Endpoint offerer;
+        Endpoint answerer;
+        UINT64 deadline = 0;
+        BOOL failed = FALSE;
+        std::mutex mutex;
+        std::condition_variable cvar;
+    };
+
+    class Window {
+      public:
+        UINT64 start = 0;
+        UINT64 setups = 0;
+        // Latency in milliseconds to sample count
+        std::map<UINT64, UINT64> setupLatencies;
+        std::map<UINT64, UINT64> teardownLatencies;
+        std::map<std::string, UINT64> errors;
+    };
+
+    VOID work();
+    STATUS runCycle(BOOL);
+    STATUS connectSession(Session*);
+    STATUS initEndpoint(Endpoint*);
+    STATUS await(Session*, const std::function<BOOL()>&);
+    VOID stream(Session*);
+    VOID freeSession(Session*);
+    VOID recordCycle(STATUS, UINT64, UINT64);
+    VOID report(BOOL);
+
+    static VOID onIceCandidate(UINT64, PCHAR);
+    static VOID onConnectionStateChange(UINT64, RTC_PEER_CONNECTION_STATE);
+    static STATUS onTick(UINT32, UINT64, UINT64);
+
+    PConfig pConfig;
+    RtcConfiguration rtcConfiguration;
+    std::vector<std::thread> workers;
+    std::atomic<bool> terminated{false};
+    BOOL started = FALSE;
+
+    TIMER_QUEUE_HANDLE timerQueueHandle = INVALID_TIMER_QUEUE_HANDLE_VALUE;
+    UINT32 tickTimerId = MAX_UINT32;
+
+    std::mutex statsMutex;
+    Window period;
+    Window total;
+    ResourceUsage baseline;
+    ResourceUsage lastUsage;
+};
+
+} // namespace Canary
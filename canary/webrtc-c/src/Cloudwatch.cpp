@@ -3,7 +3,7 @@
 namespace Canary {
 
 Cloudwatch::Cloudwatch(Canary::PConfig pConfig, ClientConfiguration* pClientConfig)
-    : logs(pConfig, pClientConfig), monitoring(pConfig, pClientConfig), terminated(FALSE), useFileLogger(FALSE)
+    : logs(pConfig, pClientConfig), monitoring(pConfig, pClientConfig), useCloudwatchLogs(FALSE)
 {
 }
 
@@ -17,16 +17,20 @@ STATUS Cloudwatch::init(Canary::PConfig pConfig)
     CreateLogStreamRequest createLogStreamRequest;
 
     clientConfig.region = pConfig->region.value;
+    if (!pConfig->cloudwatchEndpoint.value.empty()) {
+        // Includes the scheme, so a plain http:// mock works too
+        clientConfig.endpointOverride = pConfig->cloudwatchEndpoint.value;
+    }
     auto& instance = getInstanceImpl(pConfig, &clientConfig);
 
     if (STATUS_FAILED(instance.logs.init())) {
-        DLOGW("Failed to create Cloudwatch logger, fallback to file logger");
-        CHK_STATUS(createFileLogger(DEFAULT_FILE_LOGGING_BUFFER_SIZE, MAX_FILE_LOGGER_LOG_FILE_COUNT, (PCHAR) FILE_LOGGER_LOG_FILE_DIRECTORY_PATH,
-                                    TRUE, TRUE, NULL));
-        instance.useFileLogger = TRUE;
+        DLOGW("Failed to create Cloudwatch logger, fallback to console and file logging only");
+        CHK_STATUS(Logger::getInstance().init(pConfig, nullptr));
     } else {
-        globalCustomLogPrintFn = logger;
+        instance.useCloudwatchLogs = TRUE;
+        CHK_STATUS(Logger::getInstance().init(pConfig, &instance.logs));
     }
+    globalCustomLogPrintFn = Logger::log;
 
     CHK_STATUS(instance.monitoring.init());
 
@@ -50,39 +54,12 @@ Cloudwatch& Cloudwatch::getInstanceImpl(Canary::PConfig pConfig, ClientConfigura
 VOID Cloudwatch::deinit()
 {
     auto& instance = getInstance();
-    if (instance.useFileLogger) {
-        freeFileLogger();
-    } else {
+    // Drain the logger first so that everything it still holds makes it into the last Cloudwatch flush
+    Logger::getInstance().deinit();
+    if (instance.useCloudwatchLogs) {
         instance.logs.deinit();
     }
     instance.monitoring.deinit();
-    instance.terminated = TRUE;
-}
-
-VOID Cloudwatch::logger(UINT32 level, PCHAR tag, PCHAR fmt, ...)
-{
-    CHAR logFmtString[MAX_LOG_FORMAT_LENGTH + 1];
-    CHAR cwLogFmtString[MAX_LOG_FORMAT_LENGTH + 1];
-    UINT32 logLevel = GET_LOGGER_LOG_LEVEL();
-    UNUSED_PARAM(tag);
-
-    if (level >= logLevel) {
-        addLogMetadata(logFmtString, (UINT32) ARRAY_SIZE(logFmtString), fmt, level);
-
-        // Creating a copy to store the logFmtString for cloudwatch logging purpose
-        va_list valist, valist_cw;
-        va_start(valist_cw, fmt);
-        vsnprintf(cwLogFmtString, (SIZE_T) SIZEOF(cwLogFmtString), logFmtString, valist_cw);
-        va_end(valist_cw);
-        va_start(valist, fmt);
-        vprintf(logFmtString, valist);
-        va_end(valist);
-
-        auto& instance = getInstance();
-        if (!instance.terminated) {
-            instance.logs.push(cwLogFmtString);
-        }
-    }
 }
 
 } // namespace Canary
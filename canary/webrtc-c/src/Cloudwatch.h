@@ -14,14 +14,12 @@ class Cloudwatch {
     static Cloudwatch& getInstance();
     static STATUS init(Canary::PConfig);
     static VOID deinit();
-    static VOID logger(UINT32, PCHAR, PCHAR, ...);
 
   private:
     static Cloudwatch& getInstanceImpl(Canary::PConfig = nullptr, ClientConfiguration* = nullptr);
 
     Cloudwatch(Canary::PConfig, ClientConfiguration*);
-    BOOL terminated;
-    BOOL useFileLogger;
+    BOOL useCloudwatchLogs;
 };
 typedef Cloudwatch* PCloudwatch;
 
@@ -85,8 +85,8 @@ VOID CloudwatchLogs::flush(BOOL sync)
                 printf("Failed to push logs: %s\n", outcome.GetError().GetMessage().c_str());
             } else {
                 DLOGS("Successfully pushed logs to cloudwatch");
-                this->token = outcome.GetResult().GetNextSequenceToken();
             }
+            this->updateToken(outcome);
 
             this->sync.pending = FALSE;
             this->sync.await.notify_one();
@@ -101,7 +101,22 @@ VOID CloudwatchLogs::flush(BOOL sync)
             printf("Failed to push logs: %s\n", outcome.GetError().GetMessage().c_str());
         } else {
             DLOGS("Successfully pushed logs to cloudwatch");
-            this->token = outcome.GetResult().GetNextSequenceToken();
+        }
+        this->updateToken(outcome);
+    }
+}
+
+VOID CloudwatchLogs::updateToken(const PutLogEventsOutcome& outcome)
+{
+    if (outcome.IsSuccess()) {
+        this->token = outcome.GetResult().GetNextSequenceToken();
+    } else if (outcome.GetError().GetErrorType() == CloudWatchLogsErrors::INVALID_SEQUENCE_TOKEN) {
+        // The batch is lost either way, but without the expected token every following push would be rejected too.
+        // The service only hands it out at the end of the message.
+        auto& message = outcome.GetError().GetMessage();
+        auto pos = message.rfind(' ');
+        if (pos != Aws::String::npos) {
+            this->token = message.substr(pos + 1);
         }
     }
 }
@@ -11,6 +11,8 @@ class CloudwatchLogs {
     VOID flush(BOOL sync = FALSE);
 
   private:
+    VOID updateToken(const PutLogEventsOutcome&);
+
     class Synchronization {
       public:
         std::atomic<bool> pending;
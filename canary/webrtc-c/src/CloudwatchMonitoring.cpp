@@ -2,30 +2,40 @@
 
 namespace Canary {
 
-CloudwatchMonitoring::CloudwatchMonitoring(PConfig pConfig, ClientConfiguration* pClientConfig) : pConfig(pConfig), client(*pClientConfig)
+CloudwatchMonitoring::CloudwatchMonitoring(PConfig pConfig, ClientConfiguration* pClientConfig) : pConfig(pConfig)
 {
+    // The client configuration only lives during Cloudwatch::init, so the sink has to be created right away
+    if (STRCMPI(pConfig->metricsSink.value.c_str(), CANARY_METRICS_SINK_EMF) == 0) {
+        this->sink.reset(new EmfFileMetricsSink(pConfig->logStreamName.value));
+    } else if (STRCMPI(pConfig->metricsSink.value.c_str(), CANARY_METRICS_SINK_MEMORY) == 0) {
+        this->sink.reset(new MemoryMetricsSink());
+    } else if (STRCMPI(pConfig->metricsSink.value.c_str(), CANARY_METRICS_SINK_CLOUDWATCH) == 0) {
+        this->sink.reset(new CloudwatchMetricsSink(pClientConfig));
+    }
 }
 
 STATUS CloudwatchMonitoring::init()
 {
     STATUS retStatus = STATUS_SUCCESS;
 
+    CHK_ERR(this->sink != nullptr, STATUS_INVALID_ARG, "Unknown metrics sink \"%s\"", pConfig->metricsSink.value.c_str());
+    CHK_STATUS(this->sink->init());
+
     this->channelDimension.SetName("WebRTCSDKCanaryChannelName");
     this->channelDimension.SetValue(pConfig->channelName.value);
 
     this->labelDimension.SetName("WebRTCSDKCanaryLabel");
     this->labelDimension.SetValue(pConfig->label.value);
 
+CleanUp:
+
     return retStatus;
 }
 
 VOID CloudwatchMonitoring::deinit()
 {
-    // need to wait all metrics to be flushed out, otherwise we'll get a segfault.
-    // https://docs.aws.amazon.com/sdk-for-cpp/v1/developer-guide/basic-use.html
-    // TODO: maybe add a timeout? But, this might cause a segfault if it hits a timeout.
-    while (this->pendingMetrics.load() > 0) {
-        THREAD_SLEEP(HUNDREDS_OF_NANOS_IN_A_MILLISECOND * 500);
+    if (this->sink != nullptr) {
+        this->sink->deinit();
     }
 }
 
@@ -51,7 +61,6 @@ static const CHAR* unitToString(const Aws::CloudWatch::Model::StandardUnit& unit
 
 VOID CloudwatchMonitoring::push(const MetricDatum& datum)
 {
-    Aws::CloudWatch::Model::PutMetricDataRequest cwRequest;
     MetricDatum single = datum;
     MetricDatum aggregated = datum;
 
@@ -59,26 +68,21 @@ VOID CloudwatchMonitoring::push(const MetricDatum& datum)
     single.AddDimensions(this->labelDimension);
     aggregated.AddDimensions(this->labelDimension);
 
-    cwRequest.SetNamespace(DEFAULT_CLOUDWATCH_NAMESPACE);
-    cwRequest.AddMetricData(single);
-    cwRequest.AddMetricData(aggregated);
-
-    auto asyncHandler = [this](const Aws::CloudWatch::CloudWatchClient* cwClient, const Aws::CloudWatch::Model::PutMetricDataRequest& request,
-                               const Aws::CloudWatch::Model::PutMetricDataOutcome& outcome,
-                               const std::shared_ptr<const Aws::Client::AsyncCallerContext>& context) {
-        UNUSED_PARAM(cwClient);
-        UNUSED_PARAM(request);
-        UNUSED_PARAM(context);
-
-        if (!outcome.IsSuccess()) {
-            DLOGE("Failed to put sample metric data: %s", outcome.GetError().GetMessage().c_str());
-        } else {
-            DLOGS("Successfully put sample metric data");
+    this->sink->put(single);
+    this->sink->put(aggregated);
+
+    {
+        std::unique_lock<std::mutex> lock(this->segmentMutex);
+        if (this->segmented) {
+            Dimension segment = this->segmentDimension;
+            lock.unlock();
+
+            MetricDatum bySegment = datum;
+            bySegment.AddDimensions(this->labelDimension);
+            bySegment.AddDimensions(segment);
+            this->sink->put(bySegment);
         }
-        this->pendingMetrics--;
-    };
-    this->pendingMetrics++;
-    this->client.PutMetricDataAsync(cwRequest, asyncHandler);
+    }
 
     std::stringstream ss;
 
@@ -117,6 +121,14 @@ VOID CloudwatchMonitoring::push(const MetricDatum& datum)
     DLOGD("%s", ss.str().c_str());
 }
 
+VOID CloudwatchMonitoring::setSegment(const std::string& segment)
+{
+    std::lock_guard<std::mutex> lock(this->segmentMutex);
+    this->segmentDimension.SetName("Segment");
+    this->segmentDimension.SetValue(segment);
+    this->segmented = TRUE;
+}
+
 VOID CloudwatchMonitoring::pushExitStatus(STATUS retStatus)
 {
     MetricDatum datum;
@@ -166,6 +178,58 @@ VOID CloudwatchMonitoring::pushSignalingRoundtripLatency(UINT64 delay, Aws::Clou
     this->push(datum);
 }
 
+VOID CloudwatchMonitoring::pushSignalingRoundtripLatencies(const std::map<UINT64, UINT64>& latencies)
+{
+    this->pushDistribution("SignalingRoundtripLatency", latencies, Aws::CloudWatch::Model::StandardUnit::Milliseconds);
+}
+
+template <typename T>
+VOID CloudwatchMonitoring::pushDistribution(const Aws::String& name, const std::map<T, UINT64>& histogram, Aws::CloudWatch::Model::StandardUnit unit,
+                                            const Dimension* pDimension)
+{
+    MetricDatum datum;
+    Aws::Vector<DOUBLE> values, counts;
+
+    if (pDimension != nullptr) {
+        datum.AddDimensions(*pDimension);
+    }
+
+    // Samples go out as value/count pairs so Cloudwatch can compute percentiles across every sample
+    for (auto& bucket : histogram) {
+        values.push_back(bucket.first);
+        counts.push_back(bucket.second);
+
+        if (values.size() == MAX_CLOUDWATCH_DISTRIBUTION_VALUES || bucket.first == histogram.rbegin()->first) {
+            datum.SetMetricName(name);
+            datum.SetValues(values);
+            datum.SetCounts(counts);
+            datum.SetUnit(unit);
+
+            this->push(datum);
+
+            values.clear();
+            counts.clear();
+        }
+    }
+}
+
+VOID CloudwatchMonitoring::pushSignalingLoadThroughput(DOUBLE offersPerSecond, DOUBLE answersPerSecond, UINT64 outstanding)
+{
+    this->pushValue("SignalingOffersPerSecond", offersPerSecond, Aws::CloudWatch::Model::StandardUnit::Count_Second);
+    this->pushValue("SignalingAnswersPerSecond", answersPerSecond, Aws::CloudWatch::Model::StandardUnit::Count_Second);
+    this->pushValue("SignalingOutstandingOffers", outstanding, Aws::CloudWatch::Model::StandardUnit::Count);
+}
+
+VOID CloudwatchMonitoring::pushSignalingRoundtripErrors(const std::string& error, UINT64 count)
+{
+    Dimension errorDimension;
+
+    errorDimension.SetName("Error");
+    errorDimension.SetValue(error.c_str());
+
+    this->pushValue("SignalingRoundtripErrors", count, Aws::CloudWatch::Model::StandardUnit::Count, &errorDimension);
+}
+
 VOID CloudwatchMonitoring::pushSignalingConnectionDuration(UINT64 duration, Aws::CloudWatch::Model::StandardUnit unit)
 {
     MetricDatum datum;
@@ -209,49 +273,150 @@ VOID CloudwatchMonitoring::pushICEHolePunchingDelay(UINT64 delay, Aws::CloudWatc
     this->push(datum);
 }
 
-VOID CloudwatchMonitoring::pushOutboundRtpStats(Canary::POutgoingRTPMetricsContext pOutboundRtpStats)
+VOID CloudwatchMonitoring::pushTurnProbeRtt(DOUBLE rtt)
+{
+    this->pushValue("TurnProbeRtt", rtt, Aws::CloudWatch::Model::StandardUnit::Milliseconds);
+}
+
+VOID CloudwatchMonitoring::pushTurnProbeTimeouts(UINT64 timeouts)
 {
-    MetricDatum bytesDiscardedPercentageDatum, averageFramesRateDatum, nackRateDatum, retransmissionPercentDatum;
+    this->pushValue("TurnProbeTimeouts", timeouts, Aws::CloudWatch::Model::StandardUnit::Count);
+}
 
-    bytesDiscardedPercentageDatum.SetMetricName("PercentageFrameDiscarded");
-    bytesDiscardedPercentageDatum.SetValue(pOutboundRtpStats->framesPercentageDiscarded);
-    bytesDiscardedPercentageDatum.SetUnit(Aws::CloudWatch::Model::StandardUnit::Percent);
-    this->push(bytesDiscardedPercentageDatum);
+VOID CloudwatchMonitoring::pushTurnAllocationTime(DOUBLE duration)
+{
+    this->pushValue("TurnAllocationTime", duration, Aws::CloudWatch::Model::StandardUnit::Milliseconds);
+}
 
-    averageFramesRateDatum.SetMetricName("FramesPerSecond");
-    averageFramesRateDatum.SetValue(pOutboundRtpStats->averageFramesSentPerSecond);
-    averageFramesRateDatum.SetUnit(Aws::CloudWatch::Model::StandardUnit::Count_Second);
-    this->push(averageFramesRateDatum);
+VOID CloudwatchMonitoring::pushConnectionPhaseLatency(PCHAR phase, DOUBLE latency)
+{
+    Dimension phaseDimension;
 
-    nackRateDatum.SetMetricName("NackPerSecond");
-    nackRateDatum.SetValue(pOutboundRtpStats->nacksPerSecond);
-    nackRateDatum.SetUnit(Aws::CloudWatch::Model::StandardUnit::Count_Second);
-    this->push(nackRateDatum);
+    phaseDimension.SetName("Phase");
+    phaseDimension.SetValue(phase);
 
-    retransmissionPercentDatum.SetMetricName("PercentageFramesRetransmitted");
-    retransmissionPercentDatum.SetValue(pOutboundRtpStats->retxBytesPercentage);
-    retransmissionPercentDatum.SetUnit(Aws::CloudWatch::Model::StandardUnit::Percent);
-    this->push(retransmissionPercentDatum);
+    this->pushValue("ConnectionPhaseLatency", latency, Aws::CloudWatch::Model::StandardUnit::Milliseconds, &phaseDimension);
 }
 
-VOID CloudwatchMonitoring::pushInboundRtpStats(Canary::PIncomingRTPMetricsContext pIncomingRtpStats)
+VOID CloudwatchMonitoring::pushValue(const Aws::String& name, DOUBLE value, Aws::CloudWatch::Model::StandardUnit unit, const Dimension* pDimension)
 {
-    MetricDatum incomingBitrateDatum, incomingPacketRate, incomingFrameDropRateDatum;
+    MetricDatum datum;
+
+    datum.SetMetricName(name);
+    datum.SetValue(value);
+    datum.SetUnit(unit);
+    if (pDimension != nullptr) {
+        datum.AddDimensions(*pDimension);
+    }
+
+    this->push(datum);
+}
 
-    incomingBitrateDatum.SetMetricName("IncomingBitRate");
-    incomingBitrateDatum.SetValue(pIncomingRtpStats->incomingBitRate);
-    incomingBitrateDatum.SetUnit(Aws::CloudWatch::Model::StandardUnit::Kilobits_Second);
-    this->push(incomingBitrateDatum);
+VOID CloudwatchMonitoring::pushTrackStatsRates(const Canary::TrackStatsRates& rates, const Aws::String& kind)
+{
+    Dimension kindDimension;
 
-    incomingPacketRate.SetMetricName("IncomingPacketsPerSecond");
-    incomingPacketRate.SetValue(pIncomingRtpStats->packetReceiveRate);
-    incomingPacketRate.SetUnit(Aws::CloudWatch::Model::StandardUnit::Count_Second);
-    this->push(incomingPacketRate);
+    kindDimension.SetName("TrackKind");
+    kindDimension.SetValue(kind);
 
-    incomingFrameDropRateDatum.SetMetricName("IncomingFramesDroppedPerSecond");
-    incomingFrameDropRateDatum.SetValue(pIncomingRtpStats->framesDroppedPerSecond);
-    incomingFrameDropRateDatum.SetUnit(Aws::CloudWatch::Model::StandardUnit::Count_Second);
-    this->push(incomingFrameDropRateDatum);
+    this->pushValue("OutgoingBitRate", rates.outgoingBitRate, Aws::CloudWatch::Model::StandardUnit::Kilobits_Second, &kindDimension);
+    this->pushValue("OutgoingPacketsPerSecond", rates.outgoingPacketRate, Aws::CloudWatch::Model::StandardUnit::Count_Second, &kindDimension);
+    this->pushValue("IncomingBitRate", rates.incomingBitRate, Aws::CloudWatch::Model::StandardUnit::Kilobits_Second, &kindDimension);
+    this->pushValue("IncomingPacketsPerSecond", rates.incomingPacketRate, Aws::CloudWatch::Model::StandardUnit::Count_Second, &kindDimension);
+}
+
+VOID CloudwatchMonitoring::pushStatsRates(const Canary::StatsRates& rates)
+{
+    // Video metrics keep their original names and dimensions so existing dashboards and alarms still work
+    this->pushValue("PercentageFrameDiscarded", rates.framesPercentageDiscarded, Aws::CloudWatch::Model::StandardUnit::Percent);
+    this->pushValue("FramesPerSecond", rates.video.framesSentPerSecond, Aws::CloudWatch::Model::StandardUnit::Count_Second);
+    this->pushValue("NackPerSecond", rates.video.nacksPerSecond, Aws::CloudWatch::Model::StandardUnit::Count_Second);
+    this->pushValue("PliPerSecond", rates.video.plisPerSecond, Aws::CloudWatch::Model::StandardUnit::Count_Second);
+    this->pushValue("PercentageFramesRetransmitted", rates.retxBytesPercentage, Aws::CloudWatch::Model::StandardUnit::Percent);
+    this->pushValue("IncomingBitRate", rates.video.incomingBitRate, Aws::CloudWatch::Model::StandardUnit::Kilobits_Second);
+    this->pushValue("IncomingPacketsPerSecond", rates.video.incomingPacketRate, Aws::CloudWatch::Model::StandardUnit::Count_Second);
+    this->pushValue("IncomingFramesDroppedPerSecond", rates.video.framesDroppedPerSecond, Aws::CloudWatch::Model::StandardUnit::Count_Second);
+
+    this->pushTrackStatsRates(rates.audio, "Audio");
+    this->pushTrackStatsRates(rates.video, "Video");
+
+    if (rates.candidatePairValid) {
+        this->pushValue("IceCandidatePairRoundTripTime", rates.roundTripTime, Aws::CloudWatch::Model::StandardUnit::Milliseconds);
+        this->pushValue("IceCandidatePairAvailableOutgoingBitRate", rates.availableOutgoingBitrate,
+                        Aws::CloudWatch::Model::StandardUnit::Kilobits_Second);
+        this->pushValue("IceCandidatePairOutgoingBitRate", rates.candidatePairOutgoingBitRate, Aws::CloudWatch::Model::StandardUnit::Kilobits_Second);
+        this->pushValue("IceCandidatePairIncomingBitRate", rates.candidatePairIncomingBitRate, Aws::CloudWatch::Model::StandardUnit::Kilobits_Second);
+        this->pushValue("IceCandidatePairPacketsDiscardedPerSecond", rates.candidatePairPacketsDiscardedPerSecond,
+                        Aws::CloudWatch::Model::StandardUnit::Count_Second);
+    }
+
+    if (rates.transportValid) {
+        this->pushValue("TransportOutgoingBitRate", rates.transportOutgoingBitRate, Aws::CloudWatch::Model::StandardUnit::Kilobits_Second);
+        this->pushValue("TransportIncomingBitRate", rates.transportIncomingBitRate, Aws::CloudWatch::Model::StandardUnit::Kilobits_Second);
+    }
+}
+
+VOID CloudwatchMonitoring::pushImpairmentStats(const Canary::ImpairmentStats& stats)
+{
+    DOUBLE duration = (DOUBLE) stats.duration / HUNDREDS_OF_NANOS_IN_A_SECOND;
+    UINT64 impaired = stats.lost + stats.queueDropped;
+
+    if (duration <= 0) {
+        return;
+    }
+
+    this->pushValue("ImpairmentPhase", stats.phase, Aws::CloudWatch::Model::StandardUnit::None);
+    this->pushValue("ImpairmentForwardedBitRate", (DOUBLE) stats.forwardedBytes * 8.0 / 1000.0 / duration,
+                    Aws::CloudWatch::Model::StandardUnit::Kilobits_Second);
+    this->pushValue("ImpairmentLossPercentage", stats.received == 0 ? 0.0 : (DOUBLE) impaired / (DOUBLE) stats.received * 100.0,
+                    Aws::CloudWatch::Model::StandardUnit::Percent);
+    this->pushValue("ImpairmentQueueDropsPerSecond", (DOUBLE) stats.queueDropped / duration, Aws::CloudWatch::Model::StandardUnit::Count_Second);
+    this->pushValue("ImpairmentReorderedPerSecond", (DOUBLE) stats.reordered / duration, Aws::CloudWatch::Model::StandardUnit::Count_Second);
+}
+
+VOID CloudwatchMonitoring::pushChurnStats(DOUBLE setupsPerSecond, const std::map<UINT64, UINT64>& setupLatencies,
+                                          const std::map<UINT64, UINT64>& teardownLatencies, const std::map<std::string, UINT64>& errors)
+{
+    Dimension errorDimension;
+
+    this->pushValue("ChurnSetupsPerSecond", setupsPerSecond, Aws::CloudWatch::Model::StandardUnit::Count_Second);
+    this->pushDistribution("ChurnSetupLatency", setupLatencies, Aws::CloudWatch::Model::StandardUnit::Milliseconds);
+    this->pushDistribution("ChurnTeardownLatency", teardownLatencies, Aws::CloudWatch::Model::StandardUnit::Milliseconds);
+
+    errorDimension.SetName("Error");
+    for (auto& error : errors) {
+        errorDimension.SetValue(error.first.c_str());
+        this->pushValue("ChurnSetupErrors", error.second, Aws::CloudWatch::Model::StandardUnit::Count, &errorDimension);
+    }
+}
+
+VOID CloudwatchMonitoring::pushChurnGrowth(const Canary::ResourceDelta& growth)
+{
+    this->pushValue("ChurnRssGrowthPerCycle", growth.rss, Aws::CloudWatch::Model::StandardUnit::Bytes);
+    this->pushValue("ChurnHeapGrowthPerCycle", growth.heap, Aws::CloudWatch::Model::StandardUnit::Bytes);
+    this->pushValue("ChurnFdGrowthPerCycle", growth.fds, Aws::CloudWatch::Model::StandardUnit::Count);
+    this->pushValue("ChurnThreadGrowthPerCycle", growth.threads, Aws::CloudWatch::Model::StandardUnit::Count);
+}
+
+VOID CloudwatchMonitoring::pushChurnLeaks(const Canary::ResourceDelta& leaked)
+{
+    this->pushValue("ChurnLeakedHeap", leaked.heap, Aws::CloudWatch::Model::StandardUnit::Bytes);
+    this->pushValue("ChurnLeakedFds", leaked.fds, Aws::CloudWatch::Model::StandardUnit::Count);
+    this->pushValue("ChurnLeakedThreads", leaked.threads, Aws::CloudWatch::Model::StandardUnit::Count);
+}
+
+VOID CloudwatchMonitoring::pushDataChannelStats(PCHAR mode, const std::map<UINT64, UINT64>& latencies, DOUBLE throughput, UINT64 peakBuffered,
+                                                DOUBLE rejectedPerSecond)
+{
+    Dimension modeDimension;
+
+    modeDimension.SetName("Mode");
+    modeDimension.SetValue(mode);
+
+    this->pushDistribution("DataChannelEchoLatency", latencies, Aws::CloudWatch::Model::StandardUnit::Milliseconds, &modeDimension);
+    this->pushValue("DataChannelThroughput", throughput, Aws::CloudWatch::Model::StandardUnit::Megabytes_Second, &modeDimension);
+    this->pushValue("DataChannelPeakBufferedAmount", peakBuffered, Aws::CloudWatch::Model::StandardUnit::Bytes, &modeDimension);
+    this->pushValue("DataChannelSendsRejectedPerSecond", rejectedPerSecond, Aws::CloudWatch::Model::StandardUnit::Count_Second, &modeDimension);
 }
 
 VOID CloudwatchMonitoring::pushEndToEndMetrics(Canary::EndToEndMetricsContext ctx)
@@ -278,6 +443,69 @@ VOID CloudwatchMonitoring::pushEndToEndMetrics(Canary::EndToEndMetricsContext ct
     this->push(sizeMatchDatum);
 }
 
+VOID CloudwatchMonitoring::pushAudioMetrics(const Canary::AudioMetricsContext& ctx)
+{
+    UINT64 expected = ctx.framesReceived + ctx.framesLost;
+
+    // Nothing to say when the remote peer doesn't send canary audio
+    if (expected == 0) {
+        return;
+    }
+
+    DLOGD("Audio frames received %lu, lost %lu, jitter %4.2lf ms", ctx.framesReceived, ctx.framesLost,
+          ctx.jitter / HUNDREDS_OF_NANOS_IN_A_MILLISECOND);
+    this->pushDistribution("AudioFrameLatency", ctx.latencies, Aws::CloudWatch::Model::StandardUnit::Milliseconds);
+    this->pushValue("AudioFrameLossPercentage", 100.0 * ctx.framesLost / expected, Aws::CloudWatch::Model::StandardUnit::Percent);
+    this->pushValue("AudioJitter", ctx.jitter / HUNDREDS_OF_NANOS_IN_A_MILLISECOND, Aws::CloudWatch::Model::StandardUnit::Milliseconds);
+    this->pushDistribution("AVSyncSkew", ctx.syncSkews, Aws::CloudWatch::Model::StandardUnit::Milliseconds);
+}
+
+VOID CloudwatchMonitoring::pushFrameTrackerStats(const Canary::FrameTrackerStats& stats, const Aws::String& kind)
+{
+    Dimension kindDimension;
+
+    // Nothing to say about a track that was never received
+    if (stats.received == 0 && stats.lost == 0) {
+        return;
+    }
+
+    kindDimension.SetName("TrackKind");
+    kindDimension.SetValue(kind);
+
+    this->pushValue("FramesLost", stats.lost, Aws::CloudWatch::Model::StandardUnit::Count, &kindDimension);
+    this->pushValue("FramesLate", stats.late, Aws::CloudWatch::Model::StandardUnit::Count, &kindDimension);
+    this->pushValue("FramesDuplicated", stats.duplicated, Aws::CloudWatch::Model::StandardUnit::Count, &kindDimension);
+    this->pushDistribution("FrameArrivalInterval", stats.intervals, Aws::CloudWatch::Model::StandardUnit::Milliseconds, &kindDimension);
+    this->pushValue("FreezeCount", stats.freezes, Aws::CloudWatch::Model::StandardUnit::Count, &kindDimension);
+    this->pushValue("TotalFreezeDuration", (DOUBLE) stats.freezeDuration / HUNDREDS_OF_NANOS_IN_A_MILLISECOND,
+                    Aws::CloudWatch::Model::StandardUnit::Milliseconds, &kindDimension);
+}
+
+VOID CloudwatchMonitoring::pushResourceStats(const Canary::ResourceStats& stats, PCHAR unitName)
+{
+    Dimension threadDimension, switchDimension;
+
+    this->pushValue("ProcessCpuUsage", stats.cpu, Aws::CloudWatch::Model::StandardUnit::Percent);
+    if (unitName != NULL) {
+        this->pushValue(Aws::String("ProcessCpuUsagePer") + unitName, stats.cpuPerUnit, Aws::CloudWatch::Model::StandardUnit::Percent);
+    }
+    this->pushValue("ProcessRss", stats.usage.rss, Aws::CloudWatch::Model::StandardUnit::Bytes);
+    this->pushValue("ProcessThreads", stats.usage.threads, Aws::CloudWatch::Model::StandardUnit::Count);
+    this->pushValue("ProcessOpenFds", stats.usage.fds, Aws::CloudWatch::Model::StandardUnit::Count);
+
+    switchDimension.SetName("Type");
+    switchDimension.SetValue("Voluntary");
+    this->pushValue("ContextSwitchesPerSecond", stats.voluntarySwitches, Aws::CloudWatch::Model::StandardUnit::Count_Second, &switchDimension);
+    switchDimension.SetValue("Involuntary");
+    this->pushValue("ContextSwitchesPerSecond", stats.involuntarySwitches, Aws::CloudWatch::Model::StandardUnit::Count_Second, &switchDimension);
+
+    threadDimension.SetName("Thread");
+    for (auto& thread : stats.threadCpu) {
+        threadDimension.SetValue(thread.first);
+        this->pushValue("ThreadCpuUsage", thread.second, Aws::CloudWatch::Model::StandardUnit::Percent, &threadDimension);
+    }
+}
+
 VOID CloudwatchMonitoring::pushRetryCount(UINT32 retryCount)
 {
     MetricDatum currentRetryCountDatum;
@@ -8,24 +8,47 @@ class CloudwatchMonitoring {
     STATUS init();
     VOID deinit();
     VOID push(const MetricDatum&);
+    VOID setSegment(const std::string&);
     VOID pushExitStatus(STATUS);
     VOID pushSignalingRoundtripStatus(STATUS);
     VOID pushSignalingInitDelay(UINT64, Aws::CloudWatch::Model::StandardUnit);
     VOID pushTimeToFirstFrame(UINT64, Aws::CloudWatch::Model::StandardUnit);
     VOID pushSignalingRoundtripLatency(UINT64, Aws::CloudWatch::Model::StandardUnit);
+    VOID pushSignalingRoundtripLatencies(const std::map<UINT64, UINT64>&);
+    VOID pushSignalingLoadThroughput(DOUBLE, DOUBLE, UINT64);
+    VOID pushSignalingRoundtripErrors(const std::string&, UINT64);
     VOID pushSignalingConnectionDuration(UINT64, Aws::CloudWatch::Model::StandardUnit);
     VOID pushICEHolePunchingDelay(UINT64, Aws::CloudWatch::Model::StandardUnit);
-    VOID pushOutboundRtpStats(Canary::POutgoingRTPMetricsContext);
-    VOID pushInboundRtpStats(Canary::PIncomingRTPMetricsContext);
+    VOID pushTurnProbeRtt(DOUBLE);
+    VOID pushTurnProbeTimeouts(UINT64);
+    VOID pushTurnAllocationTime(DOUBLE);
+    VOID pushConnectionPhaseLatency(PCHAR, DOUBLE);
+    VOID pushStatsRates(const Canary::StatsRates&);
     VOID pushEndToEndMetrics(Canary::EndToEndMetricsContext);
+    VOID pushAudioMetrics(const Canary::AudioMetricsContext&);
+    VOID pushFrameTrackerStats(const Canary::FrameTrackerStats&, const Aws::String&);
+    VOID pushImpairmentStats(const Canary::ImpairmentStats&);
+    VOID pushChurnStats(DOUBLE, const std::map<UINT64, UINT64>&, const std::map<UINT64, UINT64>&, const std::map<std::string, UINT64>&);
+    VOID pushChurnGrowth(const Canary::ResourceDelta&);
+    VOID pushChurnLeaks(const Canary::ResourceDelta&);
+    VOID pushResourceStats(const Canary::ResourceStats&, PCHAR);
+    VOID pushDataChannelStats(PCHAR, const std::map<UINT64, UINT64>&, DOUBLE, UINT64, DOUBLE);
     VOID pushRetryCount(UINT32);
 
   private:
+    VOID pushValue(const Aws::String&, DOUBLE, Aws::CloudWatch::Model::StandardUnit, const Dimension* = nullptr);
+    VOID pushTrackStatsRates(const Canary::TrackStatsRates&, const Aws::String&);
+    template <typename T>
+    VOID pushDistribution(const Aws::String&, const std::map<T, UINT64>&, Aws::CloudWatch::Model::StandardUnit, const Dimension* = nullptr);
+
     Dimension channelDimension;
     Dimension labelDimension;
+    // Set once a load profile is running, every metric then also goes out with the segment it was measured in
+    std::mutex segmentMutex;
+    Dimension segmentDimension;
+    BOOL segmented = FALSE;
     PConfig pConfig;
-    CloudWatchClient client;
-    std::atomic<UINT64> pendingMetrics;
+    std::unique_ptr<MetricsSink> sink;
 };
 
 } // namespace Canary
@@ -30,6 +30,13 @@ STATUS Config::init(INT32 argc, PCHAR argv[])
         iterationDuration.value = CANARY_MIN_ITERATION_DURATION;
     }
 
+    // Signaling load mode needs at least one channel and a non-zero offer rate
+    if (signalingLoadViewerCount.value != 0 && (signalingLoadChannelCount.value == 0 || signalingLoadOfferRate.value == 0)) {
+        DLOGW("Signaling load needs at least 1 channel and 1 offer per second. Overriding with the defaults.");
+        signalingLoadChannelCount.value = MAX(signalingLoadChannelCount.value, CANARY_DEFAULT_SIGNALING_LOAD_CHANNELS);
+        signalingLoadOfferRate.value = MAX(signalingLoadOfferRate.value, CANARY_DEFAULT_SIGNALING_LOAD_RATE);
+    }
+
 CleanUp:
 
     return retStatus;
@@ -198,6 +205,7 @@ STATUS Config::initWithEnvVars()
     }
 
     CHK_STATUS(optenv(CANARY_ENDPOINT_ENV_VAR, &endpoint, ""));
+    CHK_STATUS(optenv(CANARY_STUN_URL_ENV_VAR, &stunUrl, ""));
     CHK_STATUS(optenv(CANARY_LABEL_ENV_VAR, &label, CANARY_DEFAULT_LABEL));
 
     CHK_STATUS(optenv(CANARY_CLIENT_ID_ENV_VAR, &clientId, CANARY_DEFAULT_CLIENT_ID));
@@ -208,6 +216,8 @@ STATUS Config::initWithEnvVars()
     defaultLogStreamName << channelName.value << '-' << (isMaster.value ? "master" : "viewer") << '-'
                           << GETTIME() / HUNDREDS_OF_NANOS_IN_A_MILLISECOND;
     CHK_STATUS(optenv(CANARY_LOG_STREAM_NAME_ENV_VAR, &this->logStreamName, defaultLogStreamName.str()));
+    CHK_STATUS(optenv(CANARY_METRICS_SINK_ENV_VAR, &this->metricsSink, CANARY_METRICS_SINK_CLOUDWATCH));
+    CHK_STATUS(optenv(CANARY_CLOUDWATCH_ENDPOINT_ENV_VAR, &this->cloudwatchEndpoint, ""));
 
     if (!duration.initialized) {
         CHK_STATUS(optenvUint64(CANARY_DURATION_IN_SECONDS_ENV_VAR, &duration, 0));
@@ -222,6 +232,23 @@ STATUS Config::initWithEnvVars()
 
     CHK_STATUS(optenvUint64(CANARY_BIT_RATE_ENV_VAR, &bitRate, CANARY_DEFAULT_BITRATE));
     CHK_STATUS(optenvUint64(CANARY_FRAME_RATE_ENV_VAR, &frameRate, CANARY_DEFAULT_FRAMERATE));
+    CHK_STATUS(optenvBool(CANARY_SEND_AUDIO_ENV_VAR, &sendAudio, TRUE));
+    CHK_STATUS(optenvUint64(CANARY_FREEZE_INTERVALS_ENV_VAR, &freezeIntervals, CANARY_DEFAULT_FREEZE_INTERVALS));
+
+    CHK_STATUS(optenvUint64(CANARY_SIGNALING_LOAD_CHANNELS_ENV_VAR, &signalingLoadChannelCount, CANARY_DEFAULT_SIGNALING_LOAD_CHANNELS));
+    CHK_STATUS(optenvUint64(CANARY_SIGNALING_LOAD_VIEWERS_ENV_VAR, &signalingLoadViewerCount, CANARY_DEFAULT_SIGNALING_LOAD_VIEWERS));
+    CHK_STATUS(optenvUint64(CANARY_SIGNALING_LOAD_RATE_ENV_VAR, &signalingLoadOfferRate, CANARY_DEFAULT_SIGNALING_LOAD_RATE));
+    CHK_STATUS(optenvUint64(CANARY_CHURN_CONCURRENCY_ENV_VAR, &churnConcurrency, 0));
+    if (!churnStreamDuration.initialized) {
+        CHK_STATUS(optenvUint64(CANARY_CHURN_STREAM_DURATION_ENV_VAR, &churnStreamDuration, CANARY_DEFAULT_CHURN_STREAM_DURATION_IN_MILLISECONDS));
+        churnStreamDuration.value *= HUNDREDS_OF_NANOS_IN_A_MILLISECOND;
+    }
+    CHK_STATUS(optenvUint64(CANARY_DATA_CHANNEL_COUNT_ENV_VAR, &dataChannelCount, 0));
+    CHK_STATUS(optenvUint64(CANARY_DATA_CHANNEL_ECHO_SIZE_ENV_VAR, &dataChannelEchoSize, CANARY_DEFAULT_DATA_CHANNEL_ECHO_SIZE));
+    CHK_STATUS(optenvUint64(CANARY_DATA_CHANNEL_BULK_SIZE_ENV_VAR, &dataChannelBulkSize, CANARY_DEFAULT_DATA_CHANNEL_BULK_SIZE));
+    CHK_STATUS(optenvUint64(CANARY_DATA_CHANNEL_WINDOW_ENV_VAR, &dataChannelBulkWindow, CANARY_DEFAULT_DATA_CHANNEL_BULK_WINDOW));
+    CHK_STATUS(optenv(CANARY_IMPAIRMENT_PROFILE_ENV_VAR, &impairmentProfile, ""));
+    CHK_STATUS(optenv(CANARY_LOAD_PROFILE_ENV_VAR, &loadProfile, ""));
 
 CleanUp:
 
@@ -239,19 +266,43 @@ VOID Config::print()
           "\tRole            : %s\n"
           "\tTrickle ICE     : %s\n"
           "\tUse TURN        : %s\n"
+          "\tSTUN URL        : %s\n"
           "\tLog Level       : %u\n"
           "\tLog Group       : %s\n"
           "\tLog Stream      : %s\n"
+          "\tMetrics Sink    : %s\n"
+          "\tCW Endpoint     : %s\n"
           "\tDuration        : %lu seconds\n"
           "\tIteration       : %lu seconds\n"
           "\tRun both peers  : %s\n"
+          "\tSend audio      : %s\n"
+          "\tFreeze after    : %lu frame intervals\n"
           "\tCredential type : %s\n"
+          "\tLoad channels   : %lu\n"
+          "\tLoad viewers    : %lu\n"
+          "\tLoad offer rate : %lu per second\n"
+          "\tChurn overlap   : %lu\n"
+          "\tChurn streaming : %lu ms\n"
+          "\tData channels   : %lu\n"
+          "\tDC echo size    : %lu bytes\n"
+          "\tDC bulk size    : %lu bytes\n"
+          "\tDC bulk window  : %lu bytes\n"
+          "\tImpairment      : %s\n"
+          "\tLoad profile    : %s\n"
           "\n",
           this->endpoint.value.c_str(), this->region.value.c_str(), this->label.value.c_str(), this->channelName.value.c_str(),
           this->clientId.value.c_str(), this->isMaster.value ? "Master" : "Viewer", this->trickleIce.value ? "True" : "False",
-          this->useTurn.value ? "True" : "False", this->logLevel.value, this->logGroupName.value.c_str(), this->logStreamName.value.c_str(),
+          this->useTurn.value ? "True" : "False", this->stunUrl.value.empty() ? "(derived)" : this->stunUrl.value.c_str(), this->logLevel.value,
+          this->logGroupName.value.c_str(), this->logStreamName.value.c_str(), this->metricsSink.value.c_str(),
+          this->cloudwatchEndpoint.value.empty() ? "(regional)" : this->cloudwatchEndpoint.value.c_str(),
           this->duration.value / HUNDREDS_OF_NANOS_IN_A_SECOND, this->iterationDuration.value / HUNDREDS_OF_NANOS_IN_A_SECOND,
-          this->runBothPeers.value ? "True" : "False", this->useIotCredentialProvider.value ? "IoT" : "Static");
+          this->runBothPeers.value ? "True" : "False", this->sendAudio.value ? "True" : "False", this->freezeIntervals.value,
+          this->useIotCredentialProvider.value ? "IoT" : "Static",
+          this->signalingLoadChannelCount.value, this->signalingLoadViewerCount.value, this->signalingLoadOfferRate.value,
+          this->churnConcurrency.value, this->churnStreamDuration.value / HUNDREDS_OF_NANOS_IN_A_MILLISECOND,
+          this->dataChannelCount.value, this->dataChannelEchoSize.value, this->dataChannelBulkSize.value, this->dataChannelBulkWindow.value,
+          this->impairmentProfile.value.empty() ? "(none)" : this->impairmentProfile.value.c_str(),
+          this->loadProfile.value.empty() ? "(constant)" : this->loadProfile.value.c_str());
     if(this->useIotCredentialProvider.value) {
         DLOGD("\tIoT endpoint : %s\n"
               "\tIoT cert filename : %s\n"
@@ -311,6 +362,8 @@ STATUS Config::initWithJSON(PCHAR filePath)
     for (UINT32 i = 0; i < (UINT32) r; i++) {
         if (compareJsonString((PCHAR) raw, &tokens[i], JSMN_STRING, (PCHAR) CANARY_ENDPOINT_ENV_VAR)) {
             jsonString(raw, tokens[++i], &endpoint);
+        } else if (compareJsonString((PCHAR) raw, &tokens[i], JSMN_STRING, (PCHAR) CANARY_STUN_URL_ENV_VAR)) {
+            jsonString(raw, tokens[++i], &stunUrl);
         } else if (compareJsonString((PCHAR) raw, &tokens[i], JSMN_STRING, (PCHAR) CANARY_LABEL_ENV_VAR)) {
             jsonString(raw, tokens[++i], &label);
         } else if (compareJsonString((PCHAR) raw, &tokens[i], JSMN_STRING, (PCHAR) CANARY_CHANNEL_NAME_ENV_VAR)) {
@@ -327,6 +380,10 @@ STATUS Config::initWithJSON(PCHAR filePath)
             jsonString(raw, tokens[++i], &logGroupName);
         } else if (compareJsonString((PCHAR) raw, &tokens[i], JSMN_STRING, (PCHAR) CANARY_LOG_STREAM_NAME_ENV_VAR)) {
             jsonString(raw, tokens[++i], &logStreamName);
+        } else if (compareJsonString((PCHAR) raw, &tokens[i], JSMN_STRING, (PCHAR) CANARY_METRICS_SINK_ENV_VAR)) {
+            jsonString(raw, tokens[++i], &metricsSink);
+        } else if (compareJsonString((PCHAR) raw, &tokens[i], JSMN_STRING, (PCHAR) CANARY_CLOUDWATCH_ENDPOINT_ENV_VAR)) {
+            jsonString(raw, tokens[++i], &cloudwatchEndpoint);
         } else if (compareJsonString((PCHAR) raw, &tokens[i], JSMN_STRING, (PCHAR) CANARY_DURATION_IN_SECONDS_ENV_VAR)) {
             jsonUint64(raw, tokens[++i], &duration);
             duration.value *= HUNDREDS_OF_NANOS_IN_A_SECOND;
@@ -339,6 +396,33 @@ STATUS Config::initWithJSON(PCHAR filePath)
             jsonUint64(raw, tokens[++i], &bitRate);
         } else if (compareJsonString((PCHAR) raw, &tokens[i], JSMN_STRING, (PCHAR) CANARY_FRAME_RATE_ENV_VAR)) {
             jsonUint64(raw, tokens[++i], &frameRate);
+        } else if (compareJsonString((PCHAR) raw, &tokens[i], JSMN_STRING, (PCHAR) CANARY_SEND_AUDIO_ENV_VAR)) {
+            jsonBool(raw, tokens[++i], &sendAudio);
+        } else if (compareJsonString((PCHAR) raw, &tokens[i], JSMN_STRING, (PCHAR) CANARY_FREEZE_INTERVALS_ENV_VAR)) {
+            jsonUint64(raw, tokens[++i], &freezeIntervals);
+        } else if (compareJsonString((PCHAR) raw, &tokens[i], JSMN_STRING, (PCHAR) CANARY_SIGNALING_LOAD_CHANNELS_ENV_VAR)) {
+            jsonUint64(raw, tokens[++i], &signalingLoadChannelCount);
+        } else if (compareJsonString((PCHAR) raw, &tokens[i], JSMN_STRING, (PCHAR) CANARY_SIGNALING_LOAD_VIEWERS_ENV_VAR)) {
+            jsonUint64(raw, tokens[++i], &signalingLoadViewerCount);
+        } else if (compareJsonString((PCHAR) raw, &tokens[i], JSMN_STRING, (PCHAR) CANARY_SIGNALING_LOAD_RATE_ENV_VAR)) {
+            jsonUint64(raw, tokens[++i], &signalingLoadOfferRate);
+        } else if (compareJsonString((PCHAR) raw, &tokens[i], JSMN_STRING, (PCHAR) CANARY_CHURN_CONCURRENCY_ENV_VAR)) {
+            jsonUint64(raw, tokens[++i], &churnConcurrency);
+        } else if (compareJsonString((PCHAR) raw, &tokens[i], JSMN_STRING, (PCHAR) CANARY_CHURN_STREAM_DURATION_ENV_VAR)) {
+            jsonUint64(raw, tokens[++i], &churnStreamDuration);
+            churnStreamDuration.value *= HUNDREDS_OF_NANOS_IN_A_MILLISECOND;
+        } else if (compareJsonString((PCHAR) raw, &tokens[i], JSMN_STRING, (PCHAR) CANARY_DATA_CHANNEL_COUNT_ENV_VAR)) {
+            jsonUint64(raw, tokens[++i], &dataChannelCount);
+        } else if (compareJsonString((PCHAR) raw, &tokens[i], JSMN_STRING, (PCHAR) CANARY_DATA_CHANNEL_ECHO_SIZE_ENV_VAR)) {
+            jsonUint64(raw, tokens[++i], &dataChannelEchoSize);
+        } else if (compareJsonString((PCHAR) raw, &tokens[i], JSMN_STRING, (PCHAR) CANARY_DATA_CHANNEL_BULK_SIZE_ENV_VAR)) {
+            jsonUint64(raw, tokens[++i], &dataChannelBulkSize);
+        } else if (compareJsonString((PCHAR) raw, &tokens[i], JSMN_STRING, (PCHAR) CANARY_DATA_CHANNEL_WINDOW_ENV_VAR)) {
+            jsonUint64(raw, tokens[++i], &dataChannelBulkWindow);
+        } else if (compareJsonString((PCHAR) raw, &tokens[i], JSMN_STRING, (PCHAR) CANARY_IMPAIRMENT_PROFILE_ENV_VAR)) {
+            jsonString(raw, tokens[++i], &impairmentProfile);
+        } else if (compareJsonString((PCHAR) raw, &tokens[i], JSMN_STRING, (PCHAR) CANARY_LOAD_PROFILE_ENV_VAR)) {
+            jsonString(raw, tokens[++i], &loadProfile);
         } else if (compareJsonString((PCHAR) raw, &tokens[i], JSMN_STRING, (PCHAR) CANARY_RUN_BOTH_PEERS_ENV_VAR)) {
             jsonBool(raw, tokens[++i], &runBothPeers);
         } else if (compareJsonString((PCHAR) raw, &tokens[i], JSMN_STRING, (PCHAR) DEFAULT_REGION_ENV_VAR)) {
@@ -15,6 +15,7 @@ class Config {
     };
 
     Value<std::string> endpoint;
+    Value<std::string> stunUrl;
     Value<std::string> label;
     Value<std::string> channelName;
     Value<std::string> clientId;
@@ -40,10 +41,39 @@ class Config {
     Value<std::string> logGroupName;
     Value<std::string> logStreamName;
 
+    // metrics
+    Value<std::string> metricsSink;
+    // Overrides the Cloudwatch and Cloudwatch Logs endpoints, e.g. http://localhost:9090 for kvsWebrtcMockCloudwatch
+    Value<std::string> cloudwatchEndpoint;
+
     Value<UINT64> duration;
     Value<UINT64> iterationDuration;
     Value<UINT64> bitRate;
     Value<UINT64> frameRate;
+    Value<BOOL> sendAudio;
+    // a gap between two received frames longer than this many frame intervals is a freeze
+    Value<UINT64> freezeIntervals;
+
+    // signaling load
+    Value<UINT64> signalingLoadChannelCount;
+    Value<UINT64> signalingLoadViewerCount;
+    Value<UINT64> signalingLoadOfferRate;
+
+    // connection churn, off unless churnConcurrency is set
+    Value<UINT64> churnConcurrency;
+    Value<UINT64> churnStreamDuration;
+
+    // data channel benchmark next to the media, off unless dataChannelCount is set. Sizes and window are in bytes
+    Value<UINT64> dataChannelCount;
+    Value<UINT64> dataChannelEchoSize;
+    Value<UINT64> dataChannelBulkSize;
+    Value<UINT64> dataChannelBulkWindow;
+
+    // network impairment applied between the peers of runBothPeers, see ImpairmentRelay
+    Value<std::string> impairmentProfile;
+
+    // bitrate, frame rate and key frame schedule of the sent video, see LoadProfile
+    Value<std::string> loadProfile;
 
     Value<std::string> caCertPath;
 
@@ -0,0 +1,119 @@
+#include "Include.h"
+
+namespace Canary {
+
+ConnectionTimeline::ConnectionTimeline() : startTime(0), published(false), isMaster(FALSE)
+{
+    for (auto& phase : this->phases) {
+        phase = 0;
+    }
+}
+
+UINT64 ConnectionTimeline::now()
+{
+    // GETTIME follows the wall clock, phase latencies must not jump with NTP adjustments
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count() /
+        DEFAULT_TIME_UNIT_IN_NANOS;
+}
+
+PCHAR ConnectionTimeline::getPhaseName(CONNECTION_PHASE phase)
+{
+    switch (phase) {
+        case CONNECTION_PHASE_SIGNALING_CREATED:
+            return (PCHAR) "SignalingCreated";
+        case CONNECTION_PHASE_SIGNALING_FETCHED:
+            return (PCHAR) "SignalingFetched";
+        case CONNECTION_PHASE_SIGNALING_CONNECTED:
+            return (PCHAR) "SignalingConnected";
+        case CONNECTION_PHASE_ICE_CONFIG_READY:
+            return (PCHAR) "IceConfigReady";
+        case CONNECTION_PHASE_OFFER:
+            return (PCHAR) "Offer";
+        case CONNECTION_PHASE_ANSWER:
+            return (PCHAR) "Answer";
+        case CONNECTION_PHASE_RELAY_CANDIDATE:
+            return (PCHAR) "RelayCandidate";
+        case CONNECTION_PHASE_ICE_GATHERING_DONE:
+            return (PCHAR) "IceGatheringDone";
+        case CONNECTION_PHASE_ICE_CHECKING:
+            return (PCHAR) "IceChecking";
+        case CONNECTION_PHASE_CONNECTED:
+            return (PCHAR) "Connected";
+        case CONNECTION_PHASE_FIRST_FRAME_SENT:
+            return (PCHAR) "FirstFrameSent";
+        case CONNECTION_PHASE_FIRST_FRAME_RECEIVED:
+            return (PCHAR) "FirstFrameReceived";
+        default:
+            return (PCHAR) "Unknown";
+    }
+}
+
+VOID ConnectionTimeline::start(const Canary::PConfig pConfig)
+{
+    this->channelName = pConfig->channelName.value;
+    this->clientId = pConfig->clientId.value;
+    this->isMaster = pConfig->isMaster.value;
+    this->startTime = now();
+}
+
+VOID ConnectionTimeline::mark(CONNECTION_PHASE phase)
+{
+    UINT64 expected = 0;
+
+    if (phase >= CONNECTION_PHASE_COUNT || this->startTime == 0) {
+        return;
+    }
+
+    // Only the first time a phase is reached counts. Zero is never a valid time since start() ran before.
+    if (!this->phases[phase].compare_exchange_strong(expected, now())) {
+        return;
+    }
+
+    if (this->phases[CONNECTION_PHASE_FIRST_FRAME_SENT] != 0 && this->phases[CONNECTION_PHASE_FIRST_FRAME_RECEIVED] != 0) {
+        this->publish();
+    }
+}
+
+VOID ConnectionTimeline::publish()
+{
+    // Shared across all timelines in the process, one JSON record per line. Master and viewer of a both peers run
+    // share the channel name, so they end up in the same file.
+    static std::mutex fileMutex;
+    static RotatingFile file((PCHAR) CANARY_TIMELINE_FILE_PATH_FORMAT, CANARY_TIMELINE_FILE_MAX_SIZE, MAX_NUMBER_OF_TIMELINE_FILES);
+
+    Aws::Utils::Json::JsonValue record, phasesJson;
+    UINT64 startTime = this->startTime.load(), phaseTime;
+    DOUBLE latency;
+    UINT32 i;
+    auto& monitoring = Canary::Cloudwatch::getInstance().monitoring;
+
+    if (startTime == 0 || this->published.exchange(true)) {
+        return;
+    }
+
+    for (i = 0; i < CONNECTION_PHASE_COUNT; i++) {
+        phaseTime = this->phases[i].load();
+        if (phaseTime == 0) {
+            continue;
+        }
+
+        latency = (DOUBLE)(phaseTime - startTime) / HUNDREDS_OF_NANOS_IN_A_MILLISECOND;
+        phasesJson.WithDouble(getPhaseName((CONNECTION_PHASE) i), latency);
+        monitoring.pushConnectionPhaseLatency(getPhaseName((CONNECTION_PHASE) i), latency);
+    }
+
+    record.WithString("ChannelName", this->channelName);
+    record.WithString("ClientId", this->clientId);
+    record.WithString("Role", this->isMaster ? "Master" : "Viewer");
+    record.WithInt64("StartTime", GETTIME() / HUNDREDS_OF_NANOS_IN_A_MILLISECOND - (now() - startTime) / HUNDREDS_OF_NANOS_IN_A_MILLISECOND);
+    record.WithObject("PhasesInMilliseconds", phasesJson);
+
+    auto json = record.View().WriteCompact();
+    DLOGI("Connection timeline: %s", json.c_str());
+
+    std::lock_guard<std::mutex> lock(fileMutex);
+    file.setPrefix(this->channelName);
+    file.write(json + "\n");
+}
+
+} // namespace Canary
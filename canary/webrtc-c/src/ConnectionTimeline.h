@@ -0,0 +1,47 @@
+#pragma once
+
+namespace Canary {
+
+typedef enum {
+    CONNECTION_PHASE_SIGNALING_CREATED,
+    CONNECTION_PHASE_SIGNALING_FETCHED,
+    CONNECTION_PHASE_SIGNALING_CONNECTED,
+    CONNECTION_PHASE_ICE_CONFIG_READY,
+    CONNECTION_PHASE_OFFER,
+    CONNECTION_PHASE_ANSWER,
+    CONNECTION_PHASE_RELAY_CANDIDATE,
+    CONNECTION_PHASE_ICE_GATHERING_DONE,
+    CONNECTION_PHASE_ICE_CHECKING,
+    CONNECTION_PHASE_CONNECTED,
+    CONNECTION_PHASE_FIRST_FRAME_SENT,
+    CONNECTION_PHASE_FIRST_FRAME_RECEIVED,
+    CONNECTION_PHASE_COUNT,
+} CONNECTION_PHASE;
+
+/*
+ * Per connection setup timeline. Every phase keeps the monotonic time it was first reached, relative to start().
+ * Marking is lock free so it can be called from signaling, ICE and media threads. The timeline is published once,
+ * as one ConnectionPhaseLatency datum per reached phase plus a JSON record, either when the first frame went both
+ * ways or at shutdown, whichever comes first.
+ */
+class ConnectionTimeline {
+  public:
+    ConnectionTimeline();
+    VOID start(const Canary::PConfig);
+    VOID mark(CONNECTION_PHASE);
+    VOID publish();
+
+    static PCHAR getPhaseName(CONNECTION_PHASE);
+
+  private:
+    static UINT64 now();
+
+    std::atomic<UINT64> startTime;
+    std::atomic<UINT64> phases[CONNECTION_PHASE_COUNT];
+    std::atomic<bool> published;
+    std::string channelName;
+    std::string clientId;
+    BOOL isMaster;
+};
+
+} // namespace Canary
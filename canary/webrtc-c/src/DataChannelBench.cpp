@@ -0,0 +1,375 @@
+#include "Include.h"
+
+namespace Canary {
+
+static BOOL isPartial(DATA_CHANNEL_MODE mode)
+{
+    return mode == DATA_CHANNEL_MODE_PARTIAL_ORDERED || mode == DATA_CHANNEL_MODE_PARTIAL_UNORDERED;
+}
+
+DataChannelBench::DataChannelBench(PConfig pConfig) : pConfig(pConfig)
+{
+    UINT64 bulkSize = pConfig->dataChannelBulkSize.value;
+
+    this->echoSize = (UINT32) MIN(MAX(pConfig->dataChannelEchoSize.value, DATA_CHANNEL_ECHO_HEADER_SIZE), DATA_CHANNEL_MAX_MESSAGE_SIZE);
+    this->bulkSize = bulkSize == 0 ? 0 : (UINT32) MIN(MAX(bulkSize, DATA_CHANNEL_BULK_HEADER_SIZE), DATA_CHANNEL_MAX_MESSAGE_SIZE);
+    // In messages, at least one has to be in flight
+    this->bulkWindow = this->bulkSize == 0 ? 0 : (UINT32) MAX(pConfig->dataChannelBulkWindow.value / this->bulkSize, 1);
+
+    this->echoBuffer.resize(this->echoSize);
+    this->bulkBuffer.resize(this->bulkSize);
+}
+
+DataChannelBench::~DataChannelBench()
+{
+    this->stop();
+}
+
+PCHAR DataChannelBench::getModeName(DATA_CHANNEL_MODE mode)
+{
+    switch (mode) {
+        case DATA_CHANNEL_MODE_RELIABLE_ORDERED:
+            return (PCHAR) "ReliableOrdered";
+        case DATA_CHANNEL_MODE_RELIABLE_UNORDERED:
+            return (PCHAR) "ReliableUnordered";
+        case DATA_CHANNEL_MODE_PARTIAL_ORDERED:
+            return (PCHAR) "PartialOrdered";
+        case DATA_CHANNEL_MODE_PARTIAL_UNORDERED:
+            return (PCHAR) "PartialUnordered";
+        default:
+            return (PCHAR) "Unknown";
+    }
+}
+
+STATUS DataChannelBench::open(PRtcPeerConnection pPeerConnection)
+{
+    STATUS retStatus = STATUS_SUCCESS;
+    RtcDataChannelInit init;
+    UINT64 now = GETTIME();
+    UINT32 i;
+
+    CHK(pPeerConnection != NULL, STATUS_NULL_ARG);
+    CHK(!this->worker.joinable(), STATUS_INVALID_OPERATION);
+    CHK_STATUS(peerConnectionOnDataChannel(pPeerConnection, (UINT64) this, onRemoteChannel));
+
+    for (i = 0; i < this->pConfig->dataChannelCount.value; i++) {
+        std::unique_ptr<Channel> channel(new Channel());
+        std::stringstream label;
+
+        channel->pBench = this;
+        channel->mode = (DATA_CHANNEL_MODE)(i % DATA_CHANNEL_MODE_COUNT);
+        label << "canary-" << getModeName(channel->mode) << '-' << i;
+
+        // Partial reliability gives up on a message after its first transmission instead of after a lifetime, which
+        // doesn't depend on the RTT of the link
+        MEMSET(&init, 0x00, SIZEOF(RtcDataChannelInit));
+        init.ordered = channel->mode == DATA_CHANNEL_MODE_RELIABLE_ORDERED || channel->mode == DATA_CHANNEL_MODE_PARTIAL_ORDERED;
+        NULLABLE_SET_EMPTY(init.maxPacketLifeTime);
+        if (isPartial(channel->mode)) {
+            NULLABLE_SET_VALUE(init.maxRetransmits, 0);
+        } else {
+            NULLABLE_SET_EMPTY(init.maxRetransmits);
+        }
+        NULLABLE_SET_EMPTY(init.id);
+
+        CHK_STATUS(createDataChannel(pPeerConnection, (PCHAR) label.str().c_str(), &init, &channel->pDataChannel));
+        CHK_STATUS(dataChannelOnOpen(channel->pDataChannel, (UINT64) channel.get(), onOpen));
+        CHK_STATUS(dataChannelOnMessage(channel->pDataChannel, (UINT64) channel.get(), onReply));
+        this->channels.push_back(std::move(channel));
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(this->statsMutex);
+        for (i = 0; i < DATA_CHANNEL_MODE_COUNT; i++) {
+            this->period[i].start = now;
+            this->total[i].start = now;
+        }
+        this->lastReportTime = now;
+    }
+
+    this->worker = std::thread(&DataChannelBench::run, this);
+
+CleanUp:
+
+    return retStatus;
+}
+
+VOID DataChannelBench::stop()
+{
+    if (this->terminated.exchange(true) || !this->worker.joinable()) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->cvar.notify_all();
+    }
+    this->worker.join();
+
+    this->report(TRUE);
+}
+
+VOID DataChannelBench::sample(UINT64 currentTime)
+{
+    if (this->worker.joinable() && currentTime - this->lastReportTime >= DATA_CHANNEL_REPORT_PERIOD) {
+        this->report(FALSE);
+        this->lastReportTime = currentTime;
+    }
+}
+
+VOID DataChannelBench::run()
+{
+    UINT64 now, wakeTime;
+    std::unique_lock<std::mutex> lock(this->mutex, std::defer_lock);
+
+    while (!this->terminated.load()) {
+        now = GETTIME();
+        wakeTime = now + DATA_CHANNEL_ECHO_PERIOD;
+
+        for (auto& channel : this->channels) {
+            if (!channel->opened.load()) {
+                continue;
+            }
+
+            if (this->pump(channel.get(), now)) {
+                wakeTime = MIN(wakeTime, now + DATA_CHANNEL_RETRY_PERIOD);
+            }
+            wakeTime = MIN(wakeTime, channel->nextEchoTime);
+        }
+
+        // Channels opening and acks coming in wake the worker up early, so the window refills as soon as it moves
+        lock.lock();
+        this->cvar.wait_for(lock, std::chrono::nanoseconds((wakeTime - MIN(now, wakeTime)) * DEFAULT_TIME_UNIT_IN_NANOS),
+                            [this]() { return this->terminated.load() || this->wake; });
+        this->wake = FALSE;
+        lock.unlock();
+    }
+}
+
+BOOL DataChannelBench::pump(Channel* pChannel, UINT64 now)
+{
+    STATUS status;
+    INT64 ackedSequence;
+    UINT64 buffered;
+    UINT32 ackEvery = MAX(this->bulkWindow / 4, 1);
+    BOOL rejected = FALSE;
+
+    if (now >= pChannel->nextEchoTime) {
+        pChannel->nextEchoTime = now + DATA_CHANNEL_ECHO_PERIOD;
+        this->echoBuffer[0] = DATA_CHANNEL_MESSAGE_ECHO_REQUEST;
+        putUnalignedInt64BigEndian((PINT64)(this->echoBuffer.data() + SIZEOF(BYTE)), now);
+        status = dataChannelSend(pChannel->pDataChannel, TRUE, this->echoBuffer.data(), this->echoSize);
+        this->record(pChannel->mode, [status](Window& window) {
+            if (STATUS_SUCCEEDED(status)) {
+                window.echoesSent++;
+            } else {
+                window.sendsRejected++;
+            }
+        });
+    }
+
+    if (this->bulkSize == 0) {
+        return FALSE;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        if (pChannel->lastAckTime == 0) {
+            pChannel->lastAckTime = now;
+        }
+
+        // Partial reliability can lose the tail of the window along with every ack that would have covered it, so a
+        // window that hasn't moved for a while is written off rather than waited for
+        if (isPartial(pChannel->mode) && (INT64) pChannel->nextSequence - 1 > pChannel->ackedSequence &&
+            now - pChannel->lastAckTime > DATA_CHANNEL_BULK_STALL_TIMEOUT) {
+            pChannel->ackedSequence = (INT64) pChannel->nextSequence - 1;
+            pChannel->lastAckTime = now;
+        }
+        ackedSequence = pChannel->ackedSequence;
+    }
+
+    while ((INT64) pChannel->nextSequence - 1 - ackedSequence < (INT64) this->bulkWindow) {
+        // Ask for an ack every quarter window and on the message that fills it
+        this->bulkBuffer[0] = pChannel->nextSequence % ackEvery == ackEvery - 1 ||
+                (INT64) pChannel->nextSequence - ackedSequence == (INT64) this->bulkWindow
+            ? DATA_CHANNEL_MESSAGE_BULK_FLUSH
+            : DATA_CHANNEL_MESSAGE_BULK;
+        putUnalignedInt32BigEndian((PINT32)(this->bulkBuffer.data() + SIZEOF(BYTE)), pChannel->nextSequence);
+        if (STATUS_FAILED(dataChannelSend(pChannel->pDataChannel, TRUE, this->bulkBuffer.data(), this->bulkSize))) {
+            rejected = TRUE;
+            break;
+        }
+
+        pChannel->nextSequence++;
+    }
+
+    buffered = ((INT64) pChannel->nextSequence - 1 - ackedSequence) * this->bulkSize;
+    this->record(pChannel->mode, [buffered, rejected](Window& window) {
+        window.peakBuffered = MAX(window.peakBuffered, buffered);
+        if (rejected) {
+            window.sendsRejected++;
+        }
+    });
+
+    return rejected;
+}
+
+VOID DataChannelBench::receiveReply(Channel* pChannel, PBYTE pMessage, UINT32 messageLen)
+{
+    UINT64 now = GETTIME(), sendTime, bytesReceived, delivered = 0;
+    UINT32 sequence;
+
+    if (messageLen >= DATA_CHANNEL_ECHO_HEADER_SIZE && pMessage[0] == DATA_CHANNEL_MESSAGE_ECHO_REPLY) {
+        sendTime = getUnalignedInt64BigEndian((PINT64)(pMessage + SIZEOF(BYTE)));
+        this->record(pChannel->mode, [now, sendTime](Window& window) {
+            window.echoesReceived++;
+            window.latencies[(now - sendTime) / HUNDREDS_OF_NANOS_IN_A_MILLISECOND]++;
+        });
+    } else if (messageLen >= DATA_CHANNEL_ACK_SIZE && pMessage[0] == DATA_CHANNEL_MESSAGE_BULK_ACK) {
+        sequence = getUnalignedInt32BigEndian((PINT32)(pMessage + SIZEOF(BYTE)));
+        bytesReceived = getUnalignedInt64BigEndian((PINT64)(pMessage + SIZEOF(BYTE) + SIZEOF(UINT32)));
+
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            // Acks can arrive out of order on unordered channels and after a write off
+            if ((INT64) sequence > pChannel->ackedSequence) {
+                pChannel->ackedSequence = sequence;
+                pChannel->lastAckTime = now;
+            }
+            if (bytesReceived > pChannel->bytesReceived) {
+                delivered = bytesReceived - pChannel->bytesReceived;
+                pChannel->bytesReceived = bytesReceived;
+            }
+            this->wake = TRUE;
+            this->cvar.notify_all();
+        }
+
+        this->record(pChannel->mode, [delivered](Window& window) { window.bytesDelivered += delivered; });
+    }
+}
+
+VOID DataChannelBench::receiveRequest(PRtcDataChannel pDataChannel, PBYTE pMessage, UINT32 messageLen)
+{
+    BYTE ack[DATA_CHANNEL_ACK_SIZE];
+    std::vector<BYTE> reply;
+
+    if (messageLen >= DATA_CHANNEL_ECHO_HEADER_SIZE && pMessage[0] == DATA_CHANNEL_MESSAGE_ECHO_REQUEST) {
+        // Echoed back at full size so both directions carry the same load
+        reply.assign(pMessage, pMessage + messageLen);
+        reply[0] = DATA_CHANNEL_MESSAGE_ECHO_REPLY;
+        CHK_LOG_ERR(dataChannelSend(pDataChannel, TRUE, reply.data(), messageLen));
+    } else if (messageLen >= DATA_CHANNEL_BULK_HEADER_SIZE &&
+               (pMessage[0] == DATA_CHANNEL_MESSAGE_BULK || pMessage[0] == DATA_CHANNEL_MESSAGE_BULK_FLUSH)) {
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            auto& remote = this->remotes[pDataChannel];
+            remote.highestSequence = MAX(remote.highestSequence, getUnalignedInt32BigEndian((PINT32)(pMessage + SIZEOF(BYTE))));
+            remote.bytesReceived += messageLen;
+
+            ack[0] = DATA_CHANNEL_MESSAGE_BULK_ACK;
+            putUnalignedInt32BigEndian((PINT32)(ack + SIZEOF(BYTE)), remote.highestSequence);
+            putUnalignedInt64BigEndian((PINT64)(ack + SIZEOF(BYTE) + SIZEOF(UINT32)), remote.bytesReceived);
+        }
+
+        if (pMessage[0] == DATA_CHANNEL_MESSAGE_BULK_FLUSH) {
+            CHK_LOG_ERR(dataChannelSend(pDataChannel, TRUE, ack, SIZEOF(ack)));
+        }
+    }
+}
+
+VOID DataChannelBench::record(DATA_CHANNEL_MODE mode, const std::function<VOID(Window&)>& update)
+{
+    std::lock_guard<std::mutex> lock(this->statsMutex);
+    update(this->period[mode]);
+    update(this->total[mode]);
+}
+
+VOID DataChannelBench::report(BOOL final)
+{
+    Window windows[DATA_CHANNEL_MODE_COUNT];
+    UINT64 now = GETTIME(), count;
+    DOUBLE seconds, throughput;
+    UINT32 mode;
+
+    {
+        std::lock_guard<std::mutex> lock(this->statsMutex);
+        for (mode = 0; mode < DATA_CHANNEL_MODE_COUNT; mode++) {
+            if (final) {
+                windows[mode] = this->total[mode];
+            } else {
+                windows[mode] = std::move(this->period[mode]);
+                this->period[mode] = Window();
+                this->period[mode].start = now;
+            }
+        }
+    }
+
+    // Modes beyond the channel count have no channel
+    for (mode = 0; mode < MIN((UINT32) this->channels.size(), (UINT32) DATA_CHANNEL_MODE_COUNT); mode++) {
+        auto& window = windows[mode];
+        seconds = MAX((DOUBLE)(now - window.start) / HUNDREDS_OF_NANOS_IN_A_SECOND, 1.0);
+        throughput = window.bytesDelivered / seconds / (1024.0 * 1024.0);
+        count = 0;
+        for (auto& bucket : window.latencies) {
+            count += bucket.second;
+        }
+
+        DLOGI("%s data channel %s: echo %lu/%lu, roundtrip p50 %lu ms, p90 %lu ms, p99 %lu ms, max %lu ms, bulk %.2f MB/s, peak buffered %lu bytes, "
+              "%lu sends rejected",
+              final ? "Total" : "Period", getModeName((DATA_CHANNEL_MODE) mode), window.echoesReceived, window.echoesSent,
+              percentile(window.latencies, count, 0.5), percentile(window.latencies, count, 0.9), percentile(window.latencies, count, 0.99),
+              window.latencies.empty() ? 0 : window.latencies.rbegin()->first, throughput, window.peakBuffered, window.sendsRejected);
+
+        // Every period is published on its own, the total would count the same samples twice
+        if (!final) {
+            Cloudwatch::getInstance().monitoring.pushDataChannelStats(getModeName((DATA_CHANNEL_MODE) mode), window.latencies, throughput,
+                                                                      window.peakBuffered, window.sendsRejected / seconds);
+        }
+    }
+}
+
+VOID DataChannelBench::onOpen(UINT64 customData, PRtcDataChannel pDataChannel)
+{
+    Channel* pChannel = (Channel*) customData;
+    DataChannelBench* pBench = pChannel->pBench;
+
+    DLOGD("Data channel %s opened", pDataChannel->name);
+    pChannel->opened = true;
+
+    std::lock_guard<std::mutex> lock(pBench->mutex);
+    pBench->wake = TRUE;
+    pBench->cvar.notify_all();
+}
+
+VOID DataChannelBench::onReply(UINT64 customData, PRtcDataChannel pDataChannel, BOOL isBinary, PBYTE pMessage, UINT32 messageLen)
+{
+    UNUSED_PARAM(pDataChannel);
+    Channel* pChannel = (Channel*) customData;
+
+    if (isBinary) {
+        pChannel->pBench->receiveReply(pChannel, pMessage, messageLen);
+    }
+}
+
+VOID DataChannelBench::onRequest(UINT64 customData, PRtcDataChannel pDataChannel, BOOL isBinary, PBYTE pMessage, UINT32 messageLen)
+{
+    DataChannelBench* pBench = (DataChannelBench*) customData;
+
+    if (isBinary && !pBench->terminated.load()) {
+        pBench->receiveRequest(pDataChannel, pMessage, messageLen);
+    }
+}
+
+VOID DataChannelBench::onRemoteChannel(UINT64 customData, PRtcDataChannel pDataChannel)
+{
+    STATUS retStatus = STATUS_SUCCESS;
+
+    DLOGD("Remote data channel %s opened", pDataChannel->name);
+    CHK_STATUS(dataChannelOnMessage(pDataChannel, customData, onRequest));
+
+CleanUp:
+
+    CHK_LOG_ERR(retStatus);
+}
+
+} // namespace Canary
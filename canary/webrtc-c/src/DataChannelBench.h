@@ -0,0 +1,113 @@
+#pragma once
+
+namespace Canary {
+
+// First byte of every benchmark message
+typedef enum {
+    DATA_CHANNEL_MESSAGE_ECHO_REQUEST,
+    DATA_CHANNEL_MESSAGE_ECHO_REPLY,
+    DATA_CHANNEL_MESSAGE_BULK,
+    // Bulk message that asks the receiver for an ack
+    DATA_CHANNEL_MESSAGE_BULK_FLUSH,
+    DATA_CHANNEL_MESSAGE_BULK_ACK,
+} DATA_CHANNEL_MESSAGE_TYPE;
+
+// Delivery guarantees of a benchmark channel, channels take them in this order round robin
+typedef enum {
+    DATA_CHANNEL_MODE_RELIABLE_ORDERED,
+    DATA_CHANNEL_MODE_RELIABLE_UNORDERED,
+    DATA_CHANNEL_MODE_PARTIAL_ORDERED,
+    DATA_CHANNEL_MODE_PARTIAL_UNORDERED,
+    DATA_CHANNEL_MODE_COUNT,
+} DATA_CHANNEL_MODE;
+
+/*
+ * Data channel benchmark that runs next to the media of a regular canary peer. Each peer opens its own channels
+ * before the offer/answer exchange and answers on the ones the remote peer opened. On every channel it sends a
+ * timestamped echo request every 100 ms and, unless the bulk message size is 0, keeps a window of bulk messages in
+ * flight. The remote peer echoes requests back and, every quarter window, acknowledges bulk messages with the highest
+ * sequence number and the bytes it received so far. That gives RTT, goodput and how much data sits unacknowledged in
+ * SCTP or on the wire. Sends that SCTP refuses because its own buffer is full are counted as backpressure.
+ *
+ * Echo: type (1 byte) + send time (8 bytes), padded to the echo message size
+ * Bulk: type (1 byte) + sequence number (4 bytes), padded to the bulk message size
+ * Ack:  type (1 byte) + highest sequence number (4 bytes) + bytes received (8 bytes)
+ */
+class DataChannelBench {
+  public:
+    DataChannelBench(PConfig);
+    ~DataChannelBench();
+    STATUS open(PRtcPeerConnection);
+    VOID stop();
+    VOID sample(UINT64);
+
+    static PCHAR getModeName(DATA_CHANNEL_MODE);
+
+  private:
+    class Channel {
+      public:
+        DataChannelBench* pBench;
+        DATA_CHANNEL_MODE mode;
+        PRtcDataChannel pDataChannel = NULL;
+        std::atomic<bool> opened{false};
+        UINT64 nextEchoTime = 0;
+        UINT32 nextSequence = 0;
+        // Bulk messages up to this sequence number were acknowledged or written off
+        INT64 ackedSequence = -1;
+        UINT64 lastAckTime = 0;
+        UINT64 bytesReceived = 0;
+    };
+
+    // State of a channel the remote peer opened
+    class Remote {
+      public:
+        UINT32 highestSequence = 0;
+        UINT64 bytesReceived = 0;
+    };
+
+    class Window {
+      public:
+        UINT64 start = 0;
+        UINT64 echoesSent = 0;
+        UINT64 echoesReceived = 0;
+        UINT64 bytesDelivered = 0;
+        UINT64 peakBuffered = 0;
+        UINT64 sendsRejected = 0;
+        // Echo roundtrip in milliseconds to sample count
+        std::map<UINT64, UINT64> latencies;
+    };
+
+    VOID run();
+    BOOL pump(Channel*, UINT64);
+    VOID receiveReply(Channel*, PBYTE, UINT32);
+    VOID receiveRequest(PRtcDataChannel, PBYTE, UINT32);
+    VOID record(DATA_CHANNEL_MODE, const std::function<VOID(Window&)>&);
+    VOID report(BOOL);
+
+    static VOID onOpen(UINT64, PRtcDataChannel);
+    static VOID onReply(UINT64, PRtcDataChannel, BOOL, PBYTE, UINT32);
+    static VOID onRequest(UINT64, PRtcDataChannel, BOOL, PBYTE, UINT32);
+    static VOID onRemoteChannel(UINT64, PRtcDataChannel);
+
+    PConfig pConfig;
+    UINT32 echoSize;
+    UINT32 bulkSize;
+    UINT32 bulkWindow;
+    std::vector<std::unique_ptr<Channel>> channels;
+    std::vector<BYTE> echoBuffer;
+    std::vector<BYTE> bulkBuffer;
+    std::map<PRtcDataChannel, Remote> remotes;
+
+    std::atomic<bool> terminated{false};
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable cvar;
+    BOOL wake = FALSE;
+
+    std::mutex statsMutex;
+    Window period[DATA_CHANNEL_MODE_COUNT];
+    Window total[DATA_CHANNEL_MODE_COUNT];
+    UINT64 lastReportTime = 0;
+};
+
+} // namespace Canary
@@ -0,0 +1,66 @@
+#include "Include.h"
+
+namespace Canary {
+
+VOID FrameTracker::init(UINT64 frameInterval, UINT64 freezeIntervals)
+{
+    this->freezeThreshold = frameInterval * freezeIntervals;
+}
+
+VOID FrameTracker::onFrame(UINT32 sequence, UINT64 arrival)
+{
+    INT32 diff = (INT32)(sequence - this->highest);
+    UINT32 age, i;
+
+    if (!this->started || ABS(diff) > FRAME_TRACKER_RESYNC_DISTANCE) {
+        // Nothing before the first frame of a stream is expected, so the whole window starts out as seen
+        this->started = TRUE;
+        this->highest = sequence;
+        this->seen.set();
+    } else if (diff > 0) {
+        if (diff >= FRAME_TRACKER_WINDOW) {
+            // The whole window and the part of the gap that doesn't fit in the new one are gone
+            this->stats.lost += FRAME_TRACKER_WINDOW - this->seen.count() + (diff - FRAME_TRACKER_WINDOW);
+            this->seen.reset();
+        } else {
+            for (i = 0; i < (UINT32) diff; i++) {
+                if (!this->seen.test(FRAME_TRACKER_WINDOW - 1)) {
+                    this->stats.lost++;
+                }
+                this->seen <<= 1;
+            }
+        }
+        this->seen.set(0);
+        this->highest = sequence;
+    } else {
+        age = (UINT32) -diff;
+        if (age < FRAME_TRACKER_WINDOW) {
+            if (this->seen.test(age)) {
+                this->stats.duplicated++;
+                return;
+            }
+            this->seen.set(age);
+        }
+        this->stats.late++;
+    }
+
+    this->stats.received++;
+
+    if (this->lastArrival != 0) {
+        UINT64 interval = arrival - this->lastArrival;
+        this->stats.intervals[interval / HUNDREDS_OF_NANOS_IN_A_MILLISECOND]++;
+        if (this->freezeThreshold != 0 && interval > this->freezeThreshold) {
+            this->stats.freezes++;
+            this->stats.freezeDuration += interval;
+        }
+    }
+    this->lastArrival = arrival;
+}
+
+VOID FrameTracker::collect(PFrameTrackerStats pStats)
+{
+    *pStats = std::move(this->stats);
+    this->stats = FrameTrackerStats();
+}
+
+} // namespace Canary
@@ -0,0 +1,43 @@
+#pragma once
+
+namespace Canary {
+
+// What one received track looked like since the stats were last collected
+struct FrameTrackerStats {
+    UINT64 received = 0;
+    UINT64 lost = 0;
+    UINT64 late = 0;
+    UINT64 duplicated = 0;
+    UINT64 freezes = 0;
+    UINT64 freezeDuration = 0;
+    // Arrival interval in milliseconds to sample count
+    std::map<UINT64, UINT64> intervals;
+};
+typedef FrameTrackerStats* PFrameTrackerStats;
+
+/*
+ * Follows the canary sequence numbers of one track as frames come out of the jitter buffer. The last
+ * FRAME_TRACKER_WINDOW sequence numbers are kept in a bitmap. A frame older than the newest one is late, one that was
+ * already seen is a duplicate, and a sequence number that leaves the window without being seen is lost. A late frame
+ * that comes in after it left the window stays counted as lost too. Losses therefore show up a window after the gap.
+ * A jump of more than FRAME_TRACKER_RESYNC_DISTANCE starts over, since that is a restarted sender rather than loss.
+ * Not thread safe, the owner serializes calls.
+ */
+class FrameTracker {
+  public:
+    VOID init(UINT64, UINT64);
+    VOID onFrame(UINT32, UINT64);
+    VOID collect(PFrameTrackerStats);
+
+  private:
+    // 0 disables freeze detection
+    UINT64 freezeThreshold = 0;
+    BOOL started = FALSE;
+    UINT32 highest = 0;
+    // Bit i is set once sequence number highest - i was received
+    std::bitset<FRAME_TRACKER_WINDOW> seen;
+    UINT64 lastArrival = 0;
+    FrameTrackerStats stats;
+};
+
+} // namespace Canary
@@ -0,0 +1,19 @@
+#include "Include.h"
+
+namespace Canary {
+
+UINT64 percentile(const std::map<UINT64, UINT64>& histogram, UINT64 count, DOUBLE fraction)
+{
+    UINT64 rank = MAX((UINT64) ceil(fraction * count), 1), seen = 0;
+
+    for (auto& bucket : histogram) {
+        seen += bucket.second;
+        if (seen >= rank) {
+            return bucket.first;
+        }
+    }
+
+    return 0;
+}
+
+} // namespace Canary
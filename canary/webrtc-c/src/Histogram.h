@@ -0,0 +1,10 @@
+#pragma once
+
+namespace Canary {
+
+/*
+ * Value at the given fraction of a value -> count histogram holding count samples, 0 when it is empty
+ */
+UINT64 percentile(const std::map<UINT64, UINT64>&, UINT64, DOUBLE);
+
+} // namespace Canary
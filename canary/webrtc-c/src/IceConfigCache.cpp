@@ -0,0 +1,147 @@
+#include "Include.h"
+
+namespace Canary {
+
+IceConfigCache& IceConfigCache::getInstance()
+{
+    static IceConfigCache instance;
+    return instance;
+}
+
+STATUS IceConfigCache::refresh(const std::string& channelName, SIGNALING_CLIENT_HANDLE signalingClientHandle)
+{
+    STATUS retStatus = STATUS_SUCCESS;
+    UINT32 i, j, iceConfigCount;
+    PIceConfigInfo pIceConfigInfo;
+    RtcIceServer iceServer;
+    Entry entry;
+    std::vector<RtcIceServer> uris;
+    UINT64 now = GETTIME();
+
+    CHK(IS_VALID_SIGNALING_CLIENT_HANDLE(signalingClientHandle), STATUS_INVALID_ARG);
+    CHK_STATUS(signalingClientGetIceConfigInfoCount(signalingClientHandle, &iceConfigCount));
+
+    // Nothing has been fetched yet, keep whatever is cached
+    CHK(iceConfigCount != 0, retStatus);
+
+    entry.expiration = MAX_UINT64;
+
+    /* signalingClientGetIceConfigInfoCount can return more than one turn server. All of them are kept and probed,
+     * lookups pick the closest ones to optimize candidate gathering latency. */
+    for (i = 0; i < iceConfigCount; i++) {
+        CHK_STATUS(signalingClientGetIceConfigInfo(signalingClientHandle, i, &pIceConfigInfo));
+        entry.expiration = MIN(entry.expiration, now + pIceConfigInfo->ttl);
+        entry.fetchKey.append(pIceConfigInfo->userName).append(1, '\n').append(pIceConfigInfo->password).append(1, '\n');
+        entry.servers.emplace_back();
+        for (j = 0; j < pIceConfigInfo->uriCount; j++) {
+            /*
+             * if urls is "turn:ip:port?transport=udp" then ICE will try TURN over UDP
+             * if urls is "turn:ip:port?transport=tcp" then ICE will try TURN over TCP/TLS
+             * if urls is "turns:ip:port?transport=udp", it's currently ignored because sdk dont do TURN over DTLS yet.
+             * if urls is "turns:ip:port?transport=tcp" then ICE will try TURN over TCP/TLS
+             * if urls is "turn:ip:port" then ICE will try both TURN over UPD and TCP/TLS
+             *
+             * It's recommended to not pass too many TURN iceServers to configuration because it will slow down ice gathering in non-trickle
+             * mode.
+             */
+            MEMSET(&iceServer, 0x00, SIZEOF(RtcIceServer));
+            STRNCPY(iceServer.urls, pIceConfigInfo->uris[j], MAX_ICE_CONFIG_URI_LEN);
+            STRNCPY(iceServer.credential, pIceConfigInfo->password, MAX_ICE_CONFIG_CREDENTIAL_LEN);
+            STRNCPY(iceServer.username, pIceConfigInfo->userName, MAX_ICE_CONFIG_USER_NAME_LEN);
+            entry.servers.back().push_back(iceServer);
+            uris.push_back(iceServer);
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        auto it = this->entries.find(channelName);
+
+        // The ttl counts from when the client fetched the config, which the first read is the closest to
+        if (it != this->entries.end() && it->second.fetchKey == entry.fetchKey) {
+            entry.expiration = it->second.expiration;
+        }
+        this->entries[channelName] = entry;
+    }
+    this->cvar.notify_all();
+
+    // Only servers without a recent result are probed again
+    TurnProbe::getInstance().submit(uris);
+
+    DLOGD("Cached %u TURN servers with %u uris for channel %s, valid for %lu seconds", (UINT32) entry.servers.size(), (UINT32) uris.size(),
+          channelName.c_str(), (entry.expiration - MIN(entry.expiration, now)) / HUNDREDS_OF_NANOS_IN_A_SECOND);
+
+CleanUp:
+
+    return retStatus;
+}
+
+BOOL IceConfigCache::lookup(const std::string& channelName, std::vector<RtcIceServer>& servers)
+{
+    auto it = this->entries.find(channelName);
+    auto& probe = TurnProbe::getInstance();
+    std::vector<std::pair<UINT64, UINT32>> order;
+    UINT32 i;
+
+    if (it == this->entries.end() || it->second.expiration < GETTIME() + ICE_CONFIG_CACHE_REFRESH_GRACE) {
+        return FALSE;
+    }
+
+    // Fastest first, ties and servers without a result keep the signaling order
+    for (i = 0; i < it->second.servers.size(); i++) {
+        order.emplace_back(it->second.servers[i].empty() ? MAX_UINT64 : probe.getRtt(TurnProbe::getServerKey(it->second.servers[i][0].urls)), i);
+    }
+    std::sort(order.begin(), order.end());
+
+    servers.clear();
+    for (i = 0; i < order.size() && i < MAX_TURN_SERVERS; i++) {
+        auto& uris = it->second.servers[order[i].second];
+        servers.insert(servers.end(), uris.begin(), uris.end());
+    }
+
+    return TRUE;
+}
+
+BOOL IceConfigCache::get(const std::string& channelName, SIGNALING_CLIENT_HANDLE signalingClientHandle, std::vector<RtcIceServer>& servers)
+{
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        if (this->lookup(channelName, servers)) {
+            return TRUE;
+        }
+    }
+
+    // Missing or about to expire, the signaling client refreshes its ICE server info on its own
+    CHK_LOG_ERR(this->refresh(channelName, signalingClientHandle));
+
+    std::lock_guard<std::mutex> lock(this->mutex);
+    return this->lookup(channelName, servers);
+}
+
+STATUS IceConfigCache::await(const std::string& channelName, SIGNALING_CLIENT_HANDLE signalingClientHandle, UINT64 timeout,
+                             std::vector<RtcIceServer>& servers)
+{
+    STATUS retStatus = STATUS_SUCCESS;
+    UINT64 deadline = GETTIME() + timeout, now;
+
+    while (!this->get(channelName, signalingClientHandle, servers)) {
+        now = GETTIME();
+        CHK_ERR(now < deadline, STATUS_OPERATION_TIMED_OUT, "Couldn't retrieve ICE configurations in alotted time.");
+
+        // Woken up by signaling state changes and cache updates. The recheck period is only a safety net for an
+        // ICE server fetch that completes without a state change.
+        std::unique_lock<std::mutex> lock(this->mutex);
+        this->cvar.wait_for(lock, std::chrono::nanoseconds(MIN(deadline - now, ICE_CONFIG_INFO_RECHECK_PERIOD) * DEFAULT_TIME_UNIT_IN_NANOS));
+    }
+
+CleanUp:
+
+    return retStatus;
+}
+
+VOID IceConfigCache::notify()
+{
+    this->cvar.notify_all();
+}
+
+} // namespace Canary
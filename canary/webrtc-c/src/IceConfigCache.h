@@ -0,0 +1,43 @@
+#pragma once
+
+namespace Canary {
+
+/*
+ * Process-wide cache of TURN servers keyed by channel name. Entries are filled from a signaling client once it
+ * has ICE server info and are treated as stale ICE_CONFIG_CACHE_REFRESH_GRACE before the TURN credentials expire,
+ * which makes the next lookup pull the refreshed info from the client. Waiters are woken up by notify(), which
+ * peers call on every signaling state change, instead of polling the client on a short period.
+ *
+ * Every TURN server signaling returns is cached and handed to TurnProbe. Lookups return the URIs of the
+ * MAX_TURN_SERVERS servers that answered the probe fastest, in signaling order until the probe has results.
+ */
+class IceConfigCache {
+  public:
+    IceConfigCache(IceConfigCache const&) = delete;
+    void operator=(IceConfigCache const&) = delete;
+
+    static IceConfigCache& getInstance();
+    STATUS refresh(const std::string&, SIGNALING_CLIENT_HANDLE);
+    BOOL get(const std::string&, SIGNALING_CLIENT_HANDLE, std::vector<RtcIceServer>&);
+    STATUS await(const std::string&, SIGNALING_CLIENT_HANDLE, UINT64, std::vector<RtcIceServer>&);
+    VOID notify();
+
+  private:
+    class Entry {
+      public:
+        // The URIs of every TURN server, in signaling order
+        std::vector<std::vector<RtcIceServer>> servers;
+        // The credentials identify the fetch, reading the same one again doesn't move the expiration
+        std::string fetchKey;
+        UINT64 expiration;
+    };
+
+    IceConfigCache() = default;
+    BOOL lookup(const std::string&, std::vector<RtcIceServer>&);
+
+    std::mutex mutex;
+    std::condition_variable cvar;
+    std::map<std::string, Entry> entries;
+};
+
+} // namespace Canary
@@ -0,0 +1,479 @@
+#include "Include.h"
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <unistd.h>
+
+namespace Canary {
+
+ImpairmentRelay& ImpairmentRelay::getInstance()
+{
+    static ImpairmentRelay instance;
+    return instance;
+}
+
+STATUS ImpairmentRelay::init(const std::string& spec)
+{
+    STATUS retStatus = STATUS_SUCCESS;
+
+    CHK(!this->enabled.load(), STATUS_INVALID_OPERATION);
+    CHK_STATUS(this->parse(spec));
+
+    MEMSET(&this->stats, 0x00, SIZEOF(ImpairmentStats));
+    this->phase = 0;
+    this->phaseStart = this->lastSampleTime = GETTIME();
+    this->logPhase();
+
+    this->terminated = FALSE;
+    this->enabled = TRUE;
+    this->worker = std::thread(&ImpairmentRelay::run, this);
+
+CleanUp:
+
+    return retStatus;
+}
+
+VOID ImpairmentRelay::deinit()
+{
+    if (!this->enabled.exchange(FALSE)) {
+        return;
+    }
+
+    this->terminated = TRUE;
+    if (this->worker.joinable()) {
+        this->worker.join();
+    }
+
+    std::lock_guard<std::mutex> lock(this->mutex);
+    for (auto& link : this->links) {
+        this->closeLink(link.second.get());
+    }
+    this->links.clear();
+    this->pending = decltype(this->pending)();
+    this->profiles.clear();
+}
+
+BOOL ImpairmentRelay::isEnabled()
+{
+    return this->enabled.load();
+}
+
+STATUS ImpairmentRelay::parse(const std::string& spec)
+{
+    STATUS retStatus = STATUS_SUCCESS;
+    std::istringstream phases(spec);
+    std::string phaseSpec, setting, key, value;
+    size_t colon, equals;
+    DOUBLE number;
+    PCHAR pEnd;
+
+    this->profiles.clear();
+    while (std::getline(phases, phaseSpec, ';')) {
+        Profile profile;
+
+        if (phaseSpec.empty()) {
+            continue;
+        }
+
+        colon = phaseSpec.find(':');
+        CHK_ERR(colon != std::string::npos && STATUS_SUCCEEDED(STRTOUI64((PCHAR) phaseSpec.substr(0, colon).c_str(), NULL, 10, &profile.duration)),
+                STATUS_INVALID_ARG, "Invalid impairment phase \"%s\", expected <seconds>:<settings>", phaseSpec.c_str());
+        profile.duration *= HUNDREDS_OF_NANOS_IN_A_SECOND;
+
+        std::istringstream settings(phaseSpec.substr(colon + 1));
+        while (std::getline(settings, setting, ',')) {
+            if (setting.empty()) {
+                continue;
+            }
+
+            equals = setting.find('=');
+            CHK_ERR(equals != std::string::npos, STATUS_INVALID_ARG, "Invalid impairment setting \"%s\", expected <key>=<value>", setting.c_str());
+            key = setting.substr(0, equals);
+            value = setting.substr(equals + 1);
+            number = strtod(value.c_str(), &pEnd);
+            CHK_ERR(!value.empty() && *pEnd == '\0' && number >= 0, STATUS_INVALID_ARG, "Invalid value in impairment setting \"%s\"",
+                    setting.c_str());
+
+            if (key == "loss") {
+                CHK_ERR(number <= 100, STATUS_INVALID_ARG, "Impairment loss is a percentage, got %s", value.c_str());
+                profile.loss = number;
+            } else if (key == "burst") {
+                CHK_ERR(number >= 1, STATUS_INVALID_ARG, "Impairment burst is a mean number of packets, got %s", value.c_str());
+                profile.burst = number;
+            } else if (key == "delay") {
+                profile.delay = (UINT64) (number * HUNDREDS_OF_NANOS_IN_A_MILLISECOND);
+            } else if (key == "jitter") {
+                profile.jitter = (UINT64) (number * HUNDREDS_OF_NANOS_IN_A_MILLISECOND);
+            } else if (key == "reorder") {
+                CHK_ERR(number <= 100, STATUS_INVALID_ARG, "Impairment reorder is a percentage, got %s", value.c_str());
+                profile.reorder = number;
+            } else if (key == "rate") {
+                profile.rate = (UINT64) number;
+            } else if (key == "queue") {
+                profile.queue = (UINT64) (number * HUNDREDS_OF_NANOS_IN_A_MILLISECOND);
+            } else {
+                CHK_ERR(FALSE, STATUS_INVALID_ARG, "Unknown impairment setting \"%s\"", key.c_str());
+            }
+        }
+
+        this->profiles.push_back(profile);
+    }
+
+    CHK_ERR(!this->profiles.empty(), STATUS_INVALID_ARG, "Impairment profile \"%s\" has no phases", spec.c_str());
+
+CleanUp:
+
+    return retStatus;
+}
+
+STATUS ImpairmentRelay::createLink(UINT32 targetAddress, UINT16 targetPort, Link* pLink)
+{
+    STATUS retStatus = STATUS_SUCCESS;
+    struct sockaddr_in address;
+    socklen_t addressLen = SIZEOF(address);
+
+    pLink->targetAddress = targetAddress;
+    pLink->targetPort = htons(targetPort);
+
+    // Both ends are bound on all interfaces, so the relay port is reachable on whatever address the candidate had
+    MEMSET(&address, 0x00, SIZEOF(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = 0;
+
+    pLink->inSocket = socket(AF_INET, SOCK_DGRAM, 0);
+    pLink->outSocket = socket(AF_INET, SOCK_DGRAM, 0);
+    CHK_ERR(pLink->inSocket >= 0 && pLink->outSocket >= 0, STATUS_INTERNAL_ERROR, "Failed to create relay sockets: %s", strerror(errno));
+    CHK_ERR(bind(pLink->inSocket, (struct sockaddr*) &address, SIZEOF(address)) == 0, STATUS_INTERNAL_ERROR, "Failed to bind relay socket: %s",
+            strerror(errno));
+    CHK_ERR(bind(pLink->outSocket, (struct sockaddr*) &address, SIZEOF(address)) == 0, STATUS_INTERNAL_ERROR, "Failed to bind relay socket: %s",
+            strerror(errno));
+    CHK_ERR(getsockname(pLink->inSocket, (struct sockaddr*) &address, &addressLen) == 0, STATUS_INTERNAL_ERROR,
+            "Failed to read the relay port: %s", strerror(errno));
+    pLink->relayPort = ntohs(address.sin_port);
+
+CleanUp:
+
+    if (STATUS_FAILED(retStatus)) {
+        this->closeLink(pLink);
+    }
+
+    return retStatus;
+}
+
+VOID ImpairmentRelay::closeLink(Link* pLink)
+{
+    if (pLink->inSocket >= 0) {
+        close(pLink->inSocket);
+        pLink->inSocket = -1;
+    }
+    if (pLink->outSocket >= 0) {
+        close(pLink->outSocket);
+        pLink->outSocket = -1;
+    }
+}
+
+BOOL ImpairmentRelay::rewriteCandidate(std::string& candidate)
+{
+    STATUS retStatus = STATUS_SUCCESS;
+    std::istringstream stream(candidate);
+    std::vector<std::string> fields;
+    std::string field, key;
+    struct in_addr address;
+    UINT64 port;
+    BOOL keep = FALSE;
+
+    while (stream >> field) {
+        fields.push_back(field);
+    }
+
+    // candidate:<foundation> <component> <transport> <priority> <address> <port> typ <type> ...
+    // Anything that can reach the other peer without going through the relay is dropped, which leaves UDP host candidates
+    CHK(fields.size() >= 8 && fields[6] == "typ" && fields[7] == "host", retStatus);
+    CHK(STRCMPI(fields[2].c_str(), "udp") == 0, retStatus);
+    CHK(inet_pton(AF_INET, fields[4].c_str(), &address) == 1, retStatus);
+    CHK(STATUS_SUCCEEDED(STRTOUI64((PCHAR) fields[5].c_str(), NULL, 10, &port)) && port <= MAX_UINT16, retStatus);
+
+    key = fields[4] + ":" + fields[5];
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+
+        CHK(this->enabled.load(), retStatus);
+
+        // The same candidate shows up in trickle messages and in the SDP, both have to point at the same relay port
+        auto it = this->links.find(key);
+        if (it == this->links.end()) {
+            std::unique_ptr<Link> link(new Link());
+            CHK_STATUS(this->createLink(address.s_addr, (UINT16) port, link.get()));
+            DLOGI("Relaying %s through port %u", key.c_str(), link->relayPort);
+            it = this->links.emplace(key, std::move(link)).first;
+        }
+
+        fields[5] = std::to_string(it->second->relayPort);
+    }
+
+    candidate = fields[0];
+    for (UINT32 i = 1; i < fields.size(); i++) {
+        candidate += " " + fields[i];
+    }
+    keep = TRUE;
+
+CleanUp:
+
+    CHK_LOG_ERR(retStatus);
+
+    if (!keep) {
+        DLOGD("Dropping candidate that would bypass the impairment relay: %s", candidate.c_str());
+    }
+
+    return keep;
+}
+
+BOOL ImpairmentRelay::rewriteCandidateJson(PCHAR json, UINT32 maxLen)
+{
+    std::string in(json), candidate;
+    const std::string key = IMPAIRMENT_CANDIDATE_JSON_KEY;
+    size_t start = in.find(key), end;
+
+    if (start == std::string::npos || (end = in.find('"', start + key.size())) == std::string::npos) {
+        DLOGW("No candidate found in %s", json);
+        return FALSE;
+    }
+
+    start += key.size();
+    candidate = in.substr(start, end - start);
+    if (!this->rewriteCandidate(candidate)) {
+        return FALSE;
+    }
+
+    in.replace(start, end - start, candidate);
+    if (in.size() >= maxLen) {
+        DLOGW("Rewritten candidate does not fit in %u bytes", maxLen);
+        return FALSE;
+    }
+
+    MEMCPY(json, in.c_str(), in.size() + 1);
+    return TRUE;
+}
+
+VOID ImpairmentRelay::rewriteSdp(PCHAR sdp, UINT32 maxLen)
+{
+    std::string in(sdp), out, line, candidate;
+    const std::string prefix = IMPAIRMENT_SDP_CANDIDATE_PREFIX;
+    size_t start = 0, end;
+
+    while (start < in.size()) {
+        end = in.find("\r\n", start);
+        end = end == std::string::npos ? in.size() : end + 2;
+        line = in.substr(start, end - start);
+        start = end;
+
+        if (line.compare(0, prefix.size(), prefix) == 0) {
+            // Strip "a=" and the line ending, the rest is the same candidate string that trickle ICE sends
+            candidate = line.substr(2, line.find_last_not_of("\r\n") - 1);
+            if (!this->rewriteCandidate(candidate)) {
+                continue;
+            }
+            line = "a=" + candidate + "\r\n";
+        }
+
+        out += line;
+    }
+
+    if (out.size() >= maxLen) {
+        DLOGW("Rewritten SDP does not fit in %u bytes, sending it unchanged", maxLen);
+        return;
+    }
+
+    MEMCPY(sdp, out.c_str(), out.size() + 1);
+}
+
+VOID ImpairmentRelay::sample(PImpairmentStats pStats)
+{
+    std::lock_guard<std::mutex> lock(this->mutex);
+    UINT64 now = GETTIME();
+
+    *pStats = this->stats;
+    pStats->phase = this->phase;
+    pStats->duration = now - this->lastSampleTime;
+
+    MEMSET(&this->stats, 0x00, SIZEOF(ImpairmentStats));
+    this->lastSampleTime = now;
+}
+
+VOID ImpairmentRelay::run()
+{
+    std::vector<struct pollfd> fds;
+    std::vector<std::pair<Link*, BOOL>> owners;
+    UINT64 now, wait;
+    INT32 ready;
+
+    while (!this->terminated.load()) {
+        fds.clear();
+        owners.clear();
+        now = GETTIME();
+        wait = IMPAIRMENT_RELAY_POLL_PERIOD;
+
+        {
+            // Links are only removed in deinit after this thread is gone, so the pointers stay valid outside the lock
+            std::lock_guard<std::mutex> lock(this->mutex);
+            for (auto& link : this->links) {
+                fds.push_back({link.second->inSocket, POLLIN, 0});
+                owners.emplace_back(link.second.get(), TRUE);
+                fds.push_back({link.second->outSocket, POLLIN, 0});
+                owners.emplace_back(link.second.get(), FALSE);
+            }
+
+            if (!this->pending.empty()) {
+                wait = this->pending.top().due > now ? MIN(wait, this->pending.top().due - now) : 0;
+            }
+        }
+
+        ready = poll(fds.data(), (nfds_t) fds.size(), (INT32) ((wait + HUNDREDS_OF_NANOS_IN_A_MILLISECOND - 1) / HUNDREDS_OF_NANOS_IN_A_MILLISECOND));
+        if (ready < 0) {
+            if (errno != EINTR) {
+                DLOGW("Impairment relay poll failed: %s", strerror(errno));
+                THREAD_SLEEP(IMPAIRMENT_RELAY_POLL_PERIOD);
+            }
+            continue;
+        }
+
+        now = GETTIME();
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->updatePhase(now);
+        for (UINT32 i = 0; ready > 0 && i < fds.size(); i++) {
+            if (fds[i].revents & POLLIN) {
+                this->receive(owners[i].first, owners[i].second, now);
+            }
+        }
+        this->flush(now);
+    }
+}
+
+VOID ImpairmentRelay::receive(Link* pLink, BOOL fromSource, UINT64 now)
+{
+    struct sockaddr_in address;
+    socklen_t addressLen = SIZEOF(address);
+    ssize_t size;
+
+    size = recvfrom(fromSource ? pLink->inSocket : pLink->outSocket, this->buffer, SIZEOF(this->buffer), 0, (struct sockaddr*) &address,
+                    &addressLen);
+    if (size < 0) {
+        return;
+    }
+
+    if (fromSource) {
+        pLink->sourceAddress = address.sin_addr.s_addr;
+        pLink->sourcePort = address.sin_port;
+    } else if (pLink->sourcePort == 0) {
+        // Nothing went out through this link yet, so there is nobody to hand the reply to
+        return;
+    }
+
+    this->stats.received++;
+    this->impair(pLink, fromSource, this->buffer, (UINT32) size, now);
+}
+
+VOID ImpairmentRelay::impair(Link* pLink, BOOL toTarget, PBYTE pData, UINT32 size, UINT64 now)
+{
+    auto& profile = this->profiles[this->phase];
+    auto& direction = toTarget ? pLink->toTarget : pLink->toSource;
+    DOUBLE loss = profile.loss / 100.0, leave, enter;
+    UINT64 departure = now, offset;
+    Packet packet;
+
+    // Gilbert model: packets are lost while in the bad state. Leaving it with 1 / burst makes the mean loss run burst
+    // packets long and entering it with loss * leave / (1 - loss) keeps the long run share of bad packets at loss
+    if (loss >= 1.0) {
+        direction.bad = TRUE;
+    } else if (profile.burst <= 1.0) {
+        direction.bad = this->roll() < loss;
+    } else {
+        leave = 1.0 / profile.burst;
+        enter = loss * leave / (1.0 - loss);
+        direction.bad = direction.bad ? this->roll() >= leave : this->roll() < enter;
+    }
+
+    if (direction.bad) {
+        this->stats.lost++;
+        return;
+    }
+
+    // The bottleneck serializes packets one after another, whatever would wait longer than the queue allows is tail dropped
+    if (profile.rate != 0) {
+        departure = MAX(now, direction.nextFree) + (UINT64) size * 8 * HUNDREDS_OF_NANOS_IN_A_SECOND / (profile.rate * 1000);
+        if (departure - now > profile.queue) {
+            this->stats.queueDropped++;
+            return;
+        }
+        direction.nextFree = departure;
+    }
+
+    packet.due = departure;
+    if (profile.reorder > 0 && this->roll() * 100.0 < profile.reorder) {
+        // Skipping the delay lets the packet overtake everything that is still in flight
+        this->stats.reordered++;
+    } else {
+        offset = profile.jitter == 0 ? 0 : std::uniform_int_distribution<UINT64>(0, 2 * profile.jitter)(this->generator);
+        packet.due += MAX(profile.delay + offset, profile.jitter) - profile.jitter;
+    }
+
+    packet.sequence = this->nextSequence++;
+    packet.pLink = pLink;
+    packet.toTarget = toTarget;
+    packet.data.assign(pData, pData + size);
+    this->pending.push(std::move(packet));
+}
+
+VOID ImpairmentRelay::flush(UINT64 now)
+{
+    struct sockaddr_in address;
+
+    MEMSET(&address, 0x00, SIZEOF(address));
+    address.sin_family = AF_INET;
+
+    while (!this->pending.empty() && this->pending.top().due <= now) {
+        auto& packet = this->pending.top();
+
+        address.sin_addr.s_addr = packet.toTarget ? packet.pLink->targetAddress : packet.pLink->sourceAddress;
+        address.sin_port = packet.toTarget ? packet.pLink->targetPort : packet.pLink->sourcePort;
+        if (sendto(packet.toTarget ? packet.pLink->outSocket : packet.pLink->inSocket, packet.data.data(), packet.data.size(), 0,
+                   (struct sockaddr*) &address, SIZEOF(address)) >= 0) {
+            this->stats.forwarded++;
+            this->stats.forwardedBytes += packet.data.size();
+        }
+
+        this->pending.pop();
+    }
+}
+
+VOID ImpairmentRelay::updatePhase(UINT64 now)
+{
+    if (this->profiles[this->phase].duration == 0 || now - this->phaseStart < this->profiles[this->phase].duration) {
+        return;
+    }
+
+    this->phase = (this->phase + 1) % this->profiles.size();
+    this->phaseStart = now;
+    this->logPhase();
+}
+
+VOID ImpairmentRelay::logPhase()
+{
+    auto& profile = this->profiles[this->phase];
+
+    DLOGI("Impairment phase %u for %lu seconds: loss %.2lf%% in bursts of %.1lf, delay %lu ms, jitter %lu ms, reorder %.2lf%%, "
+          "rate %lu kbps, queue %lu ms",
+          this->phase, profile.duration / HUNDREDS_OF_NANOS_IN_A_SECOND, profile.loss, profile.burst,
+          profile.delay / HUNDREDS_OF_NANOS_IN_A_MILLISECOND, profile.jitter / HUNDREDS_OF_NANOS_IN_A_MILLISECOND, profile.reorder, profile.rate,
+          profile.queue / HUNDREDS_OF_NANOS_IN_A_MILLISECOND);
+}
+
+DOUBLE ImpairmentRelay::roll()
+{
+    return std::uniform_real_distribution<DOUBLE>(0.0, 1.0)(this->generator);
+}
+
+} // namespace Canary
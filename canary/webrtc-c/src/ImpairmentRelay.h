@@ -0,0 +1,126 @@
+#pragma once
+
+namespace Canary {
+
+// What the relay did since the previous sample, over both directions of every link
+typedef struct {
+    UINT32 phase;
+    UINT64 duration;
+    UINT64 received;
+    UINT64 forwarded;
+    UINT64 forwardedBytes;
+    UINT64 lost;
+    UINT64 queueDropped;
+    UINT64 reordered;
+} ImpairmentStats;
+typedef ImpairmentStats* PImpairmentStats;
+
+/*
+ * Process-wide UDP relay that sits between the two peers of runBothPeers. Host candidates are rewritten before they
+ * go out on signaling so that they point at a relay port, every other candidate is dropped, and the relay forwards
+ * whatever arrives on that port to the original candidate. Each direction of a link goes through the profile of the
+ * current phase: Gilbert loss, a token bucket with a bounded queue, delay with jitter and reordering. Phases run in
+ * order and wrap around unless one of them has no duration, in which case it is held until the end.
+ *
+ * Spec: "<seconds>:<key>=<value>,...;<seconds>:..." with keys loss, burst, delay, jitter, reorder, rate and queue,
+ * e.g. "30:delay=40,jitter=10;30:loss=5,burst=4;60:rate=300,queue=100". Percentages may be fractional, delay, jitter
+ * and queue are in milliseconds and rate is in kilobits per second.
+ */
+class ImpairmentRelay {
+  public:
+    ImpairmentRelay(ImpairmentRelay const&) = delete;
+    void operator=(ImpairmentRelay const&) = delete;
+
+    static ImpairmentRelay& getInstance();
+    STATUS init(const std::string&);
+    VOID deinit();
+    BOOL isEnabled();
+    BOOL rewriteCandidate(std::string&);
+    BOOL rewriteCandidateJson(PCHAR, UINT32);
+    VOID rewriteSdp(PCHAR, UINT32);
+    VOID sample(PImpairmentStats);
+
+  private:
+    class Profile {
+      public:
+        // 0 holds the phase forever
+        UINT64 duration = 0;
+        DOUBLE loss = 0;
+        // Mean number of packets in a loss burst, 1 is independent loss
+        DOUBLE burst = 1;
+        UINT64 delay = 0;
+        UINT64 jitter = 0;
+        DOUBLE reorder = 0;
+        // Kilobits per second, 0 is unlimited
+        UINT64 rate = 0;
+        UINT64 queue = IMPAIRMENT_DEFAULT_QUEUE;
+    };
+
+    class Direction {
+      public:
+        BOOL bad = FALSE;
+        UINT64 nextFree = 0;
+    };
+
+    class Link {
+      public:
+        INT32 inSocket = -1;
+        INT32 outSocket = -1;
+        // Addresses and ports are kept in network byte order
+        UINT32 targetAddress = 0;
+        UINT16 targetPort = 0;
+        // Learned from the last packet that came in on the relay port
+        UINT32 sourceAddress = 0;
+        UINT16 sourcePort = 0;
+        UINT16 relayPort = 0;
+        Direction toTarget;
+        Direction toSource;
+    };
+
+    class Packet {
+      public:
+        UINT64 due;
+        UINT64 sequence;
+        Link* pLink;
+        BOOL toTarget;
+        std::vector<BYTE> data;
+    };
+
+    class PacketOrder {
+      public:
+        bool operator()(const Packet& a, const Packet& b) const
+        {
+            return a.due != b.due ? a.due > b.due : a.sequence > b.sequence;
+        }
+    };
+
+    ImpairmentRelay() = default;
+    STATUS parse(const std::string&);
+    STATUS createLink(UINT32, UINT16, Link*);
+    VOID closeLink(Link*);
+    VOID run();
+    VOID receive(Link*, BOOL, UINT64);
+    VOID impair(Link*, BOOL, PBYTE, UINT32, UINT64);
+    VOID flush(UINT64);
+    VOID updatePhase(UINT64);
+    VOID logPhase();
+    DOUBLE roll();
+
+    std::vector<Profile> profiles;
+    std::map<std::string, std::unique_ptr<Link>> links;
+    std::priority_queue<Packet, std::vector<Packet>, PacketOrder> pending;
+    UINT64 nextSequence = 0;
+    UINT32 phase = 0;
+    UINT64 phaseStart = 0;
+    std::mt19937 generator{std::random_device{}()};
+
+    std::atomic<bool> enabled{false};
+    std::atomic<bool> terminated{false};
+    std::thread worker;
+    std::mutex mutex;
+    ImpairmentStats stats;
+    UINT64 lastSampleTime = 0;
+    BYTE buffer[IMPAIRMENT_RELAY_MAX_PACKET_SIZE];
+};
+
+} // namespace Canary
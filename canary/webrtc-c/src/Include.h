@@ -9,6 +9,7 @@
 #define MAX_CLOUDWATCH_LOG_COUNT       128
 #define MAX_NUMBER_OF_LOG_FILES        10
 #define MAX_CONCURRENT_CONNECTIONS     10
+// TURN servers a peer connection gets, the ones that answered the probe fastest
 #define MAX_TURN_SERVERS               1
 #define MAX_STATUS_CODE_LENGTH         16
 #define MAX_CONFIG_JSON_TOKENS         128
@@ -22,7 +23,22 @@
 #define SAMPLE_AUDIO_FRAME_DURATION (20 * HUNDREDS_OF_NANOS_IN_A_MILLISECOND)
 
 #define ASYNC_ICE_CONFIG_INFO_WAIT_TIMEOUT (3 * HUNDREDS_OF_NANOS_IN_A_SECOND)
-#define ICE_CONFIG_INFO_POLL_PERIOD        (20 * HUNDREDS_OF_NANOS_IN_A_MILLISECOND)
+#define ICE_CONFIG_INFO_RECHECK_PERIOD     (250 * HUNDREDS_OF_NANOS_IN_A_MILLISECOND)
+#define ICE_CONFIG_CACHE_REFRESH_GRACE     (30 * HUNDREDS_OF_NANOS_IN_A_SECOND)
+
+#define TURN_PROBE_TIMEOUT           (1 * HUNDREDS_OF_NANOS_IN_A_SECOND)
+#define TURN_PROBE_RETRANSMIT_PERIOD (250 * HUNDREDS_OF_NANOS_IN_A_MILLISECOND)
+#define TURN_PROBE_RESULT_TTL        (5 * HUNDREDS_OF_NANOS_IN_A_MINUTE)
+#define TURN_PROBE_DEFAULT_PORT      "3478"
+#define TURN_PROBE_BUFFER_SIZE       1500
+
+// Unauthenticated STUN Allocate request for a UDP relay, RFC 5766
+#define TURN_PROBE_STUN_HEADER_LEN         20
+#define TURN_PROBE_TRANSACTION_ID_LEN      12
+#define TURN_PROBE_STUN_MAGIC_COOKIE       0x2112A442
+#define TURN_PROBE_ALLOCATE_REQUEST        0x0003
+#define TURN_PROBE_REQUESTED_TRANSPORT     0x0019
+#define TURN_PROBE_REQUESTED_TRANSPORT_UDP 17
 
 #define CA_CERT_PEM_FILE_EXTENSION                               ".pem"
 #define SIGNALING_CANARY_MASTER_CLIENT_ID                        "CANARY_MASTER"
@@ -35,7 +51,43 @@
 #define SIGNALING_CANARY_CHANNEL_NAME                            (PCHAR) "ScaryTestChannel_"
 #define SIGNALING_CANARY_MAX_CONSECUTIVE_ITERATION_FAILURE_COUNT 5
 
-#define CANARY_METADATA_SIZE (SIZEOF(UINT64) + SIZEOF(UINT32) + SIZEOF(UINT32))
+#define SIGNALING_LOAD_TICK_PERIOD        (1 * HUNDREDS_OF_NANOS_IN_A_SECOND)
+#define SIGNALING_LOAD_REPORT_PERIOD      (10 * HUNDREDS_OF_NANOS_IN_A_SECOND)
+#define SIGNALING_LOAD_DRAIN_CHECK_PERIOD (100 * HUNDREDS_OF_NANOS_IN_A_MILLISECOND)
+#define SIGNALING_LOAD_CORRELATION_ID_KEY "\"correlationId\":\""
+
+#define CHURN_REPORT_PERIOD (10 * HUNDREDS_OF_NANOS_IN_A_SECOND)
+#define CHURN_SETUP_TIMEOUT (10 * HUNDREDS_OF_NANOS_IN_A_SECOND)
+#define CHURN_CHECK_PERIOD  (100 * HUNDREDS_OF_NANOS_IN_A_MILLISECOND)
+
+#define DATA_CHANNEL_ECHO_PERIOD        (100 * HUNDREDS_OF_NANOS_IN_A_MILLISECOND)
+#define DATA_CHANNEL_RETRY_PERIOD       (5 * HUNDREDS_OF_NANOS_IN_A_MILLISECOND)
+#define DATA_CHANNEL_BULK_STALL_TIMEOUT (1 * HUNDREDS_OF_NANOS_IN_A_SECOND)
+#define DATA_CHANNEL_REPORT_PERIOD      (10 * HUNDREDS_OF_NANOS_IN_A_SECOND)
+#define DATA_CHANNEL_MAX_MESSAGE_SIZE   65536
+#define DATA_CHANNEL_ECHO_HEADER_SIZE   (SIZEOF(BYTE) + SIZEOF(UINT64))
+#define DATA_CHANNEL_BULK_HEADER_SIZE   (SIZEOF(BYTE) + SIZEOF(UINT32))
+#define DATA_CHANNEL_ACK_SIZE           (SIZEOF(BYTE) + SIZEOF(UINT32) + SIZEOF(UINT64))
+
+#define RESOURCE_SAMPLER_PERIOD           (10 * HUNDREDS_OF_NANOS_IN_A_SECOND)
+#define RESOURCE_SAMPLER_OTHER_THREADS    "other"
+#define RESOURCE_SAMPLER_THREAD_SEND      "media-send"
+#define RESOURCE_SAMPLER_THREAD_RECEIVE   "media-receive"
+#define RESOURCE_SAMPLER_THREAD_TIMER     "sdk-timer"
+#define RESOURCE_SAMPLER_THREAD_SIGNALING "signaling"
+#define RESOURCE_SAMPLER_THREAD_TURN_PROBE "turn-probe"
+
+#define FRAME_TRACKER_WINDOW          128
+#define FRAME_TRACKER_RESYNC_DISTANCE 1000
+
+#define IMPAIRMENT_DEFAULT_QUEUE         (200 * HUNDREDS_OF_NANOS_IN_A_MILLISECOND)
+#define IMPAIRMENT_RELAY_POLL_PERIOD     (10 * HUNDREDS_OF_NANOS_IN_A_MILLISECOND)
+#define IMPAIRMENT_RELAY_MAX_PACKET_SIZE 65536
+#define IMPAIRMENT_STATS_PERIOD          (10 * HUNDREDS_OF_NANOS_IN_A_SECOND)
+#define IMPAIRMENT_CANDIDATE_JSON_KEY    "\"candidate\":\""
+#define IMPAIRMENT_SDP_CANDIDATE_PREFIX  "a=candidate:"
+
+#define CANARY_METADATA_SIZE (SIZEOF(UINT64) + SIZEOF(UINT32) + SIZEOF(UINT32) + SIZEOF(UINT32))
 #define ANNEX_B_NALU_SIZE    4
 
 #define CANARY_DEFAULT_FRAMERATE 30
@@ -48,33 +100,69 @@
 #define CANARY_MIN_DURATION           (30 * HUNDREDS_OF_NANOS_IN_A_SECOND)
 #define CANARY_MIN_ITERATION_DURATION (15 * HUNDREDS_OF_NANOS_IN_A_SECOND)
 
-#define CANARY_ENDPOINT_ENV_VAR              "CANARY_ENDPOINT"
-#define CANARY_LABEL_ENV_VAR                 "CANARY_LABEL"
-#define CANARY_CHANNEL_NAME_ENV_VAR          "CANARY_CHANNEL_NAME"
-#define CANARY_CLIENT_ID_ENV_VAR             "CANARY_CLIENT_ID"
-#define CANARY_TRICKLE_ICE_ENV_VAR           "CANARY_TRICKLE_ICE"
-#define CANARY_IS_MASTER_ENV_VAR             "CANARY_IS_MASTER"
-#define CANARY_USE_TURN_ENV_VAR              "CANARY_USE_TURN"
-#define CANARY_LOG_GROUP_NAME_ENV_VAR        "CANARY_LOG_GROUP_NAME"
-#define CANARY_LOG_STREAM_NAME_ENV_VAR       "CANARY_LOG_STREAM_NAME"
-#define CANARY_CERT_PATH_ENV_VAR             "CANARY_CERT_PATH"
-#define CANARY_DURATION_IN_SECONDS_ENV_VAR   "CANARY_DURATION_IN_SECONDS"
-#define CANARY_ITERATION_IN_SECONDS_ENV_VAR  "CANARY_ITERATION_IN_SECONDS"
-#define CANARY_FORCE_TURN_ENV_VAR            "CANARY_FORCE_TURN"
-#define CANARY_BIT_RATE_ENV_VAR              "CANARY_DATARATE_IN_BITS_PER_SECOND"
-#define CANARY_FRAME_RATE_ENV_VAR            "CANARY_FRAME_RATE"
-#define CANARY_RUN_BOTH_PEERS_ENV_VAR        "CANARY_RUN_BOTH_PEERS"
-#define CANARY_USE_IOT_CREDENTIALS_ENV_VAR   "CANARY_USE_IOT_PROVIDER"
-#define IOT_CORE_CREDENTIAL_ENDPOINT_ENV_VAR "AWS_IOT_CORE_CREDENTIAL_ENDPOINT"
-#define IOT_CORE_CERT_ENV_VAR                "AWS_IOT_CORE_CERT"
-#define IOT_CORE_PRIVATE_KEY_ENV_VAR         "AWS_IOT_CORE_PRIVATE_KEY"
-#define IOT_CORE_ROLE_ALIAS_ENV_VAR          "AWS_IOT_CORE_ROLE_ALIAS"
-#define IOT_CORE_THING_NAME_ENV_VAR          "AWS_IOT_CORE_THING_NAME"
+#define CANARY_ENDPOINT_ENV_VAR                "CANARY_ENDPOINT"
+#define CANARY_LABEL_ENV_VAR                   "CANARY_LABEL"
+#define CANARY_CHANNEL_NAME_ENV_VAR            "CANARY_CHANNEL_NAME"
+#define CANARY_CLIENT_ID_ENV_VAR               "CANARY_CLIENT_ID"
+#define CANARY_TRICKLE_ICE_ENV_VAR             "CANARY_TRICKLE_ICE"
+#define CANARY_IS_MASTER_ENV_VAR               "CANARY_IS_MASTER"
+#define CANARY_USE_TURN_ENV_VAR                "CANARY_USE_TURN"
+#define CANARY_LOG_GROUP_NAME_ENV_VAR          "CANARY_LOG_GROUP_NAME"
+#define CANARY_LOG_STREAM_NAME_ENV_VAR         "CANARY_LOG_STREAM_NAME"
+#define CANARY_CERT_PATH_ENV_VAR               "CANARY_CERT_PATH"
+#define CANARY_DURATION_IN_SECONDS_ENV_VAR     "CANARY_DURATION_IN_SECONDS"
+#define CANARY_ITERATION_IN_SECONDS_ENV_VAR    "CANARY_ITERATION_IN_SECONDS"
+#define CANARY_FORCE_TURN_ENV_VAR              "CANARY_FORCE_TURN"
+#define CANARY_BIT_RATE_ENV_VAR                "CANARY_DATARATE_IN_BITS_PER_SECOND"
+#define CANARY_FRAME_RATE_ENV_VAR              "CANARY_FRAME_RATE"
+#define CANARY_RUN_BOTH_PEERS_ENV_VAR          "CANARY_RUN_BOTH_PEERS"
+#define CANARY_SEND_AUDIO_ENV_VAR              "CANARY_SEND_AUDIO"
+#define CANARY_METRICS_SINK_ENV_VAR            "CANARY_METRICS_SINK"
+#define CANARY_STUN_URL_ENV_VAR                "CANARY_STUN_URL"
+#define CANARY_CLOUDWATCH_ENDPOINT_ENV_VAR     "CANARY_CLOUDWATCH_ENDPOINT"
+#define CANARY_SIGNALING_LOAD_CHANNELS_ENV_VAR "CANARY_SIGNALING_LOAD_CHANNELS"
+#define CANARY_SIGNALING_LOAD_VIEWERS_ENV_VAR  "CANARY_SIGNALING_LOAD_VIEWERS"
+#define CANARY_SIGNALING_LOAD_RATE_ENV_VAR     "CANARY_SIGNALING_LOAD_OFFERS_PER_SECOND"
+#define CANARY_IMPAIRMENT_PROFILE_ENV_VAR      "CANARY_IMPAIRMENT_PROFILE"
+#define CANARY_CHURN_CONCURRENCY_ENV_VAR       "CANARY_CHURN_CONCURRENCY"
+#define CANARY_CHURN_STREAM_DURATION_ENV_VAR   "CANARY_CHURN_STREAM_DURATION_IN_MILLISECONDS"
+#define CANARY_DATA_CHANNEL_COUNT_ENV_VAR      "CANARY_DATA_CHANNEL_COUNT"
+#define CANARY_DATA_CHANNEL_ECHO_SIZE_ENV_VAR  "CANARY_DATA_CHANNEL_ECHO_MESSAGE_SIZE"
+#define CANARY_DATA_CHANNEL_BULK_SIZE_ENV_VAR  "CANARY_DATA_CHANNEL_BULK_MESSAGE_SIZE"
+#define CANARY_DATA_CHANNEL_WINDOW_ENV_VAR     "CANARY_DATA_CHANNEL_BULK_WINDOW"
+#define CANARY_FREEZE_INTERVALS_ENV_VAR        "CANARY_FREEZE_FRAME_INTERVALS"
+#define CANARY_LOAD_PROFILE_ENV_VAR            "CANARY_LOAD_PROFILE"
+#define CANARY_USE_IOT_CREDENTIALS_ENV_VAR     "CANARY_USE_IOT_PROVIDER"
+#define IOT_CORE_CREDENTIAL_ENDPOINT_ENV_VAR   "AWS_IOT_CORE_CREDENTIAL_ENDPOINT"
+#define IOT_CORE_CERT_ENV_VAR                  "AWS_IOT_CORE_CERT"
+#define IOT_CORE_PRIVATE_KEY_ENV_VAR           "AWS_IOT_CORE_PRIVATE_KEY"
+#define IOT_CORE_ROLE_ALIAS_ENV_VAR            "AWS_IOT_CORE_ROLE_ALIAS"
+#define IOT_CORE_THING_NAME_ENV_VAR            "AWS_IOT_CORE_THING_NAME"
 
 #define CANARY_DEFAULT_LABEL          "ScaryTestLabel"
 #define CANARY_DEFAULT_CHANNEL_NAME   "ScaryTestStream"
 #define CANARY_DEFAULT_CLIENT_ID      "DefaultClientId"
 #define CANARY_DEFAULT_LOG_GROUP_NAME "DefaultLogGroupName"
+#define CANARY_STUN_URL_NONE          "none"
+
+#define CANARY_DEFAULT_SIGNALING_LOAD_CHANNELS 1
+#define CANARY_DEFAULT_SIGNALING_LOAD_VIEWERS  0
+#define CANARY_DEFAULT_SIGNALING_LOAD_RATE     10
+
+#define CANARY_DEFAULT_CHURN_STREAM_DURATION_IN_MILLISECONDS 1000
+
+#define CANARY_DEFAULT_DATA_CHANNEL_ECHO_SIZE   64
+#define CANARY_DEFAULT_DATA_CHANNEL_BULK_SIZE   16384
+#define CANARY_DEFAULT_DATA_CHANNEL_BULK_WINDOW (256 * 1024)
+
+#define CANARY_DEFAULT_FREEZE_INTERVALS 3
+
+// A key frame is this many times the size of the delta frames around it
+#define CANARY_KEY_FRAME_SIZE_FACTOR 4
+
+#define CANARY_METRICS_SINK_CLOUDWATCH "Cloudwatch"
+#define CANARY_METRICS_SINK_EMF        "Emf"
+#define CANARY_METRICS_SINK_MEMORY     "Memory"
 
 // Signaling Canary error definitions
 #define STATUS_SIGNALING_CANARY_BASE                    0x73000000
@@ -83,24 +171,87 @@
 #define STATUS_SIGNALING_CANARY_OFFER_CID_MISMATCH      STATUS_SIGNALING_CANARY_BASE + 0x00000003
 #define STATUS_SIGNALING_CANARY_ANSWER_PAYLOAD_MISMATCH STATUS_SIGNALING_CANARY_BASE + 0x00000004
 #define STATUS_SIGNALING_CANARY_OFFER_PAYLOAD_MISMATCH  STATUS_SIGNALING_CANARY_BASE + 0x00000005
+#define STATUS_SIGNALING_CANARY_UNKNOWN_CORRELATION_ID  STATUS_SIGNALING_CANARY_BASE + 0x00000006
 
 #define STATUS_WEBRTC_CANARY_BASE                       0x74000000
 #define STATUS_WEBRTC_EMPTY_IOT_CRED_FILE               STATUS_WEBRTC_CANARY_BASE + 0x00000001
+#define STATUS_WEBRTC_CANARY_CHURN_LEAK                 STATUS_WEBRTC_CANARY_BASE + 0x00000002
 
 #define CANARY_VIDEO_FRAMES_PATH (PCHAR) "./assets/h264SampleFrames/frame-%04d.h264"
 #define CANARY_AUDIO_FRAMES_PATH (PCHAR) "./assets/opusSampleFrames/sample-%03d.opus"
 
 #define METRICS_INVOCATION_PERIOD            (60 * HUNDREDS_OF_NANOS_IN_A_SECOND)
 #define END_TO_END_METRICS_INVOCATION_PERIOD (30 * HUNDREDS_OF_NANOS_IN_A_SECOND)
-#define KVS_METRICS_INVOCATION_PERIOD        (5 * HUNDREDS_OF_NANOS_IN_A_SECOND)
-#define CANARY_METADATA_SIZE                 (SIZEOF(UINT64) + SIZEOF(UINT32) + SIZEOF(UINT32))
+#define STATS_SAMPLER_INVOCATION_PERIOD      (5 * HUNDREDS_OF_NANOS_IN_A_SECOND)
+#define CANARY_AUDIO_METADATA_SIZE           (SIZEOF(UINT64) + SIZEOF(UINT32) + SIZEOF(UINT32))
+#define AV_SYNC_MATCH_WINDOW                 SAMPLE_AUDIO_FRAME_DURATION
 
 
 #define MAX_CALL_RETRY_COUNT                 10
 
+#define CANARY_LOGGER_LEVEL_COUNT           9
+#define CANARY_LOGGER_RING_CAPACITY         512
+#define CANARY_LOGGER_RECORD_ARGS_SIZE      448
+#define CANARY_LOGGER_FLUSH_PERIOD          (50 * HUNDREDS_OF_NANOS_IN_A_MILLISECOND)
+#define CANARY_LOGGER_DEDUP_WINDOW          (1 * HUNDREDS_OF_NANOS_IN_A_SECOND)
+#define CANARY_LOGGER_RATE_LIMIT_PER_SECOND 500
+#define CANARY_LOGGER_RATE_LIMIT_BURST      1000
+#define CANARY_LOG_FILE_MAX_SIZE            (10 * 1024 * 1024)
+#define CANARY_LOG_FILE_PATH_FORMAT         "./%s.%u.log"
+
+#define MAX_CLOUDWATCH_METRIC_DATUM_COUNT  20
+#define MAX_CLOUDWATCH_DISTRIBUTION_VALUES 100
+#define MAX_NUMBER_OF_METRICS_FILES        10
+#define CLOUDWATCH_METRICS_FLUSH_PERIOD    (10 * HUNDREDS_OF_NANOS_IN_A_SECOND)
+#define CANARY_METRICS_FILE_MAX_SIZE       (10 * 1024 * 1024)
+#define CANARY_METRICS_FILE_PATH_FORMAT    "./%s.%u.metrics.json"
+
+#define MOCK_SIGNALING_PORT_ENV_VAR          "CANARY_MOCK_SIGNALING_PORT"
+#define MOCK_SIGNALING_HOST_ENV_VAR          "CANARY_MOCK_SIGNALING_HOST"
+#define MOCK_SIGNALING_CERT_ENV_VAR          "CANARY_MOCK_SIGNALING_CERT"
+#define MOCK_SIGNALING_KEY_ENV_VAR           "CANARY_MOCK_SIGNALING_KEY"
+#define MOCK_SIGNALING_TURN_URI_ENV_VAR      "CANARY_MOCK_SIGNALING_TURN_URI"
+#define MOCK_SIGNALING_LATENCY_ENV_VAR       "CANARY_MOCK_SIGNALING_LATENCY_MS"
+#define MOCK_SIGNALING_JITTER_ENV_VAR        "CANARY_MOCK_SIGNALING_JITTER_MS"
+#define MOCK_SIGNALING_HTTP_ERROR_ENV_VAR    "CANARY_MOCK_SIGNALING_HTTP_ERROR_PERCENT"
+#define MOCK_SIGNALING_CONNECT_ERROR_ENV_VAR "CANARY_MOCK_SIGNALING_CONNECT_ERROR_PERCENT"
+#define MOCK_SIGNALING_DROP_ENV_VAR          "CANARY_MOCK_SIGNALING_DROP_PERCENT"
+#define MOCK_SIGNALING_DEFAULT_PORT          8443
+#define MOCK_SIGNALING_DEFAULT_HOST          "localhost"
+#define MOCK_SIGNALING_DEFAULT_CERT          "./certs/mock/cert.pem"
+#define MOCK_SIGNALING_DEFAULT_KEY           "./certs/mock/key.pem"
+#define MOCK_SIGNALING_ARN_PREFIX            "arn:aws:kinesisvideo:mock:000000000000:channel/"
+#define MOCK_SIGNALING_MAX_JSON_TOKENS       256
+#define MOCK_SIGNALING_RX_BUFFER_SIZE        (64 * 1024)
+#define MOCK_SIGNALING_STATS_PERIOD          (10 * HUNDREDS_OF_NANOS_IN_A_SECOND)
+
+#define MOCK_CLOUDWATCH_PORT_ENV_VAR                 "CANARY_MOCK_CLOUDWATCH_PORT"
+#define MOCK_CLOUDWATCH_LATENCY_ENV_VAR              "CANARY_MOCK_CLOUDWATCH_LATENCY_MS"
+#define MOCK_CLOUDWATCH_THROTTLE_ENV_VAR             "CANARY_MOCK_CLOUDWATCH_THROTTLE_PERCENT"
+#define MOCK_CLOUDWATCH_SEQUENCE_TOKEN_ERROR_ENV_VAR "CANARY_MOCK_CLOUDWATCH_SEQUENCE_TOKEN_ERROR_PERCENT"
+#define MOCK_CLOUDWATCH_MAX_TPS_ENV_VAR              "CANARY_MOCK_CLOUDWATCH_MAX_TPS"
+#define MOCK_CLOUDWATCH_REPORT_ENV_VAR               "CANARY_MOCK_CLOUDWATCH_REPORT"
+#define MOCK_CLOUDWATCH_DEFAULT_PORT                 9090
+#define MOCK_CLOUDWATCH_LOGS_TARGET_PREFIX           "Logs_20140328."
+#define MOCK_CLOUDWATCH_STATS_PERIOD                 (10 * HUNDREDS_OF_NANOS_IN_A_SECOND)
+
+#define MOCK_SERVER_MAX_HEADER_SIZE 1024
+
+#define MAX_NUMBER_OF_TIMELINE_FILES     10
+#define CANARY_TIMELINE_FILE_MAX_SIZE    (10 * 1024 * 1024)
+#define CANARY_TIMELINE_FILE_PATH_FORMAT "./%s.%u.timeline.json"
+
 #include <numeric>
+#include <thread>
+#include <condition_variable>
+#include <algorithm>
+#include <map>
+#include <random>
+#include <queue>
+#include <bitset>
 
 #include <aws/core/Aws.h>
+#include <aws/core/utils/json/JsonSerializer.h>
 #include <aws/monitoring/CloudWatchClient.h>
 #include <aws/monitoring/model/PutMetricDataRequest.h>
 #include <aws/logs/CloudWatchLogsClient.h>
@@ -120,7 +271,21 @@ using namespace Aws::CloudWatch;
 using namespace std;
 
 #include "Config.h"
+#include "RotatingFile.h"
 #include "CloudwatchLogs.h"
+#include "Logger.h"
+#include "TurnProbe.h"
+#include "IceConfigCache.h"
+#include "ConnectionTimeline.h"
+#include "ImpairmentRelay.h"
+#include "ResourceSampler.h"
+#include "Histogram.h"
+#include "Churn.h"
+#include "DataChannelBench.h"
+#include "FrameTracker.h"
+#include "LoadProfile.h"
 #include "Peer.h"
+#include "MetricsSink.h"
 #include "CloudwatchMonitoring.h"
 #include "Cloudwatch.h"
+#include "SignalingLoad.h"
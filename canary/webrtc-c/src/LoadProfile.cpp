@@ -0,0 +1,200 @@
+#include "Include.h"
+
+namespace Canary {
+
+STATUS LoadProfile::init(const PConfig pConfig)
+{
+    STATUS retStatus = STATUS_SUCCESS;
+
+    this->segments.clear();
+    this->segment = 0;
+    this->segmentStart = 0;
+    this->enabled = !pConfig->loadProfile.value.empty();
+
+    if (this->enabled) {
+        CHK_STATUS(this->parse(pConfig->loadProfile.value, pConfig));
+    } else {
+        Segment segment;
+        segment.bitRate.from = segment.bitRate.to = (DOUBLE) pConfig->bitRate.value;
+        segment.frameRate.from = segment.frameRate.to = (DOUBLE) pConfig->frameRate.value;
+        segment.label = "0";
+        this->segments.push_back(segment);
+    }
+
+CleanUp:
+
+    return retStatus;
+}
+
+BOOL LoadProfile::isEnabled()
+{
+    return this->enabled;
+}
+
+STATUS LoadProfile::parse(const std::string& spec, const PConfig pConfig)
+{
+    STATUS retStatus = STATUS_SUCCESS;
+    std::istringstream segmentSpecs(spec);
+    std::string segmentSpec, setting, key, value;
+    size_t colon, equals;
+    DOUBLE number;
+    PCHAR pEnd;
+
+    while (std::getline(segmentSpecs, segmentSpec, ';')) {
+        Segment segment;
+
+        if (segmentSpec.empty()) {
+            continue;
+        }
+
+        colon = segmentSpec.find(':');
+        CHK_ERR(colon != std::string::npos &&
+                    STATUS_SUCCEEDED(STRTOUI64((PCHAR) segmentSpec.substr(0, colon).c_str(), NULL, 10, &segment.duration)),
+                STATUS_INVALID_ARG, "Invalid load segment \"%s\", expected <seconds>:<settings>", segmentSpec.c_str());
+        segment.duration *= HUNDREDS_OF_NANOS_IN_A_SECOND;
+        segment.bitRate.from = segment.bitRate.to = (DOUBLE) pConfig->bitRate.value;
+        segment.frameRate.from = segment.frameRate.to = (DOUBLE) pConfig->frameRate.value;
+        segment.label = std::to_string(this->segments.size());
+
+        std::istringstream settings(segmentSpec.substr(colon + 1));
+        while (std::getline(settings, setting, ',')) {
+            if (setting.empty()) {
+                continue;
+            }
+
+            equals = setting.find('=');
+            CHK_ERR(equals != std::string::npos, STATUS_INVALID_ARG, "Invalid load setting \"%s\", expected <key>=<value>", setting.c_str());
+            key = setting.substr(0, equals);
+            value = setting.substr(equals + 1);
+
+            if (key == "shape") {
+                if (value == "step") {
+                    segment.shape = LOAD_SHAPE_STEP;
+                } else if (value == "ramp") {
+                    segment.shape = LOAD_SHAPE_RAMP;
+                } else if (value == "sawtooth") {
+                    segment.shape = LOAD_SHAPE_SAWTOOTH;
+                } else if (value == "square") {
+                    segment.shape = LOAD_SHAPE_SQUARE;
+                } else {
+                    CHK_ERR(FALSE, STATUS_INVALID_ARG, "Unknown load shape \"%s\"", value.c_str());
+                }
+            } else if (key == "label") {
+                CHK_ERR(!value.empty(), STATUS_INVALID_ARG, "Empty load segment label in \"%s\"", segmentSpec.c_str());
+                segment.label = value;
+            } else if (key == "period") {
+                number = strtod(value.c_str(), &pEnd);
+                CHK_ERR(!value.empty() && *pEnd == '\0' && number > 0, STATUS_INVALID_ARG, "Invalid load period \"%s\"", value.c_str());
+                segment.period = (UINT64) (number * HUNDREDS_OF_NANOS_IN_A_SECOND);
+            } else if (key == "bitrate") {
+                CHK_STATUS(parseRange(value, &segment.bitRate));
+                CHK_ERR(segment.bitRate.from > 0 && segment.bitRate.to > 0, STATUS_INVALID_ARG, "Load bitrate must be positive, got %s",
+                        value.c_str());
+                segment.bitRate.from *= 1000;
+                segment.bitRate.to *= 1000;
+            } else if (key == "fps") {
+                CHK_STATUS(parseRange(value, &segment.frameRate));
+                CHK_ERR(segment.frameRate.from >= 1 && segment.frameRate.to >= 1, STATUS_INVALID_ARG, "Load fps must be at least 1, got %s",
+                        value.c_str());
+            } else if (key == "keyframe") {
+                CHK_STATUS(parseRange(value, &segment.keyFrameInterval));
+            } else {
+                CHK_ERR(FALSE, STATUS_INVALID_ARG, "Unknown load setting \"%s\"", key.c_str());
+            }
+        }
+
+        CHK_ERR(segment.shape != LOAD_SHAPE_RAMP || segment.duration != 0, STATUS_INVALID_ARG,
+                "Load segment \"%s\" ramps, so it needs a duration", segmentSpec.c_str());
+        CHK_ERR((segment.shape != LOAD_SHAPE_SAWTOOTH && segment.shape != LOAD_SHAPE_SQUARE) || segment.period != 0, STATUS_INVALID_ARG,
+                "Load segment \"%s\" repeats, so it needs a period", segmentSpec.c_str());
+
+        this->segments.push_back(segment);
+    }
+
+    CHK_ERR(!this->segments.empty(), STATUS_INVALID_ARG, "Load profile \"%s\" has no segments", spec.c_str());
+
+CleanUp:
+
+    return retStatus;
+}
+
+STATUS LoadProfile::parseRange(const std::string& value, Range* pRange)
+{
+    STATUS retStatus = STATUS_SUCCESS;
+    PCHAR pEnd;
+
+    pRange->from = strtod(value.c_str(), &pEnd);
+    if (*pEnd == '-') {
+        pRange->to = strtod(pEnd + 1, &pEnd);
+    } else {
+        pRange->to = pRange->from;
+    }
+
+    CHK_ERR(!value.empty() && *pEnd == '\0' && pRange->from >= 0 && pRange->to >= 0, STATUS_INVALID_ARG,
+            "Invalid load value \"%s\", expected <number> or <from>-<to>", value.c_str());
+
+CleanUp:
+
+    return retStatus;
+}
+
+DOUBLE LoadProfile::evaluate(const Segment& segment, const Range& range, UINT64 elapsed)
+{
+    DOUBLE position;
+
+    switch (segment.shape) {
+        case LOAD_SHAPE_RAMP:
+            position = (DOUBLE) MIN(elapsed, segment.duration) / segment.duration;
+            break;
+        case LOAD_SHAPE_SAWTOOTH:
+            position = (DOUBLE) (elapsed % segment.period) / segment.period;
+            break;
+        case LOAD_SHAPE_SQUARE:
+            position = elapsed % segment.period < segment.period / 2 ? 0 : 1;
+            break;
+        default:
+            position = 0;
+            break;
+    }
+
+    return range.from + (range.to - range.from) * position;
+}
+
+VOID LoadProfile::sample(UINT64 now, PLoadPoint pPoint)
+{
+    if (this->segmentStart == 0) {
+        this->segmentStart = now;
+    }
+
+    // A stalled sender can be behind by more than one segment
+    while (this->segments[this->segment].duration != 0 && now - this->segmentStart >= this->segments[this->segment].duration) {
+        this->segmentStart += this->segments[this->segment].duration;
+        this->segment = (this->segment + 1) % this->segments.size();
+    }
+
+    auto& segment = this->segments[this->segment];
+    UINT64 elapsed = now - this->segmentStart;
+
+    pPoint->bitRate = (UINT64) evaluate(segment, segment.bitRate, elapsed);
+    pPoint->frameRate = MAX((UINT64) (evaluate(segment, segment.frameRate, elapsed) + 0.5), 1);
+    pPoint->keyFrameInterval = (UINT64) (evaluate(segment, segment.keyFrameInterval, elapsed) + 0.5);
+    pPoint->segment = this->segment;
+}
+
+const std::string& LoadProfile::getLabel(UINT32 segment)
+{
+    return this->segments[segment].label;
+}
+
+UINT64 LoadProfile::getMinFrameRate()
+{
+    DOUBLE frameRate = MAX_UINT64;
+
+    for (auto& segment : this->segments) {
+        frameRate = MIN(frameRate, MIN(segment.frameRate.from, segment.frameRate.to));
+    }
+
+    return MAX((UINT64) frameRate, 1);
+}
+
+} // namespace Canary
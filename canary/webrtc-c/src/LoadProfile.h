@@ -0,0 +1,72 @@
+#pragma once
+
+namespace Canary {
+
+typedef enum {
+    LOAD_SHAPE_STEP,
+    LOAD_SHAPE_RAMP,
+    LOAD_SHAPE_SAWTOOTH,
+    LOAD_SHAPE_SQUARE,
+} LOAD_SHAPE;
+
+// What the video sender should produce at a given moment
+typedef struct {
+    UINT64 bitRate;
+    UINT64 frameRate;
+    // In frames, 0 sends every frame at the same size and without the key frame flag
+    UINT64 keyFrameInterval;
+    UINT32 segment;
+} LoadPoint;
+typedef LoadPoint* PLoadPoint;
+
+/*
+ * Schedule of video load over the run. Without a spec there is a single segment that holds CANARY_DATARATE_IN_BITS_PER_SECOND
+ * and CANARY_FRAME_RATE forever, which is what the canary always did. Segments run in order and wrap around unless one of
+ * them has no duration, in which case it is held until the end. Each segment has a label, its index unless given, that
+ * goes out as the Segment dimension on a copy of every metric.
+ *
+ * Spec: "<seconds>:<key>=<value>,...;<seconds>:..." with keys shape (step, ramp, sawtooth or square), period,
+ * bitrate, fps, keyframe and label, e.g. "60:bitrate=500,label=low;120:shape=ramp,bitrate=500-4000;60:shape=square,
+ * period=10,fps=10-30". bitrate is in kilobits per second, period in seconds and keyframe in frames. Numbers take either
+ * one value or "<from>-<to>": step holds <from>, ramp goes from <from> to <to> over the segment, sawtooth does that once
+ * per period and square spends the first half of every period at <from> and the second half at <to>.
+ */
+class LoadProfile {
+  public:
+    STATUS init(const PConfig);
+    BOOL isEnabled();
+    VOID sample(UINT64, PLoadPoint);
+    const std::string& getLabel(UINT32);
+    UINT64 getMinFrameRate();
+
+  private:
+    class Range {
+      public:
+        DOUBLE from = 0;
+        DOUBLE to = 0;
+    };
+
+    class Segment {
+      public:
+        // 0 holds the segment forever
+        UINT64 duration = 0;
+        LOAD_SHAPE shape = LOAD_SHAPE_STEP;
+        UINT64 period = 0;
+        Range bitRate;
+        Range frameRate;
+        Range keyFrameInterval;
+        std::string label;
+    };
+
+    STATUS parse(const std::string&, const PConfig);
+    static STATUS parseRange(const std::string&, Range*);
+    static DOUBLE evaluate(const Segment&, const Range&, UINT64);
+
+    BOOL enabled = FALSE;
+    std::vector<Segment> segments;
+    UINT32 segment = 0;
+    UINT64 segmentStart = 0;
+};
+typedef LoadProfile* PLoadProfile;
+
+} // namespace Canary
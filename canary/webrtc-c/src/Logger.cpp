@@ -0,0 +1,733 @@
+#include "Include.h"
+
+namespace Canary {
+
+typedef enum {
+    LOG_ARG_LENGTH_DEFAULT,
+    LOG_ARG_LENGTH_CHAR,
+    LOG_ARG_LENGTH_SHORT,
+    LOG_ARG_LENGTH_LONG,
+    LOG_ARG_LENGTH_LONG_LONG,
+    LOG_ARG_LENGTH_INTMAX,
+    LOG_ARG_LENGTH_SIZE,
+    LOG_ARG_LENGTH_PTRDIFF,
+    LOG_ARG_LENGTH_LONG_DOUBLE,
+} LOG_ARG_LENGTH;
+
+typedef struct {
+    UINT32 flagsLength;
+    BOOL widthFromArg;
+    INT64 width;
+    BOOL precisionFromArg;
+    INT64 precision;
+    LOG_ARG_LENGTH length;
+    CHAR conversion;
+} LogFormatSpec;
+
+static const PCHAR LOG_LEVEL_NAMES[CANARY_LOGGER_LEVEL_COUNT] = {
+    (PCHAR) "UNKNOWN", (PCHAR) "VERBOSE", (PCHAR) "DEBUG", (PCHAR) "INFO",    (PCHAR) "WARN",
+    (PCHAR) "ERROR",   (PCHAR) "FATAL",   (PCHAR) "SILENT", (PCHAR) "PROFILE",
+};
+
+static UINT32 levelIndex(UINT32 level)
+{
+    return MIN(level, CANARY_LOGGER_LEVEL_COUNT - 1);
+}
+
+// Parses a printf conversion specification starting at '%' and returns the position right after it
+static PCHAR parseFormatSpec(PCHAR pCur, LogFormatSpec* pSpec)
+{
+    MEMSET(pSpec, 0x00, SIZEOF(LogFormatSpec));
+    pSpec->width = -1;
+    pSpec->precision = -1;
+
+    for (pCur++; *pCur != '\0' && STRCHR("-+ #0'", *pCur) != NULL; pCur++) {
+        pSpec->flagsLength++;
+    }
+
+    if (*pCur == '*') {
+        pSpec->widthFromArg = TRUE;
+        pCur++;
+    } else if (*pCur >= '0' && *pCur <= '9') {
+        for (pSpec->width = 0; *pCur >= '0' && *pCur <= '9'; pCur++) {
+            pSpec->width = pSpec->width * 10 + (*pCur - '0');
+        }
+    }
+
+    if (*pCur == '.') {
+        pCur++;
+        if (*pCur == '*') {
+            pSpec->precisionFromArg = TRUE;
+            pCur++;
+        } else {
+            for (pSpec->precision = 0; *pCur >= '0' && *pCur <= '9'; pCur++) {
+                pSpec->precision = pSpec->precision * 10 + (*pCur - '0');
+            }
+        }
+    }
+
+    switch (*pCur) {
+        case 'h':
+            pSpec->length = LOG_ARG_LENGTH_SHORT;
+            if (*++pCur == 'h') {
+                pSpec->length = LOG_ARG_LENGTH_CHAR;
+                pCur++;
+            }
+            break;
+        case 'l':
+            pSpec->length = LOG_ARG_LENGTH_LONG;
+            if (*++pCur == 'l') {
+                pSpec->length = LOG_ARG_LENGTH_LONG_LONG;
+                pCur++;
+            }
+            break;
+        case 'q':
+            pSpec->length = LOG_ARG_LENGTH_LONG_LONG;
+            pCur++;
+            break;
+        case 'j':
+            pSpec->length = LOG_ARG_LENGTH_INTMAX;
+            pCur++;
+            break;
+        case 'z':
+            pSpec->length = LOG_ARG_LENGTH_SIZE;
+            pCur++;
+            break;
+        case 't':
+            pSpec->length = LOG_ARG_LENGTH_PTRDIFF;
+            pCur++;
+            break;
+        case 'L':
+            pSpec->length = LOG_ARG_LENGTH_LONG_DOUBLE;
+            pCur++;
+            break;
+        default:
+            break;
+    }
+
+    pSpec->conversion = *pCur;
+    return *pCur == '\0' ? pCur : pCur + 1;
+}
+
+Logger::Ring::Ring()
+{
+    for (UINT32 i = 0; i < CANARY_LOGGER_LEVEL_COUNT; i++) {
+        captured[i] = 0;
+        dropped[i] = 0;
+    }
+}
+
+Logger::RingHolder::~RingHolder()
+{
+    // The logger thread releases the ring once everything in it has been written out
+    if (ring) {
+        ring->retired = true;
+    }
+}
+
+thread_local Logger::RingHolder Logger::threadRing;
+
+Logger::Logger()
+{
+    for (UINT32 i = 0; i < CANARY_LOGGER_LEVEL_COUNT; i++) {
+        rateLimited[i] = 0;
+        deduplicated[i] = 0;
+        emitted[i] = 0;
+        retiredCaptured[i] = 0;
+        retiredDropped[i] = 0;
+    }
+}
+
+Logger& Logger::getInstance()
+{
+    static Logger instance;
+    return instance;
+}
+
+STATUS Logger::init(PConfig pConfig, CloudwatchLogs* pCloudwatchLogs)
+{
+    STATUS retStatus = STATUS_SUCCESS;
+
+    CHK(pConfig != NULL, STATUS_NULL_ARG);
+    CHK_ERR(!this->running.load(), STATUS_INVALID_OPERATION, "Logger has already been initialized");
+
+    this->pCloudwatchLogs = pCloudwatchLogs;
+    this->file.setPrefix(pConfig->logStreamName.value);
+    this->running = true;
+    this->worker = std::thread(&Logger::run, this);
+
+CleanUp:
+
+    return retStatus;
+}
+
+VOID Logger::deinit()
+{
+    string batch;
+    std::stringstream ss;
+
+    if (!this->running.exchange(false)) {
+        return;
+    }
+
+    this->wake.notify_one();
+    this->worker.join();
+
+    for (UINT32 i = 0; i < CANARY_LOGGER_LEVEL_COUNT; i++) {
+        auto stats = this->getStats(i);
+        if (stats.captured == 0 && stats.dropped == 0) {
+            continue;
+        }
+
+        ss.str("");
+        ss << "Logger " << LOG_LEVEL_NAMES[i] << " stats: captured " << stats.captured << ", emitted " << stats.emitted << ", deduplicated "
+           << stats.deduplicated << ", rate limited " << stats.rateLimited << ", dropped " << stats.dropped;
+        this->appendLine(GETTIME(), LOG_LEVEL_INFO, ss.str(), batch);
+    }
+
+    if (!batch.empty()) {
+        fwrite(batch.data(), 1, batch.size(), stdout);
+        fflush(stdout);
+        this->file.write(batch);
+    }
+
+    this->file.close();
+    this->pCloudwatchLogs = nullptr;
+}
+
+Logger::LevelStats Logger::getStats(UINT32 level)
+{
+    LevelStats stats;
+    UINT32 index = levelIndex(level);
+
+    {
+        std::lock_guard<std::mutex> lock(this->ringsMutex);
+        for (auto& ring : this->rings) {
+            stats.captured += ring->captured[index].load(std::memory_order_relaxed);
+            stats.dropped += ring->dropped[index].load(std::memory_order_relaxed);
+        }
+    }
+
+    stats.captured += this->retiredCaptured[index].load();
+    stats.dropped += this->retiredDropped[index].load();
+    stats.rateLimited = this->rateLimited[index].load();
+    stats.deduplicated = this->deduplicated[index].load();
+    stats.emitted = this->emitted[index].load();
+
+    return stats;
+}
+
+VOID Logger::log(UINT32 level, PCHAR tag, PCHAR fmt, ...)
+{
+    CHAR logFmtString[MAX_LOG_FORMAT_LENGTH + 1];
+    va_list valist;
+    UNUSED_PARAM(tag);
+
+    if (level < GET_LOGGER_LOG_LEVEL()) {
+        return;
+    }
+
+    auto& instance = getInstance();
+    va_start(valist, fmt);
+    if (instance.running.load()) {
+        instance.capture(level, fmt, valist);
+    } else {
+        // Before init and after deinit there is no logger thread, so print synchronously
+        addLogMetadata(logFmtString, (UINT32) ARRAY_SIZE(logFmtString), fmt, level);
+        vprintf(logFmtString, valist);
+    }
+    va_end(valist);
+}
+
+Logger::Ring* Logger::getThreadRing()
+{
+    if (!threadRing.ring) {
+        threadRing.ring = std::make_shared<Ring>();
+        std::lock_guard<std::mutex> lock(this->ringsMutex);
+        this->rings.push_back(threadRing.ring);
+    }
+
+    return threadRing.ring.get();
+}
+
+VOID Logger::capture(UINT32 level, PCHAR fmt, va_list args)
+{
+    Ring* pRing = this->getThreadRing();
+    UINT32 index = levelIndex(level);
+    UINT64 head = pRing->head.load(std::memory_order_relaxed);
+    UINT64 pending = head - pRing->tail.load(std::memory_order_acquire);
+    LogFormatSpec spec;
+    INT64 signedValue;
+    UINT64 unsignedValue;
+    DOUBLE doubleValue;
+    PCHAR stringValue;
+    UINT16 stringLength;
+    UINT32 remaining;
+
+    // Never block the calling thread, count the line as dropped instead
+    if (pending >= CANARY_LOGGER_RING_CAPACITY) {
+        pRing->dropped[index].fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    Record& record = pRing->records[head & (CANARY_LOGGER_RING_CAPACITY - 1)];
+    record.timestamp = GETTIME();
+    record.fmt = fmt;
+    record.level = level;
+    record.argsSize = 0;
+    record.truncated = FALSE;
+
+    auto put = [&record](const VOID* pValue, UINT32 size) {
+        if (record.argsSize + size > SIZEOF(record.args)) {
+            record.truncated = TRUE;
+            return;
+        }
+        MEMCPY(record.args + record.argsSize, pValue, size);
+        record.argsSize += size;
+    };
+
+    for (PCHAR pCur = fmt; *pCur != '\0' && !record.truncated;) {
+        if (*pCur != '%') {
+            pCur++;
+            continue;
+        }
+
+        if (pCur[1] == '%') {
+            pCur += 2;
+            continue;
+        }
+
+        pCur = parseFormatSpec(pCur, &spec);
+        if (spec.widthFromArg) {
+            signedValue = va_arg(args, INT32);
+            put(&signedValue, SIZEOF(signedValue));
+        }
+
+        if (spec.precisionFromArg) {
+            signedValue = va_arg(args, INT32);
+            put(&signedValue, SIZEOF(signedValue));
+            spec.precision = signedValue;
+        }
+
+        switch (spec.conversion) {
+            case 'd':
+            case 'i':
+            case 'c':
+                switch (spec.length) {
+                    case LOG_ARG_LENGTH_CHAR:
+                        signedValue = (signed char) va_arg(args, INT32);
+                        break;
+                    case LOG_ARG_LENGTH_SHORT:
+                        signedValue = (short) va_arg(args, INT32);
+                        break;
+                    case LOG_ARG_LENGTH_LONG:
+                        signedValue = va_arg(args, long);
+                        break;
+                    case LOG_ARG_LENGTH_LONG_LONG:
+                        signedValue = va_arg(args, long long);
+                        break;
+                    case LOG_ARG_LENGTH_INTMAX:
+                        signedValue = va_arg(args, intmax_t);
+                        break;
+                    case LOG_ARG_LENGTH_SIZE:
+                        signedValue = (INT64) va_arg(args, size_t);
+                        break;
+                    case LOG_ARG_LENGTH_PTRDIFF:
+                        signedValue = va_arg(args, ptrdiff_t);
+                        break;
+                    default:
+                        signedValue = va_arg(args, INT32);
+                        break;
+                }
+                put(&signedValue, SIZEOF(signedValue));
+                break;
+            case 'u':
+            case 'o':
+            case 'x':
+            case 'X':
+                switch (spec.length) {
+                    case LOG_ARG_LENGTH_CHAR:
+                        unsignedValue = (unsigned char) va_arg(args, UINT32);
+                        break;
+                    case LOG_ARG_LENGTH_SHORT:
+                        unsignedValue = (unsigned short) va_arg(args, UINT32);
+                        break;
+                    case LOG_ARG_LENGTH_LONG:
+                        unsignedValue = va_arg(args, unsigned long);
+                        break;
+                    case LOG_ARG_LENGTH_LONG_LONG:
+                        unsignedValue = va_arg(args, unsigned long long);
+                        break;
+                    case LOG_ARG_LENGTH_INTMAX:
+                        unsignedValue = va_arg(args, uintmax_t);
+                        break;
+                    case LOG_ARG_LENGTH_SIZE:
+                        unsignedValue = va_arg(args, size_t);
+                        break;
+                    case LOG_ARG_LENGTH_PTRDIFF:
+                        unsignedValue = (UINT64) va_arg(args, ptrdiff_t);
+                        break;
+                    default:
+                        unsignedValue = va_arg(args, UINT32);
+                        break;
+                }
+                put(&unsignedValue, SIZEOF(unsignedValue));
+                break;
+            case 'f':
+            case 'F':
+            case 'e':
+            case 'E':
+            case 'g':
+            case 'G':
+            case 'a':
+            case 'A':
+                doubleValue = spec.length == LOG_ARG_LENGTH_LONG_DOUBLE ? (DOUBLE) va_arg(args, long double) : va_arg(args, DOUBLE);
+                put(&doubleValue, SIZEOF(doubleValue));
+                break;
+            case 's':
+                stringValue = va_arg(args, PCHAR);
+                if (stringValue == NULL) {
+                    stringValue = (PCHAR) "(null)";
+                }
+                // A precision bounds the read, the buffer doesn't have to be terminated then.
+                // Copy as much of the string as fits, the rest of the line gets marked as truncated
+                unsignedValue = spec.precision >= 0 ? STRNLEN(stringValue, (SIZE_T) spec.precision) : STRLEN(stringValue);
+                remaining = record.argsSize + SIZEOF(UINT16) < SIZEOF(record.args) ? SIZEOF(record.args) - record.argsSize - SIZEOF(UINT16) : 0;
+                stringLength = (UINT16) MIN(unsignedValue, MIN(remaining, MAX_UINT16));
+                put(&stringLength, SIZEOF(stringLength));
+                put(stringValue, stringLength);
+                if (stringLength < unsignedValue) {
+                    record.truncated = TRUE;
+                }
+                break;
+            case 'p':
+                unsignedValue = (UINT64) (uintptr_t) va_arg(args, PVOID);
+                put(&unsignedValue, SIZEOF(unsignedValue));
+                break;
+            case 'n':
+                // Writing back through %n is not supported, just consume the argument
+                va_arg(args, PVOID);
+                break;
+            default:
+                // Unknown conversion, the remaining arguments can't be walked safely
+                record.truncated = TRUE;
+                break;
+        }
+    }
+
+    pRing->captured[index].fetch_add(1, std::memory_order_relaxed);
+    pRing->head.store(head + 1, std::memory_order_release);
+
+    // Nudge the logger thread early when a ring starts filling up instead of waiting for the next flush period
+    if (pending + 1 == CANARY_LOGGER_RING_CAPACITY / 2) {
+        this->wake.notify_one();
+    }
+}
+
+VOID Logger::run()
+{
+    while (this->running.load()) {
+        {
+            std::unique_lock<std::mutex> lock(this->wakeMutex);
+            this->wake.wait_for(lock, std::chrono::milliseconds(CANARY_LOGGER_FLUSH_PERIOD / HUNDREDS_OF_NANOS_IN_A_MILLISECOND));
+        }
+        this->drain(FALSE);
+    }
+
+    this->drain(TRUE);
+}
+
+VOID Logger::drain(BOOL final)
+{
+    std::vector<std::shared_ptr<Ring>> snapshot;
+    std::vector<Line> lines;
+    UINT64 dropped[CANARY_LOGGER_LEVEL_COUNT];
+    UINT64 head, tail, now;
+    string batch;
+    std::stringstream ss;
+
+    {
+        std::lock_guard<std::mutex> lock(this->ringsMutex);
+        snapshot = this->rings;
+    }
+
+    for (UINT32 i = 0; i < CANARY_LOGGER_LEVEL_COUNT; i++) {
+        dropped[i] = this->retiredDropped[i].load();
+    }
+
+    for (auto& ring : snapshot) {
+        head = ring->head.load(std::memory_order_acquire);
+        tail = ring->tail.load(std::memory_order_relaxed);
+        for (; tail < head; tail++) {
+            const Record& record = ring->records[tail & (CANARY_LOGGER_RING_CAPACITY - 1)];
+            Line line;
+            line.timestamp = record.timestamp;
+            line.level = record.level;
+            this->format(record, line.message);
+            lines.push_back(std::move(line));
+        }
+        ring->tail.store(tail, std::memory_order_release);
+
+        for (UINT32 i = 0; i < CANARY_LOGGER_LEVEL_COUNT; i++) {
+            dropped[i] += ring->dropped[i].load(std::memory_order_relaxed);
+        }
+    }
+
+    // Interleave lines from different threads in capture order
+    std::stable_sort(lines.begin(), lines.end(), [](const Line& a, const Line& b) { return a.timestamp < b.timestamp; });
+    for (auto& line : lines) {
+        this->emit(line.timestamp, line.level, line.message, batch);
+    }
+
+    now = GETTIME();
+    for (UINT32 i = 0; i < CANARY_LOGGER_LEVEL_COUNT; i++) {
+        if (dropped[i] > this->reportedDropped[i]) {
+            ss.str("");
+            ss << "Dropped " << dropped[i] - this->reportedDropped[i] << " " << LOG_LEVEL_NAMES[i] << " lines, logger ring was full";
+            this->appendLine(now, LOG_LEVEL_WARN, ss.str(), batch);
+            this->reportedDropped[i] = dropped[i];
+        }
+    }
+
+    if (this->repeatCount > 0 && (final || now - this->lastEmitTime >= CANARY_LOGGER_DEDUP_WINDOW)) {
+        this->flushRepeats(now, batch);
+        this->lastMessage.clear();
+    }
+
+    if (!batch.empty()) {
+        fwrite(batch.data(), 1, batch.size(), stdout);
+        fflush(stdout);
+        this->file.write(batch);
+    }
+
+    // Release rings of exited threads once they have been fully drained
+    std::lock_guard<std::mutex> lock(this->ringsMutex);
+    for (auto it = this->rings.begin(); it != this->rings.end();) {
+        auto& ring = *it;
+        if (ring->retired.load() && ring->head.load() == ring->tail.load()) {
+            for (UINT32 i = 0; i < CANARY_LOGGER_LEVEL_COUNT; i++) {
+                this->retiredCaptured[i] += ring->captured[i].load();
+                this->retiredDropped[i] += ring->dropped[i].load();
+            }
+            it = this->rings.erase(it);
+        } else {
+            it++;
+        }
+    }
+}
+
+VOID Logger::format(const Record& record, string& out)
+{
+    CHAR spec[MAX_LOG_FORMAT_LENGTH + 1];
+    CHAR buffer[MAX_LOG_FORMAT_LENGTH + 1];
+    UINT32 offset = 0, specLength;
+    LogFormatSpec parsed;
+    PCHAR pCur = record.fmt, pStart;
+    INT64 signedValue;
+    UINT64 unsignedValue;
+    DOUBLE doubleValue;
+    UINT16 stringLength;
+    BOOL exhausted = FALSE;
+    string stringValue;
+
+    auto get = [&record, &offset](VOID* pValue, UINT32 size) -> BOOL {
+        if (offset + size > record.argsSize) {
+            return FALSE;
+        }
+        MEMCPY(pValue, record.args + offset, size);
+        offset += size;
+        return TRUE;
+    };
+
+    while (*pCur != '\0' && !exhausted) {
+        if (*pCur != '%') {
+            for (pStart = pCur; *pCur != '\0' && *pCur != '%'; pCur++) {
+            }
+            out.append(pStart, pCur - pStart);
+            continue;
+        }
+
+        if (pCur[1] == '%') {
+            out.push_back('%');
+            pCur += 2;
+            continue;
+        }
+
+        pStart = pCur;
+        pCur = parseFormatSpec(pCur, &parsed);
+        if (parsed.widthFromArg) {
+            exhausted = !get(&parsed.width, SIZEOF(parsed.width));
+        }
+
+        if (parsed.precisionFromArg && !exhausted) {
+            exhausted = !get(&parsed.precision, SIZEOF(parsed.precision));
+        }
+
+        // Rebuild the specification with the arguments widened to the types they were captured as
+        specLength = 1 + parsed.flagsLength;
+        MEMCPY(spec, pStart, specLength);
+        if (parsed.width >= 0 || parsed.widthFromArg) {
+            specLength += SNPRINTF(spec + specLength, SIZEOF(spec) - specLength, "%" PRId64, parsed.width);
+        }
+
+        // A negative precision passed through '*' means no precision at all
+        if (parsed.precision >= 0) {
+            specLength += SNPRINTF(spec + specLength, SIZEOF(spec) - specLength, ".%" PRId64, parsed.precision);
+        }
+
+        buffer[0] = '\0';
+        switch (parsed.conversion) {
+            case 'd':
+            case 'i':
+                if (!exhausted && !(exhausted = !get(&signedValue, SIZEOF(signedValue)))) {
+                    SNPRINTF(spec + specLength, SIZEOF(spec) - specLength, "ll%c", parsed.conversion);
+                    SNPRINTF(buffer, SIZEOF(buffer), spec, (long long) signedValue);
+                }
+                break;
+            case 'c':
+                if (!exhausted && !(exhausted = !get(&signedValue, SIZEOF(signedValue)))) {
+                    SNPRINTF(spec + specLength, SIZEOF(spec) - specLength, "c");
+                    SNPRINTF(buffer, SIZEOF(buffer), spec, (INT32) signedValue);
+                }
+                break;
+            case 'u':
+            case 'o':
+            case 'x':
+            case 'X':
+                if (!exhausted && !(exhausted = !get(&unsignedValue, SIZEOF(unsignedValue)))) {
+                    SNPRINTF(spec + specLength, SIZEOF(spec) - specLength, "ll%c", parsed.conversion);
+                    SNPRINTF(buffer, SIZEOF(buffer), spec, (unsigned long long) unsignedValue);
+                }
+                break;
+            case 'f':
+            case 'F':
+            case 'e':
+            case 'E':
+            case 'g':
+            case 'G':
+            case 'a':
+            case 'A':
+                if (!exhausted && !(exhausted = !get(&doubleValue, SIZEOF(doubleValue)))) {
+                    SNPRINTF(spec + specLength, SIZEOF(spec) - specLength, "%c", parsed.conversion);
+                    SNPRINTF(buffer, SIZEOF(buffer), spec, doubleValue);
+                }
+                break;
+            case 's':
+                if (!exhausted && !(exhausted = !get(&stringLength, SIZEOF(stringLength)))) {
+                    stringValue.assign((PCHAR) record.args + offset, MIN((UINT32) stringLength, record.argsSize - offset));
+                    offset += stringLength;
+                    if (specLength == 1) {
+                        // Plain %s, skip the copy through the scratch buffer
+                        out.append(stringValue);
+                    } else {
+                        SNPRINTF(spec + specLength, SIZEOF(spec) - specLength, "s");
+                        SNPRINTF(buffer, SIZEOF(buffer), spec, stringValue.c_str());
+                    }
+                }
+                break;
+            case 'p':
+                if (!exhausted && !(exhausted = !get(&unsignedValue, SIZEOF(unsignedValue)))) {
+                    SNPRINTF(spec + specLength, SIZEOF(spec) - specLength, "p");
+                    SNPRINTF(buffer, SIZEOF(buffer), spec, (PVOID) (uintptr_t) unsignedValue);
+                }
+                break;
+            case 'n':
+                break;
+            default:
+                exhausted = TRUE;
+                break;
+        }
+
+        if (exhausted) {
+            // Whatever couldn't be captured is kept as the raw format string
+            out.append(pStart);
+        } else {
+            out.append(buffer);
+        }
+    }
+
+    if (record.truncated) {
+        out.append(" [truncated]");
+    }
+}
+
+VOID Logger::emit(UINT64 timestamp, UINT32 level, const string& message, string& batch)
+{
+    UINT32 index = levelIndex(level);
+    UINT64 elapsed;
+    std::stringstream ss;
+
+    if (level == this->lastLevel && message == this->lastMessage) {
+        this->repeatCount++;
+        this->deduplicated[index]++;
+        return;
+    }
+
+    this->flushRepeats(timestamp, batch);
+
+    // Only chatty levels are rate limited, warnings and errors always go through
+    if (level < LOG_LEVEL_WARN) {
+        if (this->lastRefillTime[index] == 0) {
+            this->tokens[index] = CANARY_LOGGER_RATE_LIMIT_BURST;
+        } else if (timestamp > this->lastRefillTime[index]) {
+            elapsed = timestamp - this->lastRefillTime[index];
+            this->tokens[index] = MIN((DOUBLE) CANARY_LOGGER_RATE_LIMIT_BURST,
+                                      this->tokens[index] + (DOUBLE) elapsed * CANARY_LOGGER_RATE_LIMIT_PER_SECOND / HUNDREDS_OF_NANOS_IN_A_SECOND);
+        }
+        this->lastRefillTime[index] = MAX(timestamp, this->lastRefillTime[index]);
+
+        if (this->tokens[index] < 1) {
+            this->rateLimited[index]++;
+            this->pendingRateLimited[index]++;
+            return;
+        }
+        this->tokens[index] -= 1;
+    }
+
+    if (this->pendingRateLimited[index] > 0) {
+        ss << "Rate limited " << this->pendingRateLimited[index] << " " << LOG_LEVEL_NAMES[index] << " lines";
+        this->appendLine(timestamp, LOG_LEVEL_WARN, ss.str(), batch);
+        this->pendingRateLimited[index] = 0;
+    }
+
+    this->appendLine(timestamp, level, message, batch);
+    this->lastMessage = message;
+    this->lastLevel = level;
+    this->lastEmitTime = timestamp;
+    this->emitted[index]++;
+}
+
+VOID Logger::flushRepeats(UINT64 timestamp, string& batch)
+{
+    std::stringstream ss;
+
+    if (this->repeatCount == 0) {
+        return;
+    }
+
+    ss << "Last message repeated " << this->repeatCount << " times";
+    this->appendLine(timestamp, this->lastLevel, ss.str(), batch);
+    this->repeatCount = 0;
+}
+
+VOID Logger::appendLine(UINT64 timestamp, UINT32 level, const string& message, string& batch)
+{
+    CHAR prefix[64];
+    time_t seconds = (time_t) (timestamp / HUNDREDS_OF_NANOS_IN_A_SECOND);
+    struct tm utc;
+    size_t length;
+
+    gmtime_r(&seconds, &utc);
+    length = strftime(prefix, SIZEOF(prefix), "%Y-%m-%d %H:%M:%S", &utc);
+    SNPRINTF(prefix + length, SIZEOF(prefix) - length, ".%03u %-7s ",
+             (UINT32) ((timestamp % HUNDREDS_OF_NANOS_IN_A_SECOND) / HUNDREDS_OF_NANOS_IN_A_MILLISECOND), LOG_LEVEL_NAMES[levelIndex(level)]);
+
+    string line = prefix + message + "\n";
+    batch.append(line);
+
+    if (this->pCloudwatchLogs != nullptr) {
+        this->pCloudwatchLogs->push(line);
+    }
+}
+
+} // namespace Canary
@@ -0,0 +1,106 @@
+#pragma once
+
+namespace Canary {
+
+/*
+ * Asynchronous logger. The calling thread only records a timestamp, the format string pointer and the raw
+ * arguments into its own ring. Formatting, deduplication, rate limiting and all sink I/O (console, rotating
+ * file and Cloudwatch Logs) happen on a single background thread in one pass.
+ *
+ * The format string is stored by pointer, which relies on DLOG* passing string literals.
+ */
+class Logger {
+  public:
+    class LevelStats {
+      public:
+        UINT64 captured = 0;
+        UINT64 dropped = 0;
+        UINT64 rateLimited = 0;
+        UINT64 deduplicated = 0;
+        UINT64 emitted = 0;
+    };
+
+    Logger(Logger const&) = delete;
+    void operator=(Logger const&) = delete;
+
+    static Logger& getInstance();
+    STATUS init(PConfig, CloudwatchLogs*);
+    VOID deinit();
+    LevelStats getStats(UINT32);
+    static VOID log(UINT32, PCHAR, PCHAR, ...);
+
+  private:
+    typedef struct {
+        UINT64 timestamp;
+        PCHAR fmt;
+        UINT32 level;
+        UINT32 argsSize;
+        BOOL truncated;
+        BYTE args[CANARY_LOGGER_RECORD_ARGS_SIZE];
+    } Record;
+
+    // Single producer (the owning thread), single consumer (the logger thread)
+    class Ring {
+      public:
+        std::atomic<UINT64> head{0};
+        std::atomic<UINT64> tail{0};
+        std::atomic<bool> retired{false};
+        std::atomic<UINT64> captured[CANARY_LOGGER_LEVEL_COUNT];
+        std::atomic<UINT64> dropped[CANARY_LOGGER_LEVEL_COUNT];
+        Record records[CANARY_LOGGER_RING_CAPACITY];
+
+        Ring();
+    };
+
+    class RingHolder {
+      public:
+        std::shared_ptr<Ring> ring;
+        ~RingHolder();
+    };
+
+    class Line {
+      public:
+        UINT64 timestamp;
+        UINT32 level;
+        string message;
+    };
+
+    Logger();
+    Ring* getThreadRing();
+    VOID capture(UINT32, PCHAR, va_list);
+    VOID run();
+    VOID drain(BOOL);
+    VOID format(const Record&, string&);
+    VOID emit(UINT64, UINT32, const string&, string&);
+    VOID flushRepeats(UINT64, string&);
+    VOID appendLine(UINT64, UINT32, const string&, string&);
+
+    static thread_local RingHolder threadRing;
+
+    std::atomic<bool> running{false};
+    std::mutex ringsMutex;
+    std::vector<std::shared_ptr<Ring>> rings;
+    std::mutex wakeMutex;
+    std::condition_variable wake;
+    std::thread worker;
+    CloudwatchLogs* pCloudwatchLogs = nullptr;
+
+    // State below is only touched by the logger thread
+    RotatingFile file{(PCHAR) CANARY_LOG_FILE_PATH_FORMAT, CANARY_LOG_FILE_MAX_SIZE, MAX_NUMBER_OF_LOG_FILES};
+    string lastMessage;
+    UINT32 lastLevel = 0;
+    UINT64 lastEmitTime = 0;
+    UINT64 repeatCount = 0;
+    DOUBLE tokens[CANARY_LOGGER_LEVEL_COUNT] = {0};
+    UINT64 lastRefillTime[CANARY_LOGGER_LEVEL_COUNT] = {0};
+    UINT64 pendingRateLimited[CANARY_LOGGER_LEVEL_COUNT] = {0};
+    UINT64 reportedDropped[CANARY_LOGGER_LEVEL_COUNT] = {0};
+
+    std::atomic<UINT64> rateLimited[CANARY_LOGGER_LEVEL_COUNT];
+    std::atomic<UINT64> deduplicated[CANARY_LOGGER_LEVEL_COUNT];
+    std::atomic<UINT64> emitted[CANARY_LOGGER_LEVEL_COUNT];
+    std::atomic<UINT64> retiredCaptured[CANARY_LOGGER_LEVEL_COUNT];
+    std::atomic<UINT64> retiredDropped[CANARY_LOGGER_LEVEL_COUNT];
+};
+
+} // namespace Canary
@@ -0,0 +1,190 @@
+#include "Include.h"
+
+namespace Canary {
+
+STATUS MetricsSink::init()
+{
+    return STATUS_SUCCESS;
+}
+
+VOID MetricsSink::deinit()
+{
+}
+
+CloudwatchMetricsSink::CloudwatchMetricsSink(ClientConfiguration* pClientConfig) : client(*pClientConfig)
+{
+}
+
+STATUS CloudwatchMetricsSink::init()
+{
+    this->flusher = std::thread(&CloudwatchMetricsSink::run, this);
+    return STATUS_SUCCESS;
+}
+
+VOID CloudwatchMetricsSink::deinit()
+{
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->stopping = TRUE;
+    }
+    this->wake.notify_one();
+    if (this->flusher.joinable()) {
+        this->flusher.join();
+    }
+
+    this->flush();
+
+    // need to wait all metrics to be flushed out, otherwise we'll get a segfault.
+    // https://docs.aws.amazon.com/sdk-for-cpp/v1/developer-guide/basic-use.html
+    // TODO: maybe add a timeout? But, this might cause a segfault if it hits a timeout.
+    while (this->pendingMetrics.load() > 0) {
+        THREAD_SLEEP(HUNDREDS_OF_NANOS_IN_A_MILLISECOND * 500);
+    }
+}
+
+VOID CloudwatchMetricsSink::put(const MetricDatum& datum)
+{
+    BOOL full;
+
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        if (this->batch.empty()) {
+            this->batchStartTime = GETTIME();
+        }
+        this->batch.push_back(datum);
+        full = this->batch.size() >= MAX_CLOUDWATCH_METRIC_DATUM_COUNT || GETTIME() - this->batchStartTime >= CLOUDWATCH_METRICS_FLUSH_PERIOD;
+    }
+
+    if (full) {
+        this->flush();
+    }
+}
+
+VOID CloudwatchMetricsSink::run()
+{
+    std::unique_lock<std::mutex> lock(this->mutex);
+    UINT64 now, wait;
+
+    while (!this->stopping) {
+        now = GETTIME();
+        if (!this->batch.empty() && now - this->batchStartTime >= CLOUDWATCH_METRICS_FLUSH_PERIOD) {
+            lock.unlock();
+            this->flush();
+            lock.lock();
+            continue;
+        }
+
+        // A batch started after this point is looked at one period later at the latest
+        wait = this->batch.empty() ? CLOUDWATCH_METRICS_FLUSH_PERIOD : this->batchStartTime + CLOUDWATCH_METRICS_FLUSH_PERIOD - now;
+        this->wake.wait_for(lock, std::chrono::milliseconds(MAX(wait / HUNDREDS_OF_NANOS_IN_A_MILLISECOND, 1)));
+    }
+}
+
+VOID CloudwatchMetricsSink::flush()
+{
+    Aws::CloudWatch::Model::PutMetricDataRequest cwRequest;
+    Aws::Vector<MetricDatum> pending;
+
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        pending.swap(this->batch);
+    }
+
+    if (pending.empty()) {
+        return;
+    }
+
+    cwRequest.SetNamespace(DEFAULT_CLOUDWATCH_NAMESPACE);
+    cwRequest.SetMetricData(pending);
+
+    auto asyncHandler = [this](const Aws::CloudWatch::CloudWatchClient* cwClient, const Aws::CloudWatch::Model::PutMetricDataRequest& request,
+                               const Aws::CloudWatch::Model::PutMetricDataOutcome& outcome,
+                               const std::shared_ptr<const Aws::Client::AsyncCallerContext>& context) {
+        UNUSED_PARAM(cwClient);
+        UNUSED_PARAM(context);
+
+        if (!outcome.IsSuccess()) {
+            DLOGE("Failed to put %u metric datums: %s", (UINT32) request.GetMetricData().size(), outcome.GetError().GetMessage().c_str());
+        } else {
+            DLOGS("Successfully put %u metric datums", (UINT32) request.GetMetricData().size());
+        }
+        this->pendingMetrics--;
+    };
+    this->pendingMetrics++;
+    this->client.PutMetricDataAsync(cwRequest, asyncHandler);
+}
+
+EmfFileMetricsSink::EmfFileMetricsSink(const string& prefix)
+{
+    this->file.setPrefix(prefix);
+}
+
+VOID EmfFileMetricsSink::deinit()
+{
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->file.close();
+}
+
+VOID EmfFileMetricsSink::put(const MetricDatum& datum)
+{
+    Aws::Utils::Json::JsonValue root, metadata, directive, metric;
+    auto& dimensions = datum.GetDimensions();
+    auto& values = datum.GetValues();
+    Aws::Utils::Array<Aws::Utils::Json::JsonValue> directives(1), metrics(1), dimensionSets(1), dimensionNames(dimensions.size());
+
+    for (size_t i = 0; i < dimensions.size(); i++) {
+        dimensionNames[i].AsString(dimensions[i].GetName());
+        root.WithString(dimensions[i].GetName(), dimensions[i].GetValue());
+    }
+    dimensionSets[0].AsArray(std::move(dimensionNames));
+
+    metric.WithString("Name", datum.GetMetricName());
+    metric.WithString("Unit", StandardUnitMapper::GetNameForStandardUnit(datum.GetUnit()));
+    metrics[0] = metric;
+
+    directive.WithString("Namespace", DEFAULT_CLOUDWATCH_NAMESPACE);
+    directive.WithArray("Dimensions", std::move(dimensionSets));
+    directive.WithArray("Metrics", std::move(metrics));
+    directives[0] = directive;
+
+    metadata.WithInt64("Timestamp", GETTIME() / HUNDREDS_OF_NANOS_IN_A_MILLISECOND);
+    metadata.WithArray("CloudWatchMetrics", std::move(directives));
+    root.WithObject("_aws", metadata);
+
+    // If the datum uses single value, GetValues will be empty and the data will be accessible
+    // from GetValue
+    if (values.empty()) {
+        root.WithDouble(datum.GetMetricName(), datum.GetValue());
+    } else {
+        Aws::Utils::Array<Aws::Utils::Json::JsonValue> samples(values.size());
+        for (size_t i = 0; i < values.size(); i++) {
+            samples[i].AsDouble(values[i]);
+        }
+        root.WithArray(datum.GetMetricName(), std::move(samples));
+    }
+
+    auto line = root.View().WriteCompact() + "\n";
+
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->file.write(string(line.c_str(), line.size()));
+}
+
+VOID MemoryMetricsSink::put(const MetricDatum& datum)
+{
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->data.push_back(datum);
+}
+
+Aws::Vector<MetricDatum> MemoryMetricsSink::getData()
+{
+    std::lock_guard<std::mutex> lock(this->mutex);
+    return this->data;
+}
+
+VOID MemoryMetricsSink::clear()
+{
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->data.clear();
+}
+
+} // namespace Canary
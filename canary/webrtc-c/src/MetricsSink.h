@@ -0,0 +1,65 @@
+#pragma once
+
+namespace Canary {
+
+/*
+ * Destination for canary metrics. CloudwatchMonitoring builds the datums (including dimensions) and hands them
+ * over to the sink selected through CANARY_METRICS_SINK.
+ */
+class MetricsSink {
+  public:
+    virtual ~MetricsSink() = default;
+    virtual STATUS init();
+    virtual VOID deinit();
+    virtual VOID put(const MetricDatum&) = 0;
+};
+typedef MetricsSink* PMetricsSink;
+
+// Batches datums into PutMetricData calls, flushed when full or when the oldest datum gets too old
+class CloudwatchMetricsSink : public MetricsSink {
+  public:
+    CloudwatchMetricsSink(ClientConfiguration*);
+    STATUS init() override;
+    VOID deinit() override;
+    VOID put(const MetricDatum&) override;
+    VOID flush();
+
+  private:
+    VOID run();
+
+    CloudWatchClient client;
+    std::mutex mutex;
+    Aws::Vector<MetricDatum> batch;
+    UINT64 batchStartTime = 0;
+    std::atomic<UINT64> pendingMetrics{0};
+    // Flushes an old batch when no more datums come in to do it
+    std::condition_variable wake;
+    std::thread flusher;
+    BOOL stopping = FALSE;
+};
+
+// Writes every datum as one CloudWatch embedded metric format (EMF) JSON line into a rotating local file
+class EmfFileMetricsSink : public MetricsSink {
+  public:
+    EmfFileMetricsSink(const string&);
+    VOID deinit() override;
+    VOID put(const MetricDatum&) override;
+
+  private:
+    std::mutex mutex;
+    RotatingFile file{(PCHAR) CANARY_METRICS_FILE_PATH_FORMAT, CANARY_METRICS_FILE_MAX_SIZE, MAX_NUMBER_OF_METRICS_FILES};
+};
+
+// Keeps every datum in memory, mostly useful for tests and local runs
+class MemoryMetricsSink : public MetricsSink {
+  public:
+    VOID put(const MetricDatum&) override;
+    Aws::Vector<MetricDatum> getData();
+    VOID clear();
+
+  private:
+    std::mutex mutex;
+    Aws::Vector<MetricDatum> data;
+};
+
+} // namespace Canary
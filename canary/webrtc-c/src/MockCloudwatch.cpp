@@ -0,0 +1,427 @@
+#include "Include.h"
+
+#include <libwebsockets.h>
+
+#include "MockServer.h"
+
+using Canary::MockServer;
+
+/*
+ * Local stand-in for Cloudwatch and Cloudwatch Logs. Point the canaries at it with CANARY_CLOUDWATCH_ENDPOINT
+ * to measure what publishing metrics and logs costs without the real services. Both APIs are served on one plain
+ * HTTP port: Cloudwatch Logs requests are told apart by their X-Amz-Target header, Cloudwatch requests use the
+ * query protocol. Every operation is accounted for with its request count, metric datums or log events per
+ * request, request bytes and the time from the request line to the response. Throttling, rejected sequence
+ * tokens, a per operation TPS limit and a fixed latency can be injected to exercise the publish backpressure.
+ *
+ * Everything runs on the libwebsockets service thread, so none of the state below needs locking.
+ */
+
+typedef struct {
+    UINT64 port;
+    UINT64 latency;
+    UINT64 throttlePercent;
+    UINT64 sequenceTokenErrorPercent;
+    UINT64 maxTps;
+    std::string reportPath;
+} MockConfig;
+
+typedef struct {
+    UINT64 requests;
+    UINT64 throttled;
+    UINT64 sequenceTokenErrors;
+    UINT64 otherErrors;
+    // Metric datums for PutMetricData, log events for PutLogEvents
+    UINT64 items;
+    UINT64 maxItems;
+    UINT64 bytes;
+    UINT64 totalLatency;
+    UINT64 maxLatency;
+} OperationStats;
+
+typedef struct {
+    UINT64 windowStart;
+    UINT64 count;
+} RateWindow;
+
+typedef struct {
+    UINT64 start;
+    std::string target;
+    std::string body;
+    std::string operation;
+    // The error is already counted as throttling or a sequence token error
+    BOOL counted;
+    UINT32 status;
+    std::string contentType;
+    std::string response;
+} HttpSession;
+
+static std::atomic<bool> gTerminated;
+static struct lws_context* gContext = NULL;
+static MockConfig gConfig;
+static std::map<std::string, OperationStats> gPeriodStats;
+static std::map<std::string, OperationStats> gTotalStats;
+static std::map<std::string, RateWindow> gRates;
+// Log group/stream to the sequence number of its last put, 0 before the first one
+static std::map<std::string, UINT64> gLogStreams;
+static UINT64 gRequestId = 0;
+
+VOID handleSignal(INT32 signal)
+{
+    UNUSED_PARAM(signal);
+    gTerminated = true;
+    lws_cancel_service(gContext);
+}
+
+static UINT64 countOccurrences(const std::string& haystack, PCHAR pNeedle)
+{
+    UINT64 count = 0;
+    SIZE_T pos = 0, length = STRLEN(pNeedle);
+
+    while ((pos = haystack.find(pNeedle, pos)) != std::string::npos) {
+        count++;
+        pos += length;
+    }
+
+    return count;
+}
+
+static std::string queryParameter(const std::string& body, PCHAR pKey)
+{
+    std::string key = std::string(pKey) + "=";
+    SIZE_T pos = body.compare(0, key.size(), key) == 0 ? 0 : body.find("&" + key);
+
+    if (pos == std::string::npos) {
+        return "";
+    }
+
+    pos = body.find('=', pos) + 1;
+    return body.substr(pos, body.find('&', pos) - pos);
+}
+
+static std::string sequenceToken(UINT64 sequence)
+{
+    return sequence == 0 ? "" : std::to_string(sequence);
+}
+
+static BOOL throttle(const std::string& operation)
+{
+    UINT64 now = GETTIME();
+    auto& rate = gRates[operation];
+
+    if (now >= rate.windowStart + HUNDREDS_OF_NANOS_IN_A_SECOND) {
+        rate.windowStart = now;
+        rate.count = 0;
+    }
+
+    return (gConfig.maxTps != 0 && ++rate.count > gConfig.maxTps) || MockServer::roll(gConfig.throttlePercent);
+}
+
+static VOID recordItems(HttpSession* pSession, UINT64 items)
+{
+    for (auto pStats : {&gPeriodStats[pSession->operation], &gTotalStats[pSession->operation]}) {
+        pStats->items += items;
+        pStats->maxItems = MAX(pStats->maxItems, items);
+    }
+}
+
+static VOID setLogsError(HttpSession* pSession, PCHAR pType, const std::string& message, const std::string& extra = "")
+{
+    pSession->status = HTTP_STATUS_BAD_REQUEST;
+    pSession->response = "{\"__type\":\"" + std::string(pType) + "\"," + extra + "\"message\":\"" + message + "\"}";
+}
+
+static VOID handleLogsRequest(HttpSession* pSession)
+{
+    jsmn_parser parser;
+    std::vector<jsmntok_t> tokens;
+    std::string group, stream, token, key;
+    UINT64 events = 0;
+    INT32 i, count, end;
+    BOOL injected;
+
+    pSession->contentType = "application/x-amz-json-1.1";
+    pSession->response = "{}";
+
+    jsmn_init(&parser);
+    count = jsmn_parse(&parser, pSession->body.c_str(), pSession->body.size(), NULL, 0);
+    tokens.resize(MAX(count, 1));
+    jsmn_init(&parser);
+    count = jsmn_parse(&parser, pSession->body.c_str(), pSession->body.size(), tokens.data(), tokens.size());
+
+    // Only the top level keys matter, so skip over nested values by their end offset
+    for (i = 1; i + 1 < count; i++) {
+        auto value = pSession->body.substr(tokens[i + 1].start, tokens[i + 1].end - tokens[i + 1].start);
+        if (compareJsonString((PCHAR) pSession->body.c_str(), &tokens[i], JSMN_STRING, (PCHAR) "logGroupName")) {
+            group = value;
+        } else if (compareJsonString((PCHAR) pSession->body.c_str(), &tokens[i], JSMN_STRING, (PCHAR) "logStreamName")) {
+            stream = value;
+        } else if (compareJsonString((PCHAR) pSession->body.c_str(), &tokens[i], JSMN_STRING, (PCHAR) "sequenceToken")) {
+            token = value;
+        } else if (compareJsonString((PCHAR) pSession->body.c_str(), &tokens[i], JSMN_STRING, (PCHAR) "logEvents")) {
+            events = tokens[i + 1].size;
+        }
+        for (end = tokens[++i].end; i + 1 < count && tokens[i + 1].start < end; i++) {
+        }
+    }
+
+    key = group + "/" + stream;
+    auto it = gLogStreams.find(key);
+
+    if (throttle(pSession->operation)) {
+        pSession->counted = TRUE;
+        gPeriodStats[pSession->operation].throttled++;
+        gTotalStats[pSession->operation].throttled++;
+        setLogsError(pSession, (PCHAR) "ThrottlingException", "Rate exceeded");
+    } else if (pSession->operation == "CreateLogGroup") {
+        // Groups are implied by their streams and the canaries ignore the outcome of this call
+    } else if (pSession->operation == "CreateLogStream") {
+        if (it != gLogStreams.end()) {
+            setLogsError(pSession, (PCHAR) "ResourceAlreadyExistsException", "The specified log stream already exists");
+        } else {
+            gLogStreams[key] = 0;
+        }
+    } else if (pSession->operation == "PutLogEvents") {
+        if (it == gLogStreams.end()) {
+            setLogsError(pSession, (PCHAR) "ResourceNotFoundException", "The specified log stream does not exist.");
+        } else {
+            // An injected error looks like another writer having put to the same stream
+            if ((injected = MockServer::roll(gConfig.sequenceTokenErrorPercent))) {
+                it->second++;
+            }
+
+            if (injected || token != sequenceToken(it->second)) {
+                pSession->counted = TRUE;
+                gPeriodStats[pSession->operation].sequenceTokenErrors++;
+                gTotalStats[pSession->operation].sequenceTokenErrors++;
+                // Same message as the service, the canaries pick the expected token up from it
+                setLogsError(pSession, (PCHAR) "InvalidSequenceTokenException",
+                             "The given sequenceToken is invalid. The next expected sequenceToken is: " + sequenceToken(it->second),
+                             "\"expectedSequenceToken\":\"" + sequenceToken(it->second) + "\",");
+            } else {
+                it->second++;
+                recordItems(pSession, events);
+                pSession->response = "{\"nextSequenceToken\":\"" + sequenceToken(it->second) + "\"}";
+            }
+        }
+    } else {
+        setLogsError(pSession, (PCHAR) "UnknownOperationException", "Operation " + pSession->operation + " is not mocked");
+    }
+}
+
+static VOID handleMonitoringRequest(HttpSession* pSession)
+{
+    std::string requestId = std::to_string(++gRequestId);
+
+    pSession->contentType = "text/xml";
+
+    if (pSession->operation != "PutMetricData") {
+        pSession->status = HTTP_STATUS_BAD_REQUEST;
+        pSession->response = "<ErrorResponse><Error><Type>Sender</Type><Code>InvalidAction</Code><Message>Action " + pSession->operation +
+            " is not mocked</Message></Error><RequestId>" + requestId + "</RequestId></ErrorResponse>";
+    } else if (throttle(pSession->operation)) {
+        pSession->counted = TRUE;
+        gPeriodStats[pSession->operation].throttled++;
+        gTotalStats[pSession->operation].throttled++;
+        pSession->status = HTTP_STATUS_BAD_REQUEST;
+        pSession->response = "<ErrorResponse xmlns=\"http://monitoring.amazonaws.com/doc/2010-08-01/\"><Error><Type>Sender</Type>"
+                             "<Code>Throttling</Code><Message>Rate exceeded</Message></Error><RequestId>" +
+            requestId + "</RequestId></ErrorResponse>";
+    } else {
+        recordItems(pSession, countOccurrences(pSession->body, (PCHAR) ".MetricName="));
+        pSession->response = "<PutMetricDataResponse xmlns=\"http://monitoring.amazonaws.com/doc/2010-08-01/\"><ResponseMetadata><RequestId>" +
+            requestId + "</RequestId></ResponseMetadata></PutMetricDataResponse>";
+    }
+}
+
+static VOID handleHttpRequest(HttpSession* pSession)
+{
+    pSession->status = HTTP_STATUS_OK;
+
+    if (pSession->target.compare(0, STRLEN(MOCK_CLOUDWATCH_LOGS_TARGET_PREFIX), MOCK_CLOUDWATCH_LOGS_TARGET_PREFIX) == 0) {
+        pSession->operation = pSession->target.substr(STRLEN(MOCK_CLOUDWATCH_LOGS_TARGET_PREFIX));
+    } else {
+        pSession->operation = queryParameter(pSession->body, (PCHAR) "Action");
+    }
+
+    gPeriodStats[pSession->operation].requests++;
+    gTotalStats[pSession->operation].requests++;
+    gPeriodStats[pSession->operation].bytes += pSession->body.size();
+    gTotalStats[pSession->operation].bytes += pSession->body.size();
+
+    if (!pSession->target.empty()) {
+        handleLogsRequest(pSession);
+    } else {
+        handleMonitoringRequest(pSession);
+    }
+
+    if (pSession->status != HTTP_STATUS_OK && !pSession->counted) {
+        gPeriodStats[pSession->operation].otherErrors++;
+        gTotalStats[pSession->operation].otherErrors++;
+    }
+
+    DLOGD("%s (%u bytes) -> %u", pSession->operation.c_str(), (UINT32) pSession->body.size(), pSession->status);
+}
+
+static INT32 writeResponse(struct lws* wsi, HttpSession* pSession)
+{
+    UINT64 latency = GETTIME() - pSession->start;
+
+    for (auto pStats : {&gPeriodStats[pSession->operation], &gTotalStats[pSession->operation]}) {
+        pStats->totalLatency += latency;
+        pStats->maxLatency = MAX(pStats->maxLatency, latency);
+    }
+
+    return MockServer::writeHttpResponse(wsi, pSession->status, (PCHAR) pSession->contentType.c_str(), pSession->response);
+}
+
+static INT32 httpCallback(struct lws* wsi, enum lws_callback_reasons reason, PVOID user, PVOID in, size_t len)
+{
+    HttpSession** ppSession = (HttpSession**) user;
+    CHAR target[MAX_URI_CHAR_LEN + 1];
+    INT32 targetLength;
+
+    switch (reason) {
+        case LWS_CALLBACK_HTTP:
+            *ppSession = new HttpSession();
+            (*ppSession)->start = GETTIME();
+            if ((targetLength = lws_hdr_custom_copy(wsi, target, SIZEOF(target), "x-amz-target:", STRLEN("x-amz-target:"))) > 0) {
+                (*ppSession)->target.assign(target, targetLength);
+            }
+            return 0;
+
+        case LWS_CALLBACK_HTTP_BODY:
+            (*ppSession)->body.append((PCHAR) in, len);
+            return 0;
+
+        case LWS_CALLBACK_HTTP_BODY_COMPLETION:
+            handleHttpRequest(*ppSession);
+            if (gConfig.latency != 0) {
+                lws_set_timer_usecs(wsi, gConfig.latency * 1000);
+            } else {
+                lws_callback_on_writable(wsi);
+            }
+            return 0;
+
+        case LWS_CALLBACK_TIMER:
+            lws_callback_on_writable(wsi);
+            return 0;
+
+        case LWS_CALLBACK_HTTP_WRITEABLE:
+            return *ppSession != NULL ? writeResponse(wsi, *ppSession) : 0;
+
+        case LWS_CALLBACK_CLOSED_HTTP:
+            delete *ppSession;
+            *ppSession = NULL;
+            return 0;
+
+        default:
+            return lws_callback_http_dummy(wsi, reason, user, in, len);
+    }
+}
+
+static VOID printStats(const std::map<std::string, OperationStats>& stats, UINT64 duration, PCHAR pLabel)
+{
+    DOUBLE seconds = MAX((DOUBLE) duration / HUNDREDS_OF_NANOS_IN_A_SECOND, 1.0);
+
+    for (auto& entry : stats) {
+        auto& operation = entry.second;
+        DLOGI("Mock cloudwatch %s %s: %lu requests (%.1lf/s), %lu throttled, %lu sequence token errors, %lu other errors, %lu items "
+              "(%.1lf/request, max %lu), %lu bytes (%.1lf/request), latency avg %.2lf ms max %.2lf ms",
+              pLabel, entry.first.c_str(), operation.requests, operation.requests / seconds, operation.throttled, operation.sequenceTokenErrors,
+              operation.otherErrors, operation.items, (DOUBLE) operation.items / MAX(operation.requests, 1), operation.maxItems, operation.bytes,
+              (DOUBLE) operation.bytes / MAX(operation.requests, 1),
+              (DOUBLE) operation.totalLatency / MAX(operation.requests, 1) / HUNDREDS_OF_NANOS_IN_A_MILLISECOND,
+              (DOUBLE) operation.maxLatency / HUNDREDS_OF_NANOS_IN_A_MILLISECOND);
+    }
+}
+
+static STATUS writeReport(UINT64 duration)
+{
+    STATUS retStatus = STATUS_SUCCESS;
+    std::string report = "{\"durationSeconds\":" + std::to_string(duration / HUNDREDS_OF_NANOS_IN_A_SECOND) + ",\"operations\":{";
+    BOOL first = TRUE;
+
+    for (auto& entry : gTotalStats) {
+        auto& operation = entry.second;
+        report += (first ? "\"" : ",\"") + entry.first + "\":{\"requests\":" + std::to_string(operation.requests) +
+            ",\"throttled\":" + std::to_string(operation.throttled) + ",\"sequenceTokenErrors\":" + std::to_string(operation.sequenceTokenErrors) +
+            ",\"otherErrors\":" + std::to_string(operation.otherErrors) + ",\"items\":" + std::to_string(operation.items) +
+            ",\"maxItems\":" + std::to_string(operation.maxItems) + ",\"bytes\":" + std::to_string(operation.bytes) +
+            ",\"totalLatencyMs\":" + std::to_string(operation.totalLatency / HUNDREDS_OF_NANOS_IN_A_MILLISECOND) +
+            ",\"maxLatencyMs\":" + std::to_string(operation.maxLatency / HUNDREDS_OF_NANOS_IN_A_MILLISECOND) + "}";
+        first = FALSE;
+    }
+    report += "}}\n";
+
+    CHK_STATUS(writeFile((PCHAR) gConfig.reportPath.c_str(), FALSE, FALSE, (PBYTE) report.c_str(), report.size()));
+
+CleanUp:
+
+    CHK_LOG_ERR(retStatus);
+    return retStatus;
+}
+
+INT32 main(INT32 argc, CHAR* argv[])
+{
+    UNUSED_PARAM(argc);
+    UNUSED_PARAM(argv);
+
+    STATUS retStatus = STATUS_SUCCESS;
+    struct lws_protocols protocols[2];
+    struct lws_context_creation_info info;
+    UINT64 startTime, lastStatsTime;
+
+#ifndef _WIN32
+    signal(SIGINT, handleSignal);
+#endif
+
+    SET_LOGGER_LOG_LEVEL(MockServer::envUint64((PCHAR) DEBUG_LOG_LEVEL_ENV_VAR, LOG_LEVEL_INFO));
+
+    gConfig.port = MockServer::envUint64((PCHAR) MOCK_CLOUDWATCH_PORT_ENV_VAR, MOCK_CLOUDWATCH_DEFAULT_PORT);
+    gConfig.latency = MockServer::envUint64((PCHAR) MOCK_CLOUDWATCH_LATENCY_ENV_VAR, 0);
+    gConfig.throttlePercent = MockServer::envUint64((PCHAR) MOCK_CLOUDWATCH_THROTTLE_ENV_VAR, 0);
+    gConfig.sequenceTokenErrorPercent = MockServer::envUint64((PCHAR) MOCK_CLOUDWATCH_SEQUENCE_TOKEN_ERROR_ENV_VAR, 0);
+    gConfig.maxTps = MockServer::envUint64((PCHAR) MOCK_CLOUDWATCH_MAX_TPS_ENV_VAR, 0);
+    gConfig.reportPath = MockServer::envString((PCHAR) MOCK_CLOUDWATCH_REPORT_ENV_VAR, (PCHAR) "");
+
+    MEMSET(protocols, 0x00, SIZEOF(protocols));
+    protocols[0].name = "http";
+    protocols[0].callback = httpCallback;
+    protocols[0].per_session_data_size = SIZEOF(HttpSession*);
+
+    MEMSET(&info, 0x00, SIZEOF(info));
+    info.port = (INT32) gConfig.port;
+    info.protocols = protocols;
+    info.gid = -1;
+    info.uid = -1;
+
+    lws_set_log_level(LLL_ERR | LLL_WARN, NULL);
+    CHK_ERR((gContext = lws_create_context(&info)) != NULL, STATUS_INTERNAL_ERROR, "Failed to start the mock cloudwatch server on port %lu",
+            gConfig.port);
+
+    DLOGI("Mock cloudwatch listening on http://localhost:%lu with %lu ms latency, %lu%% throttled, %lu%% sequence token errors, %lu max TPS",
+          gConfig.port, gConfig.latency, gConfig.throttlePercent, gConfig.sequenceTokenErrorPercent, gConfig.maxTps);
+
+    startTime = lastStatsTime = GETTIME();
+    while (!gTerminated && lws_service(gContext, 0) >= 0) {
+        if (GETTIME() >= lastStatsTime + MOCK_CLOUDWATCH_STATS_PERIOD) {
+            printStats(gPeriodStats, GETTIME() - lastStatsTime, (PCHAR) "period");
+            gPeriodStats.clear();
+            lastStatsTime = GETTIME();
+        }
+    }
+
+    printStats(gTotalStats, GETTIME() - startTime, (PCHAR) "total");
+    if (!gConfig.reportPath.empty()) {
+        writeReport(GETTIME() - startTime);
+    }
+
+CleanUp:
+
+    if (gContext != NULL) {
+        lws_context_destroy(gContext);
+    }
+
+    return STATUS_FAILED(retStatus) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
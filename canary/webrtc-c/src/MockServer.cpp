@@ -0,0 +1,60 @@
+#include "Include.h"
+
+#include <libwebsockets.h>
+
+#include "MockServer.h"
+
+namespace Canary {
+
+std::mt19937 MockServer::generator(std::random_device{}());
+
+std::string MockServer::envString(PCHAR pKey, PCHAR pDefault)
+{
+    PCHAR pValue = getenv(pKey);
+    return pValue != NULL ? pValue : pDefault;
+}
+
+UINT64 MockServer::envUint64(PCHAR pKey, UINT64 defaultValue)
+{
+    UINT64 value = defaultValue;
+    PCHAR pValue = getenv(pKey);
+
+    if (pValue != NULL && STATUS_FAILED(STRTOUI64(pValue, NULL, 10, &value))) {
+        DLOGW("Ignoring invalid value '%s' for %s", pValue, pKey);
+        value = defaultValue;
+    }
+
+    return value;
+}
+
+// Uniform in [0, max]
+UINT64 MockServer::random(UINT64 max)
+{
+    return std::uniform_int_distribution<UINT64>(0, max)(generator);
+}
+
+BOOL MockServer::roll(UINT64 percent)
+{
+    return percent != 0 && random(99) < percent;
+}
+
+INT32 MockServer::writeHttpResponse(struct lws* wsi, UINT32 status, PCHAR pContentType, const std::string& response)
+{
+    std::vector<BYTE> buffer(LWS_PRE + MOCK_SERVER_MAX_HEADER_SIZE);
+    PBYTE pStart = &buffer[LWS_PRE], pCur = pStart, pEnd = &buffer[buffer.size() - 1];
+    std::vector<BYTE> body(LWS_PRE + response.size());
+
+    if (lws_add_http_common_headers(wsi, status, pContentType, response.size(), &pCur, pEnd) != 0 ||
+        lws_finalize_write_http_header(wsi, pStart, &pCur, pEnd) != 0) {
+        return -1;
+    }
+
+    MEMCPY(&body[LWS_PRE], response.c_str(), response.size());
+    if (lws_write(wsi, &body[LWS_PRE], response.size(), LWS_WRITE_HTTP_FINAL) < 0) {
+        return -1;
+    }
+
+    return lws_http_transaction_completed(wsi) ? -1 : 0;
+}
+
+} // namespace Canary
@@ -0,0 +1,20 @@
+#pragma once
+
+namespace Canary {
+
+/*
+ * Helpers shared by the local stand-in servers. Only the mock executables include this, after libwebsockets.h.
+ */
+class MockServer {
+  public:
+    static std::string envString(PCHAR, PCHAR);
+    static UINT64 envUint64(PCHAR, UINT64);
+    static UINT64 random(UINT64);
+    static BOOL roll(UINT64);
+    static INT32 writeHttpResponse(struct lws*, UINT32, PCHAR, const std::string&);
+
+  private:
+    static std::mt19937 generator;
+};
+
+} // namespace Canary
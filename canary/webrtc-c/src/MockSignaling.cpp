@@ -0,0 +1,506 @@
+#include "Include.h"
+
+#include <libwebsockets.h>
+
+#include <deque>
+
+#include "MockServer.h"
+
+using Canary::MockServer;
+
+/*
+ * Local stand-in for the KVS signaling service. It serves the control plane calls the signaling client makes
+ * (describe/create/delete channel, get endpoint, get ICE server config) and relays offers, answers and ICE
+ * candidates between the master and viewers of a channel over a WebSocket, all on one TLS port. Requests are
+ * not authenticated. Latency, jitter, HTTP errors, rejected connections and dropped messages can be injected.
+ *
+ * Everything runs on the libwebsockets service thread, so none of the state below needs locking.
+ */
+
+typedef struct {
+    UINT64 port;
+    std::string host;
+    std::string certPath;
+    std::string keyPath;
+    std::string turnUri;
+    UINT64 latency;
+    UINT64 jitter;
+    UINT64 httpErrorPercent;
+    UINT64 connectErrorPercent;
+    UINT64 dropPercent;
+} MockConfig;
+
+typedef struct {
+    UINT64 httpRequests;
+    UINT64 httpErrors;
+    UINT64 connections;
+    UINT64 rejectedConnections;
+    UINT64 relayed;
+    UINT64 dropped;
+    UINT64 undeliverable;
+} MockStats;
+
+typedef struct {
+    UINT64 due;
+    std::string message;
+} PendingMessage;
+
+typedef struct {
+    std::string arn;
+    struct lws* master;
+    std::map<std::string, struct lws*> viewers;
+} MockChannel;
+
+typedef struct {
+    std::string path;
+    std::string body;
+    UINT32 status;
+    std::string response;
+} HttpSession;
+
+typedef struct {
+    std::string channelName;
+    std::string clientId;
+    BOOL isMaster;
+    std::string rx;
+    std::deque<PendingMessage> pending;
+} WssSession;
+
+static std::atomic<bool> gTerminated;
+static struct lws_context* gContext = NULL;
+static MockConfig gConfig;
+static MockStats gStats;
+static std::map<std::string, MockChannel> gChannels;
+
+VOID handleSignal(INT32 signal)
+{
+    UNUSED_PARAM(signal);
+    gTerminated = true;
+    lws_cancel_service(gContext);
+}
+
+// Injected delay in microseconds, the unit lws timers take
+static UINT64 injectedDelay()
+{
+    UINT64 delay = gConfig.latency;
+
+    if (gConfig.jitter != 0) {
+        delay += MockServer::random(gConfig.jitter);
+    }
+
+    return delay * 1000;
+}
+
+static std::string urlDecode(const std::string& value)
+{
+    std::string decoded;
+    UINT32 i, hex;
+
+    for (i = 0; i < value.size(); i++) {
+        if (value[i] == '%' && i + 2 < value.size() && sscanf(value.c_str() + i + 1, "%2x", &hex) == 1) {
+            decoded += (CHAR) hex;
+            i += 2;
+        } else {
+            decoded += value[i];
+        }
+    }
+
+    return decoded;
+}
+
+static std::string getJsonField(const std::string& json, PCHAR pKey)
+{
+    jsmn_parser parser;
+    jsmntok_t tokens[MOCK_SIGNALING_MAX_JSON_TOKENS];
+    INT32 i, count;
+
+    jsmn_init(&parser);
+    count = jsmn_parse(&parser, json.c_str(), json.size(), tokens, MOCK_SIGNALING_MAX_JSON_TOKENS);
+
+    for (i = 1; i + 1 < count; i++) {
+        if (compareJsonString((PCHAR) json.c_str(), &tokens[i], JSMN_STRING, pKey)) {
+            return json.substr(tokens[i + 1].start, tokens[i + 1].end - tokens[i + 1].start);
+        }
+    }
+
+    return "";
+}
+
+static std::string channelArn(const std::string& name)
+{
+    return MOCK_SIGNALING_ARN_PREFIX + name + "/0";
+}
+
+static std::string channelNameFromArn(const std::string& arn)
+{
+    std::string name = arn.substr(arn.find('/') + 1);
+    return name.substr(0, name.find('/'));
+}
+
+static MockChannel* findChannel(const std::string& body)
+{
+    std::string name = getJsonField(body, (PCHAR) "ChannelName"), arn;
+
+    if (name.empty()) {
+        arn = getJsonField(body, (PCHAR) "ChannelARN");
+        for (auto& channel : gChannels) {
+            if (channel.second.arn == arn) {
+                return &channel.second;
+            }
+        }
+        return NULL;
+    }
+
+    auto it = gChannels.find(name);
+    return it == gChannels.end() ? NULL : &it->second;
+}
+
+static VOID handleHttpRequest(HttpSession* pSession)
+{
+    std::string name, base = gConfig.host + ":" + std::to_string(gConfig.port);
+    MockChannel* pChannel = findChannel(pSession->body);
+
+    gStats.httpRequests++;
+    pSession->status = HTTP_STATUS_OK;
+
+    if (MockServer::roll(gConfig.httpErrorPercent)) {
+        gStats.httpErrors++;
+        pSession->status = HTTP_STATUS_INTERNAL_SERVER_ERROR;
+        pSession->response = "{\"__type\":\"InternalFailure\",\"Message\":\"Injected failure\"}";
+    } else if (pSession->path == "/createSignalingChannel") {
+        name = getJsonField(pSession->body, (PCHAR) "ChannelName");
+        if (pChannel == NULL) {
+            gChannels[name].arn = channelArn(name);
+        }
+        pSession->response = "{\"ChannelARN\":\"" + channelArn(name) + "\"}";
+    } else if (pChannel == NULL && pSession->path != "/v1/get-ice-server-config") {
+        // Lets the signaling client fall through to creating the channel
+        pSession->status = HTTP_STATUS_NOT_FOUND;
+        pSession->response = "{\"__type\":\"ResourceNotFoundException\",\"Message\":\"The requested channel is not found\"}";
+    } else if (pSession->path == "/describeSignalingChannel") {
+        name = channelNameFromArn(pChannel->arn);
+        pSession->response = "{\"ChannelInfo\":{\"ChannelARN\":\"" + pChannel->arn + "\",\"ChannelName\":\"" + name +
+            "\",\"ChannelStatus\":\"ACTIVE\",\"ChannelType\":\"SINGLE_MASTER\",\"CreationTime\":0,"
+            "\"SingleMasterConfiguration\":{\"MessageTtlSeconds\":60},\"Version\":\"1\"}}";
+    } else if (pSession->path == "/getSignalingChannelEndpoint") {
+        pSession->response = "{\"ResourceEndpointList\":[{\"Protocol\":\"HTTPS\",\"ResourceEndpoint\":\"https://" + base +
+            "\"},{\"Protocol\":\"WSS\",\"ResourceEndpoint\":\"wss://" + base + "\"}]}";
+    } else if (pSession->path == "/v1/get-ice-server-config") {
+        pSession->response = gConfig.turnUri.empty()
+            ? "{\"IceServerList\":[]}"
+            : "{\"IceServerList\":[{\"Password\":\"mock\",\"Ttl\":300,\"Uris\":[\"" + gConfig.turnUri + "\"],\"Username\":\"mock\"}]}";
+    } else if (pSession->path == "/deleteSignalingChannel") {
+        gChannels.erase(channelNameFromArn(pChannel->arn));
+        pSession->response = "{}";
+    } else {
+        pSession->status = HTTP_STATUS_BAD_REQUEST;
+        pSession->response = "{\"__type\":\"UnknownOperationException\"}";
+    }
+
+    DLOGD("%s -> %u", pSession->path.c_str(), pSession->status);
+}
+
+static INT32 httpCallback(struct lws* wsi, enum lws_callback_reasons reason, PVOID user, PVOID in, size_t len)
+{
+    HttpSession** ppSession = (HttpSession**) user;
+
+    switch (reason) {
+        case LWS_CALLBACK_HTTP:
+            *ppSession = new HttpSession();
+            (*ppSession)->path = (PCHAR) in;
+            // Everything the signaling client sends is a POST, so wait for the body. Anything else is answered right away
+            if (lws_hdr_total_length(wsi, WSI_TOKEN_POST_URI) == 0) {
+                handleHttpRequest(*ppSession);
+                lws_callback_on_writable(wsi);
+            }
+            return 0;
+
+        case LWS_CALLBACK_HTTP_BODY:
+            (*ppSession)->body.append((PCHAR) in, len);
+            return 0;
+
+        case LWS_CALLBACK_HTTP_BODY_COMPLETION:
+            handleHttpRequest(*ppSession);
+            if (gConfig.latency != 0 || gConfig.jitter != 0) {
+                lws_set_timer_usecs(wsi, injectedDelay());
+            } else {
+                lws_callback_on_writable(wsi);
+            }
+            return 0;
+
+        case LWS_CALLBACK_TIMER:
+            lws_callback_on_writable(wsi);
+            return 0;
+
+        case LWS_CALLBACK_HTTP_WRITEABLE:
+            return *ppSession != NULL ? MockServer::writeHttpResponse(wsi, (*ppSession)->status, (PCHAR) "application/json", (*ppSession)->response)
+                                      : 0;
+
+        case LWS_CALLBACK_CLOSED_HTTP:
+            delete *ppSession;
+            *ppSession = NULL;
+            return 0;
+
+        default:
+            return lws_callback_http_dummy(wsi, reason, user, in, len);
+    }
+}
+
+static VOID scheduleWrite(struct lws* wsi, WssSession* pSession)
+{
+    UINT64 now = GETTIME();
+
+    if (pSession->pending.empty()) {
+        return;
+    }
+
+    if (pSession->pending.front().due <= now) {
+        lws_callback_on_writable(wsi);
+    } else {
+        lws_set_timer_usecs(wsi, (pSession->pending.front().due - now) / HUNDREDS_OF_NANOS_IN_A_MICROSECOND);
+    }
+}
+
+static VOID deliver(struct lws* wsi, const std::string& message)
+{
+    WssSession* pSession = *(WssSession**) lws_wsi_user(wsi);
+    UINT64 due = GETTIME() + injectedDelay() * HUNDREDS_OF_NANOS_IN_A_MICROSECOND;
+
+    // Jitter must not reorder messages on the same connection
+    if (!pSession->pending.empty()) {
+        due = MAX(due, pSession->pending.back().due);
+    }
+
+    pSession->pending.push_back({due, message});
+    scheduleWrite(wsi, pSession);
+}
+
+static VOID relay(struct lws* wsi, WssSession* pSession)
+{
+    std::string action = getJsonField(pSession->rx, (PCHAR) "action");
+    std::string recipient = getJsonField(pSession->rx, (PCHAR) "RecipientClientId");
+    std::string payload = getJsonField(pSession->rx, (PCHAR) "MessagePayload");
+    std::string correlationId = getJsonField(pSession->rx, (PCHAR) "CorrelationId");
+    struct lws* pRecipient = NULL;
+    auto it = gChannels.find(pSession->channelName);
+
+    if (it != gChannels.end()) {
+        if (pSession->isMaster) {
+            auto viewer = it->second.viewers.find(recipient);
+            pRecipient = viewer == it->second.viewers.end() ? NULL : viewer->second;
+        } else {
+            pRecipient = it->second.master;
+        }
+    }
+
+    if (pRecipient == NULL) {
+        gStats.undeliverable++;
+        // The service only reports delivery failures for messages that carry a correlation id
+        if (!correlationId.empty()) {
+            deliver(wsi,
+                    "{\"senderClientId\":\"\",\"messageType\":\"STATUS_RESPONSE\",\"messagePayload\":\"\",\"statusResponse\":{\"correlationId\":\"" +
+                        correlationId + "\",\"errorType\":\"InvalidArgumentException\",\"statusCode\":\"400\",\"description\":\"Recipient " +
+                        (pSession->isMaster ? recipient : std::string("master")) + " is not connected\"}}");
+        }
+    } else if (MockServer::roll(gConfig.dropPercent)) {
+        gStats.dropped++;
+    } else {
+        gStats.relayed++;
+        // Like the service, answers and candidates from the master reach the viewer without a sender id
+        deliver(pRecipient,
+                "{\"senderClientId\":\"" + (pSession->isMaster ? std::string("") : pSession->clientId) + "\",\"messageType\":\"" + action +
+                    "\",\"messagePayload\":\"" + payload + "\"}");
+    }
+}
+
+static INT32 writeWssMessages(struct lws* wsi, WssSession* pSession)
+{
+    std::vector<BYTE> buffer;
+    UINT64 now = GETTIME();
+
+    // One frame per writeable callback, lws asks again if more is due
+    if (!pSession->pending.empty() && pSession->pending.front().due <= now) {
+        auto& message = pSession->pending.front().message;
+        buffer.resize(LWS_PRE + message.size());
+        MEMCPY(&buffer[LWS_PRE], message.c_str(), message.size());
+        if (lws_write(wsi, &buffer[LWS_PRE], message.size(), LWS_WRITE_TEXT) < (INT32) message.size()) {
+            return -1;
+        }
+        pSession->pending.pop_front();
+    }
+
+    scheduleWrite(wsi, pSession);
+    return 0;
+}
+
+static VOID registerSession(struct lws* wsi, WssSession* pSession)
+{
+    CHAR buffer[MAX_ARN_LEN + 1];
+    std::string arn;
+    PCHAR pValue;
+
+    if ((pValue = (PCHAR) lws_get_urlarg_by_name(wsi, "X-Amz-ChannelARN=", buffer, SIZEOF(buffer))) != NULL) {
+        arn = urlDecode(pValue);
+    }
+
+    pSession->clientId = (pValue = (PCHAR) lws_get_urlarg_by_name(wsi, "X-Amz-ClientId=", buffer, SIZEOF(buffer))) != NULL ? urlDecode(pValue) : "";
+    pSession->isMaster = pSession->clientId.empty();
+
+    // Clients holding a cached ARN from an earlier run of the mock bring their channel back
+    if (arn.compare(0, STRLEN(MOCK_SIGNALING_ARN_PREFIX), MOCK_SIGNALING_ARN_PREFIX) == 0) {
+        pSession->channelName = channelNameFromArn(arn);
+        auto& channel = gChannels[pSession->channelName];
+        channel.arn = arn;
+        if (pSession->isMaster) {
+            channel.master = wsi;
+        } else {
+            channel.viewers[pSession->clientId] = wsi;
+        }
+    }
+
+    DLOGD("%s %s connected to %s", pSession->isMaster ? "Master" : "Viewer", pSession->clientId.c_str(), arn.c_str());
+}
+
+static VOID unregisterSession(struct lws* wsi, WssSession* pSession)
+{
+    auto it = gChannels.find(pSession->channelName);
+
+    if (it == gChannels.end()) {
+        return;
+    }
+
+    auto viewer = it->second.viewers.find(pSession->clientId);
+    if (pSession->isMaster && it->second.master == wsi) {
+        it->second.master = NULL;
+    } else if (!pSession->isMaster && viewer != it->second.viewers.end() && viewer->second == wsi) {
+        it->second.viewers.erase(viewer);
+    }
+}
+
+static INT32 wssCallback(struct lws* wsi, enum lws_callback_reasons reason, PVOID user, PVOID in, size_t len)
+{
+    WssSession** ppSession = (WssSession**) user;
+
+    switch (reason) {
+        case LWS_CALLBACK_FILTER_PROTOCOL_CONNECTION:
+            if (MockServer::roll(gConfig.connectErrorPercent)) {
+                gStats.rejectedConnections++;
+                return -1;
+            }
+            return 0;
+
+        case LWS_CALLBACK_ESTABLISHED:
+            gStats.connections++;
+            *ppSession = new WssSession();
+            registerSession(wsi, *ppSession);
+            return 0;
+
+        case LWS_CALLBACK_RECEIVE:
+            (*ppSession)->rx.append((PCHAR) in, len);
+            if (lws_is_final_fragment(wsi) && lws_remaining_packet_payload(wsi) == 0) {
+                relay(wsi, *ppSession);
+                (*ppSession)->rx.clear();
+            }
+            return 0;
+
+        case LWS_CALLBACK_TIMER:
+            lws_callback_on_writable(wsi);
+            return 0;
+
+        case LWS_CALLBACK_SERVER_WRITEABLE:
+            return writeWssMessages(wsi, *ppSession);
+
+        case LWS_CALLBACK_CLOSED:
+            if (*ppSession != NULL) {
+                unregisterSession(wsi, *ppSession);
+                delete *ppSession;
+                *ppSession = NULL;
+            }
+            return 0;
+
+        default:
+            return 0;
+    }
+}
+
+static VOID printStats()
+{
+    DLOGI("Mock signaling: %lu HTTP requests (%lu injected errors), %lu connections (%lu rejected), %lu messages relayed, %lu dropped, "
+          "%lu undeliverable",
+          gStats.httpRequests, gStats.httpErrors, gStats.connections, gStats.rejectedConnections, gStats.relayed, gStats.dropped,
+          gStats.undeliverable);
+}
+
+INT32 main(INT32 argc, CHAR* argv[])
+{
+    UNUSED_PARAM(argc);
+    UNUSED_PARAM(argv);
+
+    STATUS retStatus = STATUS_SUCCESS;
+    struct lws_protocols protocols[3];
+    struct lws_context_creation_info info;
+    UINT64 lastStatsTime;
+
+#ifndef _WIN32
+    signal(SIGINT, handleSignal);
+#endif
+
+    SET_LOGGER_LOG_LEVEL(MockServer::envUint64((PCHAR) DEBUG_LOG_LEVEL_ENV_VAR, LOG_LEVEL_INFO));
+
+    gConfig.port = MockServer::envUint64((PCHAR) MOCK_SIGNALING_PORT_ENV_VAR, MOCK_SIGNALING_DEFAULT_PORT);
+    gConfig.host = MockServer::envString((PCHAR) MOCK_SIGNALING_HOST_ENV_VAR, (PCHAR) MOCK_SIGNALING_DEFAULT_HOST);
+    gConfig.certPath = MockServer::envString((PCHAR) MOCK_SIGNALING_CERT_ENV_VAR, (PCHAR) MOCK_SIGNALING_DEFAULT_CERT);
+    gConfig.keyPath = MockServer::envString((PCHAR) MOCK_SIGNALING_KEY_ENV_VAR, (PCHAR) MOCK_SIGNALING_DEFAULT_KEY);
+    gConfig.turnUri = MockServer::envString((PCHAR) MOCK_SIGNALING_TURN_URI_ENV_VAR, (PCHAR) "");
+    gConfig.latency = MockServer::envUint64((PCHAR) MOCK_SIGNALING_LATENCY_ENV_VAR, 0);
+    gConfig.jitter = MockServer::envUint64((PCHAR) MOCK_SIGNALING_JITTER_ENV_VAR, 0);
+    gConfig.httpErrorPercent = MockServer::envUint64((PCHAR) MOCK_SIGNALING_HTTP_ERROR_ENV_VAR, 0);
+    gConfig.connectErrorPercent = MockServer::envUint64((PCHAR) MOCK_SIGNALING_CONNECT_ERROR_ENV_VAR, 0);
+    gConfig.dropPercent = MockServer::envUint64((PCHAR) MOCK_SIGNALING_DROP_ENV_VAR, 0);
+
+    MEMSET(protocols, 0x00, SIZEOF(protocols));
+    protocols[0].name = "http";
+    protocols[0].callback = httpCallback;
+    protocols[0].per_session_data_size = SIZEOF(HttpSession*);
+    // The signaling client asks for the "wss" subprotocol on its WebSocket
+    protocols[1].name = "wss";
+    protocols[1].callback = wssCallback;
+    protocols[1].per_session_data_size = SIZEOF(WssSession*);
+    protocols[1].rx_buffer_size = MOCK_SIGNALING_RX_BUFFER_SIZE;
+
+    MEMSET(&info, 0x00, SIZEOF(info));
+    info.port = (INT32) gConfig.port;
+    info.protocols = protocols;
+    info.gid = -1;
+    info.uid = -1;
+    info.options = LWS_SERVER_OPTION_DO_SSL_GLOBAL_INIT;
+    info.ssl_cert_filepath = gConfig.certPath.c_str();
+    info.ssl_private_key_filepath = gConfig.keyPath.c_str();
+
+    lws_set_log_level(LLL_ERR | LLL_WARN, NULL);
+    CHK_ERR((gContext = lws_create_context(&info)) != NULL, STATUS_INTERNAL_ERROR, "Failed to start the mock signaling server on port %lu",
+            gConfig.port);
+
+    DLOGI("Mock signaling listening on https://%s:%lu with %lu+%lu ms latency, %lu%% HTTP errors, %lu%% rejected connections, %lu%% dropped "
+          "messages",
+          gConfig.host.c_str(), gConfig.port, gConfig.latency, gConfig.jitter, gConfig.httpErrorPercent, gConfig.connectErrorPercent,
+          gConfig.dropPercent);
+
+    lastStatsTime = GETTIME();
+    while (!gTerminated && lws_service(gContext, 0) >= 0) {
+        if (GETTIME() >= lastStatsTime + MOCK_SIGNALING_STATS_PERIOD) {
+            printStats();
+            lastStatsTime = GETTIME();
+        }
+    }
+
+    printStats();
+
+CleanUp:
+
+    if (gContext != NULL) {
+        lws_context_destroy(gContext);
+    }
+
+    return STATUS_FAILED(retStatus) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
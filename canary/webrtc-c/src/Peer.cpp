@@ -4,7 +4,7 @@ namespace Canary {
 
 Peer::Peer()
     : pAwsCredentialProvider(nullptr), terminated(FALSE), iceGatheringDone(FALSE), receivedOffer(FALSE), receivedAnswer(FALSE), foundPeerId(FALSE),
-      pPeerConnection(nullptr), status(STATUS_SUCCESS)
+      pPeerConnection(nullptr), status(STATUS_SUCCESS), videoFramesGenerated(0), videoBytesGenerated(0)
 {
 }
 
@@ -23,21 +23,23 @@ Peer::~Peer()
 STATUS Peer::init(const Canary::PConfig pConfig, const Callbacks& callbacks)
 {
     STATUS retStatus = STATUS_SUCCESS;
+    LoadProfile profile;
 
+    this->timeline.start(pConfig);
     this->isMaster = pConfig->isMaster.value;
     this->trickleIce = pConfig->trickleIce.value;
     this->callbacks = callbacks;
-    this->canaryOutgoingRTPMetricsContext.prevTs = GETTIME();
-    this->canaryOutgoingRTPMetricsContext.prevFramesDiscardedOnSend = 0;
-    this->canaryOutgoingRTPMetricsContext.prevNackCount = 0;
-    this->canaryOutgoingRTPMetricsContext.prevRetxBytesSent = 0;
-    this->canaryOutgoingRTPMetricsContext.prevFramesSent = 0;
-    this->canaryIncomingRTPMetricsContext.prevPacketsReceived = 0;
-    this->canaryIncomingRTPMetricsContext.prevBytesReceived = 0;
-    this->canaryIncomingRTPMetricsContext.prevFramesDropped = 0;
-    this->canaryIncomingRTPMetricsContext.prevTs = GETTIME();
     this->firstFrame = TRUE;
+    this->lastRtpStatsTime = GETTIME();
+    this->lastEndToEndStatsTime = GETTIME();
     this->useIotCredentialProvider = pConfig->useIotCredentialProvider.value;
+    // The remote peer runs the same profile, a freeze is only a gap that is long even for its slowest segment
+    CHK_STATUS(profile.init(pConfig));
+    this->videoFrameTracker.init(HUNDREDS_OF_NANOS_IN_A_SECOND / profile.getMinFrameRate(), pConfig->freezeIntervals.value);
+    this->audioFrameTracker.init(SAMPLE_AUDIO_FRAME_DURATION, pConfig->freezeIntervals.value);
+    if (pConfig->dataChannelCount.value > 0) {
+        this->dataChannelBench.reset(new DataChannelBench(pConfig));
+    }
     if(this->useIotCredentialProvider) {
         CHK_STATUS(createLwsIotCredentialProvider((PCHAR) pConfig->iotEndpoint,
                                                   (PCHAR) pConfig->iotCoreCert.value.c_str(),
@@ -93,7 +95,7 @@ STATUS Peer::initSignaling(const Canary::PConfig pConfig)
     channelInfo.asyncIceServerConfig = TRUE;
     channelInfo.retry = TRUE;
     channelInfo.reconnect = TRUE;
-    channelInfo.pCertPath = (PCHAR) DEFAULT_KVS_CACERT_PATH;
+    channelInfo.pCertPath = (PCHAR) pConfig->caCertPath.value.c_str();
     channelInfo.messageTtl = 0; // Default is 60 seconds
 
     this->clientInfo.signalingClientCreationMaxRetryAttempts = MAX_CALL_RETRY_COUNT;
@@ -107,6 +109,9 @@ STATUS Peer::initSignaling(const Canary::PConfig pConfig)
         signalingClientGetStateString(state, &pStateStr);
         DLOGD("Signaling client state changed to %d - '%s'", state, pStateStr);
 
+        // ICE server info arrives as part of the signaling state machine, let anyone waiting for TURN servers check again
+        IceConfigCache::getInstance().notify();
+
         switch (state) {
             case SIGNALING_CLIENT_STATE_NEW:
                 pPeer->signalingStartTime = GETTIME();
@@ -149,6 +154,7 @@ STATUS Peer::initSignaling(const Canary::PConfig pConfig)
         PPeer pPeer = (PPeer) customData;
         std::lock_guard<std::recursive_mutex> lock(pPeer->mutex);
 
+        ResourceSampler::nameThread((PCHAR) RESOURCE_SAMPLER_THREAD_SIGNALING);
         if (!pPeer->foundPeerId.load()) {
             pPeer->peerId = pMsg->signalingMessage.peerClientId;
             DLOGI("Found peer id: %s", pPeer->peerId.c_str());
@@ -168,7 +174,9 @@ STATUS Peer::initSignaling(const Canary::PConfig pConfig)
         return retStatus;
     };
     CHK_STATUS(createSignalingClientSync(&this->clientInfo, &channelInfo, &clientCallbacks, pAwsCredentialProvider, &signalingClientHandle));
+    this->timeline.mark(CONNECTION_PHASE_SIGNALING_CREATED);
     CHK_STATUS(signalingClientFetchSync(signalingClientHandle));
+    this->timeline.mark(CONNECTION_PHASE_SIGNALING_FETCHED);
 
 CleanUp:
 
@@ -177,35 +185,7 @@ CleanUp:
 
 STATUS Peer::initRtcConfiguration(const Canary::PConfig pConfig)
 {
-    auto awaitGetIceConfigInfoCount = [](SIGNALING_CLIENT_HANDLE signalingClientHandle, PUINT32 pIceConfigInfoCount) -> STATUS {
-        STATUS retStatus = STATUS_SUCCESS;
-        UINT64 elapsed = 0;
-
-        CHK(IS_VALID_SIGNALING_CLIENT_HANDLE(signalingClientHandle) && pIceConfigInfoCount != NULL, STATUS_NULL_ARG);
-
-        while (TRUE) {
-            // Get the configuration count
-            CHK_STATUS(signalingClientGetIceConfigInfoCount(signalingClientHandle, pIceConfigInfoCount));
-
-            // Return OK if we have some ice configs
-            CHK(*pIceConfigInfoCount == 0, retStatus);
-
-            // Check for timeout
-            CHK_ERR(elapsed <= ASYNC_ICE_CONFIG_INFO_WAIT_TIMEOUT, STATUS_OPERATION_TIMED_OUT,
-                    "Couldn't retrieve ICE configurations in alotted time.");
-
-            THREAD_SLEEP(ICE_CONFIG_INFO_POLL_PERIOD);
-            elapsed += ICE_CONFIG_INFO_POLL_PERIOD;
-        }
-
-    CleanUp:
-
-        return retStatus;
-    };
-
     STATUS retStatus = STATUS_SUCCESS;
-    UINT32 i, j, iceConfigCount, uriCount;
-    PIceConfigInfo pIceConfigInfo;
     PRtcConfiguration pConfiguration = &this->rtcConfiguration;
 
     MEMSET(pConfiguration, 0x00, SIZEOF(RtcConfiguration));
@@ -217,41 +197,49 @@ STATUS Peer::initRtcConfiguration(const Canary::PConfig pConfig)
         pConfiguration->iceTransportPolicy = ICE_TRANSPORT_POLICY_RELAY;
     }
 
-    // Set the  STUN server
-    if (pConfig->endpoint.value.empty()) {
+    // Set the  STUN server. An explicit URL wins, "none" leaves STUN out altogether
+    if (!pConfig->stunUrl.value.empty()) {
+        if (pConfig->stunUrl.value != CANARY_STUN_URL_NONE) {
+            STRNCPY(pConfiguration->iceServers[0].urls, pConfig->stunUrl.value.c_str(), MAX_ICE_CONFIG_URI_LEN);
+        }
+    } else if (pConfig->endpoint.value.empty()) {
         SNPRINTF(pConfiguration->iceServers[0].urls, MAX_ICE_CONFIG_URI_LEN, KINESIS_VIDEO_STUN_URL, pConfig->region.value.c_str());
     } else {
         SNPRINTF(pConfiguration->iceServers[0].urls, MAX_ICE_CONFIG_URI_LEN, "stun:stun.%s:443", pConfig->endpoint.value.c_str());
     }
 
-    if (pConfig->useTurn.value) {
-        // Set the URIs from the configuration
-        CHK_STATUS(awaitGetIceConfigInfoCount(signalingClientHandle, &iceConfigCount));
-
-        /* signalingClientGetIceConfigInfoCount can return more than one turn server. Use only one to optimize
-         * candidate gathering latency. But user can also choose to use more than 1 turn server. */
-        for (uriCount = 0, i = 0; i < MAX_TURN_SERVERS; i++) {
-            CHK_STATUS(signalingClientGetIceConfigInfo(signalingClientHandle, i, &pIceConfigInfo));
-            for (j = 0; j < pIceConfigInfo->uriCount; j++) {
-                CHECK(uriCount < MAX_ICE_SERVERS_COUNT);
-                /*
-                 * if configuration.iceServers[uriCount + 1].urls is "turn:ip:port?transport=udp" then ICE will try TURN over UDP
-                 * if configuration.iceServers[uriCount + 1].urls is "turn:ip:port?transport=tcp" then ICE will try TURN over TCP/TLS
-                 * if configuration.iceServers[uriCount + 1].urls is "turns:ip:port?transport=udp", it's currently ignored because sdk dont do
-                 * TURN over DTLS yet. if configuration.iceServers[uriCount + 1].urls is "turns:ip:port?transport=tcp" then ICE will try TURN over
-                 * TCP/TLS if configuration.iceServers[uriCount + 1].urls is "turn:ip:port" then ICE will try both TURN over UPD and TCP/TLS
-                 *
-                 * It's recommended to not pass too many TURN iceServers to configuration because it will slow down ice gathering in non-trickle
-                 * mode.
-                 */
-
-                STRNCPY(pConfiguration->iceServers[uriCount + 1].urls, pIceConfigInfo->uris[j], MAX_ICE_CONFIG_URI_LEN);
-                STRNCPY(pConfiguration->iceServers[uriCount + 1].credential, pIceConfigInfo->password, MAX_ICE_CONFIG_CREDENTIAL_LEN);
-                STRNCPY(pConfiguration->iceServers[uriCount + 1].username, pIceConfigInfo->userName, MAX_ICE_CONFIG_USER_NAME_LEN);
-
-                uriCount++;
-            }
-        }
+    // TURN servers are only added right before the peer connection is created, so nothing blocks here. Warm up the
+    // cache in case the signaling client already has them.
+    this->channelName = pConfig->channelName.value;
+    this->useTurn = pConfig->useTurn.value;
+    this->forceTurn = pConfig->forceTurn.value;
+    if (this->useTurn) {
+        CHK_LOG_ERR(IceConfigCache::getInstance().refresh(this->channelName, this->signalingClientHandle));
+    }
+
+    return retStatus;
+}
+
+STATUS Peer::addTurnServers()
+{
+    STATUS retStatus = STATUS_SUCCESS;
+    std::vector<RtcIceServer> servers;
+    UINT32 i;
+    auto& cache = IceConfigCache::getInstance();
+
+    CHK(this->useTurn, retStatus);
+
+    if (this->forceTurn) {
+        // Relay only, there is nothing to gather without TURN
+        CHK_STATUS(cache.await(this->channelName, this->signalingClientHandle, ASYNC_ICE_CONFIG_INFO_WAIT_TIMEOUT, servers));
+    } else if (!cache.get(this->channelName, this->signalingClientHandle, servers)) {
+        // The peer connection takes its ICE servers at creation, don't hold up host and STUN candidates for TURN
+        DLOGW("TURN servers are not available yet, gathering without them");
+    }
+
+    // The first slot is the STUN server
+    for (i = 0; i < servers.size() && i + 1 < MAX_ICE_SERVERS_COUNT; i++) {
+        this->rtcConfiguration.iceServers[i + 1] = servers[i];
     }
 
 CleanUp:
@@ -268,12 +256,26 @@ STATUS Peer::initPeerConnection()
 
         if (candidateJson == NULL) {
             DLOGD("ice candidate gathering finished");
+            pPeer->timeline.mark(CONNECTION_PHASE_ICE_GATHERING_DONE);
             pPeer->iceGatheringDone = TRUE;
             pPeer->cvar.notify_all();
-        } else if (pPeer->trickleIce) {
-            message.messageType = SIGNALING_MESSAGE_TYPE_ICE_CANDIDATE;
-            STRCPY(message.payload, candidateJson);
-            CHK_STATUS(pPeer->send(&message));
+        } else {
+            // The first relay candidate is there once the TURN allocation went through
+            if (STRSTR(candidateJson, " typ relay") != NULL && !pPeer->relayCandidateGathered.exchange(TRUE)) {
+                pPeer->timeline.mark(CONNECTION_PHASE_RELAY_CANDIDATE);
+                auto duration = (GETTIME() - pPeer->iceGatheringStartTime) / HUNDREDS_OF_NANOS_IN_A_MILLISECOND;
+                DLOGI("TURN allocation took %lu ms", duration);
+                Canary::Cloudwatch::getInstance().monitoring.pushTurnAllocationTime(duration);
+            }
+
+            if (pPeer->trickleIce) {
+                message.messageType = SIGNALING_MESSAGE_TYPE_ICE_CANDIDATE;
+                STRCPY(message.payload, candidateJson);
+                if (ImpairmentRelay::getInstance().isEnabled()) {
+                    CHK(ImpairmentRelay::getInstance().rewriteCandidateJson(message.payload, SIZEOF(message.payload)), retStatus);
+                }
+                CHK_STATUS(pPeer->send(&message));
+            }
         }
 
     CleanUp:
@@ -289,8 +291,11 @@ STATUS Peer::initPeerConnection()
         switch (newState) {
             case RTC_PEER_CONNECTION_STATE_CONNECTING:
                 pPeer->iceHolePunchingStartTime = GETTIME();
+                pPeer->timeline.mark(CONNECTION_PHASE_ICE_CHECKING);
                 break;
             case RTC_PEER_CONNECTION_STATE_CONNECTED: {
+                // The SDK reports connected once DTLS is done on top of the nominated ICE pair
+                pPeer->timeline.mark(CONNECTION_PHASE_CONNECTED);
                 auto duration = (GETTIME() - pPeer->iceHolePunchingStartTime) / HUNDREDS_OF_NANOS_IN_A_MILLISECOND;
                 DLOGI("ICE hole punching took %lu ms", duration);
                 Canary::Cloudwatch::getInstance().monitoring.pushICEHolePunchingDelay(duration, Aws::CloudWatch::Model::StandardUnit::Milliseconds);
@@ -316,6 +321,8 @@ STATUS Peer::initPeerConnection()
 
     STATUS retStatus = STATUS_SUCCESS;
     CHK(this->pPeerConnection == NULL, STATUS_INVALID_OPERATION);
+    CHK_STATUS(this->addTurnServers());
+    this->timeline.mark(CONNECTION_PHASE_ICE_CONFIG_READY);
     CHK_STATUS(createPeerConnection(&this->rtcConfiguration, &this->pPeerConnection));
     CHK_STATUS(peerConnectionOnIceCandidate(this->pPeerConnection, (UINT64) this, handleOnIceCandidate));
     CHK_STATUS(peerConnectionOnConnectionStateChange(this->pPeerConnection, (UINT64) this, onConnectionStateChange));
@@ -324,6 +331,11 @@ STATUS Peer::initPeerConnection()
         this->callbacks.onNewConnection(this);
     }
 
+    // Channels are created before the offer/answer exchange so that they open together with SCTP
+    if (this->dataChannelBench != nullptr) {
+        CHK_STATUS(this->dataChannelBench->open(this->pPeerConnection));
+    }
+
 CleanUp:
 
     return retStatus;
@@ -333,12 +345,19 @@ STATUS Peer::shutdown()
 {
     this->terminated = TRUE;
 
+    // Publishes whatever phases were reached if the connection never got to exchange frames
+    this->timeline.publish();
+
     this->cvar.notify_all();
     {
         // lock to wait until awoken thread finish.
         std::lock_guard<std::recursive_mutex> lock(this->mutex);
     }
 
+    if (this->dataChannelBench != nullptr) {
+        this->dataChannelBench->stop();
+    }
+
     if (this->pPeerConnection != NULL) {
         CHK_LOG_ERR(closePeerConnection(this->pPeerConnection));
     }
@@ -360,16 +379,22 @@ STATUS Peer::connect()
 
         MEMSET(&offerSDPInit, 0, SIZEOF(offerSDPInit));
         CHK_STATUS(createOffer(this->pPeerConnection, &offerSDPInit));
+        this->iceGatheringStartTime = GETTIME();
         CHK_STATUS(setLocalDescription(this->pPeerConnection, &offerSDPInit));
 
         if (!this->trickleIce) {
             CHK_STATUS(this->awaitIceGathering(&offerSDPInit));
         }
 
+        if (ImpairmentRelay::getInstance().isEnabled()) {
+            ImpairmentRelay::getInstance().rewriteSdp(offerSDPInit.sdp, SIZEOF(offerSDPInit.sdp));
+        }
+
         msg.messageType = SIGNALING_MESSAGE_TYPE_OFFER;
         CHK_STATUS(serializeSessionDescriptionInit(&offerSDPInit, NULL, &buffLen));
         CHK_STATUS(serializeSessionDescriptionInit(&offerSDPInit, msg.payload, &buffLen));
         CHK_STATUS(this->send(&msg));
+        this->timeline.mark(CONNECTION_PHASE_OFFER);
 
     CleanUp:
 
@@ -378,6 +403,7 @@ STATUS Peer::connect()
 
     STATUS retStatus = STATUS_SUCCESS;
     CHK_STATUS(signalingClientConnectSync(signalingClientHandle));
+    this->timeline.mark(CONNECTION_PHASE_SIGNALING_CONNECTED);
 
     if (!this->isMaster) {
         this->foundPeerId = TRUE;
@@ -442,6 +468,7 @@ STATUS Peer::handleSignalingMsg(PReceivedSignalingMessage pMsg)
             DLOGW("Offer already received, ignore new offer from client id %s", msg.peerClientId);
             CHK(FALSE, retStatus);
         }
+        this->timeline.mark(CONNECTION_PHASE_OFFER);
 
         MEMSET(&offerSDPInit, 0, SIZEOF(offerSDPInit));
         MEMSET(&answerSDPInit, 0, SIZEOF(answerSDPInit));
@@ -454,17 +481,23 @@ STATUS Peer::handleSignalingMsg(PReceivedSignalingMessage pMsg)
         CHECK(!NULLABLE_CHECK_EMPTY(canTrickle));
 
         CHK_STATUS(createAnswer(this->pPeerConnection, &answerSDPInit));
+        this->iceGatheringStartTime = GETTIME();
         CHK_STATUS(setLocalDescription(this->pPeerConnection, &answerSDPInit));
 
         if (!canTrickle.value) {
             CHK_STATUS(this->awaitIceGathering(&answerSDPInit));
         }
 
+        if (ImpairmentRelay::getInstance().isEnabled()) {
+            ImpairmentRelay::getInstance().rewriteSdp(answerSDPInit.sdp, SIZEOF(answerSDPInit.sdp));
+        }
+
         msg.messageType = SIGNALING_MESSAGE_TYPE_ANSWER;
         CHK_STATUS(serializeSessionDescriptionInit(&answerSDPInit, NULL, &buffLen));
         CHK_STATUS(serializeSessionDescriptionInit(&answerSDPInit, msg.payload, &buffLen));
 
         CHK_STATUS(this->send(&msg));
+        this->timeline.mark(CONNECTION_PHASE_ANSWER);
 
     CleanUp:
 
@@ -484,6 +517,7 @@ STATUS Peer::handleSignalingMsg(PReceivedSignalingMessage pMsg)
 
             CHK_STATUS(deserializeSessionDescriptionInit(msg.payload, msg.payloadLen, &answerSDPInit));
             CHK_STATUS(setRemoteDescription(this->pPeerConnection, &answerSDPInit));
+            this->timeline.mark(CONNECTION_PHASE_ANSWER);
         }
 
     CleanUp:
@@ -539,7 +573,10 @@ STATUS Peer::addTransceiver(RtcMediaStreamTrack& track)
     auto handleVideoFrame = [](UINT64 customData, PFrame pFrame) -> VOID {
         PPeer pPeer = (Canary::PPeer)(customData);
         std::unique_lock<std::recursive_mutex> lock(pPeer->mutex);
+        ResourceSampler::nameThread((PCHAR) RESOURCE_SAMPLER_THREAD_RECEIVE);
         PBYTE frameDataPtr = pFrame->frameData + ANNEX_B_NALU_SIZE;
+
+        pPeer->timeline.mark(CONNECTION_PHASE_FIRST_FRAME_RECEIVED);
         UINT32 rawPacketSize = 0;
 
         // Get size of hex encoded data
@@ -553,8 +590,13 @@ STATUS Peer::addTransceiver(RtcMediaStreamTrack& track)
         frameDataPtr += SIZEOF(UINT64);
         UINT32 receivedSize = getUnalignedInt32BigEndian((PINT32)(frameDataPtr));
 
-        pPeer->endToEndMetricsContext.frameLatencyAvg =
-            EMA_ACCUMULATOR_GET_NEXT(pPeer->endToEndMetricsContext.frameLatencyAvg, GETTIME() - receivedTs);
+        UINT64 now = GETTIME();
+        if (rawPacketSize >= CANARY_METADATA_SIZE) {
+            frameDataPtr += SIZEOF(UINT32) + SIZEOF(UINT32);
+            pPeer->videoFrameTracker.onFrame(getUnalignedInt32BigEndian((PINT32)(frameDataPtr)), now);
+        }
+        pPeer->endToEndMetricsContext.frameLatencyAvg = EMA_ACCUMULATOR_GET_NEXT(pPeer->endToEndMetricsContext.frameLatencyAvg, now - receivedTs);
+        pPeer->recordAvSync(now, receivedTs);
 
         // Do a size match of the raw packet. Since raw packet does not contain the NALu, the
         // comparison would be rawPacketSize + ANNEX_B_NALU_SIZE and the received size
@@ -566,17 +608,36 @@ STATUS Peer::addTransceiver(RtcMediaStreamTrack& track)
         SAFE_MEMFREE(rawPacket);
     };
 
+    auto handleAudioFrame = [](UINT64 customData, PFrame pFrame) -> VOID {
+        PPeer pPeer = (Canary::PPeer)(customData);
+        std::unique_lock<std::recursive_mutex> lock(pPeer->mutex);
+        ResourceSampler::nameThread((PCHAR) RESOURCE_SAMPLER_THREAD_RECEIVE);
+        PBYTE frameDataPtr = pFrame->frameData;
+        UINT64 now = GETTIME();
+
+        // Anything shorter can't be from a canary peer
+        if (pFrame->size < CANARY_AUDIO_METADATA_SIZE) {
+            return;
+        }
+
+        UINT64 captureTs = getUnalignedInt64BigEndian((PINT64)(frameDataPtr));
+        frameDataPtr += SIZEOF(UINT64) + SIZEOF(UINT32);
+        UINT32 sequence = getUnalignedInt32BigEndian((PINT32)(frameDataPtr));
+
+        pPeer->recordAudioFrame(now, captureTs, sequence);
+        pPeer->audioFrameTracker.onFrame(sequence, now);
+    };
+
     PRtcRtpTransceiver pTransceiver;
     STATUS retStatus = STATUS_SUCCESS;
 
     CHK_STATUS(::addTransceiver(pPeerConnection, &track, NULL, &pTransceiver));
     if (track.kind == MEDIA_STREAM_TRACK_KIND_VIDEO) {
         this->videoTransceivers.push_back(pTransceiver);
-
-        // As part of canaries, we will only be monitoring video transceiver as we do for every other metrics
         CHK_STATUS(transceiverOnFrame(pTransceiver, (UINT64) this, handleVideoFrame));
     } else {
         this->audioTransceivers.push_back(pTransceiver);
+        CHK_STATUS(transceiverOnFrame(pTransceiver, (UINT64) this, handleAudioFrame));
     }
 
     CHK_STATUS(transceiverOnBandwidthEstimation(pTransceiver, (UINT64) this, handleBandwidthEstimation));
@@ -586,6 +647,48 @@ CleanUp:
     return retStatus;
 }
 
+VOID Peer::recordAudioFrame(UINT64 arrival, UINT64 captureTs, UINT32 sequence)
+{
+    auto& audio = this->audioMetricsContext;
+    INT64 transit = (INT64) arrival - (INT64) captureTs;
+    INT32 gap;
+
+    if (this->audioReceived) {
+        // Sequence numbers wrap, so a frame from behind the last one is late or duplicated rather than a huge gap
+        gap = (INT32)(sequence - this->lastAudioSequence);
+        if (gap <= 0) {
+            return;
+        }
+        audio.framesLost += gap - 1;
+
+        // RFC 3550 section 6.4.1, transit time differences of consecutive frames smoothed with a gain of 1/16
+        audio.jitter += ((DOUBLE) ABS(transit - this->lastAudioTransit) - audio.jitter) / 16.0;
+    }
+
+    // Peers on different hosts can have clocks far enough apart for the transit to go negative
+    audio.latencies[MAX(transit, 0) / HUNDREDS_OF_NANOS_IN_A_MILLISECOND]++;
+    audio.framesReceived++;
+
+    this->audioReceived = TRUE;
+    this->lastAudioSequence = sequence;
+    this->lastAudioCaptureTs = captureTs;
+    this->lastAudioTransit = transit;
+}
+
+VOID Peer::recordAvSync(UINT64 arrival, UINT64 captureTs)
+{
+    INT64 skew;
+
+    // Only compare against audio captured at about the same time, which stops a stalled audio track from reading as skew.
+    // Both latencies are measured against the same pair of clocks, so any offset between the hosts cancels out
+    if (!this->audioReceived || ABS((INT64) captureTs - (INT64) this->lastAudioCaptureTs) > (INT64) AV_SYNC_MATCH_WINDOW) {
+        return;
+    }
+
+    skew = ((INT64) arrival - (INT64) captureTs) - this->lastAudioTransit;
+    this->audioMetricsContext.syncSkews[skew / (INT64) HUNDREDS_OF_NANOS_IN_A_MILLISECOND]++;
+}
+
 STATUS Peer::addSupportedCodec(RTC_CODEC codec)
 {
     STATUS retStatus = STATUS_SUCCESS;
@@ -603,19 +706,18 @@ STATUS Peer::writeFrame(PFrame pFrame, MEDIA_STREAM_TRACK_KIND kind)
     DOUBLE timeToFirstFrame;
     auto& transceivers = kind == MEDIA_STREAM_TRACK_KIND_VIDEO ? this->videoTransceivers : this->audioTransceivers;
     if (kind == MEDIA_STREAM_TRACK_KIND_VIDEO) {
-        std::lock_guard<std::mutex> lock(this->countUpdateMutex);
-        if (this->recorded.load()) {
-            this->canaryOutgoingRTPMetricsContext.videoFramesGenerated = 0;
-            this->canaryOutgoingRTPMetricsContext.videoBytesGenerated = 0;
-            this->recorded = FALSE;
-        }
-        this->canaryOutgoingRTPMetricsContext.videoFramesGenerated++;
-        this->canaryOutgoingRTPMetricsContext.videoBytesGenerated += pFrame->size;
+        // Cumulative, the stats sampler works with deltas
+        this->videoFramesGenerated++;
+        this->videoBytesGenerated += pFrame->size;
     }
     for (auto& transceiver : transceivers) {
         retStatus = ::writeFrame(transceiver, pFrame);
         CHK (retStatus == STATUS_SRTP_NOT_READY_YET || retStatus == STATUS_SUCCESS, retStatus);
 
+        if (STATUS_SUCCEEDED(retStatus)) {
+            this->timeline.mark(CONNECTION_PHASE_FIRST_FRAME_SENT);
+        }
+
         if (STATUS_SUCCEEDED(retStatus) && this->firstFrame && this->isMaster) {
             this->firstFrame = FALSE;
             timeToFirstFrame = (DOUBLE) (GETTIME() - this->offerReceiveTimestamp) / HUNDREDS_OF_NANOS_IN_A_MILLISECOND;
@@ -631,106 +733,207 @@ CleanUp:
     return retStatus;
 }
 
-STATUS Peer::populateOutgoingRtpMetricsContext()
+STATUS Peer::takeStatsSnapshot(PStatsSnapshot pSnapshot)
 {
-    DOUBLE currentDuration = 0;
+    STATUS retStatus = STATUS_SUCCESS;
+    RtcStats stats;
+    RtpStatsSample sample;
+    std::vector<PRtcRtpTransceiver> transceivers(this->audioTransceivers);
+
+    CHK(pSnapshot != NULL, STATUS_NULL_ARG);
+
+    pSnapshot->timestamp = GETTIME();
+    pSnapshot->videoFramesGenerated = this->videoFramesGenerated.load();
+    pSnapshot->videoBytesGenerated = this->videoBytesGenerated.load();
+    pSnapshot->rtp.clear();
+    pSnapshot->candidatePairValid = FALSE;
+    pSnapshot->transportValid = FALSE;
+
+    CHK(this->pPeerConnection != NULL, retStatus);
+
+    transceivers.insert(transceivers.end(), this->videoTransceivers.begin(), this->videoTransceivers.end());
+    for (UINT32 i = 0; i < transceivers.size(); i++) {
+        MEMSET(&sample, 0x00, SIZEOF(RtpStatsSample));
+        sample.kind = i < this->audioTransceivers.size() ? MEDIA_STREAM_TRACK_KIND_AUDIO : MEDIA_STREAM_TRACK_KIND_VIDEO;
+
+        // A transceiver that is not sending or receiving yet keeps zeroed counters
+        stats.requestedTypeOfStats = RTC_STATS_TYPE_OUTBOUND_RTP;
+        if (STATUS_SUCCEEDED(::rtcPeerConnectionGetMetrics(this->pPeerConnection, transceivers[i], &stats))) {
+            sample.packetsSent = stats.rtcStatsObject.outboundRtpStreamStats.sent.packetsSent;
+            sample.bytesSent = stats.rtcStatsObject.outboundRtpStreamStats.sent.bytesSent;
+            sample.framesSent = stats.rtcStatsObject.outboundRtpStreamStats.framesSent;
+            sample.framesDiscardedOnSend = stats.rtcStatsObject.outboundRtpStreamStats.framesDiscardedOnSend;
+            sample.nackCount = stats.rtcStatsObject.outboundRtpStreamStats.nackCount;
+            sample.pliCount = stats.rtcStatsObject.outboundRtpStreamStats.pliCount;
+            sample.retransmittedBytesSent = stats.rtcStatsObject.outboundRtpStreamStats.retransmittedBytesSent;
+        }
 
-    currentDuration = (DOUBLE)(this->canaryMetrics.timestamp - this->canaryOutgoingRTPMetricsContext.prevTs) / HUNDREDS_OF_NANOS_IN_A_SECOND;
-    {
-        std::lock_guard<std::mutex> lock(this->countUpdateMutex);
-        this->canaryOutgoingRTPMetricsContext.framesPercentageDiscarded =
-            ((DOUBLE)(this->canaryMetrics.rtcStatsObject.outboundRtpStreamStats.framesDiscardedOnSend -
-                      this->canaryOutgoingRTPMetricsContext.prevFramesDiscardedOnSend) /
-             (DOUBLE) this->canaryOutgoingRTPMetricsContext.videoFramesGenerated) *
-            100.0;
-        this->canaryOutgoingRTPMetricsContext.retxBytesPercentage =
-            (((DOUBLE) this->canaryMetrics.rtcStatsObject.outboundRtpStreamStats.retransmittedBytesSent -
-              (DOUBLE)(this->canaryOutgoingRTPMetricsContext.prevRetxBytesSent)) /
-             (DOUBLE) this->canaryOutgoingRTPMetricsContext.videoBytesGenerated) *
-            100.0;
-    }
-
-    // This flag ensures the reset of video bytes count is done only when this flag is set
-    this->recorded = TRUE;
-    this->canaryOutgoingRTPMetricsContext.averageFramesSentPerSecond =
-        ((DOUBLE)(this->canaryMetrics.rtcStatsObject.outboundRtpStreamStats.framesSent -
-                  (DOUBLE) this->canaryOutgoingRTPMetricsContext.prevFramesSent)) /
-        currentDuration;
-    this->canaryOutgoingRTPMetricsContext.nacksPerSecond =
-        ((DOUBLE) this->canaryMetrics.rtcStatsObject.outboundRtpStreamStats.nackCount - this->canaryOutgoingRTPMetricsContext.prevNackCount) /
-        currentDuration;
-    this->canaryOutgoingRTPMetricsContext.prevFramesSent = this->canaryMetrics.rtcStatsObject.outboundRtpStreamStats.framesSent;
-    this->canaryOutgoingRTPMetricsContext.prevTs = this->canaryMetrics.timestamp;
-    this->canaryOutgoingRTPMetricsContext.prevFramesDiscardedOnSend = this->canaryMetrics.rtcStatsObject.outboundRtpStreamStats.framesDiscardedOnSend;
-    this->canaryOutgoingRTPMetricsContext.prevNackCount = this->canaryMetrics.rtcStatsObject.outboundRtpStreamStats.nackCount;
-    this->canaryOutgoingRTPMetricsContext.prevRetxBytesSent = this->canaryMetrics.rtcStatsObject.outboundRtpStreamStats.retransmittedBytesSent;
-
-    return STATUS_SUCCESS;
+        stats.requestedTypeOfStats = RTC_STATS_TYPE_INBOUND_RTP;
+        if (STATUS_SUCCEEDED(::rtcPeerConnectionGetMetrics(this->pPeerConnection, transceivers[i], &stats))) {
+            sample.packetsReceived = stats.rtcStatsObject.inboundRtpStreamStats.received.packetsReceived;
+            sample.bytesReceived = stats.rtcStatsObject.inboundRtpStreamStats.bytesReceived;
+            sample.framesDropped = stats.rtcStatsObject.inboundRtpStreamStats.received.framesDropped;
+        }
+
+        pSnapshot->rtp.push_back(sample);
+    }
+
+    // Both fail until ICE has selected a pair, which is expected early in the session
+    stats.requestedTypeOfStats = RTC_STATS_TYPE_CANDIDATE_PAIR;
+    if (STATUS_SUCCEEDED(::rtcPeerConnectionGetMetrics(this->pPeerConnection, NULL, &stats))) {
+        pSnapshot->candidatePairValid = TRUE;
+        pSnapshot->candidatePairBytesSent = stats.rtcStatsObject.iceCandidatePairStats.bytesSent;
+        pSnapshot->candidatePairBytesReceived = stats.rtcStatsObject.iceCandidatePairStats.bytesReceived;
+        pSnapshot->candidatePairPacketsDiscardedOnSend = stats.rtcStatsObject.iceCandidatePairStats.packetsDiscardedOnSend;
+        pSnapshot->currentRoundTripTime = stats.rtcStatsObject.iceCandidatePairStats.currentRoundTripTime;
+        pSnapshot->availableOutgoingBitrate = stats.rtcStatsObject.iceCandidatePairStats.availableOutgoingBitrate;
+    }
+
+    stats.requestedTypeOfStats = RTC_STATS_TYPE_TRANSPORT;
+    if (STATUS_SUCCEEDED(::rtcPeerConnectionGetMetrics(this->pPeerConnection, NULL, &stats))) {
+        pSnapshot->transportValid = TRUE;
+        pSnapshot->transportBytesSent = stats.rtcStatsObject.transportStats.bytesSent;
+        pSnapshot->transportBytesReceived = stats.rtcStatsObject.transportStats.bytesReceived;
+    }
+
+CleanUp:
+
+    return retStatus;
 }
 
-STATUS Peer::populateIncomingRtpMetricsContext()
+// Counters never go backwards, but a reset in the SDK should read as "nothing happened" rather than a huge spike
+static UINT64 counterDelta(UINT64 prev, UINT64 cur)
 {
-    DOUBLE currentDuration = 0;
-    currentDuration = (DOUBLE)(this->canaryMetrics.timestamp - this->canaryIncomingRTPMetricsContext.prevTs) / HUNDREDS_OF_NANOS_IN_A_SECOND;
-    this->canaryIncomingRTPMetricsContext.packetReceiveRate =
-        (DOUBLE)(this->canaryMetrics.rtcStatsObject.inboundRtpStreamStats.received.packetsReceived -
-                 this->canaryIncomingRTPMetricsContext.prevPacketsReceived) /
-        currentDuration;
-    this->canaryIncomingRTPMetricsContext.incomingBitRate =
-        ((DOUBLE)(this->canaryMetrics.rtcStatsObject.inboundRtpStreamStats.bytesReceived - this->canaryIncomingRTPMetricsContext.prevBytesReceived) /
-         currentDuration) /
-        0.008;
-    this->canaryIncomingRTPMetricsContext.framesDroppedPerSecond =
-        ((DOUBLE) this->canaryMetrics.rtcStatsObject.inboundRtpStreamStats.received.framesDropped -
-         this->canaryIncomingRTPMetricsContext.prevFramesDropped) /
-        currentDuration;
-
-    this->canaryIncomingRTPMetricsContext.prevPacketsReceived = this->canaryMetrics.rtcStatsObject.inboundRtpStreamStats.received.packetsReceived;
-    this->canaryIncomingRTPMetricsContext.prevBytesReceived = this->canaryMetrics.rtcStatsObject.inboundRtpStreamStats.bytesReceived;
-    this->canaryIncomingRTPMetricsContext.prevFramesDropped = this->canaryMetrics.rtcStatsObject.inboundRtpStreamStats.received.framesDropped;
-    this->canaryIncomingRTPMetricsContext.prevTs = this->canaryMetrics.timestamp;
-
-    return STATUS_SUCCESS;
+    return cur >= prev ? cur - prev : 0;
 }
-STATUS Peer::publishStatsForCanary(RTC_STATS_TYPE statsType)
+
+// Bytes over a duration in seconds to Kilobits_Second
+static DOUBLE toKilobitsPerSecond(UINT64 bytes, DOUBLE duration)
 {
-    STATUS retStatus = STATUS_SUCCESS;
-    this->canaryMetrics.requestedTypeOfStats = statsType;
-    switch (statsType) {
-        case RTC_STATS_TYPE_OUTBOUND_RTP:
-            if (!this->videoTransceivers.empty()) {
-                CHK_LOG_ERR(::rtcPeerConnectionGetMetrics(this->pPeerConnection, this->videoTransceivers.back(), &this->canaryMetrics));
-                this->populateOutgoingRtpMetricsContext();
-                Canary::Cloudwatch::getInstance().monitoring.pushOutboundRtpStats(&this->canaryOutgoingRTPMetricsContext);
-            }
-            break;
-        case RTC_STATS_TYPE_INBOUND_RTP:
-            if (!this->videoTransceivers.empty()) {
-                CHK_LOG_ERR(::rtcPeerConnectionGetMetrics(this->pPeerConnection, this->videoTransceivers.back(), &this->canaryMetrics));
-                this->populateIncomingRtpMetricsContext();
-                Canary::Cloudwatch::getInstance().monitoring.pushInboundRtpStats(&this->canaryIncomingRTPMetricsContext);
-            }
-            break;
-        default:
-            CHK(FALSE, STATUS_NOT_IMPLEMENTED);
-    }
-CleanUp:
-    return retStatus;
+    return (DOUBLE) bytes * 8.0 / 1000.0 / duration;
 }
 
-STATUS Peer::publishEndToEndMetrics()
+VOID Peer::computeStatsRates(const StatsSnapshot& prev, const StatsSnapshot& cur, PStatsRates pRates)
 {
-    std::unique_lock<std::recursive_mutex> lock(this->mutex);
-    Canary::Cloudwatch::getInstance().monitoring.pushEndToEndMetrics(this->endToEndMetricsContext);
+    DOUBLE duration = (DOUBLE) counterDelta(prev.timestamp, cur.timestamp) / HUNDREDS_OF_NANOS_IN_A_SECOND;
+    UINT64 framesGenerated = counterDelta(prev.videoFramesGenerated, cur.videoFramesGenerated);
+    UINT64 bytesGenerated = counterDelta(prev.videoBytesGenerated, cur.videoBytesGenerated);
+
+    *pRates = StatsRates();
+    if (duration <= 0) {
+        return;
+    }
 
-    return STATUS_SUCCESS;
+    // Callers only compare snapshots with the same transceiver set, so transceivers line up by index
+    for (UINT32 i = 0; i < cur.rtp.size() && i < prev.rtp.size(); i++) {
+        auto& p = prev.rtp[i];
+        auto& c = cur.rtp[i];
+        auto& track = c.kind == MEDIA_STREAM_TRACK_KIND_VIDEO ? pRates->video : pRates->audio;
+
+        track.outgoingBitRate += toKilobitsPerSecond(counterDelta(p.bytesSent, c.bytesSent), duration);
+        track.outgoingPacketRate += (DOUBLE) counterDelta(p.packetsSent, c.packetsSent) / duration;
+        track.framesSentPerSecond += (DOUBLE) counterDelta(p.framesSent, c.framesSent) / duration;
+        track.nacksPerSecond += (DOUBLE) counterDelta(p.nackCount, c.nackCount) / duration;
+        track.plisPerSecond += (DOUBLE) counterDelta(p.pliCount, c.pliCount) / duration;
+        track.incomingBitRate += toKilobitsPerSecond(counterDelta(p.bytesReceived, c.bytesReceived), duration);
+        track.incomingPacketRate += (DOUBLE) counterDelta(p.packetsReceived, c.packetsReceived) / duration;
+        track.framesDroppedPerSecond += (DOUBLE) counterDelta(p.framesDropped, c.framesDropped) / duration;
+        track.framesDiscardedOnSend += counterDelta(p.framesDiscardedOnSend, c.framesDiscardedOnSend);
+        track.retransmittedBytesSent += counterDelta(p.retransmittedBytesSent, c.retransmittedBytesSent);
+    }
+
+    if (framesGenerated != 0) {
+        pRates->framesPercentageDiscarded = (DOUBLE) pRates->video.framesDiscardedOnSend / (DOUBLE) framesGenerated * 100.0;
+    }
+    if (bytesGenerated != 0) {
+        pRates->retxBytesPercentage = (DOUBLE) pRates->video.retransmittedBytesSent / (DOUBLE) bytesGenerated * 100.0;
+    }
+
+    // The selected pair can show up or change in between, only publish when both ends have one
+    pRates->candidatePairValid = prev.candidatePairValid && cur.candidatePairValid;
+    if (pRates->candidatePairValid) {
+        pRates->candidatePairOutgoingBitRate = toKilobitsPerSecond(counterDelta(prev.candidatePairBytesSent, cur.candidatePairBytesSent), duration);
+        pRates->candidatePairIncomingBitRate =
+            toKilobitsPerSecond(counterDelta(prev.candidatePairBytesReceived, cur.candidatePairBytesReceived), duration);
+        pRates->candidatePairPacketsDiscardedPerSecond =
+            (DOUBLE) counterDelta(prev.candidatePairPacketsDiscardedOnSend, cur.candidatePairPacketsDiscardedOnSend) / duration;
+        pRates->roundTripTime = cur.currentRoundTripTime * 1000.0;
+        pRates->availableOutgoingBitrate = cur.availableOutgoingBitrate / 1000.0;
+    }
+
+    pRates->transportValid = prev.transportValid && cur.transportValid;
+    if (pRates->transportValid) {
+        pRates->transportOutgoingBitRate = toKilobitsPerSecond(counterDelta(prev.transportBytesSent, cur.transportBytesSent), duration);
+        pRates->transportIncomingBitRate = toKilobitsPerSecond(counterDelta(prev.transportBytesReceived, cur.transportBytesReceived), duration);
+    }
 }
 
-STATUS Peer::publishRetryCount()
+STATUS Peer::sampleStats(UINT64 currentTime)
 {
     STATUS retStatus = STATUS_SUCCESS;
-    Canary::Cloudwatch::getInstance().monitoring.pushRetryCount(this->clientInfo.stateMachineRetryCountReadOnly);
+    StatsSnapshot snapshot;
+    StatsRates rates;
+    EndToEndMetricsContext endToEndMetrics;
+    AudioMetricsContext audioMetrics;
+    FrameTrackerStats videoFrames, audioFrames;
+    BOOL rebase, publishRtp, publishEndToEnd;
+    auto& monitoring = Canary::Cloudwatch::getInstance().monitoring;
+
+    // Cheap and most interesting while connecting, so it goes out on every tick
+    monitoring.pushRetryCount(this->clientInfo.stateMachineRetryCountReadOnly);
+
+    publishEndToEnd = currentTime - this->lastEndToEndStatsTime >= END_TO_END_METRICS_INVOCATION_PERIOD;
+
+    {
+        // Transceivers are added and end-to-end metrics are updated under this lock, so one pass takes it once
+        std::lock_guard<std::recursive_mutex> lock(this->mutex);
+
+        // Deltas only make sense against a snapshot of the same transceivers, start over whenever they change
+        rebase = this->prevSnapshot.timestamp == 0 ||
+            this->prevSnapshot.rtp.size() != this->audioTransceivers.size() + this->videoTransceivers.size();
+        publishRtp = !rebase && currentTime - this->lastRtpStatsTime >= METRICS_INVOCATION_PERIOD;
+
+        if (rebase || publishRtp) {
+            CHK_STATUS(this->takeStatsSnapshot(&snapshot));
+        }
+
+        if (publishEndToEnd) {
+            endToEndMetrics = this->endToEndMetricsContext;
+
+            // Everything but the jitter estimate starts over for the next period
+            audioMetrics = std::move(this->audioMetricsContext);
+            this->audioMetricsContext = AudioMetricsContext();
+            this->audioMetricsContext.jitter = audioMetrics.jitter;
+
+            this->videoFrameTracker.collect(&videoFrames);
+            this->audioFrameTracker.collect(&audioFrames);
+        }
+    }
+
+    if (publishRtp) {
+        computeStatsRates(this->prevSnapshot, snapshot, &rates);
+        monitoring.pushStatsRates(rates);
+    }
+
+    if (rebase || publishRtp) {
+        this->prevSnapshot = snapshot;
+        this->lastRtpStatsTime = currentTime;
+    }
+
+    if (this->dataChannelBench != nullptr) {
+        this->dataChannelBench->sample(currentTime);
+    }
+
+    if (publishEndToEnd) {
+        monitoring.pushEndToEndMetrics(endToEndMetrics);
+        monitoring.pushAudioMetrics(audioMetrics);
+        monitoring.pushFrameTrackerStats(videoFrames, "Video");
+        monitoring.pushFrameTrackerStats(audioFrames, "Audio");
+        this->lastEndToEndStatsTime = currentTime;
+    }
+
 CleanUp:
+
     return retStatus;
 }
 
@@ -4,36 +4,70 @@ namespace Canary {
 class Peer;
 typedef Peer* PPeer;
 
+// Raw RTP counters of a single transceiver, as reported by the SDK
 typedef struct {
-    UINT64 prevNumberOfPacketsSent;
-    UINT64 prevNumberOfPacketsReceived;
-    UINT64 prevNumberOfBytesSent;
-    UINT64 prevNumberOfBytesReceived;
-    UINT64 prevFramesDiscardedOnSend;
-    UINT64 prevTs;
-    UINT64 prevVideoFramesGenerated;
-    UINT64 prevFramesSent;
-    UINT64 prevNackCount;
-    UINT64 prevRetxBytesSent;
-    std::atomic<UINT64> videoFramesGenerated;
-    UINT64 videoBytesGenerated;
-    DOUBLE framesPercentageDiscarded;
-    DOUBLE nacksPerSecond;
-    DOUBLE averageFramesSentPerSecond;
-    DOUBLE retxBytesPercentage;
-} OutgoingRTPMetricsContext;
-typedef OutgoingRTPMetricsContext* POutgoingRTPMetricsContext;
+    MEDIA_STREAM_TRACK_KIND kind;
+    UINT64 packetsSent;
+    UINT64 bytesSent;
+    UINT64 framesSent;
+    UINT64 framesDiscardedOnSend;
+    UINT64 nackCount;
+    UINT64 pliCount;
+    UINT64 retransmittedBytesSent;
+    UINT64 packetsReceived;
+    UINT64 bytesReceived;
+    UINT64 framesDropped;
+} RtpStatsSample;
+typedef RtpStatsSample* PRtpStatsSample;
 
-typedef struct {
-    UINT64 prevPacketsReceived;
-    UINT64 prevTs;
-    UINT64 prevBytesReceived;
-    UINT64 prevFramesDropped;
-    DOUBLE packetReceiveRate;
-    DOUBLE incomingBitRate;
-    DOUBLE framesDroppedPerSecond;
-} IncomingRTPMetricsContext;
-typedef IncomingRTPMetricsContext* PIncomingRTPMetricsContext;
+// Everything the sampler reads in one pass. Counters are cumulative, rates are derived from two consecutive snapshots
+struct StatsSnapshot {
+    UINT64 timestamp = 0;
+    UINT64 videoFramesGenerated = 0;
+    UINT64 videoBytesGenerated = 0;
+    std::vector<RtpStatsSample> rtp;
+    BOOL candidatePairValid = FALSE;
+    UINT64 candidatePairBytesSent = 0;
+    UINT64 candidatePairBytesReceived = 0;
+    UINT64 candidatePairPacketsDiscardedOnSend = 0;
+    DOUBLE currentRoundTripTime = 0.0;
+    DOUBLE availableOutgoingBitrate = 0.0;
+    BOOL transportValid = FALSE;
+    UINT64 transportBytesSent = 0;
+    UINT64 transportBytesReceived = 0;
+};
+typedef StatsSnapshot* PStatsSnapshot;
+
+// Per media kind rates, summed over all transceivers of that kind
+struct TrackStatsRates {
+    DOUBLE outgoingBitRate = 0.0;
+    DOUBLE outgoingPacketRate = 0.0;
+    DOUBLE framesSentPerSecond = 0.0;
+    DOUBLE nacksPerSecond = 0.0;
+    DOUBLE plisPerSecond = 0.0;
+    DOUBLE incomingBitRate = 0.0;
+    DOUBLE incomingPacketRate = 0.0;
+    DOUBLE framesDroppedPerSecond = 0.0;
+    UINT64 framesDiscardedOnSend = 0;
+    UINT64 retransmittedBytesSent = 0;
+};
+
+struct StatsRates {
+    TrackStatsRates audio;
+    TrackStatsRates video;
+    DOUBLE framesPercentageDiscarded = 0.0;
+    DOUBLE retxBytesPercentage = 0.0;
+    BOOL candidatePairValid = FALSE;
+    DOUBLE candidatePairOutgoingBitRate = 0.0;
+    DOUBLE candidatePairIncomingBitRate = 0.0;
+    DOUBLE candidatePairPacketsDiscardedPerSecond = 0.0;
+    DOUBLE roundTripTime = 0.0;
+    DOUBLE availableOutgoingBitrate = 0.0;
+    BOOL transportValid = FALSE;
+    DOUBLE transportOutgoingBitRate = 0.0;
+    DOUBLE transportIncomingBitRate = 0.0;
+};
+typedef StatsRates* PStatsRates;
 
 struct EndToEndMetricsContext{
     DOUBLE frameLatencyAvg = 0.0;
@@ -42,6 +76,18 @@ struct EndToEndMetricsContext{
 };
 typedef EndToEndMetricsContext* PEndToEndMetricsContext;
 
+// Receive side audio since it was last published. Latencies and skews are in milliseconds, mapped to sample counts
+struct AudioMetricsContext {
+    UINT64 framesReceived = 0;
+    UINT64 framesLost = 0;
+    // RFC 3550 interarrival jitter in 100ns, carried over between periods
+    DOUBLE jitter = 0.0;
+    std::map<UINT64, UINT64> latencies;
+    // Video latency minus the latency of the audio frame captured closest to it, positive when video lags behind
+    std::map<INT64, UINT64> syncSkews;
+};
+typedef AudioMetricsContext* PAudioMetricsContext;
+
 class Peer {
   public:
     struct Callbacks {
@@ -59,24 +105,19 @@ class Peer {
     STATUS writeFrame(PFrame, MEDIA_STREAM_TRACK_KIND);
 
     // WebRTC Stats
-    STATUS publishStatsForCanary(RTC_STATS_TYPE);
-    STATUS publishEndToEndMetrics();
-    STATUS publishRetryCount();
+    STATUS sampleStats(UINT64);
 
   private:
     Callbacks callbacks;
     PAwsCredentialProvider pAwsCredentialProvider;
     SIGNALING_CLIENT_HANDLE signalingClientHandle;
     std::recursive_mutex mutex;
-    std::mutex countUpdateMutex;
-    std::mutex e2eLock;
     std::condition_variable_any cvar;
     std::atomic<BOOL> terminated;
     std::atomic<BOOL> iceGatheringDone;
     std::atomic<BOOL> receivedOffer;
     std::atomic<BOOL> receivedAnswer;
     std::atomic<BOOL> foundPeerId;
-    std::atomic<BOOL> recorded;
     BOOL initializedSignaling = FALSE;
     std::string peerId;
     RtcConfiguration rtcConfiguration;
@@ -85,6 +126,9 @@ class Peer {
     std::vector<PRtcRtpTransceiver> videoTransceivers;
     BOOL isMaster;
     BOOL trickleIce;
+    BOOL useTurn;
+    BOOL forceTurn;
+    std::string channelName;
     UINT64 offerReceiveTimestamp;
     BOOL firstFrame;
     BOOL useIotCredentialProvider;
@@ -94,19 +138,36 @@ class Peer {
     // metrics
     UINT64 signalingStartTime;
     UINT64 iceHolePunchingStartTime;
-    RtcStats canaryMetrics;
-    OutgoingRTPMetricsContext canaryOutgoingRTPMetricsContext;
-    IncomingRTPMetricsContext canaryIncomingRTPMetricsContext;
+    // Gathering, and with it the TURN allocation, starts with the local description
+    std::atomic<UINT64> iceGatheringStartTime{0};
+    std::atomic<BOOL> relayCandidateGathered{FALSE};
+    ConnectionTimeline timeline;
+    std::unique_ptr<DataChannelBench> dataChannelBench;
     EndToEndMetricsContext endToEndMetricsContext;
+    AudioMetricsContext audioMetricsContext;
+    BOOL audioReceived = FALSE;
+    UINT32 lastAudioSequence = 0;
+    UINT64 lastAudioCaptureTs = 0;
+    INT64 lastAudioTransit = 0;
+    FrameTracker videoFrameTracker;
+    FrameTracker audioFrameTracker;
+    std::atomic<UINT64> videoFramesGenerated;
+    std::atomic<UINT64> videoBytesGenerated;
+    StatsSnapshot prevSnapshot;
+    UINT64 lastRtpStatsTime = 0;
+    UINT64 lastEndToEndStatsTime = 0;
 
     STATUS initSignaling(const Canary::PConfig);
     STATUS initRtcConfiguration(const Canary::PConfig);
+    STATUS addTurnServers();
     STATUS initPeerConnection();
     STATUS awaitIceGathering(PRtcSessionDescriptionInit);
     STATUS handleSignalingMsg(PReceivedSignalingMessage);
     STATUS send(PSignalingMessage);
-    STATUS populateOutgoingRtpMetricsContext();
-    STATUS populateIncomingRtpMetricsContext();
+    STATUS takeStatsSnapshot(PStatsSnapshot);
+    VOID recordAudioFrame(UINT64, UINT64, UINT32);
+    VOID recordAvSync(UINT64, UINT64);
+    static VOID computeStatsRates(const StatsSnapshot&, const StatsSnapshot&, PStatsRates);
 };
 
 } // namespace Canary
@@ -0,0 +1,248 @@
+#include "Include.h"
+
+#include <fstream>
+#include <dirent.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/resource.h>
+
+namespace Canary {
+
+// utime and stime out of a /proc stat line, the name in parentheses can hold spaces so fields are counted after it
+static BOOL parseStatLine(const std::string& line, std::string* pName, UINT64* pTicks)
+{
+    size_t open = line.find('('), close = line.rfind(')');
+    std::string field;
+    UINT64 utime, stime;
+    UINT32 i;
+
+    if (open == std::string::npos || close == std::string::npos || close < open) {
+        return FALSE;
+    }
+
+    if (pName != NULL) {
+        *pName = line.substr(open + 1, close - open - 1);
+    }
+
+    // State is field 3, utime and stime are fields 14 and 15
+    std::istringstream fields(line.substr(close + 1));
+    for (i = 3; i < 14; i++) {
+        fields >> field;
+    }
+
+    if (!(fields >> utime >> stime)) {
+        return FALSE;
+    }
+
+    *pTicks = utime + stime;
+    return TRUE;
+}
+
+ResourceSampler::~ResourceSampler()
+{
+    this->stop();
+}
+
+STATUS ResourceSampler::start(TIMER_QUEUE_HANDLE timerQueueHandle, UINT64 units, PCHAR unitName)
+{
+    STATUS retStatus = STATUS_SUCCESS;
+    std::ifstream comm("/proc/self/comm");
+
+    CHK(IS_VALID_TIMER_QUEUE_HANDLE(timerQueueHandle) && unitName != NULL, STATUS_NULL_ARG);
+    CHK(!IS_VALID_TIMER_QUEUE_HANDLE(this->timerQueueHandle), STATUS_INVALID_OPERATION);
+
+    // Threads inherit the name of the process, the ones still carrying it were never named
+    CHK_ERR(std::getline(comm, this->processName), STATUS_OPEN_FILE_FAILED, "Failed to read /proc/self/comm");
+    this->units = units;
+    this->unitName = unitName;
+
+    // The first sample is only a baseline
+    CHK_STATUS(this->sample(GETTIME()));
+
+    CHK_STATUS(timerQueueAddTimer(timerQueueHandle, RESOURCE_SAMPLER_PERIOD, RESOURCE_SAMPLER_PERIOD, ResourceSampler::onTick, (UINT64) this,
+                                  &this->timerId));
+    this->timerQueueHandle = timerQueueHandle;
+
+CleanUp:
+
+    return retStatus;
+}
+
+VOID ResourceSampler::stop()
+{
+    if (IS_VALID_TIMER_QUEUE_HANDLE(this->timerQueueHandle)) {
+        timerQueueCancelTimer(this->timerQueueHandle, this->timerId, (UINT64) this);
+        this->timerQueueHandle = INVALID_TIMER_QUEUE_HANDLE_VALUE;
+    }
+}
+
+VOID ResourceSampler::nameThread(PCHAR name)
+{
+    static thread_local BOOL named = FALSE;
+
+    if (!named) {
+        named = TRUE;
+        pthread_setname_np(pthread_self(), name);
+    }
+}
+
+STATUS ResourceSampler::sampleUsage(PResourceUsage pUsage)
+{
+    STATUS retStatus = STATUS_SUCCESS;
+    std::ifstream statm("/proc/self/statm"), status("/proc/self/status");
+    std::string line;
+    UINT64 size, resident;
+    DIR* pDir = NULL;
+    struct dirent* pEntry;
+
+    CHK(pUsage != NULL, STATUS_NULL_ARG);
+    MEMSET(pUsage, 0x00, SIZEOF(ResourceUsage));
+
+    pUsage->heap = getInstrumentedTotalAllocationSize();
+
+    CHK_ERR(statm >> size >> resident, STATUS_OPEN_FILE_FAILED, "Failed to read /proc/self/statm");
+    pUsage->rss = resident * (UINT64) sysconf(_SC_PAGESIZE);
+
+    while (std::getline(status, line)) {
+        if (line.compare(0, STRLEN("Threads:"), "Threads:") == 0) {
+            std::istringstream(line.substr(STRLEN("Threads:"))) >> pUsage->threads;
+        }
+    }
+
+    CHK_ERR((pDir = opendir("/proc/self/fd")) != NULL, STATUS_OPEN_FILE_FAILED, "Failed to open /proc/self/fd");
+    while ((pEntry = readdir(pDir)) != NULL) {
+        if (pEntry->d_name[0] != '.') {
+            pUsage->fds++;
+        }
+    }
+
+    // One of them belongs to the directory stream that is reading them
+    pUsage->fds = pUsage->fds == 0 ? 0 : pUsage->fds - 1;
+
+CleanUp:
+
+    if (pDir != NULL) {
+        closedir(pDir);
+    }
+
+    return retStatus;
+}
+
+STATUS ResourceSampler::readCounters(Counters* pCounters)
+{
+    STATUS retStatus = STATUS_SUCCESS;
+    std::ifstream stat("/proc/self/stat");
+    std::string line;
+    struct rusage usage;
+
+    CHK_ERR(std::getline(stat, line) && parseStatLine(line, NULL, &pCounters->cpuTicks), STATUS_OPEN_FILE_FAILED,
+            "Failed to read /proc/self/stat");
+
+    // The switches in /proc/self/status only cover the main thread, getrusage sums up every thread the process ever had
+    CHK_ERR(getrusage(RUSAGE_SELF, &usage) == 0, STATUS_INTERNAL_ERROR, "getrusage failed with errno %d", errno);
+    pCounters->voluntarySwitches = (UINT64) usage.ru_nvcsw;
+    pCounters->involuntarySwitches = (UINT64) usage.ru_nivcsw;
+
+CleanUp:
+
+    return retStatus;
+}
+
+STATUS ResourceSampler::readThreads(std::map<UINT64, std::pair<std::string, UINT64>>* pThreads)
+{
+    STATUS retStatus = STATUS_SUCCESS;
+    DIR* pDir = NULL;
+    struct dirent* pEntry;
+    std::string line, name;
+    UINT64 tid, ticks;
+
+    pThreads->clear();
+
+    CHK_ERR((pDir = opendir("/proc/self/task")) != NULL, STATUS_OPEN_FILE_FAILED, "Failed to open /proc/self/task");
+    while ((pEntry = readdir(pDir)) != NULL) {
+        if (pEntry->d_name[0] == '.' || STATUS_FAILED(STRTOUI64(pEntry->d_name, NULL, 10, &tid))) {
+            continue;
+        }
+
+        // A thread that exited in the meantime is simply skipped
+        std::ifstream stat(std::string("/proc/self/task/") + pEntry->d_name + "/stat");
+        if (std::getline(stat, line) && parseStatLine(line, &name, &ticks)) {
+            (*pThreads)[tid] = std::make_pair(name, ticks);
+        }
+    }
+
+CleanUp:
+
+    if (pDir != NULL) {
+        closedir(pDir);
+    }
+
+    return retStatus;
+}
+
+STATUS ResourceSampler::sample(UINT64 now)
+{
+    STATUS retStatus = STATUS_SUCCESS;
+    Counters counters;
+    ResourceStats stats;
+    std::map<UINT64, std::pair<std::string, UINT64>> threads;
+    DOUBLE seconds, ticksToPercent;
+    UINT64 previous;
+    BOOL baseline = this->lastSampleTime == 0;
+
+    CHK_STATUS(readCounters(&counters));
+    CHK_STATUS(readThreads(&threads));
+    CHK_STATUS(sampleUsage(&stats.usage));
+
+    if (!baseline && now > this->lastSampleTime) {
+        seconds = (DOUBLE) (now - this->lastSampleTime) / HUNDREDS_OF_NANOS_IN_A_SECOND;
+        ticksToPercent = 100.0 / ((DOUBLE) sysconf(_SC_CLK_TCK) * seconds);
+
+        stats.cpu = (counters.cpuTicks - this->lastCounters.cpuTicks) * ticksToPercent;
+        stats.cpuPerUnit = this->units == 0 ? 0 : stats.cpu / this->units;
+        stats.voluntarySwitches = (counters.voluntarySwitches - this->lastCounters.voluntarySwitches) / seconds;
+        stats.involuntarySwitches = (counters.involuntarySwitches - this->lastCounters.involuntarySwitches) / seconds;
+
+        // Threads that started during the period have all of their CPU in it, the ones that exited lose their last part
+        for (auto& thread : threads) {
+            auto it = this->lastThreadTicks.find(thread.first);
+            previous = it == this->lastThreadTicks.end() ? 0 : MIN(it->second, thread.second.second);
+            const std::string& name = thread.second.first == this->processName ? RESOURCE_SAMPLER_OTHER_THREADS : thread.second.first;
+            stats.threadCpu[name] += (thread.second.second - previous) * ticksToPercent;
+        }
+
+        DLOGI("Process CPU %.1lf%% (%.1lf%% per %s), RSS %lu KB, %lu threads, %lu fds, %.0lf voluntary and %.0lf involuntary context switches per second",
+              stats.cpu, stats.cpuPerUnit, this->unitName.c_str(), stats.usage.rss / 1024, stats.usage.threads, stats.usage.fds,
+              stats.voluntarySwitches, stats.involuntarySwitches);
+        Cloudwatch::getInstance().monitoring.pushResourceStats(stats, this->units == 0 ? NULL : (PCHAR) this->unitName.c_str());
+    }
+
+    this->lastSampleTime = now;
+    this->lastCounters = counters;
+    this->lastThreadTicks.clear();
+    for (auto& thread : threads) {
+        this->lastThreadTicks[thread.first] = thread.second.second;
+    }
+
+CleanUp:
+
+    return retStatus;
+}
+
+STATUS ResourceSampler::onTick(UINT32 timerId, UINT64 currentTime, UINT64 customData)
+{
+    UNUSED_PARAM(timerId);
+    ResourceSampler* pSampler = (ResourceSampler*) customData;
+
+    if (pSampler == NULL) {
+        return STATUS_TIMER_QUEUE_STOP_SCHEDULING;
+    }
+
+    nameThread((PCHAR) RESOURCE_SAMPLER_THREAD_TIMER);
+    // A failed read only costs this period, the next one compares against the last good sample
+    CHK_LOG_ERR(pSampler->sample(currentTime));
+
+    return STATUS_SUCCESS;
+}
+
+} // namespace Canary
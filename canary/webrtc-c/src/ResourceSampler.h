@@ -0,0 +1,69 @@
+#pragma once
+
+namespace Canary {
+
+// Process wide resource usage. Heap only covers what went through the PIC allocators, it stays 0 unless they are instrumented
+typedef struct {
+    UINT64 rss;
+    UINT64 heap;
+    UINT64 fds;
+    UINT64 threads;
+} ResourceUsage;
+typedef ResourceUsage* PResourceUsage;
+
+// What the process cost over one sampler period. CPU is in percent of one core
+struct ResourceStats {
+    ResourceUsage usage;
+    DOUBLE cpu = 0;
+    // Process CPU divided by the streams or viewers the canary runs, 0 when it runs none
+    DOUBLE cpuPerUnit = 0;
+    DOUBLE voluntarySwitches = 0;
+    DOUBLE involuntarySwitches = 0;
+    // Thread name to CPU, threads the canary didn't name are under RESOURCE_SAMPLER_OTHER_THREADS
+    std::map<std::string, DOUBLE> threadCpu;
+};
+typedef ResourceStats* PResourceStats;
+
+/*
+ * Samples CPU, memory, threads, file descriptors and context switches of the whole process from /proc every
+ * RESOURCE_SAMPLER_PERIOD on the canary timer queue. CPU is also split by thread name: the canary names the threads its
+ * work runs on the first time it runs there (see nameThread), so SDK threads it doesn't own still end up under the role
+ * they play, e.g. the thread delivering frames becomes RESOURCE_SAMPLER_THREAD_RECEIVE. A thread that plays more than one
+ * role keeps the name of the first one. Process CPU is also divided by the number of streams or viewers the canary runs,
+ * which is what capacity planning works with.
+ */
+class ResourceSampler {
+  public:
+    ~ResourceSampler();
+    STATUS start(TIMER_QUEUE_HANDLE, UINT64, PCHAR);
+    VOID stop();
+
+    static STATUS sampleUsage(PResourceUsage);
+    static VOID nameThread(PCHAR);
+
+  private:
+    typedef struct {
+        UINT64 cpuTicks;
+        UINT64 voluntarySwitches;
+        UINT64 involuntarySwitches;
+    } Counters;
+
+    STATUS sample(UINT64);
+    static STATUS readCounters(Counters*);
+    static STATUS readThreads(std::map<UINT64, std::pair<std::string, UINT64>>*);
+    static STATUS onTick(UINT32, UINT64, UINT64);
+
+    TIMER_QUEUE_HANDLE timerQueueHandle = INVALID_TIMER_QUEUE_HANDLE_VALUE;
+    UINT32 timerId = MAX_UINT32;
+    UINT64 units = 0;
+    std::string unitName;
+    std::string processName;
+
+    // Only touched from the timer callback
+    UINT64 lastSampleTime = 0;
+    Counters lastCounters;
+    // Thread id to CPU ticks at the last sample
+    std::map<UINT64, UINT64> lastThreadTicks;
+};
+
+} // namespace Canary
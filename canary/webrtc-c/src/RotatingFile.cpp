@@ -0,0 +1,70 @@
+#include "Include.h"
+
+namespace Canary {
+
+RotatingFile::RotatingFile(PCHAR pathFormat, UINT64 maxFileSize, UINT32 maxFileCount)
+    : pathFormat(pathFormat), maxFileSize(maxFileSize), maxFileCount(maxFileCount)
+{
+}
+
+RotatingFile::~RotatingFile()
+{
+    this->close();
+}
+
+VOID RotatingFile::setPrefix(const string& prefix)
+{
+    this->prefix = prefix;
+}
+
+VOID RotatingFile::write(const string& data)
+{
+    // Open the first file lazily, if that or a later rotation fails the file stays off
+    if (this->pFile == nullptr && this->fileIndex == 0) {
+        this->rotate();
+    }
+
+    if (this->pFile == nullptr) {
+        return;
+    }
+
+    fwrite(data.data(), 1, data.size(), this->pFile);
+    fflush(this->pFile);
+    this->fileSize += data.size();
+
+    if (this->fileSize >= this->maxFileSize) {
+        this->rotate();
+    }
+}
+
+VOID RotatingFile::close()
+{
+    if (this->pFile != nullptr) {
+        fclose(this->pFile);
+        this->pFile = nullptr;
+    }
+}
+
+VOID RotatingFile::rotate()
+{
+    CHAR filePath[MAX_PATH_LEN + 1];
+
+    this->close();
+
+    if (this->fileIndex >= this->maxFileCount) {
+        SNPRINTF(filePath, MAX_PATH_LEN, this->pathFormat, this->prefix.c_str(), this->fileIndex - this->maxFileCount);
+        remove(filePath);
+    }
+
+    SNPRINTF(filePath, MAX_PATH_LEN, this->pathFormat, this->prefix.c_str(), this->fileIndex);
+    this->pFile = fopen(filePath, "w");
+    if (this->pFile == nullptr) {
+        // Need to use printf since the logger might be writing through this very file
+        printf("Failed to open %s\n", filePath);
+    }
+
+    this->fileIndex++;
+    this->fileSize = 0;
+}
+
+} // namespace Canary
@@ -0,0 +1,29 @@
+#pragma once
+
+namespace Canary {
+
+/*
+ * Size based rotating file, "<prefix>" is formatted into pathFormat together with a running index. Only the
+ * latest maxFileCount files are kept. Not thread safe, callers serialize writes.
+ */
+class RotatingFile {
+  public:
+    RotatingFile(PCHAR, UINT64, UINT32);
+    ~RotatingFile();
+    VOID setPrefix(const string&);
+    VOID write(const string&);
+    VOID close();
+
+  private:
+    VOID rotate();
+
+    PCHAR pathFormat;
+    UINT64 maxFileSize;
+    UINT32 maxFileCount;
+    string prefix;
+    FILE* pFile = nullptr;
+    UINT64 fileSize = 0;
+    UINT32 fileIndex = 0;
+};
+
+} // namespace Canary
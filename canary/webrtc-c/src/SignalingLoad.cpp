@@ -0,0 +1,532 @@
+#include "Include.h"
+
+namespace Canary {
+
+static std::string getErrorName(STATUS status)
+{
+    switch (status) {
+        case STATUS_SIGNALING_CANARY_OFFER_PAYLOAD_MISMATCH:
+        case STATUS_SIGNALING_CANARY_ANSWER_PAYLOAD_MISMATCH:
+            return "PayloadMismatch";
+        case STATUS_SIGNALING_CANARY_UNKNOWN_CORRELATION_ID:
+            return "Unmatched";
+        case STATUS_SIGNALING_CANARY_UNEXPECTED_MESSAGE:
+            return "UnexpectedMessage";
+        default:
+            return "AnswerFailed";
+    }
+}
+
+SignalingLoad::SignalingLoad(PConfig pConfig, PAwsCredentialProvider pCredentialProvider)
+    : pConfig(pConfig), pCredentialProvider(pCredentialProvider)
+{
+}
+
+SignalingLoad::~SignalingLoad()
+{
+    this->stop();
+}
+
+STATUS SignalingLoad::init(const std::string& channelName, BOOL deleteChannels)
+{
+    STATUS retStatus = STATUS_SUCCESS;
+    UINT64 channelCount = this->pConfig->signalingLoadChannelCount.value;
+    UINT64 viewerCount = this->pConfig->signalingLoadViewerCount.value;
+    std::vector<std::thread> threads;
+    std::vector<STATUS> statuses(channelCount, STATUS_SUCCESS);
+    UINT32 i;
+
+    CHK(channelCount != 0 && viewerCount != 0 && this->pConfig->signalingLoadOfferRate.value != 0, STATUS_INVALID_ARG);
+
+    this->deleteChannels = deleteChannels;
+    if (!this->pConfig->endpoint.value.empty()) {
+        this->controlPlaneUrl = std::string(CONTROL_PLANE_URI_PREFIX) + this->pConfig->endpoint.value;
+    }
+    this->viewerOfferRate = (DOUBLE) this->pConfig->signalingLoadOfferRate.value / (channelCount * viewerCount);
+
+    for (i = 0; i < channelCount; i++) {
+        this->channels.emplace_back(new Channel());
+        this->channels.back()->name = channelCount == 1 ? channelName : channelName + "_" + std::to_string(i);
+    }
+
+    // Channels come up in parallel, the clients within a channel one after the other
+    for (i = 0; i < channelCount; i++) {
+        threads.emplace_back([this, i, &statuses] { statuses[i] = this->initChannel(this->channels[i].get()); });
+    }
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    for (auto status : statuses) {
+        CHK_STATUS(status);
+    }
+
+CleanUp:
+
+    return retStatus;
+}
+
+STATUS SignalingLoad::initChannel(Channel* pChannel)
+{
+    STATUS retStatus = STATUS_SUCCESS;
+    UINT32 i;
+
+    pChannel->master.reset(new Client());
+    CHK_STATUS(this->initClient(pChannel, pChannel->master.get(), TRUE, 0));
+
+    for (i = 0; i < this->pConfig->signalingLoadViewerCount.value; i++) {
+        pChannel->viewers.emplace_back(new Client());
+        CHK_STATUS(this->initClient(pChannel, pChannel->viewers.back().get(), FALSE, i));
+    }
+
+    DLOGD("Channel %s is up with %u viewers", pChannel->name.c_str(), (UINT32) pChannel->viewers.size());
+
+CleanUp:
+
+    CHK_LOG_ERR(retStatus);
+
+    return retStatus;
+}
+
+STATUS SignalingLoad::initClient(Channel* pChannel, Client* pClient, BOOL isMaster, UINT32 index)
+{
+    STATUS retStatus = STATUS_SUCCESS;
+
+    pClient->pLoad = this;
+    pClient->isMaster = isMaster;
+
+    pClient->channelInfo.version = CHANNEL_INFO_CURRENT_VERSION;
+    pClient->channelInfo.pChannelName = (PCHAR) pChannel->name.c_str();
+    if (!this->controlPlaneUrl.empty()) {
+        pClient->channelInfo.pControlPlaneUrl = (PCHAR) this->controlPlaneUrl.c_str();
+    }
+    pClient->channelInfo.pRegion = (PCHAR) this->pConfig->region.value.c_str();
+    pClient->channelInfo.pKmsKeyId = NULL;
+    pClient->channelInfo.tagCount = 0;
+    pClient->channelInfo.pTags = NULL;
+    pClient->channelInfo.channelType = SIGNALING_CHANNEL_TYPE_SINGLE_MASTER;
+    pClient->channelInfo.channelRoleType = isMaster ? SIGNALING_CHANNEL_ROLE_TYPE_MASTER : SIGNALING_CHANNEL_ROLE_TYPE_VIEWER;
+    // Every client resolves the channel and its endpoint on its own, the same as real viewers joining at once would
+    pClient->channelInfo.cachingPolicy = SIGNALING_API_CALL_CACHE_TYPE_NONE;
+    pClient->channelInfo.cachingPeriod = SIGNALING_API_CALL_CACHE_TTL_SENTINEL_VALUE;
+    pClient->channelInfo.asyncIceServerConfig = FALSE;
+    pClient->channelInfo.retry = TRUE;
+    pClient->channelInfo.reconnect = TRUE;
+    pClient->channelInfo.pCertPath = (PCHAR) this->pConfig->caCertPath.value.c_str();
+    pClient->channelInfo.messageTtl = 0; // Default is 60 seconds
+
+    pClient->callbacks.version = SIGNALING_CLIENT_CALLBACKS_CURRENT_VERSION;
+    pClient->callbacks.errorReportFn = SignalingLoad::onError;
+    pClient->callbacks.stateChangeFn = SignalingLoad::onStateChanged;
+    pClient->callbacks.messageReceivedFn = SignalingLoad::onMessage;
+    pClient->callbacks.customData = (UINT64) pClient;
+
+    pClient->clientInfo.version = SIGNALING_CLIENT_INFO_CURRENT_VERSION;
+    pClient->clientInfo.loggingLevel = this->pConfig->logLevel.value;
+    if (isMaster) {
+        STRCPY(pClient->clientInfo.clientId, SIGNALING_CANARY_MASTER_CLIENT_ID);
+    } else {
+        SNPRINTF(pClient->clientInfo.clientId, MAX_SIGNALING_CLIENT_ID_LEN, "%s_%u", SIGNALING_CANARY_VIEWER_CLIENT_ID, index);
+    }
+
+    CHK_STATUS(createSignalingClientSync(&pClient->clientInfo, &pClient->channelInfo, &pClient->callbacks, this->pCredentialProvider,
+                                         &pClient->handle));
+    CHK_STATUS(signalingClientFetchSync(pClient->handle));
+    CHK_STATUS(signalingClientConnectSync(pClient->handle));
+
+CleanUp:
+
+    return retStatus;
+}
+
+VOID SignalingLoad::freeClient(Client* pClient)
+{
+    if (pClient != NULL && IS_VALID_SIGNALING_CLIENT_HANDLE(pClient->handle)) {
+        freeSignalingClient(&pClient->handle);
+    }
+}
+
+STATUS SignalingLoad::start(TIMER_QUEUE_HANDLE timerQueueHandle)
+{
+    STATUS retStatus = STATUS_SUCCESS;
+    UINT64 now = GETTIME();
+
+    CHK(IS_VALID_TIMER_QUEUE_HANDLE(timerQueueHandle) && !this->channels.empty(), STATUS_INVALID_OPERATION);
+
+    {
+        std::lock_guard<std::mutex> lock(this->statsMutex);
+        this->period.start = now;
+        this->total.start = now;
+    }
+
+    CHK_STATUS(timerQueueAddTimer(timerQueueHandle, SIGNALING_LOAD_TICK_PERIOD, SIGNALING_LOAD_TICK_PERIOD, SignalingLoad::onTick, (UINT64) this,
+                                  &this->tickTimerId));
+    this->timerQueueHandle = timerQueueHandle;
+
+    for (auto& pChannel : this->channels) {
+        for (auto& pViewer : pChannel->viewers) {
+            pViewer->sender = std::thread(&SignalingLoad::sendOffers, this, pViewer.get());
+        }
+    }
+
+    DLOGI("Signaling load started with %lu channels of %lu viewers at %lu offers per second", this->pConfig->signalingLoadChannelCount.value,
+          this->pConfig->signalingLoadViewerCount.value, this->pConfig->signalingLoadOfferRate.value);
+
+CleanUp:
+
+    return retStatus;
+}
+
+VOID SignalingLoad::stop()
+{
+    UINT64 deadline;
+
+    {
+        std::lock_guard<std::mutex> lock(this->stopMutex);
+        this->terminated = true;
+    }
+    this->stopCvar.notify_all();
+
+    for (auto& pChannel : this->channels) {
+        for (auto& pViewer : pChannel->viewers) {
+            if (pViewer->sender.joinable()) {
+                pViewer->sender.join();
+            }
+        }
+    }
+
+    if (IS_VALID_TIMER_QUEUE_HANDLE(this->timerQueueHandle)) {
+        timerQueueCancelTimer(this->timerQueueHandle, this->tickTimerId, (UINT64) this);
+        this->timerQueueHandle = INVALID_TIMER_QUEUE_HANDLE_VALUE;
+
+        // Give the offers in flight one roundtrip timeout to be answered before counting them as timed out
+        deadline = GETTIME() + SIGNALING_CANARY_ROUNDTRIP_TIMEOUT;
+        while (this->countOutstanding() != 0 && GETTIME() < deadline) {
+            THREAD_SLEEP(SIGNALING_LOAD_DRAIN_CHECK_PERIOD);
+        }
+
+        this->expireOffers(GETTIME(), TRUE);
+        this->report(FALSE);
+        this->report(TRUE);
+    }
+
+    for (auto& pChannel : this->channels) {
+        for (auto& pViewer : pChannel->viewers) {
+            this->freeClient(pViewer.get());
+        }
+
+        // Generated channels are deleted so the account doesn't keep accumulating them
+        if (this->deleteChannels && pChannel->master != nullptr && IS_VALID_SIGNALING_CLIENT_HANDLE(pChannel->master->handle)) {
+            signalingClientDeleteSync(pChannel->master->handle);
+        }
+
+        this->freeClient(pChannel->master.get());
+    }
+
+    this->channels.clear();
+}
+
+VOID SignalingLoad::sendOffers(Client* pClient)
+{
+    STATUS retStatus;
+    SignalingMessage message;
+    std::mt19937_64 generator(std::random_device{}());
+    std::exponential_distribution<DOUBLE> interval(this->viewerOfferRate);
+    UINT64 scheduled = GETTIME(), now, correlationId;
+
+    while (!this->terminated) {
+        scheduled += (UINT64) (interval(generator) * HUNDREDS_OF_NANOS_IN_A_SECOND);
+
+        // Offers that are already late go out right away. Their latency still counts from the scheduled time
+        now = GETTIME();
+        if (scheduled > now) {
+            std::unique_lock<std::mutex> lock(this->stopMutex);
+            if (this->stopCvar.wait_for(lock, std::chrono::nanoseconds((scheduled - now) * DEFAULT_TIME_UNIT_IN_NANOS),
+                                        [this] { return this->terminated.load(); })) {
+                break;
+            }
+        }
+
+        correlationId = pClient->nextCorrelationId++;
+        {
+            std::lock_guard<std::mutex> lock(pClient->mutex);
+            pClient->outstanding[correlationId] = scheduled;
+        }
+        this->recordOffer();
+
+        MEMSET(&message, 0x00, SIZEOF(SignalingMessage));
+        message.version = SIGNALING_MESSAGE_CURRENT_VERSION;
+        message.messageType = SIGNALING_MESSAGE_TYPE_OFFER;
+        STRCPY(message.peerClientId, SIGNALING_CANARY_MASTER_CLIENT_ID);
+        SNPRINTF(message.payload, MAX_SIGNALING_MESSAGE_LEN, "%s %lu", SIGNALING_CANARY_OFFER, correlationId);
+        SNPRINTF(message.correlationId, MAX_CORRELATION_ID_LEN, "%lu", correlationId);
+        message.payloadLen = 0; // Will calculate it
+
+        if (STATUS_FAILED(retStatus = signalingClientSendMessageSync(pClient->handle, &message))) {
+            DLOGW("Viewer %s failed to send offer %lu with 0x%08x", pClient->clientInfo.clientId, correlationId, retStatus);
+            {
+                std::lock_guard<std::mutex> lock(pClient->mutex);
+                pClient->outstanding.erase(correlationId);
+            }
+            this->recordError("SendFailed");
+        }
+    }
+}
+
+STATUS SignalingLoad::answerOffer(Client* pClient, PReceivedSignalingMessage pReceivedSignalingMessage)
+{
+    STATUS retStatus = STATUS_SUCCESS;
+    SignalingMessage message;
+    PCHAR pPayload = pReceivedSignalingMessage->signalingMessage.payload;
+    UINT32 prefixLen = STRLEN(SIGNALING_CANARY_OFFER);
+
+    CHK(0 == STRNCMP(pPayload, SIGNALING_CANARY_OFFER, prefixLen) && pPayload[prefixLen] == ' ', STATUS_SIGNALING_CANARY_OFFER_PAYLOAD_MISMATCH);
+
+    // Answer whichever viewer sent the offer and echo its correlation id back
+    MEMSET(&message, 0x00, SIZEOF(SignalingMessage));
+    message.version = SIGNALING_MESSAGE_CURRENT_VERSION;
+    message.messageType = SIGNALING_MESSAGE_TYPE_ANSWER;
+    STRNCPY(message.peerClientId, pReceivedSignalingMessage->signalingMessage.peerClientId, MAX_SIGNALING_CLIENT_ID_LEN);
+    SNPRINTF(message.payload, MAX_SIGNALING_MESSAGE_LEN, "%s%s", SIGNALING_CANARY_ANSWER, pPayload + prefixLen);
+    STRNCPY(message.correlationId, pReceivedSignalingMessage->signalingMessage.correlationId, MAX_CORRELATION_ID_LEN);
+    message.payloadLen = 0; // Will calculate it
+
+    CHK_STATUS(signalingClientSendMessageSync(pClient->handle, &message));
+
+CleanUp:
+
+    return retStatus;
+}
+
+STATUS SignalingLoad::receiveAnswer(Client* pClient, PReceivedSignalingMessage pReceivedSignalingMessage)
+{
+    STATUS retStatus = STATUS_SUCCESS;
+    PCHAR pPayload = pReceivedSignalingMessage->signalingMessage.payload;
+    UINT32 prefixLen = STRLEN(SIGNALING_CANARY_ANSWER);
+    UINT64 now = GETTIME(), correlationId, scheduled = 0;
+    BOOL found = FALSE;
+
+    CHK(0 == STRNCMP(pPayload, SIGNALING_CANARY_ANSWER, prefixLen) && pPayload[prefixLen] == ' ' &&
+            STATUS_SUCCEEDED(STRTOUI64(pPayload + prefixLen + 1, NULL, 10, &correlationId)),
+        STATUS_SIGNALING_CANARY_ANSWER_PAYLOAD_MISMATCH);
+
+    {
+        std::lock_guard<std::mutex> lock(pClient->mutex);
+        auto it = pClient->outstanding.find(correlationId);
+        if (it != pClient->outstanding.end()) {
+            scheduled = it->second;
+            pClient->outstanding.erase(it);
+            found = TRUE;
+        }
+    }
+
+    // Either a duplicate or an answer to an offer that has already timed out
+    CHK(found, STATUS_SIGNALING_CANARY_UNKNOWN_CORRELATION_ID);
+
+    this->recordLatency((now - scheduled) / HUNDREDS_OF_NANOS_IN_A_MILLISECOND);
+
+CleanUp:
+
+    return retStatus;
+}
+
+VOID SignalingLoad::expireOffers(UINT64 now, BOOL all)
+{
+    UINT64 expired = 0;
+
+    for (auto& pChannel : this->channels) {
+        for (auto& pViewer : pChannel->viewers) {
+            std::lock_guard<std::mutex> lock(pViewer->mutex);
+            auto& outstanding = pViewer->outstanding;
+
+            // Correlation ids grow with the scheduled time, so the oldest offers are always at the front
+            while (!outstanding.empty() && (all || outstanding.begin()->second + SIGNALING_CANARY_ROUNDTRIP_TIMEOUT <= now)) {
+                outstanding.erase(outstanding.begin());
+                expired++;
+            }
+        }
+    }
+
+    if (expired != 0) {
+        this->recordError("Timeout", expired);
+    }
+}
+
+UINT64 SignalingLoad::countOutstanding()
+{
+    UINT64 count = 0;
+
+    for (auto& pChannel : this->channels) {
+        for (auto& pViewer : pChannel->viewers) {
+            std::lock_guard<std::mutex> lock(pViewer->mutex);
+            count += pViewer->outstanding.size();
+        }
+    }
+
+    return count;
+}
+
+VOID SignalingLoad::recordOffer()
+{
+    std::lock_guard<std::mutex> lock(this->statsMutex);
+    this->period.offers++;
+    this->total.offers++;
+}
+
+VOID SignalingLoad::recordLatency(UINT64 latency)
+{
+    std::lock_guard<std::mutex> lock(this->statsMutex);
+    this->period.answers++;
+    this->total.answers++;
+    this->period.latencies[latency]++;
+    this->total.latencies[latency]++;
+}
+
+VOID SignalingLoad::recordError(const std::string& name, UINT64 count)
+{
+    std::lock_guard<std::mutex> lock(this->statsMutex);
+    this->period.errors[name] += count;
+    this->total.errors[name] += count;
+}
+
+VOID SignalingLoad::report(BOOL final)
+{
+    Window window;
+    UINT64 now = GETTIME(), count = 0, outstanding = this->countOutstanding();
+    DOUBLE seconds;
+    std::stringstream errors;
+
+    {
+        std::lock_guard<std::mutex> lock(this->statsMutex);
+        if (final) {
+            window = this->total;
+        } else {
+            window = std::move(this->period);
+            this->period = Window();
+            this->period.start = now;
+        }
+    }
+
+    seconds = MAX((DOUBLE) (now - window.start) / HUNDREDS_OF_NANOS_IN_A_SECOND, 1.0);
+    for (auto& bucket : window.latencies) {
+        count += bucket.second;
+    }
+    for (auto& error : window.errors) {
+        errors << ' ' << error.first << '=' << error.second;
+    }
+
+    DLOGI("%s signaling load: %.1f offers/s, %.1f answers/s, %lu outstanding, roundtrip p50 %lu ms, p90 %lu ms, p99 %lu ms, p99.9 %lu ms, "
+          "max %lu ms, errors:%s",
+          final ? "Total" : "Period", window.offers / seconds, window.answers / seconds, outstanding, percentile(window.latencies, count, 0.5),
+          percentile(window.latencies, count, 0.9), percentile(window.latencies, count, 0.99), percentile(window.latencies, count, 0.999),
+          window.latencies.empty() ? 0 : window.latencies.rbegin()->first, window.errors.empty() ? " none" : errors.str().c_str());
+
+    // Every period is published on its own, the total would count the same samples twice
+    if (!final) {
+        auto& monitoring = Cloudwatch::getInstance().monitoring;
+        monitoring.pushSignalingRoundtripLatencies(window.latencies);
+        monitoring.pushSignalingLoadThroughput(window.offers / seconds, window.answers / seconds, outstanding);
+        for (auto& error : window.errors) {
+            monitoring.pushSignalingRoundtripErrors(error.first, error.second);
+        }
+    }
+}
+
+STATUS SignalingLoad::onStateChanged(UINT64 customData, SIGNALING_CLIENT_STATE state)
+{
+    Client* pClient = (Client*) customData;
+    PCHAR pStateStr;
+
+    signalingClientGetStateString(state, &pStateStr);
+
+    DLOGD("Signaling client %s on %s changed state to %d - '%s'", pClient->clientInfo.clientId, pClient->channelInfo.pChannelName, state, pStateStr);
+
+    return STATUS_SUCCESS;
+}
+
+STATUS SignalingLoad::onError(UINT64 customData, STATUS status, PCHAR msg, UINT32 msgLen)
+{
+    Client* pClient = (Client*) customData;
+    std::string raw(msg == NULL ? "" : std::string(msg, msgLen)), id;
+    size_t start, end;
+    UINT64 correlationId;
+    BOOL found = FALSE;
+
+    DLOGW("Signaling client %s generated an error 0x%08x - '%.*s'", pClient->clientInfo.clientId, status, msgLen, msg);
+
+    // Offers the service failed to deliver come back as a status response that carries the offer correlation id
+    if (!pClient->isMaster && (start = raw.find(SIGNALING_LOAD_CORRELATION_ID_KEY)) != std::string::npos) {
+        start += STRLEN(SIGNALING_LOAD_CORRELATION_ID_KEY);
+        end = raw.find('"', start);
+        id = raw.substr(start, end == std::string::npos ? std::string::npos : end - start);
+        if (STATUS_SUCCEEDED(STRTOUI64((PCHAR) id.c_str(), NULL, 10, &correlationId))) {
+            std::lock_guard<std::mutex> lock(pClient->mutex);
+            found = pClient->outstanding.erase(correlationId) != 0;
+        }
+    }
+
+    // Load mode keeps running on client errors, they only show up in the error breakdown
+    pClient->pLoad->recordError(found ? "DeliveryFailed" : "ClientError");
+
+    return STATUS_SUCCESS;
+}
+
+STATUS SignalingLoad::onMessage(UINT64 customData, PReceivedSignalingMessage pReceivedSignalingMessage)
+{
+    STATUS retStatus = STATUS_SUCCESS;
+    Client* pClient = (Client*) customData;
+
+    CHK(pClient != NULL, STATUS_INTERNAL_ERROR);
+    ResourceSampler::nameThread((PCHAR) RESOURCE_SAMPLER_THREAD_SIGNALING);
+
+    switch (pReceivedSignalingMessage->signalingMessage.messageType) {
+        case SIGNALING_MESSAGE_TYPE_OFFER:
+            CHK(pClient->isMaster, STATUS_SIGNALING_CANARY_UNEXPECTED_MESSAGE);
+            CHK_STATUS(pClient->pLoad->answerOffer(pClient, pReceivedSignalingMessage));
+            break;
+
+        case SIGNALING_MESSAGE_TYPE_ANSWER:
+            CHK(!pClient->isMaster, STATUS_SIGNALING_CANARY_UNEXPECTED_MESSAGE);
+            CHK_STATUS(pClient->pLoad->receiveAnswer(pClient, pReceivedSignalingMessage));
+            break;
+
+        default:
+            CHK_ERR(FALSE, STATUS_SIGNALING_CANARY_UNEXPECTED_MESSAGE, "Unhandled signaling message type %u",
+                    pReceivedSignalingMessage->signalingMessage.messageType);
+    }
+
+CleanUp:
+
+    if (STATUS_FAILED(retStatus) && pClient != NULL) {
+        pClient->pLoad->recordError(getErrorName(retStatus));
+    }
+
+    return retStatus;
+}
+
+STATUS SignalingLoad::onTick(UINT32 timerId, UINT64 currentTime, UINT64 customData)
+{
+    UNUSED_PARAM(timerId);
+    SignalingLoad* pLoad = (SignalingLoad*) customData;
+    UINT64 periodStart;
+
+    if (pLoad == NULL || pLoad->terminated) {
+        return STATUS_TIMER_QUEUE_STOP_SCHEDULING;
+    }
+
+    pLoad->expireOffers(currentTime, FALSE);
+
+    {
+        std::lock_guard<std::mutex> lock(pLoad->statsMutex);
+        periodStart = pLoad->period.start;
+    }
+
+    if (currentTime >= periodStart + SIGNALING_LOAD_REPORT_PERIOD) {
+        pLoad->report(FALSE);
+    }
+
+    return STATUS_SUCCESS;
+}
+
+} // namespace Canary
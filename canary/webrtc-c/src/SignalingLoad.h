@@ -0,0 +1,90 @@
+#pragma once
+
+namespace Canary {
+
+/*
+ * Signaling load mode. Every channel gets one master and a number of viewers. Each viewer sends offers as an
+ * independent Poisson process, so the aggregate offer rate is open loop and does not slow down when the service
+ * does. Offers carry a per viewer correlation id and any number of them can be outstanding at once. Latency is
+ * measured from the scheduled send time, which keeps a slow send from hiding queueing delay.
+ */
+class SignalingLoad {
+  public:
+    SignalingLoad(PConfig, PAwsCredentialProvider);
+    ~SignalingLoad();
+    STATUS init(const std::string&, BOOL);
+    STATUS start(TIMER_QUEUE_HANDLE);
+    VOID stop();
+
+  private:
+    class Client {
+      public:
+        SignalingLoad* pLoad;
+        BOOL isMaster;
+        SignalingClientInfo clientInfo;
+        ChannelInfo channelInfo;
+        SignalingClientCallbacks callbacks;
+        SIGNALING_CLIENT_HANDLE handle = INVALID_SIGNALING_CLIENT_HANDLE_VALUE;
+        std::thread sender;
+        UINT64 nextCorrelationId = 0;
+
+        // Correlation id to scheduled send time
+        std::mutex mutex;
+        std::map<UINT64, UINT64> outstanding;
+    };
+
+    class Channel {
+      public:
+        std::string name;
+        std::unique_ptr<Client> master;
+        std::vector<std::unique_ptr<Client>> viewers;
+    };
+
+    class Window {
+      public:
+        UINT64 start = 0;
+        UINT64 offers = 0;
+        UINT64 answers = 0;
+        // Roundtrip latency in milliseconds to sample count
+        std::map<UINT64, UINT64> latencies;
+        std::map<std::string, UINT64> errors;
+    };
+
+    STATUS initChannel(Channel*);
+    STATUS initClient(Channel*, Client*, BOOL, UINT32);
+    VOID freeClient(Client*);
+    VOID sendOffers(Client*);
+    STATUS answerOffer(Client*, PReceivedSignalingMessage);
+    STATUS receiveAnswer(Client*, PReceivedSignalingMessage);
+    VOID expireOffers(UINT64, BOOL);
+    UINT64 countOutstanding();
+    VOID recordOffer();
+    VOID recordLatency(UINT64);
+    VOID recordError(const std::string&, UINT64 = 1);
+    VOID report(BOOL);
+
+    static STATUS onStateChanged(UINT64, SIGNALING_CLIENT_STATE);
+    static STATUS onError(UINT64, STATUS, PCHAR, UINT32);
+    static STATUS onMessage(UINT64, PReceivedSignalingMessage);
+    static STATUS onTick(UINT32, UINT64, UINT64);
+
+    PConfig pConfig;
+    PAwsCredentialProvider pCredentialProvider;
+    BOOL deleteChannels = FALSE;
+    std::string controlPlaneUrl;
+    DOUBLE viewerOfferRate = 0;
+    std::vector<std::unique_ptr<Channel>> channels;
+
+    std::atomic<bool> terminated{false};
+    std::mutex stopMutex;
+    std::condition_variable stopCvar;
+
+    TIMER_QUEUE_HANDLE timerQueueHandle = INVALID_TIMER_QUEUE_HANDLE_VALUE;
+    UINT32 tickTimerId = MAX_UINT32;
+
+    std::mutex statsMutex;
+    Window period;
+    Window total;
+};
+
+} // namespace Canary
@@ -0,0 +1,244 @@
+#include "Include.h"
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <poll.h>
+#include <unistd.h>
+
+namespace Canary {
+
+TurnProbe& TurnProbe::getInstance()
+{
+    static TurnProbe instance;
+    return instance;
+}
+
+TurnProbe::~TurnProbe()
+{
+    if (this->worker.joinable()) {
+        this->worker.join();
+    }
+}
+
+// "turn:host:port?transport=udp" to host and port. Only plain TURN URIs that allow UDP can be probed.
+BOOL TurnProbe::parseUri(PCHAR uri, std::string& host, std::string& port, BOOL& udp)
+{
+    std::string value(uri), scheme, query;
+    SIZE_T pos;
+
+    if ((pos = value.find(':')) == std::string::npos) {
+        return FALSE;
+    }
+
+    scheme = value.substr(0, pos);
+    value = value.substr(pos + 1);
+    if ((pos = value.find('?')) != std::string::npos) {
+        query = value.substr(pos + 1);
+        value = value.substr(0, pos);
+    }
+
+    if ((pos = value.rfind(':')) != std::string::npos) {
+        host = value.substr(0, pos);
+        port = value.substr(pos + 1);
+    } else {
+        host = value;
+        port = TURN_PROBE_DEFAULT_PORT;
+    }
+
+    udp = scheme == "turn" && query.find("transport=tcp") == std::string::npos;
+
+    return !host.empty();
+}
+
+// All the URIs of one TURN server share its host
+std::string TurnProbe::getServerKey(PCHAR uri)
+{
+    std::string host, port;
+    BOOL udp;
+
+    return parseUri(uri, host, port, udp) ? host : std::string(uri);
+}
+
+VOID TurnProbe::submit(const std::vector<RtcIceServer>& servers)
+{
+    std::vector<Target> targets;
+    std::string host, port;
+    BOOL udp;
+    UINT64 now = GETTIME();
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    for (auto& server : servers) {
+        if (!parseUri((PCHAR) server.urls, host, port, udp) || !udp) {
+            continue;
+        }
+
+        auto result = this->results.find(host);
+        if (result != this->results.end() && result->second.expiration > now) {
+            continue;
+        }
+
+        if (std::none_of(targets.begin(), targets.end(), [&host](const Target& target) { return target.key == host; })) {
+            Target target;
+            target.key = host;
+            target.host = host;
+            target.port = port;
+            targets.push_back(target);
+        }
+    }
+
+    // A probe still in flight covers these servers or the next cache refresh submits them again
+    if (this->stopped || targets.empty() || this->running.exchange(true)) {
+        return;
+    }
+
+    // The previous probe is done, it clears running as the very last thing
+    if (this->worker.joinable()) {
+        this->worker.join();
+    }
+
+    this->worker = std::thread(&TurnProbe::run, this, std::move(targets));
+}
+
+// The probe thread pushes metrics, it has to be done before Cloudwatch goes away
+VOID TurnProbe::deinit()
+{
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->stopped = TRUE;
+    }
+
+    // No submit starts another probe from here on. The probe takes the lock to store its results.
+    if (this->worker.joinable()) {
+        this->worker.join();
+    }
+}
+
+UINT64 TurnProbe::getRtt(const std::string& key)
+{
+    std::lock_guard<std::mutex> lock(this->mutex);
+    auto result = this->results.find(key);
+
+    // An expired result still beats no result until the server has been probed again
+    return result == this->results.end() ? MAX_UINT64 : result->second.rtt;
+}
+
+VOID TurnProbe::run(std::vector<Target> targets)
+{
+    struct addrinfo hints, *pAddress = NULL;
+    std::vector<struct pollfd> fds;
+    BYTE request[TURN_PROBE_STUN_HEADER_LEN + 8], response[TURN_PROBE_BUFFER_SIZE];
+    UINT16 words[4];
+    UINT32 cookie, i, j, pending = 0, timeouts = 0;
+    UINT64 deadline, now;
+    INT32 received;
+    Result result;
+
+    ResourceSampler::nameThread((PCHAR) RESOURCE_SAMPLER_THREAD_TURN_PROBE);
+
+    MEMSET(&hints, 0x00, SIZEOF(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+
+    // Connected sockets only get datagrams from their own server
+    for (auto& target : targets) {
+        if (getaddrinfo(target.host.c_str(), target.port.c_str(), &hints, &pAddress) != 0) {
+            DLOGW("Failed to resolve TURN server %s", target.host.c_str());
+            continue;
+        }
+
+        target.sock = socket(pAddress->ai_family, pAddress->ai_socktype, pAddress->ai_protocol);
+        if (target.sock >= 0 && connect(target.sock, pAddress->ai_addr, pAddress->ai_addrlen) != 0) {
+            close(target.sock);
+            target.sock = -1;
+        }
+        freeaddrinfo(pAddress);
+
+        for (j = 0; j < TURN_PROBE_TRANSACTION_ID_LEN; j++) {
+            target.transactionId[j] = (BYTE) RAND();
+        }
+    }
+
+    for (auto& target : targets) {
+        struct pollfd fd;
+        fd.fd = target.sock;
+        fd.events = POLLIN;
+        fd.revents = 0;
+        fds.push_back(fd);
+        pending += target.sock >= 0 ? 1 : 0;
+    }
+
+    // Header, then REQUESTED-TRANSPORT with UDP. The transaction id goes in per server.
+    MEMSET(request, 0x00, SIZEOF(request));
+    words[0] = htons(TURN_PROBE_ALLOCATE_REQUEST);
+    words[1] = htons(8);
+    words[2] = htons(TURN_PROBE_REQUESTED_TRANSPORT);
+    words[3] = htons(4);
+    cookie = htonl(TURN_PROBE_STUN_MAGIC_COOKIE);
+    MEMCPY(request, &words[0], 2 * SIZEOF(UINT16));
+    MEMCPY(request + 4, &cookie, SIZEOF(UINT32));
+    MEMCPY(request + TURN_PROBE_STUN_HEADER_LEN, &words[2], 2 * SIZEOF(UINT16));
+    request[TURN_PROBE_STUN_HEADER_LEN + 4] = TURN_PROBE_REQUESTED_TRANSPORT_UDP;
+
+    // Every server is probed at once, a lost request or answer is covered by sending again
+    deadline = GETTIME() + TURN_PROBE_TIMEOUT;
+    while (pending != 0 && (now = GETTIME()) < deadline) {
+        for (auto& target : targets) {
+            if (target.sock >= 0 && target.rtt == MAX_UINT64 && now >= target.lastSendTime + TURN_PROBE_RETRANSMIT_PERIOD) {
+                MEMCPY(request + 8, target.transactionId, TURN_PROBE_TRANSACTION_ID_LEN);
+                send(target.sock, request, SIZEOF(request), 0);
+                target.firstSendTime = target.lastSendTime == 0 ? now : target.firstSendTime;
+                target.lastSendTime = now;
+            }
+        }
+
+        if (poll(fds.data(), fds.size(), (INT32) (TURN_PROBE_RETRANSMIT_PERIOD / HUNDREDS_OF_NANOS_IN_A_MILLISECOND)) <= 0) {
+            continue;
+        }
+
+        now = GETTIME();
+        for (i = 0; i < targets.size(); i++) {
+            if ((fds[i].revents & POLLIN) == 0) {
+                continue;
+            }
+
+            // Any answer to our transaction counts, it is the 401 challenge unless the server allows anonymous relays
+            received = recv(targets[i].sock, response, SIZEOF(response), 0);
+            if (received >= TURN_PROBE_STUN_HEADER_LEN && targets[i].rtt == MAX_UINT64 && MEMCMP(response + 4, &cookie, SIZEOF(UINT32)) == 0 &&
+                MEMCMP(response + 8, targets[i].transactionId, TURN_PROBE_TRANSACTION_ID_LEN) == 0) {
+                targets[i].rtt = now - targets[i].firstSendTime;
+                pending--;
+            }
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        for (auto& target : targets) {
+            result.rtt = target.rtt;
+            result.expiration = GETTIME() + TURN_PROBE_RESULT_TTL;
+            this->results[target.key] = result;
+        }
+    }
+
+    for (auto& target : targets) {
+        if (target.sock >= 0) {
+            close(target.sock);
+        }
+
+        if (target.rtt == MAX_UINT64) {
+            DLOGW("TURN server %s didn't answer the allocation probe", target.host.c_str());
+            timeouts++;
+        } else {
+            DLOGI("TURN server %s answered the allocation probe in %lu ms", target.host.c_str(), target.rtt / HUNDREDS_OF_NANOS_IN_A_MILLISECOND);
+            Cloudwatch::getInstance().monitoring.pushTurnProbeRtt((DOUBLE) target.rtt / HUNDREDS_OF_NANOS_IN_A_MILLISECOND);
+        }
+    }
+
+    Cloudwatch::getInstance().monitoring.pushTurnProbeTimeouts(timeouts);
+
+    this->running = false;
+}
+
+} // namespace Canary
@@ -0,0 +1,57 @@
+#pragma once
+
+namespace Canary {
+
+/*
+ * Process-wide TURN latency probe. Every TURN server handed out by signaling gets an unauthenticated Allocate request
+ * over UDP, and the time until the server answers (normally with the 401 challenge) is taken as its allocation RTT.
+ * That round trip is the first half of every real allocation, so it ranks the servers the way relayed sessions see them.
+ * A batch of servers is probed in parallel from one background thread with retransmissions. Results are cached per
+ * server host for TURN_PROBE_RESULT_TTL, so refreshed credentials for the same servers don't trigger another probe.
+ * Servers that didn't answer within TURN_PROBE_TIMEOUT, or weren't probed yet, rank last.
+ */
+class TurnProbe {
+  public:
+    TurnProbe(TurnProbe const&) = delete;
+    void operator=(TurnProbe const&) = delete;
+    ~TurnProbe();
+
+    static TurnProbe& getInstance();
+    static std::string getServerKey(PCHAR);
+    VOID submit(const std::vector<RtcIceServer>&);
+    UINT64 getRtt(const std::string&);
+    VOID deinit();
+
+  private:
+    class Result {
+      public:
+        // MAX_UINT64 when the server didn't answer
+        UINT64 rtt;
+        UINT64 expiration;
+    };
+
+    class Target {
+      public:
+        std::string key;
+        std::string host;
+        std::string port;
+        INT32 sock = -1;
+        BYTE transactionId[TURN_PROBE_TRANSACTION_ID_LEN];
+        UINT64 lastSendTime = 0;
+        // Retransmits reuse the transaction id, the first one of them might be the one answered
+        UINT64 firstSendTime = 0;
+        UINT64 rtt = MAX_UINT64;
+    };
+
+    TurnProbe() = default;
+    static BOOL parseUri(PCHAR, std::string&, std::string&, BOOL&);
+    VOID run(std::vector<Target>);
+
+    std::mutex mutex;
+    std::map<std::string, Result> results;
+    std::thread worker;
+    std::atomic<bool> running{false};
+    BOOL stopped = FALSE;
+};
+
+} // namespace Canary
@@ -95,10 +95,14 @@ STATUS initKinesisVideoStructs(PGstKvsPlugin pGstPlugin)
     STATUS retStatus = STATUS_SUCCESS;
     PCHAR pAccessKey = NULL, pSecretKey = NULL, pSessionToken = NULL;
     IotInfo iotInfo;
+    gchar* credentialKey = NULL;
 
     CHK(pGstPlugin != NULL, STATUS_NULL_ARG);
 
-    CHK_STATUS(initKvsWebRtc());
+    // Initializes the SDK and curl with the first element of the process
+    if (pGstPlugin->pSharedContext == NULL) {
+        CHK_STATUS(acquireKvsSharedContext(&pGstPlugin->pSharedContext));
+    }
 
     // Zero out the kvs sub-structures for proper cleanup later
     MEMSET(&pGstPlugin->kvsContext, 0x00, SIZEOF(KvsContext));
@@ -140,20 +144,34 @@ STATUS initKinesisVideoStructs(PGstKvsPlugin pGstPlugin)
     // Check if we have access key then use static credential provider.
     // If we have IoT struct then use IoT credential provider.
     // If we have File then we use file credential provider.
-    // We also need to set the appropriate free function pointer.
+    // Elements with the same credentials share the provider, the IoT one is per thing name which is the channel name.
     if (pAccessKey != NULL) {
-        CHK_STATUS(
-            createStaticCredentialProvider(pAccessKey, 0, pSecretKey, 0, pSessionToken, 0, MAX_UINT64, &pGstPlugin->kvsContext.pCredentialProvider));
-        pGstPlugin->kvsContext.freeCredentialProviderFn = freeStaticCredentialProvider;
+        credentialKey = g_strdup_printf("%s/%s/%s/%s", GST_PLUGIN_CREDENTIAL_KEY_STATIC, pAccessKey, pSecretKey,
+                                        pSessionToken == NULL ? "" : pSessionToken);
+        if (STATUS_NOT_FOUND ==
+            (retStatus = getSharedCredentialProvider(pGstPlugin->pSharedContext, credentialKey, &pGstPlugin->kvsContext.pCredentialProvider))) {
+            CHK_STATUS(createStaticCredentialProvider(pAccessKey, 0, pSecretKey, 0, pSessionToken, 0, MAX_UINT64,
+                                                      &pGstPlugin->kvsContext.pCredentialProvider));
+            CHK_STATUS(addSharedCredentialProvider(pGstPlugin->pSharedContext, credentialKey, freeStaticCredentialProvider,
+                                                   &pGstPlugin->kvsContext.pCredentialProvider));
+        }
     } else if (pGstPlugin->gstParams.iotCertificate != NULL) {
         CHK_STATUS(gstStructToIotInfo(pGstPlugin->gstParams.iotCertificate, &iotInfo));
-        CHK_STATUS(createCurlIotCredentialProvider(iotInfo.endPoint, iotInfo.certPath, iotInfo.privateKeyPath, iotInfo.caCertPath, iotInfo.roleAlias,
-                                                   pGstPlugin->gstParams.channelName, &pGstPlugin->kvsContext.pCredentialProvider));
-        pGstPlugin->kvsContext.freeCredentialProviderFn = freeIotCredentialProvider;
+        credentialKey = g_strdup_printf("%s/%s/%s/%s/%s/%s/%s", GST_PLUGIN_CREDENTIAL_KEY_IOT, iotInfo.endPoint, iotInfo.certPath,
+                                        iotInfo.privateKeyPath, iotInfo.caCertPath, iotInfo.roleAlias, pGstPlugin->gstParams.channelName);
+        if (STATUS_NOT_FOUND ==
+            (retStatus = getSharedCredentialProvider(pGstPlugin->pSharedContext, credentialKey, &pGstPlugin->kvsContext.pCredentialProvider))) {
+            CHK_STATUS(createCurlIotCredentialProvider(iotInfo.endPoint, iotInfo.certPath, iotInfo.privateKeyPath, iotInfo.caCertPath,
+                                                       iotInfo.roleAlias, pGstPlugin->gstParams.channelName,
+                                                       &pGstPlugin->kvsContext.pCredentialProvider));
+            CHK_STATUS(addSharedCredentialProvider(pGstPlugin->pSharedContext, credentialKey, freeIotCredentialProvider,
+                                                   &pGstPlugin->kvsContext.pCredentialProvider));
+        }
     }
 
 CleanUp:
 
+    g_free(credentialKey);
     CHK_LOG_ERR(retStatus);
 
     return retStatus;
@@ -241,6 +259,33 @@ VOID gst_kvs_plugin_class_init(GstKvsPluginClass* klass)
                                     g_param_spec_boolean("connect-webrtc", "WebRTC Connect", "Whether to connect to WebRTC signaling channel",
                                                          DEFAULT_WEBRTC_CONNECT, (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
 
+    g_object_class_install_property(gobject_class, PROP_ENDPOINT,
+                                    g_param_spec_string("endpoint", "Signaling Endpoint",
+                                                        "Control plane endpoint override as host[:port], for example a local mock signaling server. "
+                                                        "Empty uses the regional endpoint",
+                                                        DEFAULT_ENDPOINT, (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+    g_object_class_install_property(gobject_class, PROP_LOW_LATENCY,
+                                    g_param_spec_boolean("low-latency", "Low Latency",
+                                                         "Forward each track as soon as its buffers arrive instead of waiting for every pad to have "
+                                                         "data. Tracks are no longer interleaved by timestamp. Has to be set before the pads are requested",
+                                                         DEFAULT_LOW_LATENCY, (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+    g_object_class_install_property(gobject_class, PROP_STREAM_NAME,
+                                    g_param_spec_string("stream-name", "Stream Name",
+                                                        "Name of a KVS stream to also ingest the frames to, next to WebRTC. Empty disables ingestion",
+                                                        DEFAULT_STREAM_NAME, (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+    g_object_class_install_property(gobject_class, PROP_STREAM_TAGS,
+                                    g_param_spec_boxed("stream-tags", "Stream Tags", "Key-value pairs to tag the KVS stream with", GST_TYPE_STRUCTURE,
+                                                       (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+    g_object_class_install_property(gobject_class, PROP_SIGNALING_STANDBY,
+                                    g_param_spec_boolean("signaling-standby", "Signaling Standby",
+                                                         "Keep a second signaling client fetched and ready to connect, so a failed one is replaced "
+                                                         "without describing the channel and fetching its endpoint and ICE configuration again",
+                                                         DEFAULT_SIGNALING_STANDBY, (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
     gst_element_class_set_static_metadata(gstelement_class, "KVS Plugin", "Sink/Video/Network", "GStreamer AWS KVS plugin",
                                           "AWS KVS <kinesis-video-support@amazon.com>");
 
@@ -274,6 +319,14 @@ VOID gst_kvs_plugin_init(PGstKvsPlugin pGstKvsPlugin)
     pGstKvsPlugin->audioCodecId = g_strdup(DEFAULT_AUDIO_CODEC_ID_AAC);
     pGstKvsPlugin->gstParams.trickleIce = DEFAULT_TRICKLE_ICE_MODE;
     pGstKvsPlugin->gstParams.webRtcConnect = DEFAULT_WEBRTC_CONNECT;
+    pGstKvsPlugin->gstParams.endpoint = g_strdup(DEFAULT_ENDPOINT);
+    pGstKvsPlugin->gstParams.lowLatency = DEFAULT_LOW_LATENCY;
+    pGstKvsPlugin->gstParams.streamName = g_strdup(DEFAULT_STREAM_NAME);
+    pGstKvsPlugin->gstParams.streamTags = NULL;
+    pGstKvsPlugin->gstParams.signalingStandby = DEFAULT_SIGNALING_STANDBY;
+
+    pGstKvsPlugin->producerContext.clientHandle = INVALID_CLIENT_HANDLE_VALUE;
+    pGstKvsPlugin->producerContext.streamHandle = INVALID_STREAM_HANDLE_VALUE;
 
     ATOMIC_STORE_BOOL(&pGstKvsPlugin->connectWebRtc, pGstKvsPlugin->gstParams.webRtcConnect);
 
@@ -293,10 +346,12 @@ VOID gst_kvs_plugin_finalize(GObject* object)
     }
     
     freeGstKvsWebRtcPlugin(pGstKvsPlugin);
+    freeKinesisVideoProducer(pGstKvsPlugin);
 
-    // Last object to be freed
-    if (pGstKvsPlugin->kvsContext.pCredentialProvider != NULL) {
-        pGstKvsPlugin->kvsContext.freeCredentialProviderFn(&pGstKvsPlugin->kvsContext.pCredentialProvider);
+    // Last objects to be freed, the shared ones go away with the last element
+    if (pGstKvsPlugin->pSharedContext != NULL) {
+        releaseSharedCredentialProvider(pGstKvsPlugin->pSharedContext, &pGstKvsPlugin->kvsContext.pCredentialProvider);
+        releaseKvsSharedContext(&pGstKvsPlugin->pSharedContext);
     }
 
     gst_object_unref(pGstKvsPlugin->collect);
@@ -307,12 +362,19 @@ VOID gst_kvs_plugin_finalize(GObject* object)
     g_free(pGstKvsPlugin->gstParams.accessKey);
     g_free(pGstKvsPlugin->audioCodecId);
     g_free(pGstKvsPlugin->gstParams.fileLogPath);
+    g_free(pGstKvsPlugin->gstParams.endpoint);
+    g_free(pGstKvsPlugin->gstParams.streamName);
 
     if (pGstKvsPlugin->gstParams.iotCertificate != NULL) {
         gst_structure_free(pGstKvsPlugin->gstParams.iotCertificate);
         pGstKvsPlugin->gstParams.iotCertificate = NULL;
     }
 
+    if (pGstKvsPlugin->gstParams.streamTags != NULL) {
+        gst_structure_free(pGstKvsPlugin->gstParams.streamTags);
+        pGstKvsPlugin->gstParams.streamTags = NULL;
+    }
+
     SAFE_MEMFREE(pGstKvsPlugin->pAdaptedFrameBuf);
 
     G_OBJECT_CLASS(parent_class)->finalize(object);
@@ -386,6 +448,34 @@ VOID gst_kvs_plugin_set_property(GObject* object, guint propId, const GValue* va
         case PROP_WEBRTC_CONNECT:
             pGstKvsPlugin->gstParams.webRtcConnect = g_value_get_boolean(value);
             ATOMIC_STORE_BOOL(&pGstKvsPlugin->connectWebRtc, pGstKvsPlugin->gstParams.webRtcConnect);
+            notifySessionLifecycle(&pGstKvsPlugin->sessionLifecycle, GST_PLUGIN_LIFECYCLE_EVENT_SIGNALING);
+            break;
+        case PROP_ENDPOINT:
+            g_free(pGstKvsPlugin->gstParams.endpoint);
+            pGstKvsPlugin->gstParams.endpoint = g_strdup(g_value_get_string(value));
+            break;
+        case PROP_LOW_LATENCY:
+            if (pGstKvsPlugin->numStreams != 0) {
+                GST_WARNING_OBJECT(pGstKvsPlugin, "low-latency only applies to pads requested after it is set");
+            }
+            pGstKvsPlugin->gstParams.lowLatency = g_value_get_boolean(value);
+            break;
+        case PROP_STREAM_NAME:
+            g_free(pGstKvsPlugin->gstParams.streamName);
+            pGstKvsPlugin->gstParams.streamName = g_strdup(g_value_get_string(value));
+            break;
+        case PROP_STREAM_TAGS: {
+            const GstStructure* tagsStruct = gst_value_get_structure(value);
+
+            if (pGstKvsPlugin->gstParams.streamTags != NULL) {
+                gst_structure_free(pGstKvsPlugin->gstParams.streamTags);
+            }
+
+            pGstKvsPlugin->gstParams.streamTags = (tagsStruct != NULL) ? gst_structure_copy(tagsStruct) : NULL;
+            break;
+        }
+        case PROP_SIGNALING_STANDBY:
+            pGstKvsPlugin->gstParams.signalingStandby = g_value_get_boolean(value);
             break;
         default:
             G_OBJECT_WARN_INVALID_PROPERTY_ID(object, propId, pspec);
@@ -447,21 +537,36 @@ VOID gst_kvs_plugin_get_property(GObject* object, guint propId, GValue* value, G
         case PROP_WEBRTC_CONNECT:
             g_value_set_boolean(value, pGstKvsPlugin->gstParams.webRtcConnect);
             break;
+        case PROP_ENDPOINT:
+            g_value_set_string(value, pGstKvsPlugin->gstParams.endpoint);
+            break;
+        case PROP_LOW_LATENCY:
+            g_value_set_boolean(value, pGstKvsPlugin->gstParams.lowLatency);
+            break;
+        case PROP_STREAM_NAME:
+            g_value_set_string(value, pGstKvsPlugin->gstParams.streamName);
+            break;
+        case PROP_STREAM_TAGS:
+            gst_value_set_structure(value, pGstKvsPlugin->gstParams.streamTags);
+            break;
+        case PROP_SIGNALING_STANDBY:
+            g_value_set_boolean(value, pGstKvsPlugin->gstParams.signalingStandby);
+            break;
         default:
             G_OBJECT_WARN_INVALID_PROPERTY_ID(object, propId, pspec);
             break;
     }
 }
 
-gboolean gst_kvs_plugin_handle_plugin_event(GstCollectPads* pads, GstCollectData* track_data, GstEvent* event, gpointer user_data)
+// Handles the events both pad modes have in common. Consumed events are unreffed and set to NULL, the rest is left for the default handler
+static STATUS handleTrackEvent(PGstKvsPlugin pGstKvsPlugin, PGstKvsPluginTrackData pTrackData, GstEvent** ppEvent)
 {
     STATUS retStatus = STATUS_SUCCESS;
-    PGstKvsPlugin pGstKvsPlugin = GST_KVS_PLUGIN(user_data);
-    PGstKvsPluginTrackData pTrackData = (PGstKvsPluginTrackData) track_data;
+    GstEvent* event = *ppEvent;
     GstCaps* gstcaps = NULL;
     UINT64 trackId = pTrackData->trackId;
     BYTE cpd[GST_PLUGIN_MAX_CPD_SIZE];
-    UINT32 cpdSize;
+    UINT32 cpdSize = 0;
     gchar* gstCpd = NULL;
     gboolean persistent, connectWeRtc;
     const GstStructure* gstStruct;
@@ -498,6 +603,8 @@ gboolean gst_kvs_plugin_handle_plugin_event(GstCollectPads* pads, GstCollectData
                     GST_ERROR_OBJECT(pGstKvsPlugin, "Failed to generate pcm cpd");
                     CHK(FALSE, STATUS_INVALID_OPERATION);
                 }
+
+                cpdSize = KVS_PCM_CPD_SIZE_BYTE;
             
             } else if (!pGstKvsPlugin->trackCpdReceived[trackId] && gst_structure_has_field(gststructforcaps, "codec_data")) {
                 const GValue* gstStreamFormat = gst_structure_get_value(gststructforcaps, "codec_data");
@@ -543,6 +650,11 @@ gboolean gst_kvs_plugin_handle_plugin_event(GstCollectPads* pads, GstCollectData
                 pGstKvsPlugin->trackCpdReceived[trackId] = TRUE;
             }
 
+            // The stream gets the CPD the way it came in, only WebRTC needs it in Annex-B
+            if (cpdSize != 0) {
+                CHK_STATUS(putKinesisVideoStreamCpd(pGstKvsPlugin, cpd, cpdSize, trackId));
+            }
+
             gst_event_unref(event);
             event = NULL;
 
@@ -557,6 +669,8 @@ gboolean gst_kvs_plugin_handle_plugin_event(GstCollectPads* pads, GstCollectData
                 gst_structure_get_boolean(gstStruct, KVS_ADD_METADATA_PERSISTENT, &persistent)) {
                 DLOGD("received " KVS_ADD_METADATA_G_STRUCT_NAME " event");
 
+                CHK_LOG_ERR(putKinesisVideoStreamMetadata(pGstKvsPlugin, pName, pVal, persistent));
+
                 gst_event_unref(event);
                 event = NULL;
             } else if (gst_structure_has_name(gstStruct, KVS_CONNECT_WEBRTC_G_STRUCT_NAME) &&
@@ -564,6 +678,7 @@ gboolean gst_kvs_plugin_handle_plugin_event(GstCollectPads* pads, GstCollectData
                 DLOGD("received " KVS_CONNECT_WEBRTC_G_STRUCT_NAME " event");
 
                 ATOMIC_STORE_BOOL(&pGstKvsPlugin->connectWebRtc, connectWeRtc);
+                notifySessionLifecycle(&pGstKvsPlugin->sessionLifecycle, GST_PLUGIN_LIFECYCLE_EVENT_SIGNALING);
 
                 gst_event_unref(event);
                 event = NULL;
@@ -577,9 +692,7 @@ gboolean gst_kvs_plugin_handle_plugin_event(GstCollectPads* pads, GstCollectData
 
 CleanUp:
 
-    if (event != NULL) {
-        gst_collect_pads_event_default(pads, track_data, event, FALSE);
-    }
+    *ppEvent = event;
 
     if (gstCpd != NULL) {
         g_free(gstCpd);
@@ -589,6 +702,69 @@ CleanUp:
         GST_ELEMENT_ERROR(pGstKvsPlugin, STREAM, FAILED, (NULL), ("Failed to handle event"));
     }
 
+    return retStatus;
+}
+
+gboolean gst_kvs_plugin_handle_plugin_event(GstCollectPads* pads, GstCollectData* track_data, GstEvent* event, gpointer user_data)
+{
+    STATUS retStatus = handleTrackEvent(GST_KVS_PLUGIN(user_data), (PGstKvsPluginTrackData) track_data, &event);
+
+    if (event != NULL) {
+        gst_collect_pads_event_default(pads, track_data, event, FALSE);
+    }
+
+    return STATUS_SUCCEEDED(retStatus);
+}
+
+gboolean gst_kvs_plugin_sink_event(GstPad* pad, GstObject* parent, GstEvent* event)
+{
+    STATUS retStatus = STATUS_SUCCESS;
+    PGstKvsPlugin pGstKvsPlugin = GST_KVS_PLUGIN(parent);
+    PGstKvsPluginTrackData pTrackData = (PGstKvsPluginTrackData) gst_pad_get_element_private(pad);
+    BOOL allEos = FALSE;
+
+    switch (GST_EVENT_TYPE(event)) {
+        case GST_EVENT_SEGMENT:
+            // Kept in the collect data so that the running time clipping works the same way in both modes
+            gst_event_copy_segment(event, &pTrackData->collect.segment);
+            break;
+
+        case GST_EVENT_FLUSH_STOP:
+            gst_segment_init(&pTrackData->collect.segment, GST_FORMAT_UNDEFINED);
+            GST_OBJECT_LOCK(pGstKvsPlugin);
+            if (pTrackData->eos) {
+                pTrackData->eos = FALSE;
+                pGstKvsPlugin->eosStreams--;
+            }
+            GST_OBJECT_UNLOCK(pGstKvsPlugin);
+            break;
+
+        case GST_EVENT_EOS:
+            // The element only reaches EOS once every track did, same as with collect pads
+            GST_OBJECT_LOCK(pGstKvsPlugin);
+            if (!pTrackData->eos) {
+                pTrackData->eos = TRUE;
+                allEos = ++pGstKvsPlugin->eosStreams == pGstKvsPlugin->numStreams;
+            }
+            GST_OBJECT_UNLOCK(pGstKvsPlugin);
+
+            if (allEos) {
+                gst_element_post_message(GST_ELEMENT_CAST(pGstKvsPlugin), gst_message_new_eos(GST_OBJECT_CAST(pGstKvsPlugin)));
+            }
+
+            gst_event_unref(event);
+            event = NULL;
+            break;
+
+        default:
+            retStatus = handleTrackEvent(pGstKvsPlugin, pTrackData, &event);
+            break;
+    }
+
+    if (event != NULL) {
+        return gst_pad_event_default(pad, parent, event);
+    }
+
     return STATUS_SUCCEEDED(retStatus);
 }
 
@@ -616,14 +792,11 @@ BOOL print_droppable_reason(BOOL isDroppable, GstBuffer* buffer) {
     }
 }
 
-GstFlowReturn gst_kvs_plugin_handle_buffer(GstCollectPads* pads, GstCollectData* track_data, GstBuffer* buf, gpointer user_data)
+// Sends one buffer of a track to the peers and takes ownership of it. Both pad modes end up here, so the timestamp
+// rebasing is done under the object lock as in low latency mode the tracks come in on their own streaming threads
+static VOID putTrackBuffer(PGstKvsPlugin pGstKvsPlugin, PGstKvsPluginTrackData pTrackData, GstBuffer* buf)
 {
-    PGstKvsPlugin pGstKvsPlugin = GST_KVS_PLUGIN(user_data);
-    GstFlowReturn ret = GST_FLOW_OK;
-    PGstKvsPluginTrackData pTrackData = (PGstKvsPluginTrackData) track_data;
-
     BOOL isDroppable, delta;
-    GstMessage* message;
     UINT64 trackId;
     FRAME_FLAGS frameFlags = FRAME_FLAG_NONE;
     GstMapInfo info;
@@ -632,17 +805,6 @@ GstFlowReturn gst_kvs_plugin_handle_buffer(GstCollectPads* pads, GstCollectData*
 
     info.data = NULL;
 
-    // eos reached
-    if (buf == NULL && pTrackData == NULL) {
-
-        // send out eos message to gstreamer bus
-        message = gst_message_new_eos(GST_OBJECT_CAST(pGstKvsPlugin));
-        gst_element_post_message(GST_ELEMENT_CAST(pGstKvsPlugin), message);
-
-        ret = GST_FLOW_EOS;
-        goto CleanUp;
-    }
-
     isDroppable = GST_BUFFER_FLAG_IS_SET(buf, GST_BUFFER_FLAG_CORRUPTED) || GST_BUFFER_FLAG_IS_SET(buf, GST_BUFFER_FLAG_DECODE_ONLY) ||
         (GST_BUFFER_FLAGS(buf) == GST_BUFFER_FLAG_DISCONT) ||
         (GST_BUFFER_FLAG_IS_SET(buf, GST_BUFFER_FLAG_DISCONT) && GST_BUFFER_FLAG_IS_SET(buf, GST_BUFFER_FLAG_DELTA_UNIT)) ||
@@ -676,6 +838,7 @@ GstFlowReturn gst_kvs_plugin_handle_buffer(GstCollectPads* pads, GstCollectData*
             break;
     }
 
+    GST_OBJECT_LOCK(pGstKvsPlugin);
     if (pGstKvsPlugin->firstPts == GST_CLOCK_TIME_NONE) {
         pGstKvsPlugin->firstPts = buf->pts;
     }
@@ -685,10 +848,17 @@ GstFlowReturn gst_kvs_plugin_handle_buffer(GstCollectPads* pads, GstCollectData*
     }
 
     buf->pts += pGstKvsPlugin->startTime - pGstKvsPlugin->firstPts;
+    // The stream needs the decoding time on the same clock, WebRTC only looks at the presentation time
+    if (GST_BUFFER_DTS_IS_VALID(buf)) {
+        buf->dts += pGstKvsPlugin->startTime - pGstKvsPlugin->firstPts;
+    } else {
+        buf->dts = buf->pts;
+    }
+    frame.index = pGstKvsPlugin->frameCount++;
+    GST_OBJECT_UNLOCK(pGstKvsPlugin);
 
     frame.version = FRAME_CURRENT_VERSION;
     frame.flags = frameFlags;
-    frame.index = pGstKvsPlugin->frameCount;
     frame.decodingTs = buf->dts / DEFAULT_TIME_UNIT_IN_NANOS;
     frame.presentationTs = buf->pts / DEFAULT_TIME_UNIT_IN_NANOS;
     frame.trackId = trackId;
@@ -696,6 +866,12 @@ GstFlowReturn gst_kvs_plugin_handle_buffer(GstCollectPads* pads, GstCollectData*
     frame.frameData = info.data;
     frame.duration = 0;
 
+    // Both sinks work off this one mapping. The stream takes the bits as they are and copies them right away,
+    // the video lane converts its own copy to Annex-B
+    if (STATUS_FAILED(status = putFrameToKinesisVideoStream(pGstKvsPlugin, &frame))) {
+        DLOGW("Failed to put frame to the stream with 0x%08x", status);
+    }
+
     // Need to produce the frame into peer connections
     // Check whether the frame is in AvCC/HEVC and set the flag to adapt the
     // bits to Annex-B format for RTP
@@ -703,19 +879,67 @@ GstFlowReturn gst_kvs_plugin_handle_buffer(GstCollectPads* pads, GstCollectData*
         DLOGW("Failed to put frame to peer connections with 0x%08x", status);
     }
 
-    pGstKvsPlugin->frameCount++;
-
 CleanUp:
 
     if (info.data != NULL) {
         gst_buffer_unmap(buf, &info);
     }
 
+    gst_buffer_unref(buf);
+}
+
+GstFlowReturn gst_kvs_plugin_handle_buffer(GstCollectPads* pads, GstCollectData* track_data, GstBuffer* buf, gpointer user_data)
+{
+    PGstKvsPlugin pGstKvsPlugin = GST_KVS_PLUGIN(user_data);
+    GstMessage* message;
+
+    // eos reached
+    if (buf == NULL && track_data == NULL) {
+        // send out eos message to gstreamer bus
+        message = gst_message_new_eos(GST_OBJECT_CAST(pGstKvsPlugin));
+        gst_element_post_message(GST_ELEMENT_CAST(pGstKvsPlugin), message);
+
+        return GST_FLOW_EOS;
+    }
+
     if (buf != NULL) {
+        putTrackBuffer(pGstKvsPlugin, (PGstKvsPluginTrackData) track_data, buf);
+    }
+
+    return GST_FLOW_OK;
+}
+
+GstFlowReturn gst_kvs_plugin_chain(GstPad* pad, GstObject* parent, GstBuffer* buf)
+{
+    PGstKvsPlugin pGstKvsPlugin = GST_KVS_PLUGIN(parent);
+    PGstKvsPluginTrackData pTrackData = (PGstKvsPluginTrackData) gst_pad_get_element_private(pad);
+    GstSegment* segment = &pTrackData->collect.segment;
+    guint64 pts, dts;
+
+    if (pTrackData->eos) {
         gst_buffer_unref(buf);
+        return GST_FLOW_EOS;
     }
 
-    return ret;
+    // Same as gst_collect_pads_clip_running_time, buffers outside of the segment are dropped
+    if (!pGstKvsPlugin->gstParams.disableBufferClipping && segment->format == GST_FORMAT_TIME) {
+        pts = gst_segment_to_running_time(segment, GST_FORMAT_TIME, GST_BUFFER_PTS(buf));
+        dts = gst_segment_to_running_time(segment, GST_FORMAT_TIME, GST_BUFFER_DTS(buf));
+
+        if (GST_BUFFER_PTS_IS_VALID(buf) && !GST_CLOCK_TIME_IS_VALID(pts)) {
+            GST_DEBUG_OBJECT(pad, "Dropping buffer outside of the segment");
+            gst_buffer_unref(buf);
+            return GST_FLOW_OK;
+        }
+
+        buf = gst_buffer_make_writable(buf);
+        GST_BUFFER_PTS(buf) = pts;
+        GST_BUFFER_DTS(buf) = dts;
+    }
+
+    putTrackBuffer(pGstKvsPlugin, pTrackData, buf);
+
+    return GST_FLOW_OK;
 }
 
 GstPad* gst_kvs_plugin_request_new_pad(GstElement* element, GstPadTemplate* templ, const gchar* req_name, const GstCaps* caps)
@@ -778,6 +1002,13 @@ GstPad* gst_kvs_plugin_request_new_pad(GstElement* element, GstPadTemplate* temp
     pTrackData->pGstKvsPlugin = pGstKvsPlugin;
     pTrackData->trackType = trackType;
     pTrackData->trackId = DEFAULT_VIDEO_TRACK_ID;
+    pTrackData->eos = FALSE;
+
+    // Collect pads still tracks the pad, the data just doesn't go through it anymore
+    if (pGstKvsPlugin->gstParams.lowLatency) {
+        gst_pad_set_chain_function(newpad, GST_DEBUG_FUNCPTR(gst_kvs_plugin_chain));
+        gst_pad_set_event_function(newpad, GST_DEBUG_FUNCPTR(gst_kvs_plugin_sink_event));
+    }
 
     if (!gst_element_add_pad(element, GST_PAD(newpad))) {
         gst_object_unref(newpad);
@@ -831,6 +1062,7 @@ GstStateChangeReturn gst_kvs_plugin_change_state(GstElement* element, GstStateCh
     GstStateChangeReturn ret = GST_STATE_CHANGE_SUCCESS;
     PGstKvsPlugin pGstKvsPlugin = GST_KVS_PLUGIN(element);
     STATUS status = STATUS_SUCCESS;
+    GSList* walk;
 
     switch (transition) {
         case GST_STATE_CHANGE_NULL_TO_READY:
@@ -846,6 +1078,14 @@ GstStateChangeReturn gst_kvs_plugin_change_state(GstElement* element, GstStateCh
                 goto CleanUp;
             }
 
+            // The stream is described from the tracks, so it comes after them
+            if (pGstKvsPlugin->gstParams.streamName != NULL && pGstKvsPlugin->gstParams.streamName[0] != '\0' &&
+                STATUS_FAILED(status = initKinesisVideoProducer(pGstKvsPlugin))) {
+                DLOGE("Failed to initialize KVS producer with 0x%08x", status);
+                ret = GST_STATE_CHANGE_FAILURE;
+                goto CleanUp;
+            }
+
             pGstKvsPlugin->firstPts = GST_CLOCK_TIME_NONE;
             pGstKvsPlugin->frameCount = 0;
             
@@ -862,17 +1102,14 @@ GstStateChangeReturn gst_kvs_plugin_change_state(GstElement* element, GstStateCh
                 goto CleanUp;
             }
 
-            // Schedule the WebRTC master session servicing periodic routine
-            if (STATUS_FAILED(status = timerQueueAddTimer(pGstKvsPlugin->kvsContext.timerQueueHandle, GST_PLUGIN_SERVICE_ROUTINE_START,
-                                                          GST_PLUGIN_SERVICE_ROUTINE_PERIOD, sessionServiceHandler, (UINT64) pGstKvsPlugin,
-                                                          &pGstKvsPlugin->serviceRoutineTimerId))) {
-                DLOGE("Failed to schedule WebRTC service routine with 0x%08x", status);
-                ret = GST_STATE_CHANGE_FAILURE;
-                goto CleanUp;
-            }
-
             break;
         case GST_STATE_CHANGE_READY_TO_PAUSED:
+            GST_OBJECT_LOCK(pGstKvsPlugin);
+            pGstKvsPlugin->eosStreams = 0;
+            for (walk = pGstKvsPlugin->collect->data; walk != NULL; walk = g_slist_next(walk)) {
+                ((PGstKvsPluginTrackData) walk->data)->eos = FALSE;
+            }
+            GST_OBJECT_UNLOCK(pGstKvsPlugin);
             gst_collect_pads_start(pGstKvsPlugin->collect);
             break;
         case GST_STATE_CHANGE_PAUSED_TO_READY:
@@ -930,7 +1167,9 @@ STATUS initTrackData(PGstKvsPlugin pGstKvsPlugin)
             if (STRNCMP(mediaType, GSTREAMER_MEDIA_TYPE_H264, MAX_GSTREAMER_MEDIA_TYPE_LEN) == 0) {
                 // default codec id is for h264 video.
                 videoContentType = g_strdup(VIDEO_H264_CONTENT_TYPE);
+                pGstKvsPlugin->h264Video = TRUE;
             } else if (STRNCMP(mediaType, GSTREAMER_MEDIA_TYPE_H265, MAX_GSTREAMER_MEDIA_TYPE_LEN) == 0) {
+                pGstKvsPlugin->h264Video = FALSE;
                 g_free(pGstKvsPlugin->gstParams.codecId);
                 pGstKvsPlugin->gstParams.codecId = g_strdup(DEFAULT_CODEC_ID_H265);
                 videoContentType = g_strdup(VIDEO_H265_CONTENT_TYPE);
@@ -41,12 +41,29 @@ typedef struct __WebRtcStreamingSession WebRtcStreamingSession;
 typedef struct __WebRtcStreamingSession* PWebRtcStreamingSession;
 typedef struct __PendingMessageQueue PendingMessageQueue;
 typedef struct __PendingMessageQueue* PPendingMessageQueue;
+typedef struct __SendLane SendLane;
+typedef struct __SendLane* PSendLane;
+typedef struct __QueuedFrame QueuedFrame;
+typedef struct __QueuedFrame* PQueuedFrame;
+typedef struct __SessionReaper SessionReaper;
+typedef struct __SessionReaper* PSessionReaper;
+typedef struct __SessionLifecycle SessionLifecycle;
+typedef struct __SessionLifecycle* PSessionLifecycle;
+typedef struct __SignalingStandby SignalingStandby;
+typedef struct __SignalingStandby* PSignalingStandby;
+typedef struct __KvsSharedContext KvsSharedContext;
+typedef struct __KvsSharedContext* PKvsSharedContext;
 
 #include <gst/gst.h>
 #include <gst/base/gstcollectpads.h>
+#include <com/amazonaws/kinesis/video/cproducer/Include.h>
 #include <com/amazonaws/kinesis/video/webrtcclient/Include.h>
 #include "GstPluginUtils.h"
+#include "View.h"
 #include "KvsWebRtc.h"
+#include "KvsProducer.h"
+#include "KvsSharedContext.h"
+#include "TurnProbe.h"
 
 typedef enum {
     PROP_0,
@@ -65,6 +82,11 @@ typedef enum {
     PROP_TRICKLE_ICE,
     PROP_WEBRTC_CONNECTION_MODE,
     PROP_WEBRTC_CONNECT,
+    PROP_ENDPOINT,
+    PROP_LOW_LATENCY,
+    PROP_STREAM_NAME,
+    PROP_STREAM_TAGS,
+    PROP_SIGNALING_STANDBY,
 } KVS_GST_PLUGIN_PROPS;
 
 #define KVS_ADD_METADATA_G_STRUCT_NAME "kvs-add-metadata"
@@ -126,18 +148,99 @@ typedef enum {
 
 typedef STATUS (*freeCredentialProviderFunc)(PAwsCredentialProvider*);
 
+// Credential provider shared by the elements using the same credentials
+typedef struct __SharedCredentialProvider SharedCredentialProvider;
+struct __SharedCredentialProvider {
+    gchar* key;
+    UINT32 refCount;
+    PAwsCredentialProvider pCredentialProvider;
+    freeCredentialProviderFunc freeCredentialProviderFn;
+};
+typedef struct __SharedCredentialProvider* PSharedCredentialProvider;
+
+// Allocation round trip of a TURN server, see TurnProbe.c
+typedef struct __TurnProbeResult TurnProbeResult;
+struct __TurnProbeResult {
+    CHAR host[MAX_ICE_CONFIG_URI_LEN + 1];
+    // MAX_UINT64 when the server didn't answer
+    UINT64 rtt;
+    UINT64 expiration;
+};
+typedef struct __TurnProbeResult* PTurnProbeResult;
+
+typedef struct __TurnProbeTarget TurnProbeTarget;
+struct __TurnProbeTarget {
+    CHAR host[MAX_ICE_CONFIG_URI_LEN + 1];
+    CHAR port[GST_PLUGIN_TURN_PROBE_MAX_PORT_LEN + 1];
+    INT32 sock;
+    BYTE transactionId[TURN_PROBE_TRANSACTION_ID_LEN];
+    UINT64 lastSendTime;
+    // Retransmits reuse the transaction id, the first one of them might be the one answered
+    UINT64 firstSendTime;
+    UINT64 rtt;
+};
+typedef struct __TurnProbeTarget* PTurnProbeTarget;
+
+// Process-wide resources the elements reference instead of creating their own, see KvsSharedContext.c
+struct __KvsSharedContext {
+    // Elements holding a reference, under the global lock as is the rest of the structure apart from the certificates
+    UINT32 refCount;
+
+    TIMER_QUEUE_HANDLE timerQueueHandle;
+
+    MUTEX certificateLock;
+    UINT32 pregenerateCertTimerId;
+    PStackQueue pregeneratedCertificates; // Max GST_PLUGIN_MAX_PREGENERATED_CERTIFICATES certificates
+
+    PStackQueue credentialProviders; // PSharedCredentialProvider
+
+    // TURN servers probed so far, the targets are only touched by the probe thread while it runs
+    MUTEX turnProbeLock;
+    TurnProbeResult turnProbeResults[GST_PLUGIN_MAX_TURN_PROBE_RESULTS];
+    UINT32 turnProbeResultCount;
+    TurnProbeTarget turnProbeTargets[MAX_ICE_CONFIG_COUNT];
+    UINT32 turnProbeTargetCount;
+    volatile ATOMIC_BOOL turnProbeRunning;
+    TID turnProbeTid;
+
+    PCameraView pVirtcamView;
+};
+
 typedef struct __KvsContext KvsContext;
 struct __KvsContext {
+    // Owned by the shared context
     PAwsCredentialProvider pCredentialProvider;
     TIMER_QUEUE_HANDLE timerQueueHandle;
     SIGNALING_CLIENT_HANDLE signalingHandle;
-    freeCredentialProviderFunc freeCredentialProviderFn;
     ChannelInfo channelInfo;
     SignalingClientCallbacks signalingClientCallbacks;
     SignalingClientInfo signalingClientInfo;
 };
 typedef struct __KvsContext* PKvsContext;
 
+// KVS stream the frames also go to when stream-name is set
+typedef struct __KvsProducerContext KvsProducerContext;
+struct __KvsProducerContext {
+    PDeviceInfo pDeviceInfo;
+    PStreamInfo pStreamInfo;
+    PClientCallbacks pClientCallbacks;
+    StreamCallbacks streamCallbacks;
+    CLIENT_HANDLE clientHandle;
+    STREAM_HANDLE streamHandle;
+    GstTags tags;
+
+    // Since the last report, under the lock as the pads can put frames from their own threads
+    MUTEX lock;
+    UINT64 lastReportTime;
+    UINT32 putFrames;
+    UINT32 failedFrames;
+    UINT64 latencySum;
+    UINT64 maxLatency;
+    // Frames the producer dropped from its buffer, reported by its callback
+    volatile SIZE_T droppedFrames;
+};
+typedef struct __KvsProducerContext* PKvsProducerContext;
+
 typedef struct __GstParams GstParams;
 struct __GstParams {
     gchar* channelName;
@@ -157,6 +260,11 @@ struct __GstParams {
     gboolean trickleIce;
     WEBRTC_CONNECTION_MODE connectionMode;
     gboolean webRtcConnect;
+    gchar* endpoint;
+    gboolean lowLatency;
+    gchar* streamName;
+    GstStructure* streamTags;
+    gboolean signalingStandby;
 };
 typedef struct __GstParams* PGstParams;
 
@@ -177,6 +285,175 @@ struct __RtcMetricsHistory {
 };
 typedef struct __RtcMetricsHistory* PRtcMetricsHistory;
 
+// Copy of a frame waiting in a send lane, the frame bits follow the structure
+struct __QueuedFrame {
+    Frame frame;
+    ELEMENTARY_STREAM_NAL_FORMAT nalFormat;
+    UINT64 enqueueTime;
+};
+
+/*
+ * Queue and worker thread sending the frames of one media kind to the peers, so that packetizing and encrypting a large
+ * video frame for every session doesn't hold back the audio frames behind it.
+ */
+struct __SendLane {
+    PCHAR name;
+    UINT64 trackId;
+    UINT32 maxDepth;
+    // A full lane drops the frames until the next key frame rather than the oldest one
+    BOOL dropUntilKeyFrame;
+    // Lane this one steps aside for between two sessions while that one has frames to send
+    PSendLane pYieldTo;
+
+    MUTEX lock;
+    CVAR cvar;
+    PStackQueue pFrames;
+    UINT32 depth;
+    BOOL waitingForKeyFrame;
+    // Queued and in flight frames
+    volatile SIZE_T pending;
+    volatile ATOMIC_BOOL terminate;
+    TID workerTid;
+    // Numbers the frames sent, only used by the worker
+    UINT64 frameSequence;
+
+    // Since the last report, under the lane lock
+    UINT64 lastReportTime;
+    UINT32 sentFrames;
+    UINT32 droppedFrames;
+    UINT32 maxObservedDepth;
+    UINT64 latencySum;
+    UINT64 maxLatency;
+
+    // Back pointer to the main object
+    PGstKvsPlugin pGstKvsPlugin;
+};
+
+/*
+ * Keeps the video sent to one session within its bandwidth estimation. The budget is in bytes and refills at the
+ * estimate, a session over it loses its non-reference frames first and is held until the next key frame otherwise.
+ */
+typedef struct __SessionRateControl SessionRateControl;
+struct __SessionRateControl {
+    // Bits per second, 0 until the first estimate. Stored by the SDK, everything else belongs to the video lane
+    volatile SIZE_T estimate;
+    // Goes negative when a key frame is sent over the budget
+    INT64 budget;
+    UINT64 lastRefillTime;
+    BOOL waitingForKeyFrame;
+
+    UINT64 sentFrames;
+    UINT64 droppedNonReferenceFrames;
+    UINT64 droppedFrames;
+    UINT64 holds;
+    UINT64 recoveries;
+};
+typedef struct __SessionRateControl* PSessionRateControl;
+
+/*
+ * How long viewers take to get (back) to connected. New sessions count from their offer, ICE restarts from the restart
+ * offer, so the two reconnect paths can be compared directly. Updated from the SDK callbacks under its own lock.
+ */
+typedef struct __ReconnectStats ReconnectStats;
+struct __ReconnectStats {
+    MUTEX lock;
+
+    // Since the last report
+    UINT64 lastReportTime;
+    UINT32 sessionConnects;
+    UINT64 sessionConnectTimeSum;
+    UINT32 iceRestarts;
+    UINT32 iceRestartRecoveries;
+    UINT64 iceRestartTimeSum;
+    UINT32 selfRecoveries;
+    UINT32 disconnectTimeouts;
+};
+typedef struct __ReconnectStats* PReconnectStats;
+
+/*
+ * Closes and frees terminated sessions on its own thread. The service routine only detaches them from the session list
+ * and the peer table under the lock, so a burst of teardowns doesn't hold up the offers and ICE candidates of the others.
+ */
+struct __SessionReaper {
+    MUTEX lock;
+    CVAR cvar;
+    PStackQueue pSessions;
+    UINT32 depth;
+    // Queued and in flight sessions, the service routine leaves terminated sessions attached while this is at the limit
+    volatile SIZE_T pending;
+    volatile ATOMIC_BOOL terminate;
+    TID workerTid;
+
+    // Since the last report, under the reaper lock
+    UINT64 lastReportTime;
+    UINT32 freedSessions;
+    UINT32 maxObservedDepth;
+    UINT64 latencySum;
+    UINT64 maxLatency;
+
+    // Back pointer to the main object
+    PGstKvsPlugin pGstKvsPlugin;
+};
+
+/*
+ * Runs the session service pass on its own thread as soon as something calls for it: a session terminated or lost its
+ * connection, the reaper made room, the signaling client has to be recreated or connected, a pending queue was added.
+ * In between it sleeps until the earliest deadline the last pass found (grace periods, queue expiry, retries, reports).
+ */
+struct __SessionLifecycle {
+    MUTEX lock;
+    CVAR cvar;
+    // GST_PLUGIN_LIFECYCLE_EVENT_* raised since the last pass
+    UINT32 events;
+    UINT64 nextDeadline;
+    volatile ATOMIC_BOOL terminate;
+    TID workerTid;
+    // First signaling error asking for a new client, 0 when there is none
+    volatile SIZE_T recreateRequestTime;
+
+    // Since the last report, under the lifecycle lock
+    UINT64 lastReportTime;
+    UINT32 eventPasses;
+    UINT32 deadlinePasses;
+    UINT32 freedSlots;
+    UINT64 slotLatencySum;
+    UINT64 maxSlotLatency;
+    UINT32 signalingRecreates;
+    UINT64 recreateLatencySum;
+    UINT64 maxRecreateLatency;
+
+    // Back pointer to the main object
+    PGstKvsPlugin pGstKvsPlugin;
+};
+
+/*
+ * Second signaling client for the channel, described, with its endpoint and ICE configuration fetched, but not connected
+ * as the channel takes one master connection at a time. When the active client fails the standby only has to connect to
+ * take over. It's rebuilt in the background before its ICE configuration gets old. Also keeps the signaling availability
+ * of the element, with or without a standby.
+ */
+struct __SignalingStandby {
+    MUTEX lock;
+    // Invalid while there is none
+    SIGNALING_CLIENT_HANDLE signalingHandle;
+    // When the standby is to be (re)built next
+    UINT64 nextPrepareTime;
+    volatile ATOMIC_BOOL preparing;
+    TID preparerTid;
+
+    // Since the last report, under the standby lock
+    UINT64 lastReportTime;
+    UINT32 handovers;
+    UINT64 handoverGapSum;
+    UINT64 maxHandoverGap;
+    UINT32 recreations;
+    // Without a working signaling client, an outage still going on is added at the report
+    UINT64 downtime;
+
+    // Back pointer to the main object
+    PGstKvsPlugin pGstKvsPlugin;
+};
+
 typedef VOID (*StreamSessionShutdownCallback)(UINT64, PWebRtcStreamingSession);
 
 struct __WebRtcStreamingSession {
@@ -198,6 +475,24 @@ struct __WebRtcStreamingSession {
     BOOL firstFrame;
     RtcMetricsHistory rtcMetricsHistory;
     BOOL remoteCanTrickleIce;
+    SessionRateControl rateControl;
+    // Last frame sequence of each send lane written to the session, the lanes look at their own only
+    UINT64 audioFrameSequence;
+    UINT64 videoFrameSequence;
+    // Gathering, and with it the TURN allocation, starts with the local description
+    UINT64 iceGatheringStartTime;
+    volatile ATOMIC_BOOL relayCandidateGathered;
+    // DTLS fingerprint of the viewer, a restart offer has to come from the same one
+    CHAR remoteFingerprint[GST_PLUGIN_MAX_FINGERPRINT_LEN + 1];
+    // When the connection was lost, 0 while connected. The session is torn down once it's past the grace period.
+    volatile SIZE_T disconnectTime;
+    // From the restart offer until connected again
+    volatile ATOMIC_BOOL iceRestarting;
+    UINT32 iceRestartCount;
+    UINT32 connectCount;
+    // When it was terminated and when the service pass handed it to the reaper
+    UINT64 terminateTime;
+    UINT64 detachTime;
 
     // this is called when the WebRtcStreamingSession is being freed
     StreamSessionShutdownCallback shutdownCallback;
@@ -217,6 +512,8 @@ struct __GstKvsPlugin {
 
     // KVS related context
     KvsContext kvsContext;
+    KvsProducerContext producerContext;
+    PKvsSharedContext pSharedContext;
 
     // Internal fields
     volatile ATOMIC_BOOL terminate;
@@ -225,8 +522,9 @@ struct __GstKvsPlugin {
     volatile ATOMIC_BOOL connectWebRtc;
 
     CHAR caCertPath[MAX_PATH_LEN + 1];
+    CHAR controlPlaneUrl[MAX_URI_CHAR_LEN + 1];
 
-    BOOL trackCpdReceived[DEFAULT_AUDIO_TRACK_ID]; // We should only have up-to two tacks
+    BOOL trackCpdReceived[DEFAULT_AUDIO_TRACK_ID + 1]; // We should only have up-to two tacks, indexed by the track id
 
     PCHAR pRegion;
 
@@ -239,20 +537,29 @@ struct __GstKvsPlugin {
     PWebRtcStreamingSession streamingSessionList[DEFAULT_MAX_CONCURRENT_WEBRTC_STREAMING_SESSION];
     UINT32 streamingSessionCount;
 
+    SendLane audioLane;
+    SendLane videoLane;
+
+    ReconnectStats reconnectStats;
+    SessionReaper sessionReaper;
+    SessionLifecycle sessionLifecycle;
+    SignalingStandby signalingStandby;
+
     UINT32 iceUriCount;
 
     UINT32 iceCandidatePairStatsTimerId;
 
     RtcOnDataChannel onDataChannel;
 
-    UINT32 pregenerateCertTimerId;
-    UINT32 serviceRoutineTimerId;
-    PStackQueue pregeneratedCertificates; // Max MAX_RTCCONFIGURATION_CERTIFICATES certificates
-
     RtcStats rtcIceCandidatePairMetrics;
 
     UINT32 frameCount;
     GST_PLUGIN_MEDIA_TYPE mediaType;
+    // Non-reference frames are only told apart for H.264, with other codecs every delta frame counts as a reference
+    BOOL h264Video;
+
+    // Pads that reached EOS in low latency mode, collect pads keeps track of it otherwise
+    guint eosStreams;
 
     PBYTE pAdaptedFrameBuf;
     UINT32 adaptedFrameBufSize;
@@ -278,6 +585,8 @@ struct __GstKvsPluginTrackData {
     MKV_TRACK_INFO_TYPE trackType;
     guint trackId;
     PGstKvsPlugin pGstKvsPlugin;
+    // Only used in low latency mode
+    BOOL eos;
 };
 typedef struct __GstKvsPluginTrackData* PGstKvsPluginTrackData;
 
@@ -301,6 +610,10 @@ GstStateChangeReturn gst_kvs_plugin_change_state(GstElement*, GstStateChange);
 GstFlowReturn gst_kvs_plugin_handle_buffer(GstCollectPads*, GstCollectData*, GstBuffer*, gpointer);
 gboolean gst_kvs_plugin_handle_plugin_event(GstCollectPads*, GstCollectData*, GstEvent*, gpointer);
 
+/* low latency mode pad callbacks, each sink pad is handled on its own streaming thread */
+GstFlowReturn gst_kvs_plugin_chain(GstPad*, GstObject*, GstBuffer*);
+gboolean gst_kvs_plugin_sink_event(GstPad*, GstObject*, GstEvent*);
+
 /* Request pad callback */
 GstPad* gst_kvs_plugin_request_new_pad(GstElement*, GstPadTemplate*, const gchar*, const GstCaps*);
 VOID gst_kvs_plugin_release_pad(GstElement*, GstPad*);
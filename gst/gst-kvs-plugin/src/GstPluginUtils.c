@@ -190,6 +190,42 @@ CleanUp:
     return retStatus;
 }
 
+STATUS identifyNonReferenceFrame(PBYTE pData, UINT32 size, PBOOL pNonReference)
+{
+    STATUS retStatus = STATUS_SUCCESS;
+    BOOL nonReference = FALSE;
+    PBYTE pCurPnt = pData, pEndPnt = pData + size;
+    BYTE naluHeader, naluType;
+
+    CHK(pData != NULL && pNonReference != NULL, STATUS_NULL_ARG);
+
+    // H.264 only, HEVC headers are laid out differently. Every slice of a picture carries the same nal_ref_idc,
+    // so the first slice NALu of the Annex-B frame decides
+    while (pCurPnt + 3 < pEndPnt) {
+        if (pCurPnt[0] != 0x00 || pCurPnt[1] != 0x00 || pCurPnt[2] != 0x01) {
+            pCurPnt++;
+            continue;
+        }
+
+        naluHeader = pCurPnt[3];
+        naluType = naluHeader & 0x1f;
+        if (naluType >= 1 && naluType <= IDR_NALU_TYPE) {
+            nonReference = (naluHeader & 0x60) == 0;
+            break;
+        }
+
+        pCurPnt += 3;
+    }
+
+CleanUp:
+
+    if (pNonReference != NULL) {
+        *pNonReference = nonReference;
+    }
+
+    return retStatus;
+}
+
 STATUS convertCpdFromAvcToAnnexB(PGstKvsPlugin pGstKvsPlugin, PBYTE pData, UINT32 size)
 {
     STATUS retStatus = STATUS_SUCCESS;
@@ -10,6 +10,7 @@
 #define DEFAULT_ADAPT_CPD_NALS                 FALSE
 #define DEFAULT_ADAPT_FRAME_NALS               FALSE
 #define DEFAULT_DISABLE_BUFFER_CLIPPING        FALSE
+#define DEFAULT_LOW_LATENCY                    FALSE
 #define DEFAULT_CODEC_ID_H264                  "V_MPEG4/ISO/AVC"
 #define DEFAULT_CODEC_ID_H265                  "V_MPEGH/ISO/HEVC"
 #define DEFAULT_ACCESS_KEY                     "access_key"
@@ -68,6 +69,7 @@ STATUS lookForSslCert(PGstKvsPlugin);
 STATUS initTrackData(PGstKvsPlugin);
 STATUS identifyFrameNalFormat(PBYTE, UINT32, ELEMENTARY_STREAM_NAL_FORMAT*);
 STATUS identifyCpdNalFormat(PBYTE, UINT32, ELEMENTARY_STREAM_NAL_FORMAT*);
+STATUS identifyNonReferenceFrame(PBYTE, UINT32, PBOOL);
 STATUS convertCpdFromAvcToAnnexB(PGstKvsPlugin, PBYTE, UINT32);
 STATUS convertCpdFromHevcToAnnexB(PGstKvsPlugin, PBYTE, UINT32);
 
@@ -0,0 +1,249 @@
+#define LOG_CLASS "KvsProducer"
+#include "GstPlugin.h"
+
+STATUS initKinesisVideoProducer(PGstKvsPlugin pGstKvsPlugin)
+{
+    STATUS retStatus = STATUS_SUCCESS;
+    PKvsProducerContext pProducerContext;
+    PStreamCallbacks pStreamCallbacks = NULL;
+    PAuthCallbacks pAuthCallbacks = NULL;
+    PTrackInfo pTrackInfo;
+
+    CHK(pGstKvsPlugin != NULL, STATUS_NULL_ARG);
+    CHK_ERR(pGstKvsPlugin->kvsContext.pCredentialProvider != NULL, STATUS_INVALID_OPERATION, "Ingesting to a stream needs credentials");
+
+    pProducerContext = &pGstKvsPlugin->producerContext;
+    MEMSET(pProducerContext, 0x00, SIZEOF(KvsProducerContext));
+    pProducerContext->clientHandle = INVALID_CLIENT_HANDLE_VALUE;
+    pProducerContext->streamHandle = INVALID_STREAM_HANDLE_VALUE;
+    pProducerContext->lock = MUTEX_CREATE(FALSE);
+    pProducerContext->lastReportTime = GETTIME();
+
+    CHK_STATUS(createDefaultDeviceInfo(&pProducerContext->pDeviceInfo));
+    pProducerContext->pDeviceInfo->clientInfo.loggerLogLevel = pGstKvsPlugin->gstParams.logLevel;
+
+    if (pGstKvsPlugin->mediaType == GST_PLUGIN_MEDIA_TYPE_AUDIO_VIDEO) {
+        CHK_STATUS(createRealtimeAudioVideoStreamInfoProvider(pGstKvsPlugin->gstParams.streamName, GST_PLUGIN_STREAM_RETENTION_PERIOD,
+                                                              GST_PLUGIN_STREAM_BUFFER_DURATION, &pProducerContext->pStreamInfo));
+        STRNCPY(pProducerContext->pStreamInfo->streamCaps.trackInfoList[0].codecId, pGstKvsPlugin->gstParams.codecId, MKV_MAX_CODEC_ID_LEN);
+        STRNCPY(pProducerContext->pStreamInfo->streamCaps.trackInfoList[1].codecId, pGstKvsPlugin->audioCodecId, MKV_MAX_CODEC_ID_LEN);
+    } else {
+        CHK_STATUS(createRealtimeVideoStreamInfoProvider(pGstKvsPlugin->gstParams.streamName, GST_PLUGIN_STREAM_RETENTION_PERIOD,
+                                                         GST_PLUGIN_STREAM_BUFFER_DURATION, &pProducerContext->pStreamInfo));
+        pTrackInfo = &pProducerContext->pStreamInfo->streamCaps.trackInfoList[0];
+
+        // A single track keeps the video track id whatever it carries, see initTrackData
+        if (pGstKvsPlugin->mediaType == GST_PLUGIN_MEDIA_TYPE_AUDIO_ONLY) {
+            pTrackInfo->trackType = MKV_TRACK_INFO_TYPE_AUDIO;
+            STRNCPY(pTrackInfo->trackName, KVS_PRODUCER_AUDIO_TRACK_NAME, MKV_MAX_TRACK_NAME_LEN);
+            STRNCPY(pTrackInfo->codecId, pGstKvsPlugin->audioCodecId, MKV_MAX_CODEC_ID_LEN);
+        } else {
+            STRNCPY(pTrackInfo->codecId, pGstKvsPlugin->gstParams.codecId, MKV_MAX_CODEC_ID_LEN);
+        }
+    }
+
+    STRNCPY(pProducerContext->pStreamInfo->streamCaps.contentType, pGstKvsPlugin->gstParams.contentType, MAX_CONTENT_TYPE_LEN);
+
+    // The producer takes the frames as they come in, WebRTC gets its own Annex-B copy from the video lane
+    pProducerContext->pStreamInfo->streamCaps.nalAdaptationFlags = NAL_ADAPTATION_FLAG_NONE;
+    if (pGstKvsPlugin->gstParams.adaptCpdNals) {
+        pProducerContext->pStreamInfo->streamCaps.nalAdaptationFlags |= NAL_ADAPTATION_ANNEXB_CPD_NALS;
+    }
+
+    if (pGstKvsPlugin->gstParams.adaptFrameNals) {
+        pProducerContext->pStreamInfo->streamCaps.nalAdaptationFlags |= NAL_ADAPTATION_ANNEXB_NALS;
+    }
+
+    if (pGstKvsPlugin->gstParams.streamTags != NULL) {
+        CHK_STATUS(gstStructToTags(pGstKvsPlugin->gstParams.streamTags, &pProducerContext->tags));
+        pProducerContext->pStreamInfo->tagCount = pProducerContext->tags.tagCount;
+        pProducerContext->pStreamInfo->tags = pProducerContext->tags.tags;
+    }
+
+    CHK_STATUS(createAbstractDefaultCallbacksProvider(DEFAULT_CALLBACK_CHAIN_COUNT, API_CALL_CACHE_TYPE_ALL, ENDPOINT_UPDATE_PERIOD_SENTINEL_VALUE,
+                                                      pGstKvsPlugin->pRegion, EMPTY_STRING, pGstKvsPlugin->caCertPath, NULL, NULL,
+                                                      &pProducerContext->pClientCallbacks));
+
+    // Same credentials as the signaling client, the provider stays owned by the KVS context
+    CHK_STATUS(createCredentialProviderAuthCallbacks(pProducerContext->pClientCallbacks, pGstKvsPlugin->kvsContext.pCredentialProvider,
+                                                     &pAuthCallbacks));
+    CHK_STATUS(createContinuousRetryStreamCallbacks(pProducerContext->pClientCallbacks, &pStreamCallbacks));
+
+    pProducerContext->streamCallbacks.version = STREAM_CALLBACKS_CURRENT_VERSION;
+    pProducerContext->streamCallbacks.customData = (UINT64) pGstKvsPlugin;
+    pProducerContext->streamCallbacks.droppedFrameReportFn = producerDroppedFrameReportHandler;
+    pProducerContext->streamCallbacks.streamErrorReportFn = producerStreamErrorReportHandler;
+    CHK_STATUS(addStreamCallbacks(pProducerContext->pClientCallbacks, &pProducerContext->streamCallbacks));
+
+    CHK_STATUS(createKinesisVideoClient(pProducerContext->pDeviceInfo, pProducerContext->pClientCallbacks, &pProducerContext->clientHandle));
+    CHK_STATUS(createKinesisVideoStreamSync(pProducerContext->clientHandle, pProducerContext->pStreamInfo, &pProducerContext->streamHandle));
+
+    DLOGI("Ingesting to stream %s next to WebRTC", pGstKvsPlugin->gstParams.streamName);
+
+CleanUp:
+
+    CHK_LOG_ERR(retStatus);
+    return retStatus;
+}
+
+STATUS freeKinesisVideoProducer(PGstKvsPlugin pGstKvsPlugin)
+{
+    STATUS retStatus = STATUS_SUCCESS;
+    PKvsProducerContext pProducerContext;
+
+    CHK(pGstKvsPlugin != NULL, STATUS_NULL_ARG);
+    pProducerContext = &pGstKvsPlugin->producerContext;
+
+    if (IS_VALID_STREAM_HANDLE(pProducerContext->streamHandle)) {
+        // Flushes whatever is still buffered
+        CHK_LOG_ERR(stopKinesisVideoStreamSync(pProducerContext->streamHandle));
+        freeKinesisVideoStream(&pProducerContext->streamHandle);
+    }
+
+    if (IS_VALID_CLIENT_HANDLE(pProducerContext->clientHandle)) {
+        freeKinesisVideoClient(&pProducerContext->clientHandle);
+    }
+
+    // Also frees the stream and auth callbacks added to it
+    if (pProducerContext->pClientCallbacks != NULL) {
+        freeCallbacksProvider(&pProducerContext->pClientCallbacks);
+    }
+
+    if (pProducerContext->pStreamInfo != NULL) {
+        freeStreamInfoProvider(&pProducerContext->pStreamInfo);
+    }
+
+    if (pProducerContext->pDeviceInfo != NULL) {
+        freeDeviceInfo(&pProducerContext->pDeviceInfo);
+    }
+
+    if (IS_VALID_MUTEX_VALUE(pProducerContext->lock)) {
+        MUTEX_FREE(pProducerContext->lock);
+        pProducerContext->lock = INVALID_MUTEX_VALUE;
+    }
+
+CleanUp:
+
+    return retStatus;
+}
+
+STATUS putFrameToKinesisVideoStream(PGstKvsPlugin pGstKvsPlugin, PFrame pFrame)
+{
+    STATUS retStatus = STATUS_SUCCESS, status;
+    PKvsProducerContext pProducerContext;
+    UINT64 startTime, latency;
+
+    CHK(pGstKvsPlugin != NULL && pFrame != NULL, STATUS_NULL_ARG);
+    pProducerContext = &pGstKvsPlugin->producerContext;
+    CHK(IS_VALID_STREAM_HANDLE(pProducerContext->streamHandle), retStatus);
+
+    // The producer copies the frame into its own buffer before this returns
+    startTime = GETTIME();
+    status = putKinesisVideoFrame(pProducerContext->streamHandle, pFrame);
+    latency = GETTIME() - startTime;
+
+    MUTEX_LOCK(pProducerContext->lock);
+    if (STATUS_SUCCEEDED(status)) {
+        pProducerContext->putFrames++;
+        pProducerContext->latencySum += latency;
+        pProducerContext->maxLatency = MAX(pProducerContext->maxLatency, latency);
+    } else {
+        pProducerContext->failedFrames++;
+    }
+    MUTEX_UNLOCK(pProducerContext->lock);
+
+    CHK_STATUS(status);
+
+CleanUp:
+
+    return retStatus;
+}
+
+STATUS putKinesisVideoStreamCpd(PGstKvsPlugin pGstKvsPlugin, PBYTE pCpd, UINT32 cpdSize, UINT64 trackId)
+{
+    STATUS retStatus = STATUS_SUCCESS;
+
+    CHK(pGstKvsPlugin != NULL && pCpd != NULL, STATUS_NULL_ARG);
+    CHK(IS_VALID_STREAM_HANDLE(pGstKvsPlugin->producerContext.streamHandle), retStatus);
+
+    CHK_STATUS(kinesisVideoStreamFormatChanged(pGstKvsPlugin->producerContext.streamHandle, cpdSize, pCpd, trackId));
+
+CleanUp:
+
+    CHK_LOG_ERR(retStatus);
+    return retStatus;
+}
+
+STATUS putKinesisVideoStreamMetadata(PGstKvsPlugin pGstKvsPlugin, PCHAR pName, PCHAR pValue, BOOL persistent)
+{
+    STATUS retStatus = STATUS_SUCCESS;
+
+    CHK(pGstKvsPlugin != NULL && pName != NULL && pValue != NULL, STATUS_NULL_ARG);
+    CHK(IS_VALID_STREAM_HANDLE(pGstKvsPlugin->producerContext.streamHandle), retStatus);
+
+    CHK_STATUS(putKinesisVideoFragmentMetadata(pGstKvsPlugin->producerContext.streamHandle, pName, pValue, persistent));
+
+CleanUp:
+
+    CHK_LOG_ERR(retStatus);
+    return retStatus;
+}
+
+VOID reportKinesisVideoProducerStats(PGstKvsPlugin pGstKvsPlugin, UINT64 currentTime)
+{
+    PKvsProducerContext pProducerContext = &pGstKvsPlugin->producerContext;
+    StreamMetrics streamMetrics;
+    UINT32 droppedFrames;
+
+    if (!IS_VALID_STREAM_HANDLE(pProducerContext->streamHandle)) {
+        return;
+    }
+
+    MEMSET(&streamMetrics, 0x00, SIZEOF(StreamMetrics));
+    streamMetrics.version = STREAM_METRICS_CURRENT_VERSION;
+    CHK_LOG_ERR(getKinesisVideoStreamMetrics(pProducerContext->streamHandle, &streamMetrics));
+
+    MUTEX_LOCK(pProducerContext->lock);
+    if (currentTime >= pProducerContext->lastReportTime + GST_PLUGIN_STREAM_REPORT_PERIOD) {
+        droppedFrames = (UINT32) ATOMIC_EXCHANGE(&pProducerContext->droppedFrames, 0);
+        if (pProducerContext->putFrames != 0 || pProducerContext->failedFrames != 0 || droppedFrames != 0) {
+            DLOGI("Stream sink: %u frames put, %u failed, %u dropped from the buffer, put latency avg %" PRIu64 " us max %" PRIu64
+                  " us, %" PRIu64 " ms buffered",
+                  pProducerContext->putFrames, pProducerContext->failedFrames, droppedFrames,
+                  pProducerContext->putFrames == 0 ? 0 : pProducerContext->latencySum / pProducerContext->putFrames / HUNDREDS_OF_NANOS_IN_A_MICROSECOND,
+                  pProducerContext->maxLatency / HUNDREDS_OF_NANOS_IN_A_MICROSECOND,
+                  streamMetrics.currentViewDuration / HUNDREDS_OF_NANOS_IN_A_MILLISECOND);
+        }
+
+        pProducerContext->lastReportTime = currentTime;
+        pProducerContext->putFrames = 0;
+        pProducerContext->failedFrames = 0;
+        pProducerContext->latencySum = 0;
+        pProducerContext->maxLatency = 0;
+    }
+    MUTEX_UNLOCK(pProducerContext->lock);
+}
+
+STATUS producerDroppedFrameReportHandler(UINT64 customData, STREAM_HANDLE streamHandle, UINT64 timecode)
+{
+    UNUSED_PARAM(streamHandle);
+    PGstKvsPlugin pGstKvsPlugin = (PGstKvsPlugin) customData;
+
+    DLOGW("Stream dropped a frame at %" PRIu64, timecode);
+    ATOMIC_INCREMENT(&pGstKvsPlugin->producerContext.droppedFrames);
+
+    return STATUS_SUCCESS;
+}
+
+STATUS producerStreamErrorReportHandler(UINT64 customData, STREAM_HANDLE streamHandle, UPLOAD_HANDLE uploadHandle, UINT64 erroredTimecode,
+                                        STATUS statusCode)
+{
+    UNUSED_PARAM(customData);
+    UNUSED_PARAM(streamHandle);
+    UNUSED_PARAM(uploadHandle);
+
+    // The continuous retry callbacks take care of the recovery
+    DLOGW("Stream reported error 0x%08x at %" PRIu64, statusCode, erroredTimecode);
+
+    return STATUS_SUCCESS;
+}
@@ -0,0 +1,21 @@
+#ifndef __KVS_PRODUCER_FUNCTIONALITY_H__
+#define __KVS_PRODUCER_FUNCTIONALITY_H__
+
+#define DEFAULT_STREAM_NAME ""
+
+#define GST_PLUGIN_STREAM_RETENTION_PERIOD (2 * HUNDREDS_OF_NANOS_IN_AN_HOUR)
+#define GST_PLUGIN_STREAM_BUFFER_DURATION  (120 * HUNDREDS_OF_NANOS_IN_A_SECOND)
+#define GST_PLUGIN_STREAM_REPORT_PERIOD    (10 * HUNDREDS_OF_NANOS_IN_A_SECOND)
+
+#define KVS_PRODUCER_AUDIO_TRACK_NAME "kvs audio track"
+
+STATUS initKinesisVideoProducer(PGstKvsPlugin);
+STATUS freeKinesisVideoProducer(PGstKvsPlugin);
+STATUS putFrameToKinesisVideoStream(PGstKvsPlugin, PFrame);
+STATUS putKinesisVideoStreamCpd(PGstKvsPlugin, PBYTE, UINT32, UINT64);
+STATUS putKinesisVideoStreamMetadata(PGstKvsPlugin, PCHAR, PCHAR, BOOL);
+VOID reportKinesisVideoProducerStats(PGstKvsPlugin, UINT64);
+STATUS producerDroppedFrameReportHandler(UINT64, STREAM_HANDLE, UINT64);
+STATUS producerStreamErrorReportHandler(UINT64, STREAM_HANDLE, UPLOAD_HANDLE, UINT64, STATUS);
+
+#endif //__KVS_PRODUCER_FUNCTIONALITY_H__
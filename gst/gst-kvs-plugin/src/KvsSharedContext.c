@@ -0,0 +1,383 @@
+#define LOG_CLASS "KvsSharedContext"
+#include "GstPlugin.h"
+#include "VirtcamCurl.h"
+
+// The SDK, curl, the timer queue thread, the certificate pool, the credential providers, the TURN probe results and the virtcam
+// thread are set up by the first element and torn down with the last one, so every further camera pipeline in the process only
+// adds its own signaling client and sessions
+static KvsSharedContext gKvsSharedContext;
+G_LOCK_DEFINE_STATIC(sharedContext);
+
+static STATUS freeKvsSharedContext(PKvsSharedContext pSharedContext)
+{
+    STATUS retStatus = STATUS_SUCCESS;
+    StackQueueIterator iterator;
+    UINT64 data;
+    PSharedCredentialProvider pSharedCredentialProvider;
+
+    if (IS_VALID_TIMER_QUEUE_HANDLE(pSharedContext->timerQueueHandle)) {
+        if (pSharedContext->pregenerateCertTimerId != MAX_UINT32) {
+            retStatus = timerQueueCancelTimer(pSharedContext->timerQueueHandle, pSharedContext->pregenerateCertTimerId, (UINT64) pSharedContext);
+            if (STATUS_FAILED(retStatus)) {
+                DLOGE("Failed to cancel certificate pre-generation timer with: 0x%08x", retStatus);
+            }
+            pSharedContext->pregenerateCertTimerId = MAX_UINT32;
+        }
+
+        timerQueueFree(&pSharedContext->timerQueueHandle);
+        pSharedContext->timerQueueHandle = INVALID_TIMER_QUEUE_HANDLE_VALUE;
+    }
+
+    if (pSharedContext->pregeneratedCertificates != NULL) {
+        stackQueueGetIterator(pSharedContext->pregeneratedCertificates, &iterator);
+        while (IS_VALID_ITERATOR(iterator)) {
+            stackQueueIteratorGetItem(iterator, &data);
+            stackQueueIteratorNext(&iterator);
+            freeRtcCertificate((PRtcCertificate) data);
+        }
+
+        CHK_LOG_ERR(stackQueueClear(pSharedContext->pregeneratedCertificates, FALSE));
+        CHK_LOG_ERR(stackQueueFree(pSharedContext->pregeneratedCertificates));
+        pSharedContext->pregeneratedCertificates = NULL;
+    }
+
+    // Every element releases its provider before the context, anything left here has leaked a reference
+    if (pSharedContext->credentialProviders != NULL) {
+        stackQueueGetIterator(pSharedContext->credentialProviders, &iterator);
+        while (IS_VALID_ITERATOR(iterator)) {
+            stackQueueIteratorGetItem(iterator, &data);
+            stackQueueIteratorNext(&iterator);
+            pSharedCredentialProvider = (PSharedCredentialProvider) data;
+            // The key holds the credentials, keep it out of the logs
+            DLOGW("Credential provider still has %u references", pSharedCredentialProvider->refCount);
+            pSharedCredentialProvider->freeCredentialProviderFn(&pSharedCredentialProvider->pCredentialProvider);
+            g_free(pSharedCredentialProvider->key);
+            SAFE_MEMFREE(pSharedCredentialProvider);
+        }
+
+        CHK_LOG_ERR(stackQueueClear(pSharedContext->credentialProviders, FALSE));
+        CHK_LOG_ERR(stackQueueFree(pSharedContext->credentialProviders));
+        pSharedContext->credentialProviders = NULL;
+    }
+
+    if (IS_VALID_MUTEX_VALUE(pSharedContext->certificateLock)) {
+        MUTEX_FREE(pSharedContext->certificateLock);
+        pSharedContext->certificateLock = INVALID_MUTEX_VALUE;
+    }
+
+    freeTurnProbe(pSharedContext);
+    if (IS_VALID_MUTEX_VALUE(pSharedContext->turnProbeLock)) {
+        MUTEX_FREE(pSharedContext->turnProbeLock);
+        pSharedContext->turnProbeLock = INVALID_MUTEX_VALUE;
+    }
+
+    if (pSharedContext->pVirtcamView != NULL) {
+        // The view thread polls the flag between its requests
+        ATOMIC_STORE_BOOL(&pSharedContext->pVirtcamView->interrupted, TRUE);
+        freeVirtcamView(pSharedContext->pVirtcamView);
+        pSharedContext->pVirtcamView = NULL;
+        gVirtcamView = NULL;
+    }
+
+    curl_global_cleanup();
+    deinitKvsWebRtc();
+
+    return retStatus;
+}
+
+static STATUS initKvsSharedContext(PKvsSharedContext pSharedContext)
+{
+    STATUS retStatus = STATUS_SUCCESS;
+    PCameraView pVirtcamView = NULL;
+
+    MEMSET(pSharedContext, 0x00, SIZEOF(KvsSharedContext));
+    pSharedContext->timerQueueHandle = INVALID_TIMER_QUEUE_HANDLE_VALUE;
+    pSharedContext->certificateLock = INVALID_MUTEX_VALUE;
+    pSharedContext->pregenerateCertTimerId = MAX_UINT32;
+    pSharedContext->turnProbeLock = INVALID_MUTEX_VALUE;
+    pSharedContext->turnProbeTid = INVALID_TID_VALUE;
+
+    CHK_STATUS(initKvsWebRtc());
+    curl_global_init(CURL_GLOBAL_ALL);
+
+    pSharedContext->certificateLock = MUTEX_CREATE(FALSE);
+    pSharedContext->turnProbeLock = MUTEX_CREATE(FALSE);
+    CHK_STATUS(stackQueueCreate(&pSharedContext->pregeneratedCertificates));
+    CHK_STATUS(stackQueueCreate(&pSharedContext->credentialProviders));
+
+    CHK_STATUS(timerQueueCreate(&pSharedContext->timerQueueHandle));
+    CHK_LOG_ERR(retStatus = timerQueueAddTimer(pSharedContext->timerQueueHandle, GST_PLUGIN_PRE_GENERATE_CERT_START,
+                                               GST_PLUGIN_PRE_GENERATE_CERT_PERIOD, pregenerateCertTimerCallback, (UINT64) pSharedContext,
+                                               &pSharedContext->pregenerateCertTimerId));
+
+    /* Initialize virtcam view and thread */
+    CHK_STATUS(createVirtcamView(&pVirtcamView));
+    pSharedContext->pVirtcamView = pVirtcamView;
+    if (!ATOMIC_EXCHANGE_BOOL(&pVirtcamView->viewThreadStarted, TRUE)) {
+        THREAD_CREATE(&pVirtcamView->viewTid, checkNewRecordingRoutine, (PVOID) pVirtcamView);
+        printf("[KVS GStreamer Master] Create thread to check for new cameraId\n");
+    }
+
+    gVirtcamView = pVirtcamView;
+
+CleanUp:
+
+    if (STATUS_FAILED(retStatus)) {
+        freeKvsSharedContext(pSharedContext);
+    }
+
+    return retStatus;
+}
+
+STATUS acquireKvsSharedContext(PKvsSharedContext* ppSharedContext)
+{
+    STATUS retStatus = STATUS_SUCCESS;
+    PKvsSharedContext pSharedContext = &gKvsSharedContext;
+
+    CHK(ppSharedContext != NULL, STATUS_NULL_ARG);
+
+    G_LOCK(sharedContext);
+    if (pSharedContext->refCount == 0) {
+        retStatus = initKvsSharedContext(pSharedContext);
+    }
+
+    if (STATUS_SUCCEEDED(retStatus)) {
+        pSharedContext->refCount++;
+        *ppSharedContext = pSharedContext;
+        DLOGI("Shared context is referenced by %u elements", pSharedContext->refCount);
+    }
+    G_UNLOCK(sharedContext);
+
+CleanUp:
+
+    CHK_LOG_ERR(retStatus);
+    return retStatus;
+}
+
+STATUS releaseKvsSharedContext(PKvsSharedContext* ppSharedContext)
+{
+    STATUS retStatus = STATUS_SUCCESS;
+    PKvsSharedContext pSharedContext;
+
+    CHK(ppSharedContext != NULL, STATUS_NULL_ARG);
+    pSharedContext = *ppSharedContext;
+    CHK(pSharedContext != NULL, retStatus);
+
+    G_LOCK(sharedContext);
+    if (--pSharedContext->refCount == 0) {
+        retStatus = freeKvsSharedContext(pSharedContext);
+    }
+    G_UNLOCK(sharedContext);
+
+    *ppSharedContext = NULL;
+
+CleanUp:
+
+    CHK_LOG_ERR(retStatus);
+    return retStatus;
+}
+
+STATUS pregenerateCertTimerCallback(UINT32 timerId, UINT64 currentTime, UINT64 customData)
+{
+    UNUSED_PARAM(timerId);
+    UNUSED_PARAM(currentTime);
+    STATUS retStatus = STATUS_SUCCESS;
+    PKvsSharedContext pSharedContext = (PKvsSharedContext) customData;
+    BOOL locked = FALSE;
+    UINT32 certCount, targetCount;
+    PRtcCertificate pRtcCertificate = NULL;
+
+    CHK_WARN(pSharedContext != NULL, STATUS_NULL_ARG, "pregenerateCertTimerCallback(): Passed argument is NULL");
+
+    // One certificate ready per element, the reference count is only read here so the global lock isn't needed
+    targetCount = MIN(MAX(pSharedContext->refCount, MAX_RTCCONFIGURATION_CERTIFICATES), GST_PLUGIN_MAX_PREGENERATED_CERTIFICATES);
+
+    MUTEX_LOCK(pSharedContext->certificateLock);
+    locked = TRUE;
+
+    // Quick check if there is anything that needs to be done.
+    CHK_STATUS(stackQueueGetCount(pSharedContext->pregeneratedCertificates, &certCount));
+    CHK(certCount < targetCount, retStatus);
+
+    // Generating the key pair is the slow part, the sessions can take certificates meanwhile
+    MUTEX_UNLOCK(pSharedContext->certificateLock);
+    locked = FALSE;
+
+    // Generate the certificate with the keypair
+    CHK_STATUS(createRtcCertificate(&pRtcCertificate));
+
+    // Add to the stack queue
+    MUTEX_LOCK(pSharedContext->certificateLock);
+    locked = TRUE;
+    CHK_STATUS(stackQueueEnqueue(pSharedContext->pregeneratedCertificates, (UINT64) pRtcCertificate));
+
+    DLOGV("New certificate has been pre-generated and added to the queue");
+
+    // Reset it so it won't be freed on exit
+    pRtcCertificate = NULL;
+
+    MUTEX_UNLOCK(pSharedContext->certificateLock);
+    locked = FALSE;
+
+CleanUp:
+
+    if (pRtcCertificate != NULL) {
+        freeRtcCertificate(pRtcCertificate);
+    }
+
+    if (locked) {
+        MUTEX_UNLOCK(pSharedContext->certificateLock);
+    }
+
+    return retStatus;
+}
+
+// Hands over a pre-generated certificate the caller frees after use, or NULL when the pool is empty
+STATUS takePregeneratedCertificate(PKvsSharedContext pSharedContext, PRtcCertificate* ppRtcCertificate)
+{
+    STATUS retStatus = STATUS_SUCCESS;
+    UINT64 data;
+
+    CHK(pSharedContext != NULL && ppRtcCertificate != NULL, STATUS_NULL_ARG);
+    *ppRtcCertificate = NULL;
+
+    MUTEX_LOCK(pSharedContext->certificateLock);
+    retStatus = stackQueueDequeue(pSharedContext->pregeneratedCertificates, &data);
+    MUTEX_UNLOCK(pSharedContext->certificateLock);
+
+    CHK(retStatus == STATUS_SUCCESS || retStatus == STATUS_NOT_FOUND, retStatus);
+
+    if (retStatus == STATUS_NOT_FOUND) {
+        retStatus = STATUS_SUCCESS;
+    } else {
+        *ppRtcCertificate = (PRtcCertificate) data;
+    }
+
+CleanUp:
+
+    return retStatus;
+}
+
+// Must be called under the global lock
+static PSharedCredentialProvider findSharedCredentialProvider(PKvsSharedContext pSharedContext, PCHAR key,
+                                                              PAwsCredentialProvider pCredentialProvider)
+{
+    StackQueueIterator iterator;
+    UINT64 data;
+    PSharedCredentialProvider pSharedCredentialProvider;
+
+    stackQueueGetIterator(pSharedContext->credentialProviders, &iterator);
+    while (IS_VALID_ITERATOR(iterator)) {
+        stackQueueIteratorGetItem(iterator, &data);
+        stackQueueIteratorNext(&iterator);
+        pSharedCredentialProvider = (PSharedCredentialProvider) data;
+        if ((key != NULL && 0 == STRCMP(pSharedCredentialProvider->key, key)) ||
+            (pCredentialProvider != NULL && pSharedCredentialProvider->pCredentialProvider == pCredentialProvider)) {
+            return pSharedCredentialProvider;
+        }
+    }
+
+    return NULL;
+}
+
+// References the provider created for the given credentials, STATUS_NOT_FOUND if there is none yet
+STATUS getSharedCredentialProvider(PKvsSharedContext pSharedContext, PCHAR key, PAwsCredentialProvider* ppCredentialProvider)
+{
+    STATUS retStatus = STATUS_SUCCESS;
+    PSharedCredentialProvider pSharedCredentialProvider;
+
+    CHK(pSharedContext != NULL && key != NULL && ppCredentialProvider != NULL, STATUS_NULL_ARG);
+
+    G_LOCK(sharedContext);
+    if (NULL != (pSharedCredentialProvider = findSharedCredentialProvider(pSharedContext, key, NULL))) {
+        pSharedCredentialProvider->refCount++;
+        *ppCredentialProvider = pSharedCredentialProvider->pCredentialProvider;
+    } else {
+        retStatus = STATUS_NOT_FOUND;
+    }
+    G_UNLOCK(sharedContext);
+
+CleanUp:
+
+    return retStatus;
+}
+
+// Takes over a newly created provider. If another element has added one for the same credentials meanwhile,
+// the new provider is freed and the existing one is returned instead.
+STATUS addSharedCredentialProvider(PKvsSharedContext pSharedContext, PCHAR key, freeCredentialProviderFunc freeCredentialProviderFn,
+                                   PAwsCredentialProvider* ppCredentialProvider)
+{
+    STATUS retStatus = STATUS_SUCCESS;
+    PSharedCredentialProvider pSharedCredentialProvider = NULL;
+    BOOL locked = FALSE;
+
+    CHK(pSharedContext != NULL && key != NULL && freeCredentialProviderFn != NULL && ppCredentialProvider != NULL &&
+            *ppCredentialProvider != NULL,
+        STATUS_NULL_ARG);
+
+    G_LOCK(sharedContext);
+    locked = TRUE;
+
+    if (NULL != (pSharedCredentialProvider = findSharedCredentialProvider(pSharedContext, key, NULL))) {
+        freeCredentialProviderFn(ppCredentialProvider);
+        pSharedCredentialProvider->refCount++;
+        *ppCredentialProvider = pSharedCredentialProvider->pCredentialProvider;
+        pSharedCredentialProvider = NULL;
+        CHK(FALSE, retStatus);
+    }
+
+    CHK(NULL != (pSharedCredentialProvider = (PSharedCredentialProvider) MEMCALLOC(1, SIZEOF(SharedCredentialProvider))), STATUS_NOT_ENOUGH_MEMORY);
+    pSharedCredentialProvider->key = g_strdup(key);
+    pSharedCredentialProvider->refCount = 1;
+    pSharedCredentialProvider->pCredentialProvider = *ppCredentialProvider;
+    pSharedCredentialProvider->freeCredentialProviderFn = freeCredentialProviderFn;
+    CHK_STATUS(stackQueueEnqueue(pSharedContext->credentialProviders, (UINT64) pSharedCredentialProvider));
+
+    // Owned by the list now
+    pSharedCredentialProvider = NULL;
+
+CleanUp:
+
+    if (locked) {
+        G_UNLOCK(sharedContext);
+    }
+
+    if (pSharedCredentialProvider != NULL) {
+        g_free(pSharedCredentialProvider->key);
+        SAFE_MEMFREE(pSharedCredentialProvider);
+    }
+
+    return retStatus;
+}
+
+STATUS releaseSharedCredentialProvider(PKvsSharedContext pSharedContext, PAwsCredentialProvider* ppCredentialProvider)
+{
+    STATUS retStatus = STATUS_SUCCESS;
+    PSharedCredentialProvider pSharedCredentialProvider = NULL;
+
+    CHK(pSharedContext != NULL && ppCredentialProvider != NULL, STATUS_NULL_ARG);
+    CHK(*ppCredentialProvider != NULL, retStatus);
+
+    G_LOCK(sharedContext);
+    if (NULL != (pSharedCredentialProvider = findSharedCredentialProvider(pSharedContext, NULL, *ppCredentialProvider)) &&
+        --pSharedCredentialProvider->refCount == 0) {
+        retStatus = stackQueueRemoveItem(pSharedContext->credentialProviders, (UINT64) pSharedCredentialProvider);
+    } else {
+        pSharedCredentialProvider = NULL;
+    }
+    G_UNLOCK(sharedContext);
+
+    // Free the last reference outside of the lock as the IoT provider waits for its pending request
+    if (pSharedCredentialProvider != NULL) {
+        pSharedCredentialProvider->freeCredentialProviderFn(&pSharedCredentialProvider->pCredentialProvider);
+        g_free(pSharedCredentialProvider->key);
+        SAFE_MEMFREE(pSharedCredentialProvider);
+    }
+
+    *ppCredentialProvider = NULL;
+
+CleanUp:
+
+    CHK_LOG_ERR(retStatus);
+    return retStatus;
+}
@@ -0,0 +1,18 @@
+#ifndef __KVS_SHARED_CONTEXT_H__
+#define __KVS_SHARED_CONTEXT_H__
+
+// Upper bound of the shared certificate pool, it otherwise grows with the number of elements
+#define GST_PLUGIN_MAX_PREGENERATED_CERTIFICATES 16
+
+#define GST_PLUGIN_CREDENTIAL_KEY_STATIC "static"
+#define GST_PLUGIN_CREDENTIAL_KEY_IOT    "iot"
+
+STATUS acquireKvsSharedContext(PKvsSharedContext*);
+STATUS releaseKvsSharedContext(PKvsSharedContext*);
+STATUS pregenerateCertTimerCallback(UINT32, UINT64, UINT64);
+STATUS takePregeneratedCertificate(PKvsSharedContext, PRtcCertificate*);
+STATUS getSharedCredentialProvider(PKvsSharedContext, PCHAR, PAwsCredentialProvider*);
+STATUS addSharedCredentialProvider(PKvsSharedContext, PCHAR, freeCredentialProviderFunc, PAwsCredentialProvider*);
+STATUS releaseSharedCredentialProvider(PKvsSharedContext, PAwsCredentialProvider*);
+
+#endif //__KVS_SHARED_CONTEXT_H__
@@ -9,7 +9,7 @@ PCameraView gVirtcamView = NULL;
 STATUS signalingClientStateChangedFn(UINT64 customData, SIGNALING_CLIENT_STATE state)
 {
     DLOGD("signalingClientStateChangedFn");
-    UNUSED_PARAM(customData);
+    PGstKvsPlugin pGstKvsPlugin = (PGstKvsPlugin) customData;
     STATUS retStatus = STATUS_SUCCESS;
     PCHAR pStateStr;
 
@@ -17,6 +17,11 @@ STATUS signalingClientStateChangedFn(UINT64 customData, SIGNALING_CLIENT_STATE s
 
     DLOGV("Signaling client state changed to %d - '%s'", state, pStateStr);
 
+    // Ready is where the service pass connects the client
+    if (state == SIGNALING_CLIENT_STATE_READY) {
+        notifySessionLifecycle(&pGstKvsPlugin->sessionLifecycle, GST_PLUGIN_LIFECYCLE_EVENT_SIGNALING);
+    }
+
     // Return success to continue
     return retStatus;
 }
@@ -30,7 +35,11 @@ STATUS signalingClientErrorFn(UINT64 customData, STATUS status, PCHAR msg, UINT3
 
     // We will force re-create the signaling client on the following errors
     if (status == STATUS_SIGNALING_ICE_CONFIG_REFRESH_FAILED || status == STATUS_SIGNALING_RECONNECT_FAILED) {
+        if (ATOMIC_LOAD(&pGstKvsPlugin->sessionLifecycle.recreateRequestTime) == 0) {
+            ATOMIC_STORE(&pGstKvsPlugin->sessionLifecycle.recreateRequestTime, (SIZE_T) GETTIME());
+        }
         ATOMIC_STORE_BOOL(&pGstKvsPlugin->recreateSignalingClient, TRUE);
+        notifySessionLifecycle(&pGstKvsPlugin->sessionLifecycle, GST_PLUGIN_LIFECYCLE_EVENT_SIGNALING);
     }
 
     return STATUS_SUCCESS;
@@ -73,16 +82,24 @@ VOID onConnectionStateChange(UINT64 customData, RTC_PEER_CONNECTION_STATE newSta
     switch (newState) {
         case RTC_PEER_CONNECTION_STATE_CONNECTED:
             ATOMIC_STORE_BOOL(&pStreamingSession->connected, TRUE);
+            recordSessionConnected(pStreamingSession);
             if (STATUS_FAILED(retStatus = logSelectedIceCandidatesInformation(pStreamingSession))) {
                 DLOGW("Failed to get information about selected Ice candidates: 0x%08x", retStatus);
             }
             break;
         case RTC_PEER_CONNECTION_STATE_FAILED:
             // explicit fallthrough
-        case RTC_PEER_CONNECTION_STATE_CLOSED:
-            // explicit fallthrough
         case RTC_PEER_CONNECTION_STATE_DISCONNECTED:
-            ATOMIC_STORE_BOOL(&pStreamingSession->terminateFlag, TRUE);
+            // The viewer gets the grace period to restart ICE on this peer connection, see sessionServiceHandler
+            if (ATOMIC_LOAD(&pStreamingSession->disconnectTime) == 0) {
+                DLOGI("Lost the connection to peer %s, waiting for it to restart ICE", pStreamingSession->peerId);
+                ATOMIC_STORE(&pStreamingSession->disconnectTime, (SIZE_T) GETTIME());
+                notifySessionLifecycle(&pStreamingSession->pGstKvsPlugin->sessionLifecycle, GST_PLUGIN_LIFECYCLE_EVENT_SESSION);
+            }
+            ATOMIC_STORE_BOOL(&pStreamingSession->connected, FALSE);
+            break;
+        case RTC_PEER_CONNECTION_STATE_CLOSED:
+            terminateStreamingSession(pStreamingSession);
             // explicit fallthrough
         default:
             ATOMIC_STORE_BOOL(&pStreamingSession->connected, FALSE);
@@ -98,7 +115,7 @@ STATUS signalingClientMessageReceivedFn(UINT64 customData, PReceivedSignalingMes
 {
     STATUS retStatus = STATUS_SUCCESS;
     PGstKvsPlugin pGstKvsPlugin = (PGstKvsPlugin) customData;
-    BOOL peerConnectionFound = FALSE;
+    BOOL peerConnectionFound = FALSE, restarted = FALSE;
     BOOL locked = TRUE;
     if (IS_VALID_MUTEX_VALUE(pGstKvsPlugin->sessionLock)) {
         if (!locked)
@@ -127,9 +144,23 @@ STATUS signalingClientMessageReceivedFn(UINT64 customData, PReceivedSignalingMes
 
     switch (pReceivedSignalingMessage->signalingMessage.messageType) {
         case SIGNALING_MESSAGE_TYPE_OFFER:
-            // Check if we already have an ongoing master session with the same peer
-            CHK_ERR(!peerConnectionFound, STATUS_INVALID_OPERATION, "Peer connection %s is in progress",
-                    pReceivedSignalingMessage->signalingMessage.peerClientId);
+            // Another offer from a peer with a live session restarts ICE on it instead of starting over
+            if (peerConnectionFound && !ATOMIC_LOAD_BOOL(&pStreamingSession->terminateFlag)) {
+                CHK_STATUS(handleRestartOffer(pGstKvsPlugin, pStreamingSession, &pReceivedSignalingMessage->signalingMessage, &restarted));
+                if (restarted) {
+                    break;
+                }
+            }
+
+            // Anything else replaces the session of the peer. The service pass detaches the old one from the list, the peer
+            // table only knows the new one from here on.
+            if (peerConnectionFound) {
+                DLOGI("Peer %s sent an offer for a new connection, replacing its session", pStreamingSession->peerId);
+                terminateStreamingSession(pStreamingSession);
+                CHK_STATUS(hashTableRemove(pGstKvsPlugin->pRtcPeerConnectionForRemoteClient, clientIdHash));
+                peerConnectionFound = FALSE;
+                pStreamingSession = NULL;
+            }
 
             /*
              * Create new streaming session for each offer, then insert the client id and streaming session into
@@ -207,6 +238,9 @@ STATUS signalingClientMessageReceivedFn(UINT64 customData, PReceivedSignalingMes
                 *pReceivedSignalingMessageCopy = *pReceivedSignalingMessage;
                 CHK_STATUS(stackQueueEnqueue(pPendingMessageQueue->messageQueue, (UINT64) pReceivedSignalingMessageCopy));
 
+                // Brings its expiry into the deadlines of the service pass
+                notifySessionLifecycle(&pGstKvsPlugin->sessionLifecycle, GST_PLUGIN_LIFECYCLE_EVENT_PENDING_QUEUE);
+
                 // NULL the pointers to not free any longer
                 pPendingMessageQueue = NULL;
                 pReceivedSignalingMessageCopy = NULL;
@@ -247,9 +281,16 @@ STATUS initKinesisVideoWebRtc(PGstKvsPlugin pGstPlugin)
 
     pGstPlugin->sessionListReadLock = MUTEX_CREATE(FALSE);
     pGstPlugin->signalingLock = MUTEX_CREATE(FALSE);
+    pGstPlugin->reconnectStats.lock = MUTEX_CREATE(FALSE);
+    pGstPlugin->reconnectStats.lastReportTime = GETTIME();
+
+    // Audio frames are small and latency critical, video steps aside for them between sessions
+    CHK_STATUS(initSendLane(pGstPlugin, &pGstPlugin->audioLane, (PCHAR) "Audio", DEFAULT_AUDIO_TRACK_ID, GST_PLUGIN_AUDIO_LANE_MAX_DEPTH, FALSE,
+                            NULL));
+    CHK_STATUS(initSendLane(pGstPlugin, &pGstPlugin->videoLane, (PCHAR) "Video", DEFAULT_VIDEO_TRACK_ID, GST_PLUGIN_VIDEO_LANE_MAX_DEPTH, TRUE,
+                            &pGstPlugin->audioLane));
+    CHK_STATUS(initSessionReaper(pGstPlugin, &pGstPlugin->sessionReaper));
 
-    pGstPlugin->pregenerateCertTimerId = MAX_UINT32;
-    pGstPlugin->serviceRoutineTimerId = MAX_UINT32;
     pGstPlugin->iceUriCount = 0;
 
     MEMSET(&pGstPlugin->kvsContext.channelInfo, 0x00, SIZEOF(ChannelInfo));
@@ -270,6 +311,15 @@ STATUS initKinesisVideoWebRtc(PGstKvsPlugin pGstPlugin)
     pGstPlugin->kvsContext.channelInfo.pCertPath = pGstPlugin->caCertPath;
     pGstPlugin->kvsContext.channelInfo.messageTtl = 0; // Default is 60 seconds
 
+    if (pGstPlugin->gstParams.endpoint != NULL && pGstPlugin->gstParams.endpoint[0] != '\0') {
+        SNPRINTF(pGstPlugin->controlPlaneUrl, ARRAY_SIZE(pGstPlugin->controlPlaneUrl), "%s%s", CONTROL_PLANE_URI_PREFIX,
+                 pGstPlugin->gstParams.endpoint);
+        pGstPlugin->kvsContext.channelInfo.pControlPlaneUrl = pGstPlugin->controlPlaneUrl;
+
+        // Cached endpoints are keyed by channel and region only, don't mix them with the overridden ones
+        pGstPlugin->kvsContext.channelInfo.cachingPolicy = SIGNALING_API_CALL_CACHE_TYPE_NONE;
+    }
+
     pGstPlugin->kvsContext.signalingClientCallbacks.version = SIGNALING_CLIENT_CALLBACKS_CURRENT_VERSION;
     pGstPlugin->kvsContext.signalingClientCallbacks.errorReportFn = signalingClientErrorFn;
     pGstPlugin->kvsContext.signalingClientCallbacks.stateChangeFn = signalingClientStateChangedFn;
@@ -284,11 +334,8 @@ STATUS initKinesisVideoWebRtc(PGstKvsPlugin pGstPlugin)
     CHK_STATUS(hashTableCreateWithParams(GST_PLUGIN_HASH_TABLE_BUCKET_COUNT, GST_PLUGIN_HASH_TABLE_BUCKET_LENGTH,
                                          &pGstPlugin->pRtcPeerConnectionForRemoteClient));
 
-    CHK_STATUS(timerQueueCreate(&pGstPlugin->kvsContext.timerQueueHandle));
-    CHK_STATUS(stackQueueCreate(&pGstPlugin->pregeneratedCertificates));
-    CHK_LOG_ERR(retStatus = timerQueueAddTimer(pGstPlugin->kvsContext.timerQueueHandle, GST_PLUGIN_PRE_GENERATE_CERT_START,
-                                               GST_PLUGIN_PRE_GENERATE_CERT_PERIOD, pregenerateCertTimerCallback, (UINT64) pGstPlugin,
-                                               &pGstPlugin->pregenerateCertTimerId));
+    // The timers of the element run on the shared timer queue
+    pGstPlugin->kvsContext.timerQueueHandle = pGstPlugin->pSharedContext->timerQueueHandle;
 
     // Create the signaling client
     CHK_STATUS(createSignalingClientSync(&pGstPlugin->kvsContext.signalingClientInfo, &pGstPlugin->kvsContext.channelInfo,
@@ -298,21 +345,21 @@ STATUS initKinesisVideoWebRtc(PGstKvsPlugin pGstPlugin)
     // Get signaling client to Ready state
     CHK_STATUS(signalingClientFetchSync(pGstPlugin->kvsContext.signalingHandle));
 
+    // Rank the TURN servers before the first viewer shows up
+    if (pGstPlugin->gstParams.connectionMode != WEBRTC_CONNECTION_MODE_P2P_ONLY) {
+        CHK_LOG_ERR(submitTurnProbe(pGstPlugin->pSharedContext, pGstPlugin->kvsContext.signalingHandle));
+    }
+
     // Get signaling client to connect state
     if (ATOMIC_LOAD_BOOL(&pGstPlugin->connectWebRtc)) {
         CHK_STATUS(signalingClientConnectSync(pGstPlugin->kvsContext.signalingHandle));
     }
 
-    /* Initialize virtcam view and thread */
-    PCameraView pVirtcamView = NULL;
-    curl_global_init(CURL_GLOBAL_ALL);
-    CHK_STATUS(createVirtcamView(&pVirtcamView));
-    if (!ATOMIC_EXCHANGE_BOOL(&pVirtcamView->viewThreadStarted, TRUE)) {
-        THREAD_CREATE(&pVirtcamView->viewTid, checkNewRecordingRoutine, (PVOID) pVirtcamView);
-        printf("[KVS GStreamer Master] Create thread to check for new cameraId\n");
-    }
+    // The first lifecycle pass fetches the standby when it's enabled
+    CHK_STATUS(initSignalingStandby(pGstPlugin, &pGstPlugin->signalingStandby));
 
-    gVirtcamView = pVirtcamView;
+    // Everything from here on is driven by the lifecycle events, its first pass runs right away
+    CHK_STATUS(initSessionLifecycle(pGstPlugin, &pGstPlugin->sessionLifecycle));
 
 CleanUp:
 
@@ -374,10 +421,38 @@ STATUS freeGstKvsWebRtcPlugin(PGstKvsPlugin pGstKvsPlugin)
 
     CHK(pGstKvsPlugin != NULL, STATUS_NULL_ARG);
 
+    // No more service passes, sessions that terminate from here on are freed below. Its lock stays until nothing notifies anymore.
+    stopSessionLifecycle(&pGstKvsPlugin->sessionLifecycle);
+
+    // Nothing starts another standby once the passes stopped
+    freeSignalingStandby(&pGstKvsPlugin->signalingStandby);
+
+    // The shared timer queue keeps running, make sure none of the callbacks of the element fires anymore
+    if (IS_VALID_TIMER_QUEUE_HANDLE(pGstKvsPlugin->kvsContext.timerQueueHandle)) {
+        if (pGstKvsPlugin->iceCandidatePairStatsTimerId != MAX_UINT32) {
+            retStatus = timerQueueCancelTimer(pGstKvsPlugin->kvsContext.timerQueueHandle, pGstKvsPlugin->iceCandidatePairStatsTimerId,
+                                              (UINT64) pGstKvsPlugin);
+            if (STATUS_FAILED(retStatus)) {
+                DLOGE("Failed to cancel stats timer with: 0x%08x", retStatus);
+            }
+            pGstKvsPlugin->iceCandidatePairStatsTimerId = MAX_UINT32;
+        }
+
+        // The queue itself belongs to the shared context
+        pGstKvsPlugin->kvsContext.timerQueueHandle = INVALID_TIMER_QUEUE_HANDLE_VALUE;
+    }
+
     if (IS_VALID_SIGNALING_CLIENT_HANDLE(pGstKvsPlugin->kvsContext.signalingHandle)) {
         freeSignalingClient(&pGstKvsPlugin->kvsContext.signalingHandle);
     }
 
+    // Stop writing to the sessions before they go away. The video lane can be waiting on the audio one
+    freeSendLane(&pGstKvsPlugin->videoLane);
+    freeSendLane(&pGstKvsPlugin->audioLane);
+
+    // Frees what was detached before the service pass stopped. It takes the session lock to cancel the stats timer.
+    freeSessionReaper(&pGstKvsPlugin->sessionReaper);
+
     if (pGstKvsPlugin->pPendingSignalingMessageForRemoteClient != NULL) {
         // Iterate and free all the pending queues
         stackQueueGetIterator(pGstKvsPlugin->pPendingSignalingMessageForRemoteClient, &iterator);
@@ -414,7 +489,8 @@ STATUS freeGstKvsWebRtcPlugin(PGstKvsPlugin pGstKvsPlugin)
         MUTEX_UNLOCK(pGstKvsPlugin->sessionLock);
     }
 
-    deinitKvsWebRtc();
+    // The signaling clients, the standby fetch, the reaper and the closing peer connections are gone, none of them notifies anymore
+    freeSessionLifecycle(&pGstKvsPlugin->sessionLifecycle);
 
     if (IS_VALID_MUTEX_VALUE(pGstKvsPlugin->sessionLock)) {
         MUTEX_FREE(pGstKvsPlugin->sessionLock);
@@ -431,54 +507,11 @@ STATUS freeGstKvsWebRtcPlugin(PGstKvsPlugin pGstKvsPlugin)
         pGstKvsPlugin->signalingLock = INVALID_MUTEX_VALUE;
     }
 
-    if (IS_VALID_TIMER_QUEUE_HANDLE(pGstKvsPlugin->kvsContext.timerQueueHandle)) {
-        if (pGstKvsPlugin->iceCandidatePairStatsTimerId != MAX_UINT32) {
-            retStatus = timerQueueCancelTimer(pGstKvsPlugin->kvsContext.timerQueueHandle, pGstKvsPlugin->iceCandidatePairStatsTimerId,
-                                              (UINT64) pGstKvsPlugin);
-            if (STATUS_FAILED(retStatus)) {
-                DLOGE("Failed to cancel stats timer with: 0x%08x", retStatus);
-            }
-            pGstKvsPlugin->iceCandidatePairStatsTimerId = MAX_UINT32;
-        }
-
-        if (pGstKvsPlugin->pregenerateCertTimerId != MAX_UINT32) {
-            retStatus =
-                timerQueueCancelTimer(pGstKvsPlugin->kvsContext.timerQueueHandle, pGstKvsPlugin->pregenerateCertTimerId, (UINT64) pGstKvsPlugin);
-            if (STATUS_FAILED(retStatus)) {
-                DLOGE("Failed to cancel certificate pre-generation timer with: 0x%08x", retStatus);
-            }
-            pGstKvsPlugin->pregenerateCertTimerId = MAX_UINT32;
-        }
-
-        if (pGstKvsPlugin->serviceRoutineTimerId != MAX_UINT32) {
-            retStatus =
-                timerQueueCancelTimer(pGstKvsPlugin->kvsContext.timerQueueHandle, pGstKvsPlugin->serviceRoutineTimerId, (UINT64) pGstKvsPlugin);
-            if (STATUS_FAILED(retStatus)) {
-                DLOGE("Failed to cancel service handler routine timer with: 0x%08x", retStatus);
-            }
-            pGstKvsPlugin->serviceRoutineTimerId = MAX_UINT32;
-        }
-
-        timerQueueFree(&pGstKvsPlugin->kvsContext.timerQueueHandle);
-        pGstKvsPlugin->kvsContext.timerQueueHandle = INVALID_TIMER_QUEUE_HANDLE_VALUE;
-    }
-
-    if (pGstKvsPlugin->pregeneratedCertificates != NULL) {
-        stackQueueGetIterator(pGstKvsPlugin->pregeneratedCertificates, &iterator);
-        while (IS_VALID_ITERATOR(iterator)) {
-            stackQueueIteratorGetItem(iterator, &data);
-            stackQueueIteratorNext(&iterator);
-            freeRtcCertificate((PRtcCertificate) data);
-        }
-
-        CHK_LOG_ERR(stackQueueClear(pGstKvsPlugin->pregeneratedCertificates, FALSE));
-        CHK_LOG_ERR(stackQueueFree(pGstKvsPlugin->pregeneratedCertificates));
-        pGstKvsPlugin->pregeneratedCertificates = NULL;
+    if (IS_VALID_MUTEX_VALUE(pGstKvsPlugin->reconnectStats.lock)) {
+        MUTEX_FREE(pGstKvsPlugin->reconnectStats.lock);
+        pGstKvsPlugin->reconnectStats.lock = INVALID_MUTEX_VALUE;
     }
 
-    curl_global_cleanup();
-    freeVirtcamView(gVirtcamView);
-    
 CleanUp:
 
     return retStatus;
@@ -523,6 +556,14 @@ STATUS freeWebRtcStreamingSession(PWebRtcStreamingSession* ppStreamingSession)
 
     DLOGD("Freeing streaming session with peer id: %s ", pStreamingSession->peerId);
 
+    if (pStreamingSession->rateControl.droppedFrames != 0) {
+        DLOGI("Session with peer id %s had %" PRIu64 " of %" PRIu64 " video frames dropped over its rate budget, %" PRIu64 " holds, %" PRIu64
+              " recoveries",
+              pStreamingSession->peerId, pStreamingSession->rateControl.droppedFrames,
+              pStreamingSession->rateControl.sentFrames + pStreamingSession->rateControl.droppedFrames, pStreamingSession->rateControl.holds,
+              pStreamingSession->rateControl.recoveries);
+    }
+
     ATOMIC_STORE_BOOL(&pStreamingSession->terminateFlag, TRUE);
 
     if (pStreamingSession->shutdownCallback != NULL) {
@@ -571,52 +612,6 @@ CleanUp:
     return retStatus;
 }
 
-STATUS pregenerateCertTimerCallback(UINT32 timerId, UINT64 currentTime, UINT64 customData)
-{
-    UNUSED_PARAM(timerId);
-    UNUSED_PARAM(currentTime);
-    STATUS retStatus = STATUS_SUCCESS;
-    PGstKvsPlugin pGstKvsPlugin = (PGstKvsPlugin) customData;
-    BOOL locked = FALSE;
-    UINT32 certCount;
-    PRtcCertificate pRtcCertificate = NULL;
-
-    CHK_WARN(pGstKvsPlugin != NULL, STATUS_NULL_ARG, "pregenerateCertTimerCallback(): Passed argument is NULL");
-
-    MUTEX_LOCK(pGstKvsPlugin->sessionLock);
-    locked = TRUE;
-
-    // Quick check if there is anything that needs to be done.
-    CHK_STATUS(stackQueueGetCount(pGstKvsPlugin->pregeneratedCertificates, &certCount));
-    CHK(certCount != MAX_RTCCONFIGURATION_CERTIFICATES, retStatus);
-
-    // Generate the certificate with the keypair
-    CHK_STATUS(createRtcCertificate(&pRtcCertificate));
-
-    // Add to the stack queue
-    CHK_STATUS(stackQueueEnqueue(pGstKvsPlugin->pregeneratedCertificates, (UINT64) pRtcCertificate));
-
-    DLOGV("New certificate has been pre-generated and added to the queue");
-
-    // Reset it so it won't be freed on exit
-    pRtcCertificate = NULL;
-
-    MUTEX_UNLOCK(pGstKvsPlugin->sessionLock);
-    locked = FALSE;
-
-CleanUp:
-
-    if (pRtcCertificate != NULL) {
-        freeRtcCertificate(pRtcCertificate);
-    }
-
-    if (locked) {
-        MUTEX_UNLOCK(pGstKvsPlugin->sessionLock);
-    }
-
-    return retStatus;
-}
-
 STATUS getPendingMessageQueueForHash(PStackQueue pPendingQueue, UINT64 clientHash, BOOL remove, PPendingMessageQueue* ppPendingMessageQueue)
 {
     STATUS retStatus = STATUS_SUCCESS;
@@ -649,14 +644,16 @@ CleanUp:
     return retStatus;
 }
 
-STATUS removeExpiredMessageQueues(PStackQueue pPendingQueue)
+// Also returns when the next of the remaining queues expires, MAX_UINT64 when there are none
+STATUS removeExpiredMessageQueues(PStackQueue pPendingQueue, PUINT64 pNextExpiration)
 {
     STATUS retStatus = STATUS_SUCCESS;
     PPendingMessageQueue pPendingMessageQueue = NULL;
     UINT32 i, count;
     UINT64 data, curTime;
 
-    CHK(pPendingQueue != NULL, STATUS_NULL_ARG);
+    CHK(pPendingQueue != NULL && pNextExpiration != NULL, STATUS_NULL_ARG);
+    *pNextExpiration = MAX_UINT64;
 
     curTime = GETTIME();
     CHK_STATUS(stackQueueGetCount(pPendingQueue, &count));
@@ -673,6 +670,7 @@ STATUS removeExpiredMessageQueues(PStackQueue pPendingQueue)
         } else {
             // Enqueue back again as it's still valued
             CHK_STATUS(stackQueueEnqueue(pPendingQueue, data));
+            *pNextExpiration = MIN(*pNextExpiration, pPendingMessageQueue->createTime + GST_PLUGIN_PENDING_MESSAGE_CLEANUP_DURATION);
         }
     }
 
@@ -777,10 +775,13 @@ STATUS initializePeerConnection(PGstKvsPlugin pGstKvsPlugin, PRtcPeerConnection*
     ENTERS();
     STATUS retStatus = STATUS_SUCCESS;
     RtcConfiguration configuration;
-    UINT32 i, j, iceConfigCount, uriCount = 0, maxTurnServer = 1;
+    UINT32 i, j, iceConfigCount, uriCount = 0, orderCount = 0;
+    UINT32 order[MAX_ICE_CONFIG_COUNT];
+    UINT64 rtts[MAX_ICE_CONFIG_COUNT], rtt;
     PIceConfigInfo pIceConfigInfo;
-    UINT64 data, curTime;
+    UINT64 curTime;
     PRtcCertificate pRtcCertificate = NULL;
+    BOOL signalingLocked = FALSE;
 
     CHK(pGstKvsPlugin != NULL && ppRtcPeerConnection != NULL, STATUS_NULL_ARG);
 
@@ -797,13 +798,37 @@ STATUS initializePeerConnection(PGstKvsPlugin pGstKvsPlugin, PRtcPeerConnection*
     SNPRINTF(configuration.iceServers[0].urls, MAX_ICE_CONFIG_URI_LEN, KINESIS_VIDEO_STUN_URL, pGstKvsPlugin->kvsContext.channelInfo.pRegion);
 
     if (pGstKvsPlugin->gstParams.connectionMode != WEBRTC_CONNECTION_MODE_P2P_ONLY) {
+        // The signaling client can be replaced meanwhile, see replaceSignalingClient
+        MUTEX_LOCK(pGstKvsPlugin->signalingLock);
+        signalingLocked = TRUE;
+
         // Set the URIs from the configuration
         CHK_STATUS(signalingClientGetIceConfigInfoCount(pGstKvsPlugin->kvsContext.signalingHandle, &iceConfigCount));
 
-        /* signalingClientGetIceConfigInfoCount can return more than one turn server. Use only one to optimize
-         * candidate gathering latency. But user can also choose to use more than 1 turn server. */
-        for (uriCount = 0, i = 0; i < maxTurnServer; i++) {
+        // Probes the servers without a recent result in the background, this session goes with what is known now
+        CHK_LOG_ERR(submitTurnProbe(pGstKvsPlugin->pSharedContext, pGstKvsPlugin->kvsContext.signalingHandle));
+
+        // Fastest first, ties and servers without a result keep the signaling order
+        for (i = 0; i < MIN(iceConfigCount, MAX_ICE_CONFIG_COUNT); i++) {
             CHK_STATUS(signalingClientGetIceConfigInfo(pGstKvsPlugin->kvsContext.signalingHandle, i, &pIceConfigInfo));
+            rtt = MAX_UINT64;
+            if (pIceConfigInfo->uriCount != 0) {
+                CHK_STATUS(getTurnProbeRtt(pGstKvsPlugin->pSharedContext, pIceConfigInfo->uris[0], &rtt));
+            }
+
+            for (j = orderCount; j > 0 && rtts[j - 1] > rtt; j--) {
+                order[j] = order[j - 1];
+                rtts[j] = rtts[j - 1];
+            }
+            order[j] = i;
+            rtts[j] = rtt;
+            orderCount++;
+        }
+
+        /* signalingClientGetIceConfigInfoCount can return more than one turn server. Use only the closest ones to optimize
+         * candidate gathering latency. But user can also choose to use more than 1 turn server. */
+        for (uriCount = 0, i = 0; i < MIN(orderCount, GST_PLUGIN_MAX_TURN_SERVERS); i++) {
+            CHK_STATUS(signalingClientGetIceConfigInfo(pGstKvsPlugin->kvsContext.signalingHandle, order[i], &pIceConfigInfo));
             for (j = 0; j < pIceConfigInfo->uriCount; j++) {
                 CHECK(uriCount < MAX_ICE_SERVERS_COUNT);
                 /*
@@ -823,20 +848,17 @@ STATUS initializePeerConnection(PGstKvsPlugin pGstKvsPlugin, PRtcPeerConnection*
                 uriCount++;
             }
         }
+
+        MUTEX_UNLOCK(pGstKvsPlugin->signalingLock);
+        signalingLocked = FALSE;
     }
 
     pGstKvsPlugin->iceUriCount = uriCount + 1;
 
-    // Check if we have any pre-generated certs and use them
-    // NOTE: We are running under the config lock
-    retStatus = stackQueueDequeue(pGstKvsPlugin->pregeneratedCertificates, &data);
-    CHK(retStatus == STATUS_SUCCESS || retStatus == STATUS_NOT_FOUND, retStatus);
-
-    if (retStatus == STATUS_NOT_FOUND) {
-        retStatus = STATUS_SUCCESS;
-    } else {
+    // Check if we have any pre-generated certs and use them, they come from the pool all the elements share
+    CHK_STATUS(takePregeneratedCertificate(pGstKvsPlugin->pSharedContext, &pRtcCertificate));
+    if (pRtcCertificate != NULL) {
         // Use the pre-generated cert and get rid of it to not reuse again
-        pRtcCertificate = (PRtcCertificate) data;
         configuration.certificates[0] = *pRtcCertificate;
     }
 
@@ -848,6 +870,10 @@ CleanUp:
 
     CHK_LOG_ERR(retStatus);
 
+    if (signalingLocked) {
+        MUTEX_UNLOCK(pGstKvsPlugin->signalingLock);
+    }
+
     // Free the certificate which can be NULL as we no longer need it and won't reuse
     freeRtcCertificate(pRtcCertificate);
 
@@ -877,7 +903,14 @@ VOID onIceCandidateHandler(UINT64 customData, PCHAR candidateJson)
             // MMMMMM
         }
 
-    } else if (pStreamingSession->remoteCanTrickleIce && ATOMIC_LOAD_BOOL(&pStreamingSession->peerIdReceived)) {
+    } else {
+        // The first relay candidate is there once the TURN allocation went through
+        if (NULL != STRSTR(candidateJson, " typ relay") && !ATOMIC_EXCHANGE_BOOL(&pStreamingSession->relayCandidateGathered, TRUE)) {
+            DLOGI("TURN allocation for peer %s took %" PRIu64 " ms", pStreamingSession->peerId,
+                  (GETTIME() - pStreamingSession->iceGatheringStartTime) / HUNDREDS_OF_NANOS_IN_A_MILLISECOND);
+        }
+
+        CHK(pStreamingSession->remoteCanTrickleIce && ATOMIC_LOAD_BOOL(&pStreamingSession->peerIdReceived), retStatus);
         message.version = SIGNALING_MESSAGE_CURRENT_VERSION;
         message.messageType = SIGNALING_MESSAGE_TYPE_ICE_CANDIDATE;
         STRNCPY(message.peerClientId, pStreamingSession->peerId, MAX_SIGNALING_CLIENT_ID_LEN);
@@ -973,8 +1006,69 @@ CleanUp:
 
 VOID sampleBandwidthEstimationHandler(UINT64 customData, DOUBLE maxiumBitrate)
 {
-    UNUSED_PARAM(customData);
+    PWebRtcStreamingSession pStreamingSession = (PWebRtcStreamingSession) customData;
+
     DLOGD("Received bitrate suggestion: %f", maxiumBitrate);
+
+    // Both transceivers report the estimate of the same connection
+    if (pStreamingSession != NULL && maxiumBitrate >= 1) {
+        ATOMIC_STORE(&pStreamingSession->rateControl.estimate, (SIZE_T) maxiumBitrate);
+    }
+}
+
+BOOL admitVideoFrame(PWebRtcStreamingSession pStreamingSession, PFrame pFrame, BOOL nonReference, UINT64 currentTime)
+{
+    PSessionRateControl pRateControl = &pStreamingSession->rateControl;
+    UINT64 estimate = (UINT64) ATOMIC_LOAD(&pRateControl->estimate);
+    INT64 rate, window;
+    BOOL admit;
+
+    // Nothing to go by until the first estimate comes in
+    if (estimate == 0) {
+        pRateControl->sentFrames++;
+        return TRUE;
+    }
+
+    rate = (INT64) (estimate * GST_PLUGIN_RATE_CONTROL_HEADROOM / 8);
+    window = rate * GST_PLUGIN_RATE_CONTROL_WINDOW / HUNDREDS_OF_NANOS_IN_A_SECOND;
+    if (pRateControl->lastRefillTime == 0) {
+        pRateControl->budget = window;
+    } else if (currentTime > pRateControl->lastRefillTime) {
+        pRateControl->budget += rate * (INT64) (currentTime - pRateControl->lastRefillTime) / HUNDREDS_OF_NANOS_IN_A_SECOND;
+    }
+
+    pRateControl->lastRefillTime = currentTime;
+    pRateControl->budget = MIN(pRateControl->budget, window);
+
+    if (CHECK_FRAME_FLAG_KEY_FRAME(pFrame->flags)) {
+        // A key frame only needs the debt paid off, holding it back too would keep a held session frozen for another GOP
+        admit = pRateControl->budget >= 0;
+        if (admit && pRateControl->waitingForKeyFrame) {
+            pRateControl->waitingForKeyFrame = FALSE;
+            pRateControl->recoveries++;
+        }
+    } else if (pRateControl->waitingForKeyFrame) {
+        admit = FALSE;
+    } else if (pRateControl->budget >= (INT64) pFrame->size) {
+        admit = TRUE;
+    } else if (nonReference) {
+        // Nothing refers to it, the session stays decodable
+        admit = FALSE;
+        pRateControl->droppedNonReferenceFrames++;
+    } else {
+        admit = FALSE;
+        pRateControl->waitingForKeyFrame = TRUE;
+        pRateControl->holds++;
+    }
+
+    if (admit) {
+        pRateControl->budget -= pFrame->size;
+        pRateControl->sentFrames++;
+    } else {
+        pRateControl->droppedFrames++;
+    }
+
+    return admit;
 }
 
 STATUS handleRemoteCandidate(PWebRtcStreamingSession pStreamingSession, PSignalingMessage pSignalingMessage)
@@ -1026,30 +1120,15 @@ STATUS handleOffer(PGstKvsPlugin pGstKvsPlugin, PWebRtcStreamingSession pStreami
 {
     STATUS retStatus = STATUS_SUCCESS;
     RtcSessionDescriptionInit offerSessionDescriptionInit;
-    NullableBool canTrickle;
     BOOL active;
 
     CHK(pGstKvsPlugin != NULL && pSignalingMessage != NULL && pStreamingSession != NULL, STATUS_NULL_ARG);
 
     MEMSET(&offerSessionDescriptionInit, 0x00, SIZEOF(RtcSessionDescriptionInit));
-    MEMSET(&pStreamingSession->answerSessionDescriptionInit, 0x00, SIZEOF(RtcSessionDescriptionInit));
 
     CHK_STATUS(deserializeSessionDescriptionInit(pSignalingMessage->payload, pSignalingMessage->payloadLen, &offerSessionDescriptionInit));
-    CHK_STATUS(setRemoteDescription(pStreamingSession->pPeerConnection, &offerSessionDescriptionInit));
-    canTrickle = canTrickleIceCandidates(pStreamingSession->pPeerConnection);
-
-    // cannot be null after setRemoteDescription
-    CHK(!NULLABLE_CHECK_EMPTY(canTrickle), STATUS_INTERNAL_ERROR);
-
-    pStreamingSession->remoteCanTrickleIce = canTrickle.value;
-    CHK_STATUS(setLocalDescription(pStreamingSession->pPeerConnection, &pStreamingSession->answerSessionDescriptionInit));
-
-    // If remote support trickle ice, send answer now. Otherwise answer will be sent once ice candidate gathering is complete.
-    if (pStreamingSession->remoteCanTrickleIce) {
-        CHK_STATUS(createAnswer(pStreamingSession->pPeerConnection, &pStreamingSession->answerSessionDescriptionInit));
-        CHK_STATUS(respondWithAnswer(pStreamingSession));
-        DLOGD("time taken to send answer %" PRIu64 " ms", (GETTIME() - pStreamingSession->offerReceiveTime) / HUNDREDS_OF_NANOS_IN_A_MILLISECOND);
-    }
+    getSdpFingerprint(offerSessionDescriptionInit.sdp, pStreamingSession->remoteFingerprint);
+    CHK_STATUS(answerOffer(pStreamingSession, &offerSessionDescriptionInit));
 
     // We need the metrics timer only when there isn't one already in progress
     // IMPORTANT: This is called under the lock
@@ -1071,6 +1150,131 @@ CleanUp:
     return retStatus;
 }
 
+// Restarts ICE when the offer comes from the peer connection of the session, pRestarted is FALSE for a new one
+STATUS handleRestartOffer(PGstKvsPlugin pGstKvsPlugin, PWebRtcStreamingSession pStreamingSession, PSignalingMessage pSignalingMessage,
+                          PBOOL pRestarted)
+{
+    STATUS retStatus = STATUS_SUCCESS;
+    RtcSessionDescriptionInit offerSessionDescriptionInit;
+    CHAR fingerprint[GST_PLUGIN_MAX_FINGERPRINT_LEN + 1];
+
+    CHK(pGstKvsPlugin != NULL && pSignalingMessage != NULL && pStreamingSession != NULL && pRestarted != NULL, STATUS_NULL_ARG);
+    *pRestarted = FALSE;
+
+    MEMSET(&offerSessionDescriptionInit, 0x00, SIZEOF(RtcSessionDescriptionInit));
+
+    CHK_STATUS(deserializeSessionDescriptionInit(pSignalingMessage->payload, pSignalingMessage->payloadLen, &offerSessionDescriptionInit));
+
+    // A new fingerprint is a new peer connection on the viewer side, e.g. a reloaded page. The caller replaces the session.
+    getSdpFingerprint(offerSessionDescriptionInit.sdp, fingerprint);
+    CHK(0 == STRCMP(fingerprint, pStreamingSession->remoteFingerprint), retStatus);
+
+    *pRestarted = TRUE;
+    pStreamingSession->iceRestartCount++;
+    pStreamingSession->offerReceiveTime = GETTIME();
+    DLOGI("Peer %s restarts ICE (%u)", pStreamingSession->peerId, pStreamingSession->iceRestartCount);
+
+    // The viewer did what the grace period waits for, the restart gets a full one of its own
+    if (ATOMIC_LOAD(&pStreamingSession->disconnectTime) != 0) {
+        ATOMIC_STORE(&pStreamingSession->disconnectTime, (SIZE_T) pStreamingSession->offerReceiveTime);
+    }
+
+    // New credentials and candidates, the DTLS association with its SRTP keys and the transceivers stay as they are
+    ATOMIC_STORE_BOOL(&pStreamingSession->iceRestarting, TRUE);
+    ATOMIC_STORE_BOOL(&pStreamingSession->candidateGatheringDone, FALSE);
+    ATOMIC_STORE_BOOL(&pStreamingSession->relayCandidateGathered, FALSE);
+    CHK_STATUS(restartIce(pStreamingSession->pPeerConnection));
+    CHK_STATUS(answerOffer(pStreamingSession, &offerSessionDescriptionInit));
+
+    MUTEX_LOCK(pGstKvsPlugin->reconnectStats.lock);
+    pGstKvsPlugin->reconnectStats.iceRestarts++;
+    MUTEX_UNLOCK(pGstKvsPlugin->reconnectStats.lock);
+
+CleanUp:
+
+    // Falls back to a full reconnect with a new session
+    if (STATUS_FAILED(retStatus) && pStreamingSession != NULL) {
+        terminateStreamingSession(pStreamingSession);
+    }
+
+    CHK_LOG_ERR(retStatus);
+    return retStatus;
+}
+
+STATUS answerOffer(PWebRtcStreamingSession pStreamingSession, PRtcSessionDescriptionInit pOfferSessionDescriptionInit)
+{
+    STATUS retStatus = STATUS_SUCCESS;
+    NullableBool canTrickle;
+
+    CHK(pStreamingSession != NULL && pOfferSessionDescriptionInit != NULL, STATUS_NULL_ARG);
+
+    MEMSET(&pStreamingSession->answerSessionDescriptionInit, 0x00, SIZEOF(RtcSessionDescriptionInit));
+
+    CHK_STATUS(setRemoteDescription(pStreamingSession->pPeerConnection, pOfferSessionDescriptionInit));
+    canTrickle = canTrickleIceCandidates(pStreamingSession->pPeerConnection);
+
+    // cannot be null after setRemoteDescription
+    CHK(!NULLABLE_CHECK_EMPTY(canTrickle), STATUS_INTERNAL_ERROR);
+
+    pStreamingSession->remoteCanTrickleIce = canTrickle.value;
+    pStreamingSession->iceGatheringStartTime = GETTIME();
+    CHK_STATUS(setLocalDescription(pStreamingSession->pPeerConnection, &pStreamingSession->answerSessionDescriptionInit));
+
+    // If remote support trickle ice, send answer now. Otherwise answer will be sent once ice candidate gathering is complete.
+    if (pStreamingSession->remoteCanTrickleIce) {
+        CHK_STATUS(createAnswer(pStreamingSession->pPeerConnection, &pStreamingSession->answerSessionDescriptionInit));
+        CHK_STATUS(respondWithAnswer(pStreamingSession));
+        DLOGD("time taken to send answer %" PRIu64 " ms", (GETTIME() - pStreamingSession->offerReceiveTime) / HUNDREDS_OF_NANOS_IN_A_MILLISECOND);
+    }
+
+CleanUp:
+
+    return retStatus;
+}
+
+// Copies the "a=fingerprint:" value of the SDP, empty when there is none
+VOID getSdpFingerprint(PCHAR sdp, PCHAR pFingerprint)
+{
+    PCHAR pStart, pEnd;
+    UINT32 length = 0;
+
+    if (NULL != (pStart = STRSTR(sdp, GST_PLUGIN_SDP_FINGERPRINT))) {
+        pStart += STRLEN(GST_PLUGIN_SDP_FINGERPRINT);
+        for (pEnd = pStart; *pEnd != '\0' && *pEnd != '\r' && *pEnd != '\n'; pEnd++) {
+        }
+        length = MIN((UINT32) (pEnd - pStart), GST_PLUGIN_MAX_FINGERPRINT_LEN);
+        STRNCPY(pFingerprint, pStart, length);
+    }
+
+    pFingerprint[length] = '\0';
+}
+
+VOID recordSessionConnected(PWebRtcStreamingSession pStreamingSession)
+{
+    PReconnectStats pStats = &pStreamingSession->pGstKvsPlugin->reconnectStats;
+    UINT64 now = GETTIME(), disconnectTime = (UINT64) ATOMIC_EXCHANGE(&pStreamingSession->disconnectTime, 0);
+    UINT64 sinceOffer = (now - pStreamingSession->offerReceiveTime) / HUNDREDS_OF_NANOS_IN_A_MILLISECOND;
+
+    MUTEX_LOCK(pStats->lock);
+    if (ATOMIC_EXCHANGE_BOOL(&pStreamingSession->iceRestarting, FALSE)) {
+        DLOGI("Peer %s reconnected %" PRIu64 " ms after the restart offer, %" PRIu64 " ms after losing the connection", pStreamingSession->peerId,
+              sinceOffer, disconnectTime == 0 ? 0 : (now - disconnectTime) / HUNDREDS_OF_NANOS_IN_A_MILLISECOND);
+        pStats->iceRestartRecoveries++;
+        pStats->iceRestartTimeSum += now - pStreamingSession->offerReceiveTime;
+    } else if (disconnectTime != 0) {
+        DLOGI("Peer %s came back by itself after %" PRIu64 " ms", pStreamingSession->peerId,
+              (now - disconnectTime) / HUNDREDS_OF_NANOS_IN_A_MILLISECOND);
+        pStats->selfRecoveries++;
+    } else if (pStreamingSession->connectCount == 0) {
+        DLOGI("Peer %s connected %" PRIu64 " ms after its offer", pStreamingSession->peerId, sinceOffer);
+        pStats->sessionConnects++;
+        pStats->sessionConnectTimeSum += now - pStreamingSession->offerReceiveTime;
+    }
+    MUTEX_UNLOCK(pStats->lock);
+
+    pStreamingSession->connectCount++;
+}
+
 STATUS handleAnswer(PGstKvsPlugin pGstKvsPlugin, PWebRtcStreamingSession pStreamingSession, PSignalingMessage pSignalingMessage)
 {
     UNUSED_PARAM(pGstKvsPlugin);
@@ -1161,6 +1365,14 @@ STATUS getIceCandidatePairStatsCallback(UINT32 timerId, UINT64 currentTime, UINT
                 DLOGD("Number of STUN responses received: %llu",
                       pGstKvsPlugin->rtcIceCandidatePairMetrics.rtcStatsObject.iceCandidatePairStats.responsesReceived);
 
+                DLOGD("Video rate budget: %" PRIu64 " bps, %" PRIu64 " frames sent, %" PRIu64 " dropped (%" PRIu64
+                      " non-reference), %" PRIu64 " holds until a key frame, %" PRIu64 " recoveries",
+                      (UINT64) ATOMIC_LOAD(&pGstKvsPlugin->streamingSessionList[i]->rateControl.estimate),
+                      pGstKvsPlugin->streamingSessionList[i]->rateControl.sentFrames,
+                      pGstKvsPlugin->streamingSessionList[i]->rateControl.droppedFrames,
+                      pGstKvsPlugin->streamingSessionList[i]->rateControl.droppedNonReferenceFrames,
+                      pGstKvsPlugin->streamingSessionList[i]->rateControl.holds, pGstKvsPlugin->streamingSessionList[i]->rateControl.recoveries);
+
                 pGstKvsPlugin->streamingSessionList[i]->rtcMetricsHistory.prevTs = pGstKvsPlugin->rtcIceCandidatePairMetrics.timestamp;
                 pGstKvsPlugin->streamingSessionList[i]->rtcMetricsHistory.prevNumberOfPacketsSent =
                     pGstKvsPlugin->rtcIceCandidatePairMetrics.rtcStatsObject.iceCandidatePairStats.packetsSent;
@@ -1283,69 +1495,168 @@ VOID onSampleStreamingSessionShutdown(UINT64 customData, PWebRtcStreamingSession
     g_signal_emit_by_name(appsrc, "end-of-stream", &ret);
 }
 
-STATUS sessionServiceHandler(UINT32 timerId, UINT64 currentTime, UINT64 customData)
+// Sets the terminate flag and has the session detached right away. Returns FALSE if it was terminated already.
+BOOL terminateStreamingSession(PWebRtcStreamingSession pStreamingSession)
+{
+    if (ATOMIC_LOAD_BOOL(&pStreamingSession->terminateFlag)) {
+        return FALSE;
+    }
+
+    // Written before the flag, the service pass only reads it once it sees the flag
+    pStreamingSession->terminateTime = GETTIME();
+    if (ATOMIC_EXCHANGE_BOOL(&pStreamingSession->terminateFlag, TRUE)) {
+        return FALSE;
+    }
+
+    notifySessionLifecycle(&pStreamingSession->pGstKvsPlugin->sessionLifecycle, GST_PLUGIN_LIFECYCLE_EVENT_SESSION);
+    return TRUE;
+}
+
+/*
+ * One pass over everything the session lifecycle takes care of. Runs on the lifecycle thread whenever an event comes in or
+ * the deadline of the previous pass is due, and returns the next deadline: the end of a grace period, the expiry of a pending
+ * queue, a retry or a report.
+ */
+STATUS sessionServiceHandler(PGstKvsPlugin pGstKvsPlugin, UINT64 currentTime, PUINT64 pNextDeadline)
 {
     STATUS retStatus = STATUS_SUCCESS;
-    PGstKvsPlugin pGstKvsPlugin = (PGstKvsPlugin) customData;
+    PSessionLifecycle pLifecycle;
     PWebRtcStreamingSession pStreamingSession = NULL;
-    UINT32 i, clientIdHash;
-    BOOL locked = FALSE, peerConnectionFound = FALSE;
+    UINT32 i, clientIdHash, freedSlots = 0;
+    UINT64 disconnectTime, nextDeadline = MAX_UINT64, nextExpiration, slotLatencySum = 0, maxSlotLatency = 0, recreateRequestTime, latency,
+           hashValue = 0;
+    BOOL locked = FALSE, peerConnectionFound = FALSE, handedOver = FALSE;
     SIGNALING_CLIENT_STATE signalingClientState;
 
-    CHK(pGstKvsPlugin != NULL, STATUS_NULL_ARG);
+    CHK(pGstKvsPlugin != NULL && pNextDeadline != NULL, STATUS_NULL_ARG);
+    pLifecycle = &pGstKvsPlugin->sessionLifecycle;
+
+    // Whatever fails below is tried again soon
+    *pNextDeadline = currentTime + GST_PLUGIN_LIFECYCLE_RETRY_PERIOD;
 
     MUTEX_LOCK(pGstKvsPlugin->sessionLock);
     locked = TRUE;
 
     // scan and cleanup terminated streaming session
     for (i = 0; i < pGstKvsPlugin->streamingSessionCount; ++i) {
-        if (ATOMIC_LOAD_BOOL(&pGstKvsPlugin->streamingSessionList[i]->terminateFlag)) {
-            pStreamingSession = pGstKvsPlugin->streamingSessionList[i];
+        pStreamingSession = pGstKvsPlugin->streamingSessionList[i];
+
+        // The viewer didn't restart ICE in time, it has to come back with a new session
+        disconnectTime = (UINT64) ATOMIC_LOAD(&pStreamingSession->disconnectTime);
+        if (disconnectTime != 0 && !ATOMIC_LOAD_BOOL(&pStreamingSession->terminateFlag)) {
+            if (currentTime < disconnectTime + GST_PLUGIN_ICE_DISCONNECT_GRACE_PERIOD) {
+                nextDeadline = MIN(nextDeadline, disconnectTime + GST_PLUGIN_ICE_DISCONNECT_GRACE_PERIOD);
+            } else if (terminateStreamingSession(pStreamingSession)) {
+                DLOGI("Peer %s didn't reconnect within %u seconds", pStreamingSession->peerId,
+                      (UINT32) (GST_PLUGIN_ICE_DISCONNECT_GRACE_PERIOD / HUNDREDS_OF_NANOS_IN_A_SECOND));
+                MUTEX_LOCK(pGstKvsPlugin->reconnectStats.lock);
+                pGstKvsPlugin->reconnectStats.disconnectTimeouts++;
+                MUTEX_UNLOCK(pGstKvsPlugin->reconnectStats.lock);
+            }
+        }
 
+        // Only detached here, the reaper closes and frees it. With its backlog full the session waits until the reaper makes room.
+        if (ATOMIC_LOAD_BOOL(&pStreamingSession->terminateFlag) &&
+            ATOMIC_LOAD(&pGstKvsPlugin->sessionReaper.pending) < GST_PLUGIN_SESSION_REAPER_MAX_DEPTH) {
             MUTEX_LOCK(pGstKvsPlugin->sessionListReadLock);
 
-            // swap with last element and decrement count
+            // swap with last element and decrement count, the swapped in session is looked at next
             pGstKvsPlugin->streamingSessionCount--;
             pGstKvsPlugin->streamingSessionList[i] = pGstKvsPlugin->streamingSessionList[pGstKvsPlugin->streamingSessionCount];
+            i--;
 
-            // Remove from the hash table
+            // Remove from the hash table, unless a new session of the same peer replaced it there
             clientIdHash = COMPUTE_CRC32((PBYTE) pStreamingSession->peerId, (UINT32) STRLEN(pStreamingSession->peerId));
             CHK_STATUS(hashTableContains(pGstKvsPlugin->pRtcPeerConnectionForRemoteClient, clientIdHash, &peerConnectionFound));
             if (peerConnectionFound) {
+                CHK_STATUS(hashTableGet(pGstKvsPlugin->pRtcPeerConnectionForRemoteClient, clientIdHash, &hashValue));
+            }
+            if (peerConnectionFound && hashValue == (UINT64) pStreamingSession) {
                 CHK_STATUS(hashTableRemove(pGstKvsPlugin->pRtcPeerConnectionForRemoteClient, clientIdHash));
             }
 
             MUTEX_UNLOCK(pGstKvsPlugin->sessionListReadLock);
 
-            CHK_STATUS(freeWebRtcStreamingSession(&pStreamingSession));
+            // The slot is free for the next offer from here on
+            if (pStreamingSession->terminateTime != 0) {
+                latency = currentTime > pStreamingSession->terminateTime ? currentTime - pStreamingSession->terminateTime : 0;
+                freedSlots++;
+                slotLatencySum += latency;
+                maxSlotLatency = MAX(maxSlotLatency, latency);
+            }
+
+            CHK_STATUS(reapStreamingSession(&pGstKvsPlugin->sessionReaper, pStreamingSession));
         }
     }
 
-    // Check if we need to re-create the signaling client on-the-fly
-    if (ATOMIC_LOAD_BOOL(&pGstKvsPlugin->recreateSignalingClient) &&
-        STATUS_SUCCEEDED(freeSignalingClient(&pGstKvsPlugin->kvsContext.signalingHandle)) &&
-        STATUS_SUCCEEDED(createSignalingClientSync(&pGstKvsPlugin->kvsContext.signalingClientInfo, &pGstKvsPlugin->kvsContext.channelInfo,
-                                                   &pGstKvsPlugin->kvsContext.signalingClientCallbacks, pGstKvsPlugin->kvsContext.pCredentialProvider,
-                                                   &pGstKvsPlugin->kvsContext.signalingHandle)) &&
-        STATUS_SUCCEEDED(signalingClientFetchSync(pGstKvsPlugin->kvsContext.signalingHandle))) {
-        // Re-set the variable again
-        ATOMIC_STORE_BOOL(&pGstKvsPlugin->recreateSignalingClient, FALSE);
+    // Check if any lingering pending message queues
+    CHK_STATUS(removeExpiredMessageQueues(pGstKvsPlugin->pPendingSignalingMessageForRemoteClient, &nextExpiration));
+    nextDeadline = MIN(nextDeadline, nextExpiration);
+
+    MUTEX_UNLOCK(pGstKvsPlugin->sessionLock);
+    locked = FALSE;
+
+    // The signaling client is recreated outside of the session lock, its own callbacks take that lock.
+    // A fetched standby only has to connect, the full recreation is the fallback.
+    if (ATOMIC_LOAD_BOOL(&pGstKvsPlugin->recreateSignalingClient)) {
+        handedOver = pGstKvsPlugin->gstParams.signalingStandby && STATUS_SUCCEEDED(handOverToStandbySignalingClient(pGstKvsPlugin));
+        if (handedOver || STATUS_SUCCEEDED(replaceSignalingClient(pGstKvsPlugin))) {
+            // Re-set the variable again
+            ATOMIC_STORE_BOOL(&pGstKvsPlugin->recreateSignalingClient, FALSE);
+
+            recreateRequestTime = (UINT64) ATOMIC_EXCHANGE(&pLifecycle->recreateRequestTime, 0);
+            latency = recreateRequestTime == 0 ? 0 : GETTIME() - recreateRequestTime;
+            DLOGI("Signaling client %s %" PRIu64 " ms after the error", handedOver ? "handed over to the standby" : "recreated",
+                  latency / HUNDREDS_OF_NANOS_IN_A_MILLISECOND);
+
+            if (!handedOver) {
+                MUTEX_LOCK(pLifecycle->lock);
+                pLifecycle->signalingRecreates++;
+                pLifecycle->recreateLatencySum += latency;
+                pLifecycle->maxRecreateLatency = MAX(pLifecycle->maxRecreateLatency, latency);
+                MUTEX_UNLOCK(pLifecycle->lock);
+            }
+
+            recordSignalingRecovery(&pGstKvsPlugin->signalingStandby, recreateRequestTime, handedOver);
+        } else {
+            nextDeadline = MIN(nextDeadline, currentTime + GST_PLUGIN_LIFECYCLE_RETRY_PERIOD);
+        }
     }
 
-    // Check the signaling client state and connect if needed
+    // Check the signaling client state and connect if needed. Getting to ready again raises an event.
     if (ATOMIC_LOAD_BOOL(&pGstKvsPlugin->connectWebRtc) && IS_VALID_SIGNALING_CLIENT_HANDLE(pGstKvsPlugin->kvsContext.signalingHandle)) {
         CHK_STATUS(signalingClientGetCurrentState(pGstKvsPlugin->kvsContext.signalingHandle, &signalingClientState));
-        if (signalingClientState == SIGNALING_CLIENT_STATE_READY) {
-            UNUSED_PARAM(signalingClientConnectSync(pGstKvsPlugin->kvsContext.signalingHandle));
+        if (signalingClientState == SIGNALING_CLIENT_STATE_READY &&
+            STATUS_FAILED(signalingClientConnectSync(pGstKvsPlugin->kvsContext.signalingHandle))) {
+            nextDeadline = MIN(nextDeadline, currentTime + GST_PLUGIN_LIFECYCLE_RETRY_PERIOD);
         }
     }
 
-    // Check if any lingering pending message queues
-    CHK_STATUS(removeExpiredMessageQueues(pGstKvsPlugin->pPendingSignalingMessageForRemoteClient));
+    // Keeps the next standby fetched, also right after a handover used it up
+    if (pGstKvsPlugin->gstParams.signalingStandby) {
+        nextDeadline = MIN(nextDeadline, refreshSignalingStandby(&pGstKvsPlugin->signalingStandby, currentTime));
+    }
 
-    // periodically wake up and clean up terminated streaming session
-    MUTEX_UNLOCK(pGstKvsPlugin->sessionLock);
-    locked = FALSE;
+    reportSendLaneStats(&pGstKvsPlugin->audioLane, currentTime);
+    reportSendLaneStats(&pGstKvsPlugin->videoLane, currentTime);
+    reportReconnectStats(pGstKvsPlugin, currentTime);
+    reportSessionReaperStats(&pGstKvsPlugin->sessionReaper, currentTime);
+    reportSessionLifecycleStats(pLifecycle, currentTime);
+    reportSignalingStats(&pGstKvsPlugin->signalingStandby, pLifecycle, currentTime);
+    reportKinesisVideoProducerStats(pGstKvsPlugin, currentTime);
+
+    // The reports are the only regular work left
+    nextDeadline = MIN(nextDeadline, pGstKvsPlugin->audioLane.lastReportTime + GST_PLUGIN_SEND_LANE_REPORT_PERIOD);
+    nextDeadline = MIN(nextDeadline, pGstKvsPlugin->videoLane.lastReportTime + GST_PLUGIN_SEND_LANE_REPORT_PERIOD);
+    nextDeadline = MIN(nextDeadline, pGstKvsPlugin->reconnectStats.lastReportTime + GST_PLUGIN_RECONNECT_REPORT_PERIOD);
+    nextDeadline = MIN(nextDeadline, pGstKvsPlugin->sessionReaper.lastReportTime + GST_PLUGIN_SESSION_REAPER_REPORT_PERIOD);
+    nextDeadline = MIN(nextDeadline, pLifecycle->lastReportTime + GST_PLUGIN_LIFECYCLE_REPORT_PERIOD);
+    nextDeadline = MIN(nextDeadline, pGstKvsPlugin->signalingStandby.lastReportTime + GST_PLUGIN_SIGNALING_REPORT_PERIOD);
+    if (IS_VALID_STREAM_HANDLE(pGstKvsPlugin->producerContext.streamHandle)) {
+        nextDeadline = MIN(nextDeadline, pGstKvsPlugin->producerContext.lastReportTime + GST_PLUGIN_STREAM_REPORT_PERIOD);
+    }
+
+    *pNextDeadline = MAX(nextDeadline, currentTime + GST_PLUGIN_LIFECYCLE_MIN_WAIT);
 
 CleanUp:
 
@@ -1355,31 +1666,266 @@ CleanUp:
         MUTEX_UNLOCK(pGstKvsPlugin->sessionLock);
     }
 
+    if (freedSlots != 0) {
+        MUTEX_LOCK(pLifecycle->lock);
+        pLifecycle->freedSlots += freedSlots;
+        pLifecycle->slotLatencySum += slotLatencySum;
+        pLifecycle->maxSlotLatency = MAX(pLifecycle->maxSlotLatency, maxSlotLatency);
+        MUTEX_UNLOCK(pLifecycle->lock);
+    }
+
+    return retStatus;
+}
+
+STATUS initSendLane(PGstKvsPlugin pGstKvsPlugin, PSendLane pLane, PCHAR name, UINT64 trackId, UINT32 maxDepth, BOOL dropUntilKeyFrame,
+                    PSendLane pYieldTo)
+{
+    STATUS retStatus = STATUS_SUCCESS;
+
+    CHK(pGstKvsPlugin != NULL && pLane != NULL && name != NULL, STATUS_NULL_ARG);
+    CHK(maxDepth != 0, STATUS_INVALID_ARG);
+
+    MEMSET(pLane, 0x00, SIZEOF(SendLane));
+    pLane->pGstKvsPlugin = pGstKvsPlugin;
+    pLane->name = name;
+    pLane->trackId = trackId;
+    pLane->maxDepth = maxDepth;
+    pLane->dropUntilKeyFrame = dropUntilKeyFrame;
+    pLane->pYieldTo = pYieldTo;
+    pLane->lastReportTime = GETTIME();
+    ATOMIC_STORE_BOOL(&pLane->terminate, FALSE);
+
+    pLane->lock = MUTEX_CREATE(FALSE);
+    pLane->cvar = CVAR_CREATE();
+    CHK_STATUS(stackQueueCreate(&pLane->pFrames));
+    CHK_STATUS(THREAD_CREATE(&pLane->workerTid, sendLaneRoutine, (PVOID) pLane));
+
+CleanUp:
+
+    CHK_LOG_ERR(retStatus);
+    return retStatus;
+}
+
+STATUS freeSendLane(PSendLane pLane)
+{
+    STATUS retStatus = STATUS_SUCCESS;
+    UINT64 item;
+
+    CHK(pLane != NULL, STATUS_NULL_ARG);
+
+    if (IS_VALID_TID_VALUE(pLane->workerTid)) {
+        MUTEX_LOCK(pLane->lock);
+        ATOMIC_STORE_BOOL(&pLane->terminate, TRUE);
+        CVAR_BROADCAST(pLane->cvar);
+        MUTEX_UNLOCK(pLane->lock);
+
+        THREAD_JOIN(pLane->workerTid, NULL);
+        pLane->workerTid = INVALID_TID_VALUE;
+    }
+
+    if (pLane->pFrames != NULL) {
+        while (pLane->depth != 0 && STATUS_SUCCEEDED(stackQueueDequeue(pLane->pFrames, &item))) {
+            MEMFREE((PQueuedFrame) item);
+            pLane->depth--;
+        }
+
+        stackQueueFree(pLane->pFrames);
+        pLane->pFrames = NULL;
+    }
+
+    if (IS_VALID_CVAR_VALUE(pLane->cvar)) {
+        CVAR_FREE(pLane->cvar);
+        pLane->cvar = INVALID_CVAR_VALUE;
+    }
+
+    if (IS_VALID_MUTEX_VALUE(pLane->lock)) {
+        MUTEX_FREE(pLane->lock);
+        pLane->lock = INVALID_MUTEX_VALUE;
+    }
+
+CleanUp:
+
     return retStatus;
 }
 
 STATUS putFrameToWebRtcPeers(PGstKvsPlugin pGstKvsPlugin, PFrame pFrame, ELEMENTARY_STREAM_NAL_FORMAT nalFormat)
 {
     STATUS retStatus = STATUS_SUCCESS;
-    PWebRtcStreamingSession pStreamingSession;
-    PRtcRtpTransceiver pRtcRtpTransceiver;
-    UINT32 i;
+    PSendLane pLane;
+    PQueuedFrame pQueuedFrame = NULL;
+    UINT64 item;
+    BOOL locked = FALSE;
 
     CHK(pGstKvsPlugin != NULL && pFrame != NULL, STATUS_NULL_ARG);
 
+    pLane = pFrame->trackId == DEFAULT_AUDIO_TRACK_ID ? &pGstKvsPlugin->audioLane : &pGstKvsPlugin->videoLane;
+    CHK(pLane->pFrames != NULL, STATUS_INVALID_OPERATION);
+
+    // The caller unmaps the buffer once this returns, the lane needs its own copy
+    CHK(NULL != (pQueuedFrame = (PQueuedFrame) MEMALLOC(SIZEOF(QueuedFrame) + pFrame->size)), STATUS_NOT_ENOUGH_MEMORY);
+    pQueuedFrame->frame = *pFrame;
+    pQueuedFrame->frame.frameData = (PBYTE) (pQueuedFrame + 1);
+    MEMCPY(pQueuedFrame->frame.frameData, pFrame->frameData, pFrame->size);
+    pQueuedFrame->nalFormat = nalFormat;
+    pQueuedFrame->enqueueTime = GETTIME();
+
     // Adjust the duration as some peers are sensitive to 0 duration
-    if (pFrame->duration == 0) {
-        pFrame->duration = GST_PLUGIN_DEFAULT_FRAME_DURATION;
+    if (pQueuedFrame->frame.duration == 0) {
+        pQueuedFrame->frame.duration = GST_PLUGIN_DEFAULT_FRAME_DURATION;
+    }
+
+    MUTEX_LOCK(pLane->lock);
+    locked = TRUE;
+
+    if (pLane->waitingForKeyFrame) {
+        CHK(CHECK_FRAME_FLAG_KEY_FRAME(pFrame->flags), STATUS_SUCCESS);
+        pLane->waitingForKeyFrame = FALSE;
+    }
+
+    if (pLane->depth == pLane->maxDepth) {
+        if (pLane->dropUntilKeyFrame) {
+            // Any delta frame sent past a dropped one would only decode into artifacts
+            if (!CHECK_FRAME_FLAG_KEY_FRAME(pFrame->flags)) {
+                pLane->waitingForKeyFrame = TRUE;
+                CHK(FALSE, STATUS_SUCCESS);
+            }
+
+            // A key frame resyncs the peers on its own, so the backlog in front of it is no longer needed
+            while (pLane->depth > 0) {
+                CHK_STATUS(stackQueueDequeue(pLane->pFrames, &item));
+                MEMFREE((PQueuedFrame) item);
+                pLane->depth--;
+                pLane->droppedFrames++;
+                ATOMIC_DECREMENT(&pLane->pending);
+            }
+        } else {
+            // Stale audio is worth less than the frame that just came in
+            CHK_STATUS(stackQueueDequeue(pLane->pFrames, &item));
+            MEMFREE((PQueuedFrame) item);
+            pLane->depth--;
+            pLane->droppedFrames++;
+            ATOMIC_DECREMENT(&pLane->pending);
+        }
+    }
+
+    CHK_STATUS(stackQueueEnqueue(pLane->pFrames, (UINT64) pQueuedFrame));
+    pQueuedFrame = NULL;
+    pLane->depth++;
+    pLane->maxObservedDepth = MAX(pLane->maxObservedDepth, pLane->depth);
+    ATOMIC_INCREMENT(&pLane->pending);
+    CVAR_BROADCAST(pLane->cvar);
+
+CleanUp:
+
+    if (pQueuedFrame != NULL) {
+        // Dropped rather than queued
+        if (locked) {
+            pLane->droppedFrames++;
+        }
+
+        MEMFREE(pQueuedFrame);
+    }
+
+    if (locked) {
+        MUTEX_UNLOCK(pLane->lock);
+    }
+
+    CHK_LOG_ERR(retStatus);
+    return retStatus;
+}
+
+PVOID sendLaneRoutine(PVOID args)
+{
+    STATUS retStatus = STATUS_SUCCESS;
+    PSendLane pLane = (PSendLane) args;
+    PQueuedFrame pQueuedFrame;
+    UINT64 item, latency;
+
+    CHK(pLane != NULL, STATUS_NULL_ARG);
+
+    while (TRUE) {
+        MUTEX_LOCK(pLane->lock);
+        while (pLane->depth == 0 && !ATOMIC_LOAD_BOOL(&pLane->terminate)) {
+            CVAR_WAIT(pLane->cvar, pLane->lock, INFINITE_TIME_VALUE);
+        }
+
+        if (ATOMIC_LOAD_BOOL(&pLane->terminate)) {
+            MUTEX_UNLOCK(pLane->lock);
+            break;
+        }
+
+        retStatus = stackQueueDequeue(pLane->pFrames, &item);
+        pLane->depth--;
+        MUTEX_UNLOCK(pLane->lock);
+
+        CHK_STATUS(retStatus);
+        pQueuedFrame = (PQueuedFrame) item;
+
+        if (STATUS_FAILED(retStatus = writeFrameToWebRtcPeers(pLane, pQueuedFrame))) {
+            DLOGW("Failed to put %s frame to peer connections with 0x%08x", pLane->name, retStatus);
+        }
+
+        latency = GETTIME() - pQueuedFrame->enqueueTime;
+        MEMFREE(pQueuedFrame);
+
+        // Wakes up a lane waiting for this one to be done
+        MUTEX_LOCK(pLane->lock);
+        ATOMIC_DECREMENT(&pLane->pending);
+        pLane->sentFrames++;
+        pLane->latencySum += latency;
+        pLane->maxLatency = MAX(pLane->maxLatency, latency);
+        CVAR_BROADCAST(pLane->cvar);
+        MUTEX_UNLOCK(pLane->lock);
     }
 
+CleanUp:
+
+    CHK_LOG_ERR(retStatus);
+    return (PVOID)(ULONG_PTR) retStatus;
+}
+
+STATUS writeFrameToWebRtcPeers(PSendLane pLane, PQueuedFrame pQueuedFrame)
+{
+    STATUS retStatus = STATUS_SUCCESS;
+    PGstKvsPlugin pGstKvsPlugin = pLane->pGstKvsPlugin;
+    PSendLane pYieldTo = pLane->pYieldTo;
+    PFrame pFrame = &pQueuedFrame->frame;
+    PWebRtcStreamingSession pStreamingSession;
+    PRtcRtpTransceiver pRtcRtpTransceiver;
+    PUINT64 pSessionSequence;
+    UINT32 i;
+    UINT64 currentTime = GETTIME(), sequence = ++pLane->frameSequence;
+    BOOL locked = FALSE, video = pFrame->trackId == DEFAULT_VIDEO_TRACK_ID, nonReference = FALSE;
+
     MUTEX_LOCK(pGstKvsPlugin->sessionListReadLock);
-    // Check if the bits need adaptation and if we have any active sessions
-    if (IS_AVCC_HEVC_CPD_NAL_FORMAT(nalFormat) && pFrame->trackId == DEFAULT_VIDEO_TRACK_ID && pGstKvsPlugin->streamingSessionCount != 0) {
-        CHK_STATUS(adaptVideoFrameFromAvccToAnnexB(pGstKvsPlugin, pFrame, nalFormat));
+    locked = TRUE;
+
+    // Check if the bits need adaptation and if we have any active sessions. Only the video lane gets here with video frames
+    if (IS_AVCC_HEVC_CPD_NAL_FORMAT(pQueuedFrame->nalFormat) && video && pGstKvsPlugin->streamingSessionCount != 0) {
+        CHK_STATUS(adaptVideoFrameFromAvccToAnnexB(pGstKvsPlugin, pFrame, pQueuedFrame->nalFormat));
+    }
+
+    // The frame is Annex-B by now, an unparsable one is simply treated as a reference frame. The check reads H.264 NALu headers only.
+    if (video && pGstKvsPlugin->h264Video && !CHECK_FRAME_FLAG_KEY_FRAME(pFrame->flags)) {
+        CHK_LOG_ERR(identifyNonReferenceFrame(pFrame->frameData, pFrame->size, &nonReference));
     }
 
     for (i = 0; i < pGstKvsPlugin->streamingSessionCount; ++i) {
         pStreamingSession = pGstKvsPlugin->streamingSessionList[i];
+
+        // The list can change while the lock is given up below, each session is stamped with the frame it got
+        pSessionSequence = video ? &pStreamingSession->videoFrameSequence : &pStreamingSession->audioFrameSequence;
+        if (*pSessionSequence == sequence) {
+            continue;
+        }
+
+        *pSessionSequence = sequence;
+
+        // A session over its budget only costs itself frames
+        if (video && !admitVideoFrame(pStreamingSession, pFrame, nonReference, currentTime)) {
+            continue;
+        }
+
         pRtcRtpTransceiver =
             pFrame->trackId == DEFAULT_AUDIO_TRACK_ID ? pStreamingSession->pAudioRtcRtpTransceiver : pStreamingSession->pVideoRtcRtpTransceiver;
 
@@ -1387,8 +1933,100 @@ STATUS putFrameToWebRtcPeers(PGstKvsPlugin pGstKvsPlugin, PFrame pFrame, ELEMENT
 
         CHK(retStatus == STATUS_SUCCESS || retStatus == STATUS_SRTP_NOT_READY_YET, retStatus);
         retStatus = STATUS_SUCCESS;
+
+        // Let the other lane through before going on with the next session
+        if (pYieldTo != NULL && i + 1 < pGstKvsPlugin->streamingSessionCount && ATOMIC_LOAD(&pYieldTo->pending) != 0) {
+            MUTEX_UNLOCK(pGstKvsPlugin->sessionListReadLock);
+
+            MUTEX_LOCK(pYieldTo->lock);
+            while (ATOMIC_LOAD(&pYieldTo->pending) != 0 && !ATOMIC_LOAD_BOOL(&pYieldTo->terminate) &&
+                   STATUS_SUCCEEDED(CVAR_WAIT(pYieldTo->cvar, pYieldTo->lock, GST_PLUGIN_SEND_LANE_YIELD_TIMEOUT))) {
+            }
+            MUTEX_UNLOCK(pYieldTo->lock);
+
+            MUTEX_LOCK(pGstKvsPlugin->sessionListReadLock);
+            i = MAX_UINT32;
+        }
+    }
+
+CleanUp:
+
+    if (locked) {
+        MUTEX_UNLOCK(pGstKvsPlugin->sessionListReadLock);
+    }
+
+    return retStatus;
+}
+
+VOID reportSendLaneStats(PSendLane pLane, UINT64 currentTime)
+{
+    if (pLane->pFrames == NULL) {
+        return;
+    }
+
+    MUTEX_LOCK(pLane->lock);
+    if (currentTime >= pLane->lastReportTime + GST_PLUGIN_SEND_LANE_REPORT_PERIOD) {
+        if (pLane->sentFrames != 0 || pLane->droppedFrames != 0) {
+            DLOGI("%s lane: %u frames sent, %u dropped, latency avg %" PRIu64 " ms max %" PRIu64 " ms, queue depth %u max %u", pLane->name,
+                  pLane->sentFrames, pLane->droppedFrames,
+                  pLane->sentFrames == 0 ? 0 : pLane->latencySum / pLane->sentFrames / HUNDREDS_OF_NANOS_IN_A_MILLISECOND,
+                  pLane->maxLatency / HUNDREDS_OF_NANOS_IN_A_MILLISECOND, pLane->depth, pLane->maxObservedDepth);
+        }
+
+        pLane->lastReportTime = currentTime;
+        pLane->sentFrames = 0;
+        pLane->droppedFrames = 0;
+        pLane->latencySum = 0;
+        pLane->maxLatency = 0;
+        pLane->maxObservedDepth = pLane->depth;
+    }
+    MUTEX_UNLOCK(pLane->lock);
+}
+
+VOID reportReconnectStats(PGstKvsPlugin pGstKvsPlugin, UINT64 currentTime)
+{
+    PReconnectStats pStats = &pGstKvsPlugin->reconnectStats;
+
+    MUTEX_LOCK(pStats->lock);
+    if (currentTime >= pStats->lastReportTime + GST_PLUGIN_RECONNECT_REPORT_PERIOD) {
+        if (pStats->sessionConnects != 0 || pStats->iceRestarts != 0 || pStats->selfRecoveries != 0 || pStats->disconnectTimeouts != 0) {
+            DLOGI("Reconnects: %u new sessions connected in avg %" PRIu64 " ms, %u ICE restarts of which %u reconnected in avg %" PRIu64
+                  " ms, %u connections came back by themselves, %u timed out",
+                  pStats->sessionConnects,
+                  pStats->sessionConnects == 0 ? 0 : pStats->sessionConnectTimeSum / pStats->sessionConnects / HUNDREDS_OF_NANOS_IN_A_MILLISECOND,
+                  pStats->iceRestarts, pStats->iceRestartRecoveries,
+                  pStats->iceRestartRecoveries == 0 ? 0
+                                                    : pStats->iceRestartTimeSum / pStats->iceRestartRecoveries / HUNDREDS_OF_NANOS_IN_A_MILLISECOND,
+                  pStats->selfRecoveries, pStats->disconnectTimeouts);
+        }
+
+        pStats->lastReportTime = currentTime;
+        pStats->sessionConnects = 0;
+        pStats->sessionConnectTimeSum = 0;
+        pStats->iceRestarts = 0;
+        pStats->iceRestartRecoveries = 0;
+        pStats->iceRestartTimeSum = 0;
+        pStats->selfRecoveries = 0;
+        pStats->disconnectTimeouts = 0;
     }
-    MUTEX_UNLOCK(pGstKvsPlugin->sessionListReadLock);
+    MUTEX_UNLOCK(pStats->lock);
+}
+
+STATUS initSessionReaper(PGstKvsPlugin pGstKvsPlugin, PSessionReaper pReaper)
+{
+    STATUS retStatus = STATUS_SUCCESS;
+
+    CHK(pGstKvsPlugin != NULL && pReaper != NULL, STATUS_NULL_ARG);
+
+    MEMSET(pReaper, 0x00, SIZEOF(SessionReaper));
+    pReaper->pGstKvsPlugin = pGstKvsPlugin;
+    pReaper->lastReportTime = GETTIME();
+    ATOMIC_STORE_BOOL(&pReaper->terminate, FALSE);
+
+    pReaper->lock = MUTEX_CREATE(FALSE);
+    pReaper->cvar = CVAR_CREATE();
+    CHK_STATUS(stackQueueCreate(&pReaper->pSessions));
+    CHK_STATUS(THREAD_CREATE(&pReaper->workerTid, sessionReaperRoutine, (PVOID) pReaper));
 
 CleanUp:
 
@@ -1396,6 +2034,601 @@ CleanUp:
     return retStatus;
 }
 
+STATUS freeSessionReaper(PSessionReaper pReaper)
+{
+    STATUS retStatus = STATUS_SUCCESS;
+    PWebRtcStreamingSession pStreamingSession;
+    UINT64 item;
+
+    CHK(pReaper != NULL, STATUS_NULL_ARG);
+
+    // The worker drains the backlog before it exits
+    if (IS_VALID_TID_VALUE(pReaper->workerTid)) {
+        MUTEX_LOCK(pReaper->lock);
+        ATOMIC_STORE_BOOL(&pReaper->terminate, TRUE);
+        CVAR_BROADCAST(pReaper->cvar);
+        MUTEX_UNLOCK(pReaper->lock);
+
+        THREAD_JOIN(pReaper->workerTid, NULL);
+        pReaper->workerTid = INVALID_TID_VALUE;
+    }
+
+    if (pReaper->pSessions != NULL) {
+        while (pReaper->depth != 0 && STATUS_SUCCEEDED(stackQueueDequeue(pReaper->pSessions, &item))) {
+            pStreamingSession = (PWebRtcStreamingSession) item;
+            freeWebRtcStreamingSession(&pStreamingSession);
+            pReaper->depth--;
+        }
+
+        stackQueueFree(pReaper->pSessions);
+        pReaper->pSessions = NULL;
+    }
+
+    if (IS_VALID_CVAR_VALUE(pReaper->cvar)) {
+        CVAR_FREE(pReaper->cvar);
+        pReaper->cvar = INVALID_CVAR_VALUE;
+    }
+
+    if (IS_VALID_MUTEX_VALUE(pReaper->lock)) {
+        MUTEX_FREE(pReaper->lock);
+        pReaper->lock = INVALID_MUTEX_VALUE;
+    }
+
+CleanUp:
+
+    return retStatus;
+}
+
+// The session has to be detached already, nothing else may reach it from here on
+STATUS reapStreamingSession(PSessionReaper pReaper, PWebRtcStreamingSession pStreamingSession)
+{
+    STATUS retStatus = STATUS_SUCCESS;
+    BOOL locked = FALSE;
+
+    CHK(pReaper != NULL && pStreamingSession != NULL, STATUS_NULL_ARG);
+
+    pStreamingSession->detachTime = GETTIME();
+
+    MUTEX_LOCK(pReaper->lock);
+    locked = TRUE;
+
+    CHK_STATUS(stackQueueEnqueue(pReaper->pSessions, (UINT64) pStreamingSession));
+    pReaper->depth++;
+    pReaper->maxObservedDepth = MAX(pReaper->maxObservedDepth, pReaper->depth);
+    ATOMIC_INCREMENT(&pReaper->pending);
+    CVAR_SIGNAL(pReaper->cvar);
+
+CleanUp:
+
+    if (locked) {
+        MUTEX_UNLOCK(pReaper->lock);
+    }
+
+    // Not worth leaking the peer connection over, the caller pays for the teardown instead
+    if (STATUS_FAILED(retStatus) && pStreamingSession != NULL) {
+        freeWebRtcStreamingSession(&pStreamingSession);
+    }
+
+    return retStatus;
+}
+
+PVOID sessionReaperRoutine(PVOID args)
+{
+    STATUS retStatus = STATUS_SUCCESS;
+    PSessionReaper pReaper = (PSessionReaper) args;
+    PWebRtcStreamingSession pStreamingSession;
+    UINT64 item, detachTime, latency;
+    BOOL full;
+
+    CHK(pReaper != NULL, STATUS_NULL_ARG);
+
+    while (TRUE) {
+        MUTEX_LOCK(pReaper->lock);
+        while (pReaper->depth == 0 && !ATOMIC_LOAD_BOOL(&pReaper->terminate)) {
+            CVAR_WAIT(pReaper->cvar, pReaper->lock, INFINITE_TIME_VALUE);
+        }
+
+        // Unlike the send lanes, the backlog is worked off before exiting
+        if (pReaper->depth == 0) {
+            MUTEX_UNLOCK(pReaper->lock);
+            break;
+        }
+
+        retStatus = stackQueueDequeue(pReaper->pSessions, &item);
+        pReaper->depth--;
+        MUTEX_UNLOCK(pReaper->lock);
+
+        CHK_STATUS(retStatus);
+        pStreamingSession = (PWebRtcStreamingSession) item;
+        detachTime = pStreamingSession->detachTime;
+
+        CHK_LOG_ERR(freeWebRtcStreamingSession(&pStreamingSession));
+        latency = GETTIME() - detachTime;
+
+        MUTEX_LOCK(pReaper->lock);
+        full = ATOMIC_LOAD(&pReaper->pending) >= GST_PLUGIN_SESSION_REAPER_MAX_DEPTH;
+        ATOMIC_DECREMENT(&pReaper->pending);
+        pReaper->freedSessions++;
+        pReaper->latencySum += latency;
+        pReaper->maxLatency = MAX(pReaper->maxLatency, latency);
+        MUTEX_UNLOCK(pReaper->lock);
+
+        // Terminated sessions may have been left attached while the backlog was full
+        if (full) {
+            notifySessionLifecycle(&pReaper->pGstKvsPlugin->sessionLifecycle, GST_PLUGIN_LIFECYCLE_EVENT_SESSION);
+        }
+    }
+
+CleanUp:
+
+    CHK_LOG_ERR(retStatus);
+    return (PVOID)(ULONG_PTR) retStatus;
+}
+
+VOID reportSessionReaperStats(PSessionReaper pReaper, UINT64 currentTime)
+{
+    if (pReaper->pSessions == NULL) {
+        return;
+    }
+
+    MUTEX_LOCK(pReaper->lock);
+    if (currentTime >= pReaper->lastReportTime + GST_PLUGIN_SESSION_REAPER_REPORT_PERIOD) {
+        if (pReaper->freedSessions != 0) {
+            DLOGI("Session reaper: %u sessions freed, teardown avg %" PRIu64 " ms max %" PRIu64 " ms, backlog %u max %u", pReaper->freedSessions,
+                  pReaper->latencySum / pReaper->freedSessions / HUNDREDS_OF_NANOS_IN_A_MILLISECOND,
+                  pReaper->maxLatency / HUNDREDS_OF_NANOS_IN_A_MILLISECOND, pReaper->depth, pReaper->maxObservedDepth);
+        }
+
+        pReaper->lastReportTime = currentTime;
+        pReaper->freedSessions = 0;
+        pReaper->latencySum = 0;
+        pReaper->maxLatency = 0;
+        pReaper->maxObservedDepth = pReaper->depth;
+    }
+    MUTEX_UNLOCK(pReaper->lock);
+}
+
+STATUS initSessionLifecycle(PGstKvsPlugin pGstKvsPlugin, PSessionLifecycle pLifecycle)
+{
+    STATUS retStatus = STATUS_SUCCESS;
+
+    CHK(pGstKvsPlugin != NULL && pLifecycle != NULL, STATUS_NULL_ARG);
+
+    MEMSET(pLifecycle, 0x00, SIZEOF(SessionLifecycle));
+    pLifecycle->pGstKvsPlugin = pGstKvsPlugin;
+    pLifecycle->lastReportTime = GETTIME();
+    ATOMIC_STORE_BOOL(&pLifecycle->terminate, FALSE);
+
+    // The first pass runs right away
+    pLifecycle->nextDeadline = 0;
+
+    pLifecycle->lock = MUTEX_CREATE(FALSE);
+    pLifecycle->cvar = CVAR_CREATE();
+    CHK_STATUS(THREAD_CREATE(&pLifecycle->workerTid, sessionLifecycleRoutine, (PVOID) pLifecycle));
+
+CleanUp:
+
+    CHK_LOG_ERR(retStatus);
+    return retStatus;
+}
+
+// Ends the passes but keeps the lock and cvar, notifying a stopped lifecycle is harmless
+STATUS stopSessionLifecycle(PSessionLifecycle pLifecycle)
+{
+    STATUS retStatus = STATUS_SUCCESS;
+
+    CHK(pLifecycle != NULL, STATUS_NULL_ARG);
+
+    if (IS_VALID_TID_VALUE(pLifecycle->workerTid)) {
+        MUTEX_LOCK(pLifecycle->lock);
+        ATOMIC_STORE_BOOL(&pLifecycle->terminate, TRUE);
+        CVAR_BROADCAST(pLifecycle->cvar);
+        MUTEX_UNLOCK(pLifecycle->lock);
+
+        THREAD_JOIN(pLifecycle->workerTid, NULL);
+        pLifecycle->workerTid = INVALID_TID_VALUE;
+    }
+
+CleanUp:
+
+    return retStatus;
+}
+
+// Only once nothing can notify anymore
+STATUS freeSessionLifecycle(PSessionLifecycle pLifecycle)
+{
+    STATUS retStatus = STATUS_SUCCESS;
+
+    CHK(pLifecycle != NULL, STATUS_NULL_ARG);
+
+    stopSessionLifecycle(pLifecycle);
+
+    if (IS_VALID_CVAR_VALUE(pLifecycle->cvar)) {
+        CVAR_FREE(pLifecycle->cvar);
+        pLifecycle->cvar = INVALID_CVAR_VALUE;
+    }
+
+    if (IS_VALID_MUTEX_VALUE(pLifecycle->lock)) {
+        MUTEX_FREE(pLifecycle->lock);
+        pLifecycle->lock = INVALID_MUTEX_VALUE;
+    }
+
+CleanUp:
+
+    return retStatus;
+}
+
+// Can be called before the lifecycle exists, e.g. from the properties, the first pass picks the change up. The lock is only
+// freed once the signaling clients, the reaper and the sessions are gone, see freeGstKvsWebRtcPlugin.
+VOID notifySessionLifecycle(PSessionLifecycle pLifecycle, UINT32 event)
+{
+    if (!IS_VALID_MUTEX_VALUE(pLifecycle->lock)) {
+        return;
+    }
+
+    MUTEX_LOCK(pLifecycle->lock);
+    pLifecycle->events |= event;
+    CVAR_SIGNAL(pLifecycle->cvar);
+    MUTEX_UNLOCK(pLifecycle->lock);
+}
+
+PVOID sessionLifecycleRoutine(PVOID args)
+{
+    STATUS retStatus = STATUS_SUCCESS;
+    PSessionLifecycle pLifecycle = (PSessionLifecycle) args;
+    UINT64 now, nextDeadline;
+    UINT32 events;
+
+    CHK(pLifecycle != NULL, STATUS_NULL_ARG);
+
+    while (TRUE) {
+        MUTEX_LOCK(pLifecycle->lock);
+        while (pLifecycle->events == 0 && !ATOMIC_LOAD_BOOL(&pLifecycle->terminate) && (now = GETTIME()) < pLifecycle->nextDeadline) {
+            CVAR_WAIT(pLifecycle->cvar, pLifecycle->lock, pLifecycle->nextDeadline - now);
+        }
+
+        if (ATOMIC_LOAD_BOOL(&pLifecycle->terminate)) {
+            MUTEX_UNLOCK(pLifecycle->lock);
+            break;
+        }
+
+        events = pLifecycle->events;
+        pLifecycle->events = 0;
+        if (events != 0) {
+            pLifecycle->eventPasses++;
+        } else {
+            pLifecycle->deadlinePasses++;
+        }
+        MUTEX_UNLOCK(pLifecycle->lock);
+
+        // Events raised during the pass run another one right after
+        if (STATUS_FAILED(retStatus = sessionServiceHandler(pLifecycle->pGstKvsPlugin, GETTIME(), &nextDeadline))) {
+            DLOGW("Session service pass failed with 0x%08x", retStatus);
+        }
+
+        MUTEX_LOCK(pLifecycle->lock);
+        pLifecycle->nextDeadline = nextDeadline;
+        MUTEX_UNLOCK(pLifecycle->lock);
+    }
+
+CleanUp:
+
+    CHK_LOG_ERR(retStatus);
+    return (PVOID)(ULONG_PTR) retStatus;
+}
+
+VOID reportSessionLifecycleStats(PSessionLifecycle pLifecycle, UINT64 currentTime)
+{
+    MUTEX_LOCK(pLifecycle->lock);
+    if (currentTime >= pLifecycle->lastReportTime + GST_PLUGIN_LIFECYCLE_REPORT_PERIOD) {
+        if (pLifecycle->freedSlots != 0 || pLifecycle->signalingRecreates != 0) {
+            DLOGI("Session lifecycle: %u passes on events, %u on deadlines, %u slots freed avg %" PRIu64 " ms max %" PRIu64
+                  " ms after termination, %u signaling clients recreated avg %" PRIu64 " ms max %" PRIu64 " ms after the error",
+                  pLifecycle->eventPasses, pLifecycle->deadlinePasses, pLifecycle->freedSlots,
+                  pLifecycle->freedSlots == 0 ? 0 : pLifecycle->slotLatencySum / pLifecycle->freedSlots / HUNDREDS_OF_NANOS_IN_A_MILLISECOND,
+                  pLifecycle->maxSlotLatency / HUNDREDS_OF_NANOS_IN_A_MILLISECOND, pLifecycle->signalingRecreates,
+                  pLifecycle->signalingRecreates == 0
+                      ? 0
+                      : pLifecycle->recreateLatencySum / pLifecycle->signalingRecreates / HUNDREDS_OF_NANOS_IN_A_MILLISECOND,
+                  pLifecycle->maxRecreateLatency / HUNDREDS_OF_NANOS_IN_A_MILLISECOND);
+        }
+
+        pLifecycle->lastReportTime = currentTime;
+        pLifecycle->eventPasses = 0;
+        pLifecycle->deadlinePasses = 0;
+        pLifecycle->freedSlots = 0;
+        pLifecycle->slotLatencySum = 0;
+        pLifecycle->maxSlotLatency = 0;
+        pLifecycle->signalingRecreates = 0;
+        pLifecycle->recreateLatencySum = 0;
+        pLifecycle->maxRecreateLatency = 0;
+    }
+    MUTEX_UNLOCK(pLifecycle->lock);
+}
+
+STATUS initSignalingStandby(PGstKvsPlugin pGstKvsPlugin, PSignalingStandby pStandby)
+{
+    STATUS retStatus = STATUS_SUCCESS;
+
+    CHK(pGstKvsPlugin != NULL && pStandby != NULL, STATUS_NULL_ARG);
+
+    MEMSET(pStandby, 0x00, SIZEOF(SignalingStandby));
+    pStandby->pGstKvsPlugin = pGstKvsPlugin;
+    pStandby->signalingHandle = INVALID_SIGNALING_CLIENT_HANDLE_VALUE;
+    pStandby->preparerTid = INVALID_TID_VALUE;
+    pStandby->lastReportTime = GETTIME();
+    ATOMIC_STORE_BOOL(&pStandby->preparing, FALSE);
+
+    // Fetched on the first pass
+    pStandby->nextPrepareTime = 0;
+
+    pStandby->lock = MUTEX_CREATE(FALSE);
+
+CleanUp:
+
+    CHK_LOG_ERR(retStatus);
+    return retStatus;
+}
+
+STATUS freeSignalingStandby(PSignalingStandby pStandby)
+{
+    STATUS retStatus = STATUS_SUCCESS;
+
+    CHK(pStandby != NULL, STATUS_NULL_ARG);
+
+    // A fetch in flight isn't interrupted, it installs its client which is freed right below
+    if (IS_VALID_TID_VALUE(pStandby->preparerTid)) {
+        THREAD_JOIN(pStandby->preparerTid, NULL);
+        pStandby->preparerTid = INVALID_TID_VALUE;
+    }
+
+    if (IS_VALID_SIGNALING_CLIENT_HANDLE(pStandby->signalingHandle)) {
+        freeSignalingClient(&pStandby->signalingHandle);
+    }
+
+    if (IS_VALID_MUTEX_VALUE(pStandby->lock)) {
+        MUTEX_FREE(pStandby->lock);
+        pStandby->lock = INVALID_MUTEX_VALUE;
+    }
+
+CleanUp:
+
+    return retStatus;
+}
+
+// Starts a background fetch when the standby is missing or getting old. Returns when the standby wants to be looked at next.
+UINT64 refreshSignalingStandby(PSignalingStandby pStandby, UINT64 currentTime)
+{
+    STATUS retStatus = STATUS_SUCCESS;
+    UINT64 nextPrepareTime = MAX_UINT64;
+    TID previousTid = INVALID_TID_VALUE;
+    BOOL start = FALSE;
+
+    MUTEX_LOCK(pStandby->lock);
+    if (!ATOMIC_LOAD_BOOL(&pStandby->preparing)) {
+        if (currentTime < pStandby->nextPrepareTime) {
+            nextPrepareTime = pStandby->nextPrepareTime;
+        } else {
+            // The current standby stays usable until the new one replaces it
+            ATOMIC_STORE_BOOL(&pStandby->preparing, TRUE);
+            previousTid = pStandby->preparerTid;
+            pStandby->preparerTid = INVALID_TID_VALUE;
+            start = TRUE;
+        }
+    }
+    MUTEX_UNLOCK(pStandby->lock);
+
+    CHK(start, retStatus);
+
+    // The previous fetch cleared preparing as the last thing under the lock
+    if (IS_VALID_TID_VALUE(previousTid)) {
+        THREAD_JOIN(previousTid, NULL);
+    }
+
+    // Only this thread starts fetches, the tid is written back before the next pass looks at it
+    if (STATUS_FAILED(retStatus = THREAD_CREATE(&pStandby->preparerTid, signalingStandbyRoutine, (PVOID) pStandby))) {
+        DLOGW("Failed to start the standby signaling client fetch with 0x%08x", retStatus);
+        pStandby->preparerTid = INVALID_TID_VALUE;
+        MUTEX_LOCK(pStandby->lock);
+        pStandby->nextPrepareTime = currentTime + GST_PLUGIN_SIGNALING_STANDBY_RETRY_PERIOD;
+        ATOMIC_STORE_BOOL(&pStandby->preparing, FALSE);
+        MUTEX_UNLOCK(pStandby->lock);
+        nextPrepareTime = currentTime + GST_PLUGIN_SIGNALING_STANDBY_RETRY_PERIOD;
+    }
+
+CleanUp:
+
+    return nextPrepareTime;
+}
+
+/*
+ * Creates and fetches a client for the same channel, with the same callbacks. It isn't connected, the channel takes a single
+ * master connection and the SDK only raises errors for connected clients, so the callbacks keep acting on the active one.
+ */
+PVOID signalingStandbyRoutine(PVOID args)
+{
+    STATUS retStatus = STATUS_SUCCESS;
+    PSignalingStandby pStandby = (PSignalingStandby) args;
+    PGstKvsPlugin pGstKvsPlugin;
+    SIGNALING_CLIENT_HANDLE signalingHandle = INVALID_SIGNALING_CLIENT_HANDLE_VALUE, replacedHandle;
+    UINT64 startTime;
+
+    CHK(pStandby != NULL && pStandby->pGstKvsPlugin != NULL, STATUS_NULL_ARG);
+    pGstKvsPlugin = pStandby->pGstKvsPlugin;
+    startTime = GETTIME();
+
+    CHK_STATUS(createSignalingClientSync(&pGstKvsPlugin->kvsContext.signalingClientInfo, &pGstKvsPlugin->kvsContext.channelInfo,
+                                         &pGstKvsPlugin->kvsContext.signalingClientCallbacks, pGstKvsPlugin->kvsContext.pCredentialProvider,
+                                         &signalingHandle));
+    CHK_STATUS(signalingClientFetchSync(signalingHandle));
+
+    DLOGD("Standby signaling client fetched in %" PRIu64 " ms", (GETTIME() - startTime) / HUNDREDS_OF_NANOS_IN_A_MILLISECOND);
+
+CleanUp:
+
+    CHK_LOG_ERR(retStatus);
+
+    if (pStandby != NULL && pStandby->pGstKvsPlugin != NULL) {
+        if (STATUS_FAILED(retStatus) && IS_VALID_SIGNALING_CLIENT_HANDLE(signalingHandle)) {
+            freeSignalingClient(&signalingHandle);
+        }
+
+        // Installed before preparing is cleared so the next pass sees it
+        MUTEX_LOCK(pStandby->lock);
+        replacedHandle = pStandby->signalingHandle;
+        if (IS_VALID_SIGNALING_CLIENT_HANDLE(signalingHandle)) {
+            pStandby->signalingHandle = signalingHandle;
+            pStandby->nextPrepareTime = GETTIME() + GST_PLUGIN_SIGNALING_STANDBY_REFRESH_PERIOD;
+        } else {
+            replacedHandle = INVALID_SIGNALING_CLIENT_HANDLE_VALUE;
+            pStandby->nextPrepareTime = GETTIME() + GST_PLUGIN_SIGNALING_STANDBY_RETRY_PERIOD;
+        }
+        ATOMIC_STORE_BOOL(&pStandby->preparing, FALSE);
+        MUTEX_UNLOCK(pStandby->lock);
+
+        if (IS_VALID_SIGNALING_CLIENT_HANDLE(replacedHandle)) {
+            freeSignalingClient(&replacedHandle);
+        }
+
+        // A failing client may be waiting for this one
+        notifySessionLifecycle(&pStandby->pGstKvsPlugin->sessionLifecycle, GST_PLUGIN_LIFECYCLE_EVENT_SIGNALING);
+    }
+
+    return (PVOID)(ULONG_PTR) retStatus;
+}
+
+// Creates and fetches a new client, swaps it in under the signaling lock and frees the failed one once nothing can pick it up anymore
+STATUS replaceSignalingClient(PGstKvsPlugin pGstKvsPlugin)
+{
+    STATUS retStatus = STATUS_SUCCESS;
+    SIGNALING_CLIENT_HANDLE signalingHandle = INVALID_SIGNALING_CLIENT_HANDLE_VALUE, failedHandle = INVALID_SIGNALING_CLIENT_HANDLE_VALUE;
+
+    CHK(pGstKvsPlugin != NULL, STATUS_NULL_ARG);
+
+    CHK_STATUS(createSignalingClientSync(&pGstKvsPlugin->kvsContext.signalingClientInfo, &pGstKvsPlugin->kvsContext.channelInfo,
+                                         &pGstKvsPlugin->kvsContext.signalingClientCallbacks, pGstKvsPlugin->kvsContext.pCredentialProvider,
+                                         &signalingHandle));
+    CHK_STATUS(signalingClientFetchSync(signalingHandle));
+
+    MUTEX_LOCK(pGstKvsPlugin->signalingLock);
+    failedHandle = pGstKvsPlugin->kvsContext.signalingHandle;
+    pGstKvsPlugin->kvsContext.signalingHandle = signalingHandle;
+    MUTEX_UNLOCK(pGstKvsPlugin->signalingLock);
+
+    signalingHandle = INVALID_SIGNALING_CLIENT_HANDLE_VALUE;
+
+CleanUp:
+
+    CHK_LOG_ERR(retStatus);
+
+    if (IS_VALID_SIGNALING_CLIENT_HANDLE(signalingHandle)) {
+        freeSignalingClient(&signalingHandle);
+    }
+
+    if (IS_VALID_SIGNALING_CLIENT_HANDLE(failedHandle)) {
+        freeSignalingClient(&failedHandle);
+    }
+
+    return retStatus;
+}
+
+/*
+ * Replaces the failed signaling client with the standby. The sessions and their pending queues stay as they are, a negotiation
+ * in flight carries on through the new client as it connects with the same client id.
+ */
+STATUS handOverToStandbySignalingClient(PGstKvsPlugin pGstKvsPlugin)
+{
+    STATUS retStatus = STATUS_SUCCESS;
+    PSignalingStandby pStandby;
+    SIGNALING_CLIENT_HANDLE signalingHandle = INVALID_SIGNALING_CLIENT_HANDLE_VALUE, failedHandle;
+
+    CHK(pGstKvsPlugin != NULL, STATUS_NULL_ARG);
+    pStandby = &pGstKvsPlugin->signalingStandby;
+
+    // The next standby is fetched on the same pass
+    MUTEX_LOCK(pStandby->lock);
+    signalingHandle = pStandby->signalingHandle;
+    pStandby->signalingHandle = INVALID_SIGNALING_CLIENT_HANDLE_VALUE;
+    pStandby->nextPrepareTime = 0;
+    MUTEX_UNLOCK(pStandby->lock);
+
+    CHK(IS_VALID_SIGNALING_CLIENT_HANDLE(signalingHandle), STATUS_INVALID_OPERATION);
+
+    // Answers and candidates go out through the standby from here on, they fail like on the failed client until it connects
+    MUTEX_LOCK(pGstKvsPlugin->signalingLock);
+    failedHandle = pGstKvsPlugin->kvsContext.signalingHandle;
+    pGstKvsPlugin->kvsContext.signalingHandle = signalingHandle;
+    MUTEX_UNLOCK(pGstKvsPlugin->signalingLock);
+
+    // The failed client can still hold the master connection, e.g. after a failed ICE configuration refresh, and would
+    // reconnect and report errors through the shared callbacks. It goes away before the standby takes the channel.
+    if (IS_VALID_SIGNALING_CLIENT_HANDLE(failedHandle)) {
+        freeSignalingClient(&failedHandle);
+    }
+
+    // On failure the standby stays in place and the full recreation replaces it
+    if (ATOMIC_LOAD_BOOL(&pGstKvsPlugin->connectWebRtc)) {
+        CHK_STATUS(signalingClientConnectSync(signalingHandle));
+    }
+
+CleanUp:
+
+    CHK_LOG_ERR(retStatus);
+    return retStatus;
+}
+
+// The outage runs from the error to the recovery, the part before the current report window was counted already
+VOID recordSignalingRecovery(PSignalingStandby pStandby, UINT64 errorTime, BOOL handedOver)
+{
+    UINT64 now = GETTIME(), gap = (errorTime == 0 || now < errorTime) ? 0 : now - errorTime;
+
+    MUTEX_LOCK(pStandby->lock);
+    if (handedOver) {
+        pStandby->handovers++;
+        pStandby->handoverGapSum += gap;
+        pStandby->maxHandoverGap = MAX(pStandby->maxHandoverGap, gap);
+    } else {
+        pStandby->recreations++;
+    }
+
+    if (errorTime != 0 && now > MAX(errorTime, pStandby->lastReportTime)) {
+        pStandby->downtime += now - MAX(errorTime, pStandby->lastReportTime);
+    }
+    MUTEX_UNLOCK(pStandby->lock);
+}
+
+VOID reportSignalingStats(PSignalingStandby pStandby, PSessionLifecycle pLifecycle, UINT64 currentTime)
+{
+    UINT64 window, downtime, errorTime = (UINT64) ATOMIC_LOAD(&pLifecycle->recreateRequestTime);
+
+    MUTEX_LOCK(pStandby->lock);
+    if (currentTime >= pStandby->lastReportTime + GST_PLUGIN_SIGNALING_REPORT_PERIOD) {
+        window = currentTime - pStandby->lastReportTime;
+        downtime = pStandby->downtime;
+
+        // Still down, the rest of the outage goes into the next windows
+        if (errorTime != 0 && currentTime > MAX(errorTime, pStandby->lastReportTime)) {
+            downtime += currentTime - MAX(errorTime, pStandby->lastReportTime);
+        }
+        downtime = MIN(downtime, window);
+
+        if (downtime != 0 || pStandby->handovers != 0 || pStandby->recreations != 0) {
+            DLOGI("Signaling: %.3f%% available, %u handovers to the standby gap avg %" PRIu64 " ms max %" PRIu64 " ms, %u full recreations",
+                  100.0 * (DOUBLE) (window - downtime) / (DOUBLE) window, pStandby->handovers,
+                  pStandby->handovers == 0 ? 0 : pStandby->handoverGapSum / pStandby->handovers / HUNDREDS_OF_NANOS_IN_A_MILLISECOND,
+                  pStandby->maxHandoverGap / HUNDREDS_OF_NANOS_IN_A_MILLISECOND, pStandby->recreations);
+        }
+
+        pStandby->lastReportTime = currentTime;
+        pStandby->handovers = 0;
+        pStandby->handoverGapSum = 0;
+        pStandby->maxHandoverGap = 0;
+        pStandby->recreations = 0;
+        pStandby->downtime = 0;
+    }
+    MUTEX_UNLOCK(pStandby->lock);
+}
+
 STATUS adaptVideoFrameFromAvccToAnnexB(PGstKvsPlugin pGstKvsPlugin, PFrame pFrame, ELEMENTARY_STREAM_NAL_FORMAT nalFormat)
 {
     STATUS retStatus = STATUS_SUCCESS;
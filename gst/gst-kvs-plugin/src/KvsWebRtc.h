@@ -7,6 +7,8 @@
 #define DEFAULT_TRICKLE_ICE_MODE       TRUE
 #define DEFAULT_WEBRTC_CONNECTION_MODE WEBRTC_CONNECTION_MODE_DEFAULT
 #define DEFAULT_WEBRTC_CONNECT         TRUE
+#define DEFAULT_ENDPOINT               ""
+#define DEFAULT_SIGNALING_STANDBY      FALSE
 
 #define GST_PLUGIN_HASH_TABLE_BUCKET_COUNT  50
 #define GST_PLUGIN_HASH_TABLE_BUCKET_LENGTH 2
@@ -15,8 +17,43 @@
 #define GST_PLUGIN_PRE_GENERATE_CERT_PERIOD         (1000 * HUNDREDS_OF_NANOS_IN_A_MILLISECOND)
 #define GST_PLUGIN_PENDING_MESSAGE_CLEANUP_DURATION (20 * HUNDREDS_OF_NANOS_IN_A_SECOND)
 #define GST_PLUGIN_STATS_DURATION                   (60 * HUNDREDS_OF_NANOS_IN_A_SECOND)
-#define GST_PLUGIN_SERVICE_ROUTINE_START            (300 * HUNDREDS_OF_NANOS_IN_A_MILLISECOND)
-#define GST_PLUGIN_SERVICE_ROUTINE_PERIOD           (1000 * HUNDREDS_OF_NANOS_IN_A_MILLISECOND)
+
+// Session lifecycle events, each one runs the service pass right away
+#define GST_PLUGIN_LIFECYCLE_EVENT_SESSION       0x01
+#define GST_PLUGIN_LIFECYCLE_EVENT_SIGNALING     0x02
+#define GST_PLUGIN_LIFECYCLE_EVENT_PENDING_QUEUE 0x04
+// Failed signaling recreation and connection attempts are retried after this
+#define GST_PLUGIN_LIFECYCLE_RETRY_PERIOD (1000 * HUNDREDS_OF_NANOS_IN_A_MILLISECOND)
+// Keeps a deadline that is already due from spinning the worker
+#define GST_PLUGIN_LIFECYCLE_MIN_WAIT      (10 * HUNDREDS_OF_NANOS_IN_A_MILLISECOND)
+#define GST_PLUGIN_LIFECYCLE_REPORT_PERIOD (60 * HUNDREDS_OF_NANOS_IN_A_SECOND)
+
+// The standby is rebuilt ahead of the 5 minute lifetime of the TURN credentials in its ICE configuration
+#define GST_PLUGIN_SIGNALING_STANDBY_REFRESH_PERIOD (4 * HUNDREDS_OF_NANOS_IN_A_MINUTE)
+#define GST_PLUGIN_SIGNALING_STANDBY_RETRY_PERIOD   (5 * HUNDREDS_OF_NANOS_IN_A_SECOND)
+#define GST_PLUGIN_SIGNALING_REPORT_PERIOD          (60 * HUNDREDS_OF_NANOS_IN_A_SECOND)
+
+// Send lanes, the depths are in frames
+#define GST_PLUGIN_AUDIO_LANE_MAX_DEPTH       50
+#define GST_PLUGIN_VIDEO_LANE_MAX_DEPTH       60
+#define GST_PLUGIN_SEND_LANE_YIELD_TIMEOUT    (10 * HUNDREDS_OF_NANOS_IN_A_MILLISECOND)
+#define GST_PLUGIN_SEND_LANE_REPORT_PERIOD    (10 * HUNDREDS_OF_NANOS_IN_A_SECOND)
+
+// Video is held to this part of the bandwidth estimation, the rest is left to audio and retransmissions
+#define GST_PLUGIN_RATE_CONTROL_HEADROOM 0.9
+// Budget a session can save up while it sends less than its estimate
+#define GST_PLUGIN_RATE_CONTROL_WINDOW (500 * HUNDREDS_OF_NANOS_IN_A_MILLISECOND)
+
+// Sessions waiting to be freed. A mass disconnect fits, the rest stays terminated in the session list until there is room.
+#define GST_PLUGIN_SESSION_REAPER_MAX_DEPTH     DEFAULT_MAX_CONCURRENT_WEBRTC_STREAMING_SESSION
+#define GST_PLUGIN_SESSION_REAPER_REPORT_PERIOD (60 * HUNDREDS_OF_NANOS_IN_A_SECOND)
+
+// A lost connection is kept this long for the viewer to restart ICE on it, after that it needs a new session
+#define GST_PLUGIN_ICE_DISCONNECT_GRACE_PERIOD (10 * HUNDREDS_OF_NANOS_IN_A_SECOND)
+#define GST_PLUGIN_RECONNECT_REPORT_PERIOD     (60 * HUNDREDS_OF_NANOS_IN_A_SECOND)
+// "a=fingerprint:" value, the hash name and up to SHA-512 in hex with colons
+#define GST_PLUGIN_MAX_FINGERPRINT_LEN 200
+#define GST_PLUGIN_SDP_FINGERPRINT     "a=fingerprint:"
 
 // Default opus frame duration
 #define GST_PLUGIN_DEFAULT_FRAME_DURATION (20 * HUNDREDS_OF_NANOS_IN_A_MILLISECOND)
@@ -53,8 +90,7 @@ STATUS freeMessageQueue(PPendingMessageQueue);
 STATUS gatherIceServerStats(PWebRtcStreamingSession);
 STATUS freeWebRtcStreamingSession(PWebRtcStreamingSession*);
 STATUS streamingSessionOnShutdown(PWebRtcStreamingSession, UINT64, StreamSessionShutdownCallback);
-STATUS pregenerateCertTimerCallback(UINT32, UINT64, UINT64);
-STATUS removeExpiredMessageQueues(PStackQueue);
+STATUS removeExpiredMessageQueues(PStackQueue, PUINT64);
 STATUS getPendingMessageQueueForHash(PStackQueue, UINT64, BOOL, PPendingMessageQueue*);
 STATUS createWebRtcStreamingSession(PGstKvsPlugin, PCHAR, BOOL, PWebRtcStreamingSession*);
 STATUS initializePeerConnection(PGstKvsPlugin, PRtcPeerConnection*);
@@ -68,14 +104,45 @@ STATUS submitPendingIceCandidate(PPendingMessageQueue, PWebRtcStreamingSession);
 STATUS logSelectedIceCandidatesInformation(PWebRtcStreamingSession);
 STATUS handleRemoteCandidate(PWebRtcStreamingSession, PSignalingMessage);
 VOID sampleBandwidthEstimationHandler(UINT64, DOUBLE);
+BOOL admitVideoFrame(PWebRtcStreamingSession, PFrame, BOOL, UINT64);
 STATUS handleOffer(PGstKvsPlugin, PWebRtcStreamingSession, PSignalingMessage);
+STATUS handleRestartOffer(PGstKvsPlugin, PWebRtcStreamingSession, PSignalingMessage, PBOOL);
+STATUS answerOffer(PWebRtcStreamingSession, PRtcSessionDescriptionInit);
+VOID getSdpFingerprint(PCHAR, PCHAR);
+VOID recordSessionConnected(PWebRtcStreamingSession);
 STATUS handleAnswer(PGstKvsPlugin, PWebRtcStreamingSession, PSignalingMessage);
 STATUS getIceCandidatePairStatsCallback(UINT32, UINT64, UINT64);
 PVOID receiveGstreamerAudioVideo(PVOID);
 VOID onGstAudioFrameReady(UINT64, PFrame);
 VOID onSampleStreamingSessionShutdown(UINT64, PWebRtcStreamingSession);
-STATUS sessionServiceHandler(UINT32, UINT64, UINT64);
+STATUS sessionServiceHandler(PGstKvsPlugin, UINT64, PUINT64);
+BOOL terminateStreamingSession(PWebRtcStreamingSession);
 STATUS putFrameToWebRtcPeers(PGstKvsPlugin, PFrame, ELEMENTARY_STREAM_NAL_FORMAT);
+STATUS initSendLane(PGstKvsPlugin, PSendLane, PCHAR, UINT64, UINT32, BOOL, PSendLane);
+STATUS freeSendLane(PSendLane);
+PVOID sendLaneRoutine(PVOID);
+STATUS writeFrameToWebRtcPeers(PSendLane, PQueuedFrame);
+VOID reportSendLaneStats(PSendLane, UINT64);
+VOID reportReconnectStats(PGstKvsPlugin, UINT64);
+STATUS initSessionReaper(PGstKvsPlugin, PSessionReaper);
+STATUS freeSessionReaper(PSessionReaper);
+STATUS reapStreamingSession(PSessionReaper, PWebRtcStreamingSession);
+PVOID sessionReaperRoutine(PVOID);
+VOID reportSessionReaperStats(PSessionReaper, UINT64);
+STATUS initSessionLifecycle(PGstKvsPlugin, PSessionLifecycle);
+STATUS stopSessionLifecycle(PSessionLifecycle);
+STATUS freeSessionLifecycle(PSessionLifecycle);
+VOID notifySessionLifecycle(PSessionLifecycle, UINT32);
+PVOID sessionLifecycleRoutine(PVOID);
+VOID reportSessionLifecycleStats(PSessionLifecycle, UINT64);
+STATUS initSignalingStandby(PGstKvsPlugin, PSignalingStandby);
+STATUS freeSignalingStandby(PSignalingStandby);
+UINT64 refreshSignalingStandby(PSignalingStandby, UINT64);
+PVOID signalingStandbyRoutine(PVOID);
+STATUS replaceSignalingClient(PGstKvsPlugin);
+STATUS handOverToStandbySignalingClient(PGstKvsPlugin);
+VOID recordSignalingRecovery(PSignalingStandby, UINT64, BOOL);
+VOID reportSignalingStats(PSignalingStandby, PSessionLifecycle, UINT64);
 STATUS adaptVideoFrameFromAvccToAnnexB(PGstKvsPlugin, PFrame, ELEMENTARY_STREAM_NAL_FORMAT);
 PVOID checkNewRecordingRoutine(PVOID);
 
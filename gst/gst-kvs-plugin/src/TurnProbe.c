@@ -0,0 +1,318 @@
+#define LOG_CLASS "TurnProbe"
+#include "GstPlugin.h"
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <poll.h>
+#include <unistd.h>
+
+// Every TURN server signaling returns gets an unauthenticated Allocate request over UDP, and the time until it answers
+// (normally with the 401 challenge) is its allocation RTT. That is the first round trip of every real allocation, so
+// it ranks the servers the way relayed sessions see them. The servers are probed in parallel from a background thread
+// and the results are kept process-wide for GST_PLUGIN_TURN_PROBE_RESULT_TTL, so refreshed credentials for the same
+// servers, or other elements using them, don't probe again.
+
+// "turn:host:port?transport=udp" to host and port. Only plain TURN URIs that allow UDP can be probed.
+static BOOL parseTurnUri(PCHAR pUri, PCHAR pHost, PCHAR pPort, PBOOL pUdp)
+{
+    PCHAR pStart, pEnd, pColon = NULL, pCur;
+    UINT32 hostLen;
+
+    if (NULL == (pStart = STRCHR(pUri, ':'))) {
+        return FALSE;
+    }
+
+    *pUdp = (pStart - pUri) == 4 && 0 == STRNCMP(pUri, "turn", 4);
+    pStart++;
+
+    if (NULL != (pEnd = STRCHR(pStart, '?'))) {
+        if (NULL != STRSTR(pEnd, "transport=tcp")) {
+            *pUdp = FALSE;
+        }
+    } else {
+        pEnd = pStart + STRLEN(pStart);
+    }
+
+    for (pCur = pStart; pCur < pEnd; pCur++) {
+        if (*pCur == ':') {
+            pColon = pCur;
+        }
+    }
+
+    hostLen = (UINT32) ((pColon != NULL ? pColon : pEnd) - pStart);
+    if (hostLen == 0 || hostLen > MAX_ICE_CONFIG_URI_LEN) {
+        return FALSE;
+    }
+
+    STRNCPY(pHost, pStart, hostLen);
+    pHost[hostLen] = '\0';
+
+    if (pColon != NULL && (UINT32) (pEnd - pColon - 1) <= GST_PLUGIN_TURN_PROBE_MAX_PORT_LEN) {
+        STRNCPY(pPort, pColon + 1, pEnd - pColon - 1);
+        pPort[pEnd - pColon - 1] = '\0';
+    } else {
+        STRCPY(pPort, GST_PLUGIN_TURN_PROBE_DEFAULT_PORT);
+    }
+
+    return TRUE;
+}
+
+// Must be called under the probe lock
+static PTurnProbeResult findTurnProbeResult(PKvsSharedContext pSharedContext, PCHAR pHost)
+{
+    UINT32 i;
+
+    for (i = 0; i < pSharedContext->turnProbeResultCount; i++) {
+        if (0 == STRCMP(pSharedContext->turnProbeResults[i].host, pHost)) {
+            return &pSharedContext->turnProbeResults[i];
+        }
+    }
+
+    return NULL;
+}
+
+// Starts probing the TURN servers of the signaling client that weren't probed recently. A probe in progress
+// covers them or the next peer connection submits them again.
+STATUS submitTurnProbe(PKvsSharedContext pSharedContext, SIGNALING_CLIENT_HANDLE signalingHandle)
+{
+    STATUS retStatus = STATUS_SUCCESS;
+    UINT32 i, j, k, iceConfigCount, targetCount = 0;
+    PIceConfigInfo pIceConfigInfo;
+    PTurnProbeResult pResult;
+    PTurnProbeTarget pTarget;
+    CHAR host[MAX_ICE_CONFIG_URI_LEN + 1], port[GST_PLUGIN_TURN_PROBE_MAX_PORT_LEN + 1];
+    BOOL udp, locked = FALSE;
+    UINT64 now = GETTIME();
+
+    CHK(pSharedContext != NULL, STATUS_NULL_ARG);
+    CHK(!ATOMIC_LOAD_BOOL(&pSharedContext->turnProbeRunning), retStatus);
+
+    CHK_STATUS(signalingClientGetIceConfigInfoCount(signalingHandle, &iceConfigCount));
+
+    MUTEX_LOCK(pSharedContext->turnProbeLock);
+    locked = TRUE;
+
+    // The previous probe is done, it clears the flag as the very last thing
+    CHK(!ATOMIC_EXCHANGE_BOOL(&pSharedContext->turnProbeRunning, TRUE), retStatus);
+    if (IS_VALID_TID_VALUE(pSharedContext->turnProbeTid)) {
+        THREAD_JOIN(pSharedContext->turnProbeTid, NULL);
+        pSharedContext->turnProbeTid = INVALID_TID_VALUE;
+    }
+
+    for (i = 0; i < MIN(iceConfigCount, MAX_ICE_CONFIG_COUNT); i++) {
+        CHK_STATUS(signalingClientGetIceConfigInfo(signalingHandle, i, &pIceConfigInfo));
+        for (j = 0; j < pIceConfigInfo->uriCount; j++) {
+            if (!parseTurnUri(pIceConfigInfo->uris[j], host, port, &udp) || !udp) {
+                continue;
+            }
+
+            if (NULL != (pResult = findTurnProbeResult(pSharedContext, host)) && pResult->expiration > now) {
+                break;
+            }
+
+            for (k = 0; k < targetCount && 0 != STRCMP(pSharedContext->turnProbeTargets[k].host, host); k++) {
+            }
+            if (k != targetCount) {
+                break;
+            }
+
+            pTarget = &pSharedContext->turnProbeTargets[targetCount++];
+            MEMSET(pTarget, 0x00, SIZEOF(TurnProbeTarget));
+            STRCPY(pTarget->host, host);
+            STRCPY(pTarget->port, port);
+            pTarget->sock = -1;
+            pTarget->rtt = MAX_UINT64;
+
+            // One UDP URI per server is enough
+            break;
+        }
+    }
+
+    pSharedContext->turnProbeTargetCount = targetCount;
+    if (targetCount == 0) {
+        ATOMIC_STORE_BOOL(&pSharedContext->turnProbeRunning, FALSE);
+    } else {
+        CHK_STATUS(THREAD_CREATE(&pSharedContext->turnProbeTid, turnProbeRoutine, (PVOID) pSharedContext));
+    }
+
+CleanUp:
+
+    if (STATUS_FAILED(retStatus) && locked) {
+        ATOMIC_STORE_BOOL(&pSharedContext->turnProbeRunning, FALSE);
+    }
+
+    if (locked) {
+        MUTEX_UNLOCK(pSharedContext->turnProbeLock);
+    }
+
+    return retStatus;
+}
+
+// Round trip of the server in the URI, MAX_UINT64 when it didn't answer or wasn't probed yet
+STATUS getTurnProbeRtt(PKvsSharedContext pSharedContext, PCHAR pUri, PUINT64 pRtt)
+{
+    STATUS retStatus = STATUS_SUCCESS;
+    PTurnProbeResult pResult;
+    CHAR host[MAX_ICE_CONFIG_URI_LEN + 1], port[GST_PLUGIN_TURN_PROBE_MAX_PORT_LEN + 1];
+    BOOL udp;
+
+    CHK(pSharedContext != NULL && pUri != NULL && pRtt != NULL, STATUS_NULL_ARG);
+    *pRtt = MAX_UINT64;
+    CHK(parseTurnUri(pUri, host, port, &udp), retStatus);
+
+    // An expired result still beats no result until the server has been probed again
+    MUTEX_LOCK(pSharedContext->turnProbeLock);
+    if (NULL != (pResult = findTurnProbeResult(pSharedContext, host))) {
+        *pRtt = pResult->rtt;
+    }
+    MUTEX_UNLOCK(pSharedContext->turnProbeLock);
+
+CleanUp:
+
+    return retStatus;
+}
+
+STATUS freeTurnProbe(PKvsSharedContext pSharedContext)
+{
+    STATUS retStatus = STATUS_SUCCESS;
+
+    CHK(pSharedContext != NULL, STATUS_NULL_ARG);
+
+    // The probe gives up on its own after GST_PLUGIN_TURN_PROBE_TIMEOUT
+    if (IS_VALID_TID_VALUE(pSharedContext->turnProbeTid)) {
+        THREAD_JOIN(pSharedContext->turnProbeTid, NULL);
+        pSharedContext->turnProbeTid = INVALID_TID_VALUE;
+    }
+
+CleanUp:
+
+    return retStatus;
+}
+
+PVOID turnProbeRoutine(PVOID args)
+{
+    PKvsSharedContext pSharedContext = (PKvsSharedContext) args;
+    PTurnProbeTarget pTarget;
+    PTurnProbeResult pResult;
+    struct addrinfo hints, *pAddress = NULL;
+    struct pollfd fds[MAX_ICE_CONFIG_COUNT];
+    BYTE request[TURN_PROBE_STUN_HEADER_LEN + 8], response[GST_PLUGIN_TURN_PROBE_BUFFER_SIZE];
+    UINT16 words[4];
+    UINT32 cookie, i, j, targetCount = pSharedContext->turnProbeTargetCount, pending = 0;
+    UINT64 deadline, now;
+    INT32 received;
+
+    MEMSET(&hints, 0x00, SIZEOF(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+
+    // Connected sockets only get datagrams from their own server
+    for (i = 0; i < targetCount; i++) {
+        pTarget = &pSharedContext->turnProbeTargets[i];
+        if (0 != getaddrinfo(pTarget->host, pTarget->port, &hints, &pAddress)) {
+            DLOGW("Failed to resolve TURN server %s", pTarget->host);
+        } else {
+            pTarget->sock = socket(pAddress->ai_family, pAddress->ai_socktype, pAddress->ai_protocol);
+            if (pTarget->sock >= 0 && 0 != connect(pTarget->sock, pAddress->ai_addr, pAddress->ai_addrlen)) {
+                close(pTarget->sock);
+                pTarget->sock = -1;
+            }
+            freeaddrinfo(pAddress);
+        }
+
+        for (j = 0; j < TURN_PROBE_TRANSACTION_ID_LEN; j++) {
+            pTarget->transactionId[j] = (BYTE) RAND();
+        }
+
+        fds[i].fd = pTarget->sock;
+        fds[i].events = POLLIN;
+        fds[i].revents = 0;
+        pending += pTarget->sock >= 0 ? 1 : 0;
+    }
+
+    // Header, then REQUESTED-TRANSPORT with UDP. The transaction id goes in per server.
+    MEMSET(request, 0x00, SIZEOF(request));
+    words[0] = htons(TURN_PROBE_ALLOCATE_REQUEST);
+    words[1] = htons(8);
+    words[2] = htons(TURN_PROBE_REQUESTED_TRANSPORT);
+    words[3] = htons(4);
+    cookie = htonl(TURN_PROBE_STUN_MAGIC_COOKIE);
+    MEMCPY(request, &words[0], 2 * SIZEOF(UINT16));
+    MEMCPY(request + 4, &cookie, SIZEOF(UINT32));
+    MEMCPY(request + TURN_PROBE_STUN_HEADER_LEN, &words[2], 2 * SIZEOF(UINT16));
+    request[TURN_PROBE_STUN_HEADER_LEN + 4] = TURN_PROBE_REQUESTED_TRANSPORT_UDP;
+
+    // Every server is probed at once, a lost request or answer is covered by sending again
+    deadline = GETTIME() + GST_PLUGIN_TURN_PROBE_TIMEOUT;
+    while (pending != 0 && (now = GETTIME()) < deadline) {
+        for (i = 0; i < targetCount; i++) {
+            pTarget = &pSharedContext->turnProbeTargets[i];
+            if (pTarget->sock >= 0 && pTarget->rtt == MAX_UINT64 && now >= pTarget->lastSendTime + GST_PLUGIN_TURN_PROBE_RETRANSMIT) {
+                MEMCPY(request + 8, pTarget->transactionId, TURN_PROBE_TRANSACTION_ID_LEN);
+                send(pTarget->sock, request, SIZEOF(request), 0);
+                pTarget->firstSendTime = pTarget->lastSendTime == 0 ? now : pTarget->firstSendTime;
+                pTarget->lastSendTime = now;
+            }
+        }
+
+        if (poll(fds, targetCount, (INT32) (GST_PLUGIN_TURN_PROBE_RETRANSMIT / HUNDREDS_OF_NANOS_IN_A_MILLISECOND)) <= 0) {
+            continue;
+        }
+
+        now = GETTIME();
+        for (i = 0; i < targetCount; i++) {
+            pTarget = &pSharedContext->turnProbeTargets[i];
+            if ((fds[i].revents & POLLIN) == 0) {
+                continue;
+            }
+
+            // Any answer to our transaction counts, it is the 401 challenge unless the server allows anonymous relays
+            received = recv(pTarget->sock, response, SIZEOF(response), 0);
+            if (received >= TURN_PROBE_STUN_HEADER_LEN && pTarget->rtt == MAX_UINT64 && 0 == MEMCMP(response + 4, &cookie, SIZEOF(UINT32)) &&
+                0 == MEMCMP(response + 8, pTarget->transactionId, TURN_PROBE_TRANSACTION_ID_LEN)) {
+                pTarget->rtt = now - pTarget->firstSendTime;
+                pending--;
+            }
+        }
+    }
+
+    MUTEX_LOCK(pSharedContext->turnProbeLock);
+    for (i = 0; i < targetCount; i++) {
+        pTarget = &pSharedContext->turnProbeTargets[i];
+        if (pTarget->sock >= 0) {
+            close(pTarget->sock);
+        }
+
+        if (pTarget->rtt == MAX_UINT64) {
+            DLOGW("TURN server %s didn't answer the allocation probe", pTarget->host);
+        } else {
+            DLOGI("TURN server %s answered the allocation probe in %" PRIu64 " ms", pTarget->host, pTarget->rtt / HUNDREDS_OF_NANOS_IN_A_MILLISECOND);
+        }
+
+        // A full table gives up the entry that expires first
+        if (NULL == (pResult = findTurnProbeResult(pSharedContext, pTarget->host))) {
+            if (pSharedContext->turnProbeResultCount < GST_PLUGIN_MAX_TURN_PROBE_RESULTS) {
+                pResult = &pSharedContext->turnProbeResults[pSharedContext->turnProbeResultCount++];
+            } else {
+                pResult = &pSharedContext->turnProbeResults[0];
+                for (j = 1; j < GST_PLUGIN_MAX_TURN_PROBE_RESULTS; j++) {
+                    if (pSharedContext->turnProbeResults[j].expiration < pResult->expiration) {
+                        pResult = &pSharedContext->turnProbeResults[j];
+                    }
+                }
+            }
+
+            STRCPY(pResult->host, pTarget->host);
+        }
+
+        pResult->rtt = pTarget->rtt;
+        pResult->expiration = GETTIME() + GST_PLUGIN_TURN_PROBE_RESULT_TTL;
+    }
+    MUTEX_UNLOCK(pSharedContext->turnProbeLock);
+
+    ATOMIC_STORE_BOOL(&pSharedContext->turnProbeRunning, FALSE);
+
+    return NULL;
+}
@@ -0,0 +1,28 @@
+#ifndef __KVS_TURN_PROBE_H__
+#define __KVS_TURN_PROBE_H__
+
+// TURN servers a session gets, the ones that answered the probe fastest
+#define GST_PLUGIN_MAX_TURN_SERVERS 1
+
+#define GST_PLUGIN_MAX_TURN_PROBE_RESULTS  32
+#define GST_PLUGIN_TURN_PROBE_TIMEOUT      (1 * HUNDREDS_OF_NANOS_IN_A_SECOND)
+#define GST_PLUGIN_TURN_PROBE_RETRANSMIT   (250 * HUNDREDS_OF_NANOS_IN_A_MILLISECOND)
+#define GST_PLUGIN_TURN_PROBE_RESULT_TTL   (5 * HUNDREDS_OF_NANOS_IN_A_MINUTE)
+#define GST_PLUGIN_TURN_PROBE_DEFAULT_PORT "3478"
+#define GST_PLUGIN_TURN_PROBE_MAX_PORT_LEN 5
+#define GST_PLUGIN_TURN_PROBE_BUFFER_SIZE  1500
+
+// Unauthenticated STUN Allocate request for a UDP relay, RFC 5766
+#define TURN_PROBE_STUN_HEADER_LEN         20
+#define TURN_PROBE_TRANSACTION_ID_LEN      12
+#define TURN_PROBE_STUN_MAGIC_COOKIE       0x2112A442
+#define TURN_PROBE_ALLOCATE_REQUEST        0x0003
+#define TURN_PROBE_REQUESTED_TRANSPORT     0x0019
+#define TURN_PROBE_REQUESTED_TRANSPORT_UDP 17
+
+STATUS submitTurnProbe(PKvsSharedContext, SIGNALING_CLIENT_HANDLE);
+STATUS getTurnProbeRtt(PKvsSharedContext, PCHAR, PUINT64);
+STATUS freeTurnProbe(PKvsSharedContext);
+PVOID turnProbeRoutine(PVOID);
+
+#endif //__KVS_TURN_PROBE_H__